@@ -127,6 +127,10 @@ module PileUpMerger PileUpMerger {
  set MeanPileUp 50
  # spread in the beam direction in m (assumes gaussian) ; 
  set ZVertexSpread 0.053
+ # read the pile-up of the next events in a background thread <0 reads it in Process>
+ # set PrefetchDepth 4
+ # seed of the random numbers of the background thread <0 derives it from RandomSeed and the module name>
+ # set PrefetchSeed 0
 }
 
 ##################
@@ -2328,35 +2332,53 @@ module PileUpJetID PileUpJetID {
  
   add Cones  0.1 0.2 0.3 0.4 0.5 0.6 0.7
 
-  add Pt010_Tight_betaStar   0.15 0.15 999. 999.
-  add Pt1020_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt2030_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt3050_Tight_betaStar  0.15 0.15 999. 999.
-
-  add Pt010_Tight_RMS  0.06 0.07 0.04 0.05 
-  add Pt1020_Tight_RMS 0.06 0.07 0.04 0.05
-  add Pt2030_Tight_RMS 0.05 0.07 0.03 0.045
-  add Pt3050_Tight_RMS 0.05 0.06 0.03 0.04
-
-  add Pt010_Medium_betaStar  0.2 0.3 999. 999.
-  add Pt1020_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt2030_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt3050_Medium_betaStar 0.2 0.3 999. 999.
-
-  add Pt010_Medium_RMS    0.06 0.03 0.03 0.04
-  add Pt1020_Medium_RMS   0.06 0.03 0.03 0.04
-  add Pt2030_Medium_RMS   0.06 0.03 0.03 0.04
-  add Pt3050_Medium_RMS   0.06 0.03 0.03 0.04
-
-  add Pt010_Loose_betaStar  0.2 0.3 999. 999
-  add Pt1020_Loose_betaStar 0.2 0.3 999. 999
-  add Pt2030_Loose_betaStar 0.2 0.3 999. 999
-  add Pt3050_Loose_betaStar 0.2 0.3 999. 999
-
-  add Pt010_Loose_RMS   0.06 0.05 0.05 0.07
-  add Pt1020_Loose_RMS  0.06 0.05 0.05 0.07
-  add Pt2030_Loose_RMS  0.06 0.05 0.05 0.055
-  add Pt3050_Loose_RMS  0.06 0.05 0.05 0.055
+  # cut based ID: lower edges of the pt and |eta| bins
+  add CutPTBins  0.0 10.0 20.0 30.0
+  add CutEtaBins 0.0 2.5 2.75 3.0
+
+  # cuts for each working point and variable, one row of |eta| bins per pt bin,
+  # working points set the bits of the flag in the order they first appear
+  add Cuts {Tight betaStar} {
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+  }
+
+  add Cuts {Tight RMS} {
+    0.06 0.07 0.04 0.05
+    0.06 0.07 0.04 0.05
+    0.05 0.07 0.03 0.045
+    0.05 0.06 0.03 0.04
+  }
+
+  add Cuts {Medium betaStar} {
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+  }
+
+  add Cuts {Medium RMS} {
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+  }
+
+  add Cuts {Loose betaStar} {
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+  }
+
+  add Cuts {Loose RMS} {
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.055
+    0.06 0.05 0.05 0.055
+  }
   
 }
 
@@ -2374,35 +2396,53 @@ module PileUpJetID PuppiPileUpJetID {
  
   add Cones  0.1 0.2 0.3 0.4 0.5 0.6 0.7
 
-  add Pt010_Tight_betaStar   0.15 0.15 999. 999.
-  add Pt1020_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt2030_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt3050_Tight_betaStar  0.15 0.15 999. 999.
-
-  add Pt010_Tight_RMS  0.06 0.07 0.04 0.04 
-  add Pt1020_Tight_RMS 0.06 0.07 0.04 0.04
-  add Pt2030_Tight_RMS 0.05 0.07 0.03 0.04
-  add Pt3050_Tight_RMS 0.05 0.06 0.03 0.04
-
-  add Pt010_Medium_betaStar  0.2 0.3 999. 999.
-  add Pt1020_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt2030_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt3050_Medium_betaStar 0.2 0.3 999. 999.
-
-  add Pt010_Medium_RMS    0.06 0.03 0.03 0.05
-  add Pt1020_Medium_RMS   0.06 0.03 0.03 0.05
-  add Pt2030_Medium_RMS   0.06 0.03 0.03 0.045
-  add Pt3050_Medium_RMS   0.06 0.03 0.03 0.04
-
-  add Pt010_Loose_betaStar  0.2 0.3 999. 999
-  add Pt1020_Loose_betaStar 0.2 0.3 999. 999
-  add Pt2030_Loose_betaStar 0.2 0.3 999. 999
-  add Pt3050_Loose_betaStar 0.2 0.3 999. 999
-
-  add Pt010_Loose_RMS   0.06 0.05 0.05 0.07
-  add Pt1020_Loose_RMS  0.06 0.05 0.05 0.07
-  add Pt2030_Loose_RMS  0.06 0.05 0.05 0.055
-  add Pt3050_Loose_RMS  0.06 0.05 0.05 0.055
+  # cut based ID: lower edges of the pt and |eta| bins
+  add CutPTBins  0.0 10.0 20.0 30.0
+  add CutEtaBins 0.0 2.5 2.75 3.0
+
+  # cuts for each working point and variable, one row of |eta| bins per pt bin,
+  # working points set the bits of the flag in the order they first appear
+  add Cuts {Tight betaStar} {
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+  }
+
+  add Cuts {Tight RMS} {
+    0.06 0.07 0.04 0.04
+    0.06 0.07 0.04 0.04
+    0.05 0.07 0.03 0.04
+    0.05 0.06 0.03 0.04
+  }
+
+  add Cuts {Medium betaStar} {
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+  }
+
+  add Cuts {Medium RMS} {
+    0.06 0.03 0.03 0.05
+    0.06 0.03 0.03 0.05
+    0.06 0.03 0.03 0.045
+    0.06 0.03 0.03 0.04
+  }
+
+  add Cuts {Loose betaStar} {
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+  }
+
+  add Cuts {Loose RMS} {
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.055
+    0.06 0.05 0.05 0.055
+  }
   
 }
 
@@ -2456,6 +2496,16 @@ module ConstituentFilter ConstituentFilterPUPPI {
 module TreeWriter TreeWriter {
   ## branch notation : <particle collection> <branch name> <type of object in classes/DelphesClass.h<
 
+  ## output settings of single branches: CompressionAlgorithm, CompressionLevel, BasketSize and SplitLevel;
+  ## settings not given here are taken from the card, for example "set CompressionLevel 4";
+  ## "set ImplicitMT 4" compresses the baskets on 4 threads
+  # add BranchSettings GenParticles {BasketSize 256000 CompressionAlgorithm 2 CompressionLevel 5}
+
+  ## fields written by single branches: keep or drop, followed by field names or the profiles
+  ## minimal, btag, area, substructure, pileupid, fractions and references
+  # add BranchFields JetPUID {keep minimal btag area pileupid}
+  # add BranchFields Jet {drop substructure fractions}
+
   ## input status 1 particle from Pythia8
   add Branch Delphes/stableParticles GenParticles GenParticle
   ## input partons
@@ -2531,6 +2581,20 @@ module TreeWriter TreeWriter {
   set fOffsetFromModifyBeamSpot 0 
 }
 
+#####################################################
+# Flat columns with index links, without TRef, to use
+# in the ExecutionPath in place of TreeWriter
+#####################################################
+
+#module FlatTreeWriter FlatTreeWriter {
+#  add Branch Delphes/stableParticles GenParticles GenParticle
+#  add Branch PileUpJetID/jets JetPUID Jet
+#  add Branch MuonIsolation/muons Muon Muon
+#  add BranchFields JetPUID {keep minimal btag references}
+#  ## structure of the columns for compiled analyses
+#  set HeaderFile DelphesFlat.h
+#}
+
 
 #####################################################
 # Find uniquely identified photons/electrons/tau/jets
@@ -1982,35 +1982,53 @@ module PileUpJetID PileUpJetID {
  
   add Cones  0.1 0.2 0.3 0.4 0.5 0.6 0.7
 
-  add Pt010_Tight_betaStar   0.15 0.15 999. 999.
-  add Pt1020_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt2030_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt3050_Tight_betaStar  0.15 0.15 999. 999.
-
-  add Pt010_Tight_RMS  0.06 0.07 0.04 0.05 
-  add Pt1020_Tight_RMS 0.06 0.07 0.04 0.05
-  add Pt2030_Tight_RMS 0.05 0.07 0.03 0.045
-  add Pt3050_Tight_RMS 0.05 0.06 0.03 0.04
-
-  add Pt010_Medium_betaStar  0.2 0.3 999. 999.
-  add Pt1020_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt2030_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt3050_Medium_betaStar 0.2 0.3 999. 999.
-
-  add Pt010_Medium_RMS    0.06 0.03 0.03 0.04
-  add Pt1020_Medium_RMS   0.06 0.03 0.03 0.04
-  add Pt2030_Medium_RMS   0.06 0.03 0.03 0.04
-  add Pt3050_Medium_RMS   0.06 0.03 0.03 0.04
-
-  add Pt010_Loose_betaStar  0.2 0.3 999. 999
-  add Pt1020_Loose_betaStar 0.2 0.3 999. 999
-  add Pt2030_Loose_betaStar 0.2 0.3 999. 999
-  add Pt3050_Loose_betaStar 0.2 0.3 999. 999
-
-  add Pt010_Loose_RMS   0.06 0.05 0.05 0.07
-  add Pt1020_Loose_RMS  0.06 0.05 0.05 0.07
-  add Pt2030_Loose_RMS  0.06 0.05 0.05 0.055
-  add Pt3050_Loose_RMS  0.06 0.05 0.05 0.055
+  # cut based ID: lower edges of the pt and |eta| bins
+  add CutPTBins  0.0 10.0 20.0 30.0
+  add CutEtaBins 0.0 2.5 2.75 3.0
+
+  # cuts for each working point and variable, one row of |eta| bins per pt bin,
+  # working points set the bits of the flag in the order they first appear
+  add Cuts {Tight betaStar} {
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+  }
+
+  add Cuts {Tight RMS} {
+    0.06 0.07 0.04 0.05
+    0.06 0.07 0.04 0.05
+    0.05 0.07 0.03 0.045
+    0.05 0.06 0.03 0.04
+  }
+
+  add Cuts {Medium betaStar} {
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+  }
+
+  add Cuts {Medium RMS} {
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+    0.06 0.03 0.03 0.04
+  }
+
+  add Cuts {Loose betaStar} {
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+  }
+
+  add Cuts {Loose RMS} {
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.055
+    0.06 0.05 0.05 0.055
+  }
   
 }
 
@@ -2028,35 +2046,53 @@ module PileUpJetID PuppiPileUpJetID {
  
   add Cones  0.1 0.2 0.3 0.4 0.5 0.6 0.7
 
-  add Pt010_Tight_betaStar   0.15 0.15 999. 999.
-  add Pt1020_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt2030_Tight_betaStar  0.15 0.15 999. 999.
-  add Pt3050_Tight_betaStar  0.15 0.15 999. 999.
-
-  add Pt010_Tight_RMS  0.06 0.07 0.04 0.04 
-  add Pt1020_Tight_RMS 0.06 0.07 0.04 0.04
-  add Pt2030_Tight_RMS 0.05 0.07 0.03 0.04
-  add Pt3050_Tight_RMS 0.05 0.06 0.03 0.04
-
-  add Pt010_Medium_betaStar  0.2 0.3 999. 999.
-  add Pt1020_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt2030_Medium_betaStar 0.2 0.3 999. 999.
-  add Pt3050_Medium_betaStar 0.2 0.3 999. 999.
-
-  add Pt010_Medium_RMS    0.06 0.03 0.03 0.05
-  add Pt1020_Medium_RMS   0.06 0.03 0.03 0.05
-  add Pt2030_Medium_RMS   0.06 0.03 0.03 0.045
-  add Pt3050_Medium_RMS   0.06 0.03 0.03 0.04
-
-  add Pt010_Loose_betaStar  0.2 0.3 999. 999
-  add Pt1020_Loose_betaStar 0.2 0.3 999. 999
-  add Pt2030_Loose_betaStar 0.2 0.3 999. 999
-  add Pt3050_Loose_betaStar 0.2 0.3 999. 999
-
-  add Pt010_Loose_RMS   0.06 0.05 0.05 0.07
-  add Pt1020_Loose_RMS  0.06 0.05 0.05 0.07
-  add Pt2030_Loose_RMS  0.06 0.05 0.05 0.055
-  add Pt3050_Loose_RMS  0.06 0.05 0.05 0.055
+  # cut based ID: lower edges of the pt and |eta| bins
+  add CutPTBins  0.0 10.0 20.0 30.0
+  add CutEtaBins 0.0 2.5 2.75 3.0
+
+  # cuts for each working point and variable, one row of |eta| bins per pt bin,
+  # working points set the bits of the flag in the order they first appear
+  add Cuts {Tight betaStar} {
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+    0.15 0.15 999. 999.
+  }
+
+  add Cuts {Tight RMS} {
+    0.06 0.07 0.04 0.04
+    0.06 0.07 0.04 0.04
+    0.05 0.07 0.03 0.04
+    0.05 0.06 0.03 0.04
+  }
+
+  add Cuts {Medium betaStar} {
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+    0.2 0.3 999. 999.
+  }
+
+  add Cuts {Medium RMS} {
+    0.06 0.03 0.03 0.05
+    0.06 0.03 0.03 0.05
+    0.06 0.03 0.03 0.045
+    0.06 0.03 0.03 0.04
+  }
+
+  add Cuts {Loose betaStar} {
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+    0.2 0.3 999. 999
+  }
+
+  add Cuts {Loose RMS} {
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.07
+    0.06 0.05 0.05 0.055
+    0.06 0.05 0.05 0.055
+  }
   
 }
 
@@ -176,6 +176,19 @@ Bool_t Candidate::Overlaps(const Candidate *object) const{
   return kFALSE;
 }
 
+void Candidate::FillUniqueIDs(std::vector< UInt_t > &ids) const{
+  const Candidate *candidate;
+
+  ids.push_back(GetUniqueID());
+
+  if(fArray){
+    TIter it(fArray);
+    while((candidate = static_cast<Candidate *>(it.Next()))){
+      candidate->FillUniqueIDs(ids);
+    }
+  }
+}
+
 
 TObject *Candidate::Clone(const char *newname) const{
   Candidate *object = fFactory->NewCandidate();
@@ -846,6 +846,10 @@ class Candidate: public SortableObject  {
 
   Bool_t Overlaps(const Candidate *object) const;
 
+  // appends unique IDs of this candidate and of all its constituents,
+  // two candidates overlap if and only if these lists share an ID
+  void FillUniqueIDs(std::vector< UInt_t > &ids) const;
+
   virtual void     Copy(TObject &object) const;
   virtual TObject *Clone(const char *newname = "") const;
   virtual void     Clear(Option_t* option = ""); 
@@ -0,0 +1,164 @@
+
+/** \class DelphesEtaPhiGrid
+ *
+ *  Cell grid in (eta, phi) used to find all entries
+ *  within a DeltaR cone without scanning the full list
+ *
+ */
+
+#include "classes/DelphesEtaPhiGrid.h"
+
+#include "TMath.h"
+#include "TVector2.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// entries beyond this |eta| (e.g. zero pt vectors) are kept in the edge cells
+static const Double_t kEtaLimit = 10.0;
+
+//------------------------------------------------------------------------------
+
+DelphesEtaPhiGrid::DelphesEtaPhiGrid(Double_t cellSize) :
+  fCellSize(cellSize), fEtaMin(0.0), fEtaCellSize(cellSize), fPhiCellSize(cellSize),
+  fNumberOfEtaCells(0), fNumberOfPhiCells(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::Clear()
+{
+  fEta.clear();
+  fPhi.clear();
+  fCellStart.clear();
+  fCellContent.clear();
+  fNumberOfEtaCells = 0;
+  fNumberOfPhiCells = 0;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesEtaPhiGrid::Add(Double_t eta, Double_t phi)
+{
+  fEta.push_back(eta);
+  fPhi.push_back(TVector2::Phi_mpi_pi(phi));
+  return fEta.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesEtaPhiGrid::EtaCell(Double_t eta) const
+{
+  Int_t cell;
+  if(eta > kEtaLimit) eta = kEtaLimit;
+  if(eta < -kEtaLimit) eta = -kEtaLimit;
+  cell = TMath::FloorNint((eta - fEtaMin)/fEtaCellSize);
+  if(cell < 0) cell = 0;
+  if(cell >= fNumberOfEtaCells) cell = fNumberOfEtaCells - 1;
+  return cell;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t DelphesEtaPhiGrid::PhiCell(Double_t phi) const
+{
+  Int_t cell = TMath::FloorNint((phi + TMath::Pi())/fPhiCellSize);
+  if(cell < 0) cell = 0;
+  if(cell >= fNumberOfPhiCells) cell = fNumberOfPhiCells - 1;
+  return cell;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::Build()
+{
+  Int_t i, cell, size = fEta.size();
+  Double_t eta, etaMin, etaMax;
+  vector< Int_t > cellIndex(size);
+
+  fCellStart.clear();
+  fCellContent.resize(size);
+
+  if(size == 0) return;
+
+  etaMin = kEtaLimit;
+  etaMax = -kEtaLimit;
+  for(i = 0; i < size; ++i)
+  {
+    eta = TMath::Max(-kEtaLimit, TMath::Min(kEtaLimit, fEta[i]));
+    if(eta < etaMin) etaMin = eta;
+    if(eta > etaMax) etaMax = eta;
+  }
+
+  fEtaMin = etaMin;
+  fEtaCellSize = fCellSize;
+  fNumberOfEtaCells = TMath::FloorNint((etaMax - etaMin)/fEtaCellSize) + 1;
+
+  fNumberOfPhiCells = TMath::Max(1, TMath::FloorNint(TMath::TwoPi()/fCellSize));
+  fPhiCellSize = TMath::TwoPi()/fNumberOfPhiCells;
+
+  // counting sort of the entries into cells
+  fCellStart.assign(fNumberOfEtaCells*fNumberOfPhiCells + 1, 0);
+  for(i = 0; i < size; ++i)
+  {
+    cell = EtaCell(fEta[i])*fNumberOfPhiCells + PhiCell(fPhi[i]);
+    cellIndex[i] = cell;
+    ++fCellStart[cell + 1];
+  }
+
+  for(cell = 0; cell < fNumberOfEtaCells*fNumberOfPhiCells; ++cell)
+  {
+    fCellStart[cell + 1] += fCellStart[cell];
+  }
+
+  vector< Int_t > position(fCellStart.begin(), fCellStart.end() - 1);
+  for(i = 0; i < size; ++i)
+  {
+    fCellContent[position[cellIndex[i]]++] = i;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesEtaPhiGrid::FindNeighbours(Double_t eta, Double_t phi, Double_t deltaR, vector< Int_t > &result) const
+{
+  Int_t etaCell, etaFirst, etaLast, phiFirst, phiLast, k, cell, i, j;
+  Double_t dEta, dPhi, deltaR2 = deltaR*deltaR;
+  size_t first = result.size();
+
+  if(fCellStart.empty()) return;
+
+  phi = TVector2::Phi_mpi_pi(phi);
+
+  etaFirst = EtaCell(eta - deltaR);
+  etaLast = EtaCell(eta + deltaR);
+
+  phiFirst = TMath::FloorNint((phi - deltaR + TMath::Pi())/fPhiCellSize);
+  phiLast = TMath::FloorNint((phi + deltaR + TMath::Pi())/fPhiCellSize);
+  if(phiLast - phiFirst + 1 >= fNumberOfPhiCells)
+  {
+    phiFirst = 0;
+    phiLast = fNumberOfPhiCells - 1;
+  }
+
+  for(etaCell = etaFirst; etaCell <= etaLast; ++etaCell)
+  {
+    for(k = phiFirst; k <= phiLast; ++k)
+    {
+      cell = etaCell*fNumberOfPhiCells + ((k % fNumberOfPhiCells) + fNumberOfPhiCells) % fNumberOfPhiCells;
+      for(j = fCellStart[cell]; j < fCellStart[cell + 1]; ++j)
+      {
+        i = fCellContent[j];
+        dEta = eta - fEta[i];
+        dPhi = TVector2::Phi_mpi_pi(phi - fPhi[i]);
+        if(dEta*dEta + dPhi*dPhi <= deltaR2) result.push_back(i);
+      }
+    }
+  }
+
+  sort(result.begin() + first, result.end());
+}
+
+//------------------------------------------------------------------------------
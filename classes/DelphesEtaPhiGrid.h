@@ -0,0 +1,52 @@
+#ifndef DelphesEtaPhiGrid_h
+#define DelphesEtaPhiGrid_h
+
+/** \class DelphesEtaPhiGrid
+ *
+ *  Cell grid in (eta, phi) used to find all entries
+ *  within a DeltaR cone without scanning the full list
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class DelphesEtaPhiGrid
+{
+public:
+
+  DelphesEtaPhiGrid(Double_t cellSize = 0.5);
+
+  void SetCellSize(Double_t cellSize) { fCellSize = cellSize; }
+
+  void Clear();
+
+  Int_t Add(Double_t eta, Double_t phi);
+
+  void Build();
+
+  // appends indices of all entries with DeltaR <= deltaR, in insertion order
+  void FindNeighbours(Double_t eta, Double_t phi, Double_t deltaR, std::vector< Int_t > &result) const;
+
+  Int_t GetEntries() const { return fEta.size(); }
+
+  Double_t GetEta(Int_t i) const { return fEta[i]; }
+  Double_t GetPhi(Int_t i) const { return fPhi[i]; }
+
+private:
+
+  Int_t EtaCell(Double_t eta) const;
+  Int_t PhiCell(Double_t phi) const;
+
+  Double_t fCellSize;
+  Double_t fEtaMin, fEtaCellSize, fPhiCellSize;
+
+  Int_t fNumberOfEtaCells, fNumberOfPhiCells;
+
+  std::vector< Double_t > fEta, fPhi;
+
+  std::vector< Int_t > fCellStart, fCellContent;
+};
+
+#endif /* DelphesEtaPhiGrid_h */
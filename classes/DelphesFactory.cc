@@ -25,7 +25,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 DelphesFactory::DelphesFactory(const char *name) :
-  TNamed(name, ""), fObjArrays(0)
+  TNamed(name, ""), fObjArrays(0), fStaging(kFALSE)
 {
   fObjArrays = new ExRootTreeBranch("PermanentObjArrays", TObjArray::Class(), 0);
 }
@@ -53,7 +53,8 @@ void DelphesFactory::Clear()
     (*itPool)->Clear();
   }
 
-  TProcessID::SetObjectCount(0);
+  // the object count is shared by all threads
+  if(!fStaging) TProcessID::SetObjectCount(0);
 
   map< const TClass*, ExRootTreeBranch* >::iterator itBranches;
   for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
@@ -77,12 +78,20 @@ Candidate *DelphesFactory::NewCandidate()
 {
   Candidate *object = New<Candidate>();
   object->SetFactory(this);
-  TProcessID::AssignID(object);
+  if(!fStaging) TProcessID::AssignID(object);
   return object;
 }
 
 //------------------------------------------------------------------------------
 
+void DelphesFactory::AdoptCandidate(Candidate *candidate)
+{
+  candidate->SetFactory(this);
+  TProcessID::AssignID(candidate);
+}
+
+//------------------------------------------------------------------------------
+
 TObject *DelphesFactory::New(TClass *cl)
 {
   TObject *object = 0;
@@ -39,6 +39,14 @@ public:
 
   Candidate *NewCandidate();
 
+  // a staging factory creates candidates in another thread, they get their
+  // TProcessID numbers later in the thread of the main factory
+  void SetStaging(Bool_t staging) { fStaging = staging; }
+
+  // takes a candidate of a staging factory: clones are made by this factory
+  // and the candidate gets its TProcessID number
+  void AdoptCandidate(Candidate *candidate);
+
   TObject *New(TClass *cl);
 
   template<typename T>
@@ -50,8 +58,10 @@ private:
 
   std::map< const TClass*, ExRootTreeBranch* > fBranches; //!
   std::set< TObject* > fPool; //!
+
+  Bool_t fStaging; //!
   
-  ClassDef(DelphesFactory, 1)
+  ClassDef(DelphesFactory, 2)
 };
 
 #endif /* DelphesFactory */
@@ -20,17 +20,19 @@
 
 #include <map>
 #include <vector>
+#include <algorithm>
 
 #include <stdio.h>
+#include <string.h>
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
+#include "TThread.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 #include "classes/DelphesStream.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -39,22 +41,186 @@ using namespace std;
 
 static const int kBufferSize  = 1024;
 
+// size of the blocks read in block mode
+static const size_t kBlockSize = 16*1024*1024;
+
+// smallest part of a block given to one thread
+static const size_t kMinChunkSize = 256*1024;
+
+// vertices with codes below -kMaxVertexIndex go to the maps
+static const int kMaxVertexIndex = 1 << 20;
+
+//---------------------------------------------------------------------------
+
+// one line of the file, parsed
+
+struct HepMCRecord
+{
+  char key;
+  bool valid;
+
+  // E: event number, MPI, process ID, signal code, vertex counter, beam codes, state size, weight size
+  // U: momentum unit (1 GEV, 2 MEV), position unit (1 MM, 2 CM)
+  // F: ID1, ID2
+  // V: out vertex code, vertex ID, in counter, out counter
+  // P: particle code, PID, status, in vertex code
+  int integer[9];
+
+  // E: scale, alphaQCD, alphaQED
+  // F: X1, X2, scalePDF, PDF1, PDF2
+  // V: X, Y, Z, T
+  // P: Px, Py, Pz, E, mass, theta, phi
+  double real[7];
+
+  // E: first state and weight in the chunk
+  size_t state, weight;
+};
+
+//---------------------------------------------------------------------------
+
+// lines of one part of a block, parsed by one thread
+
+struct HepMCChunk
+{
+  char *begin, *end;
+
+  std::vector< HepMCRecord > records;
+  std::vector< int > states;
+  std::vector< double > weights;
+};
+
+//---------------------------------------------------------------------------
+
+static void ParseRecord(char *line, HepMCRecord &record, HepMCChunk &chunk)
+{
+  DelphesStream bufferStream(line + 1);
+  char momentumUnit[4], positionUnit[3];
+  int i, rc, state;
+  double weight;
+
+  record.key = line[0];
+  record.valid = true;
+
+  if(record.key == 'E')
+  {
+    rc = bufferStream.ReadInt(record.integer[0])
+      && bufferStream.ReadInt(record.integer[1])
+      && bufferStream.ReadDbl(record.real[0])
+      && bufferStream.ReadDbl(record.real[1])
+      && bufferStream.ReadDbl(record.real[2])
+      && bufferStream.ReadInt(record.integer[2])
+      && bufferStream.ReadInt(record.integer[3])
+      && bufferStream.ReadInt(record.integer[4])
+      && bufferStream.ReadInt(record.integer[5])
+      && bufferStream.ReadInt(record.integer[6])
+      && bufferStream.ReadInt(record.integer[7]);
+
+    record.state = chunk.states.size();
+    for(i = 0; rc && i < record.integer[7]; ++i)
+    {
+      rc = bufferStream.ReadInt(state);
+      chunk.states.push_back(state);
+    }
+
+    rc = rc && bufferStream.ReadInt(record.integer[8]);
+
+    record.weight = chunk.weights.size();
+    for(i = 0; rc && i < record.integer[8]; ++i)
+    {
+      rc = bufferStream.ReadDbl(weight);
+      chunk.weights.push_back(weight);
+    }
+
+    record.valid = rc;
+  }
+  else if(record.key == 'U')
+  {
+    rc = sscanf(line + 1, "%3s %2s", momentumUnit, positionUnit);
+
+    record.valid = (rc == 2);
+    if(!record.valid) return;
+
+    record.integer[0] = 0;
+    if(strncmp(momentumUnit, "GEV", 3) == 0)
+    {
+      record.integer[0] = 1;
+    }
+    else if(strncmp(momentumUnit, "MEV", 3) == 0)
+    {
+      record.integer[0] = 2;
+    }
+
+    record.integer[1] = 0;
+    if(strncmp(positionUnit, "MM", 3) == 0)
+    {
+      record.integer[1] = 1;
+    }
+    else if(strncmp(positionUnit, "CM", 3) == 0)
+    {
+      record.integer[1] = 2;
+    }
+  }
+  else if(record.key == 'F')
+  {
+    record.valid = bufferStream.ReadInt(record.integer[0])
+      && bufferStream.ReadInt(record.integer[1])
+      && bufferStream.ReadDbl(record.real[0])
+      && bufferStream.ReadDbl(record.real[1])
+      && bufferStream.ReadDbl(record.real[2])
+      && bufferStream.ReadDbl(record.real[3])
+      && bufferStream.ReadDbl(record.real[4]);
+  }
+  else if(record.key == 'V')
+  {
+    record.valid = bufferStream.ReadInt(record.integer[0])
+      && bufferStream.ReadInt(record.integer[1])
+      && bufferStream.ReadDbl(record.real[0])
+      && bufferStream.ReadDbl(record.real[1])
+      && bufferStream.ReadDbl(record.real[2])
+      && bufferStream.ReadDbl(record.real[3])
+      && bufferStream.ReadInt(record.integer[2])
+      && bufferStream.ReadInt(record.integer[3]);
+  }
+  else if(record.key == 'P')
+  {
+    record.valid = bufferStream.ReadInt(record.integer[0])
+      && bufferStream.ReadInt(record.integer[1])
+      && bufferStream.ReadDbl(record.real[0])
+      && bufferStream.ReadDbl(record.real[1])
+      && bufferStream.ReadDbl(record.real[2])
+      && bufferStream.ReadDbl(record.real[3])
+      && bufferStream.ReadDbl(record.real[4])
+      && bufferStream.ReadInt(record.integer[2])
+      && bufferStream.ReadDbl(record.real[5])
+      && bufferStream.ReadDbl(record.real[6])
+      && bufferStream.ReadInt(record.integer[3]);
+  }
+}
+
 //---------------------------------------------------------------------------
 
 DelphesHepMCReader::DelphesHepMCReader() :
-  fInputFile(0), fBuffer(0), fPDG(0),
+  fInputFile(0), fBuffer(0), fLineRecord(0), fLineChunk(0),
+  fThreads(0), fBlockUsed(0), fEndOfFile(false), fChunks(0), fChunk(0), fRecord(0),
+  fPDG(0),
   fVertexCounter(-1), fInCounter(-1), fOutCounter(-1),
   fParticleCounter(0)
 {
   fBuffer = new char[kBufferSize];
 
-  fPDG = TDatabasePDG::Instance();
+  fLineRecord = new HepMCRecord;
+  fLineChunk = new HepMCChunk;
+
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
 
 DelphesHepMCReader::~DelphesHepMCReader()
 {
+  if(fChunks) delete[] fChunks;
+  if(fLineChunk) delete fLineChunk;
+  if(fLineRecord) delete fLineRecord;
   if(fBuffer) delete[] fBuffer;
 }
 
@@ -62,7 +228,37 @@ DelphesHepMCReader::~DelphesHepMCReader()
 
 void DelphesHepMCReader::SetInputFile(FILE *inputFile)
 {
+  int i;
+
   fInputFile = inputFile;
+
+  // drop what is left of the previous file
+  fBlockUsed = 0;
+  fEndOfFile = false;
+  fChunk = 0;
+  fRecord = 0;
+  for(i = 0; fChunks && i < fThreads; ++i)
+  {
+    fChunks[i].records.clear();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesHepMCReader::SetNumberOfThreads(int threads)
+{
+  if(fChunks) delete[] fChunks;
+  fChunks = 0;
+
+  fThreads = threads > 0 ? threads : 0;
+  if(fThreads == 0) return;
+
+  if(fThreads > 1) TThread::Initialize();
+
+  fChunks = new HepMCChunk[fThreads];
+  fBlock.resize(kBlockSize + 1);
+
+  SetInputFile(fInputFile);
 }
 
 //---------------------------------------------------------------------------
@@ -78,6 +274,8 @@ void DelphesHepMCReader::Clear()
   fVertexCounter = -1;
   fInCounter = -1;
   fOutCounter = -1;
+  fMotherIndex.clear();
+  fDaughterIndex.clear();
   fMotherMap.clear();
   fDaughterMap.clear();
   fParticleCounter = 0;
@@ -97,171 +295,199 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
   TObjArray *stableParticleOutputArray,
   TObjArray *partonOutputArray)
 {
-  map< int, pair< int, int > >::iterator itMotherMap;
-  map< int, pair< int, int > >::iterator itDaughterMap;
-  char key, momentumUnit[4], positionUnit[3];
-  int i, rc, state;
-  double weight;
+  HepMCChunk *chunk;
+  HepMCRecord *record;
 
-  if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
+  if(fThreads > 0)
+  {
+    // next parsed line, parse the next block when all are used
+    while(fChunk >= fThreads || fRecord >= fChunks[fChunk].records.size())
+    {
+      if(fChunk < fThreads)
+      {
+        ++fChunk;
+        fRecord = 0;
+      }
+      else if(!ReadNextBlock())
+      {
+        return kFALSE;
+      }
+    }
+
+    chunk = &fChunks[fChunk];
+    record = &chunk->records[fRecord++];
+  }
+  else
+  {
+    if(!fgets(fBuffer, kBufferSize, fInputFile)) return kFALSE;
+
+    chunk = fLineChunk;
+    record = fLineRecord;
 
-  DelphesStream bufferStream(fBuffer + 1);
+    chunk->states.clear();
+    chunk->weights.clear();
+    ParseRecord(fBuffer, *record, *chunk);
+  }
 
-  key = fBuffer[0];
+  if(!ApplyRecord(*record, *chunk, factory, allParticleOutputArray,
+    stableParticleOutputArray, partonOutputArray)) return kFALSE;
 
-  if(key == 'E')
+  if(EventReady())
   {
-    Clear();
+    FinalizeParticles(allParticleOutputArray);
+  }
 
-    rc = bufferStream.ReadInt(fEventNumber)
-      && bufferStream.ReadInt(fMPI)
-      && bufferStream.ReadDbl(fScale)
-      && bufferStream.ReadDbl(fAlphaQCD)
-      && bufferStream.ReadDbl(fAlphaQED)
-      && bufferStream.ReadInt(fProcessID)
-      && bufferStream.ReadInt(fSignalCode)
-      && bufferStream.ReadInt(fVertexCounter)
-      && bufferStream.ReadInt(fBeamCode[0])
-      && bufferStream.ReadInt(fBeamCode[1])
-      && bufferStream.ReadInt(fStateSize);
+  return kTRUE;
+}
 
-    if(!rc)
-    {
-      cerr << "** ERROR: " << "invalid event format" << endl;
-      return kFALSE;
-    }
+//---------------------------------------------------------------------------
 
-    for(i = 0; i < fStateSize; ++i)
-    {
-      rc = rc && bufferStream.ReadInt(state);
-      fState.push_back(state);
-    }
+bool DelphesHepMCReader::ApplyRecord(const HepMCRecord &record, const HepMCChunk &chunk,
+  DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  pair< int, int > *vertex;
 
-    rc = rc && bufferStream.ReadInt(fWeightSize);
+  if(record.key == 'E')
+  {
+    Clear();
 
-    if(!rc)
+    if(!record.valid)
     {
       cerr << "** ERROR: " << "invalid event format" << endl;
       return kFALSE;
     }
 
-    for(i = 0; i < fWeightSize; ++i)
+    fEventNumber = record.integer[0];
+    fMPI = record.integer[1];
+    fScale = record.real[0];
+    fAlphaQCD = record.real[1];
+    fAlphaQED = record.real[2];
+    fProcessID = record.integer[2];
+    fSignalCode = record.integer[3];
+    fVertexCounter = record.integer[4];
+    fBeamCode[0] = record.integer[5];
+    fBeamCode[1] = record.integer[6];
+
+    fStateSize = record.integer[7];
+    if(fStateSize > 0)
     {
-      rc = rc && bufferStream.ReadDbl(weight);
-      fWeight.push_back(weight);
+      fState.assign(chunk.states.begin() + record.state, chunk.states.begin() + record.state + fStateSize);
     }
 
-    if(!rc)
+    fWeightSize = record.integer[8];
+    if(fWeightSize > 0)
     {
-      cerr << "** ERROR: " << "invalid event format" << endl;
-      return kFALSE;
+      fWeight.assign(chunk.weights.begin() + record.weight, chunk.weights.begin() + record.weight + fWeightSize);
     }
   }
-  else if(key == 'U')
+  else if(record.key == 'U')
   {
-    rc = sscanf(fBuffer + 1, "%3s %2s", momentumUnit, positionUnit);
-
-    if(rc != 2)
+    if(!record.valid)
     {
       cerr << "** ERROR: " << "invalid units format" << endl;
       return kFALSE;
     }
 
-    if(strncmp(momentumUnit, "GEV", 3) == 0)
+    if(record.integer[0] == 1)
     {
       fMomentumCoefficient = 1.0;
     }
-    else if(strncmp(momentumUnit, "MEV", 3) == 0)
+    else if(record.integer[0] == 2)
     {
       fMomentumCoefficient = 0.001;
     }
-    
-    if(strncmp(positionUnit, "MM", 3) == 0)
+
+    if(record.integer[1] == 1)
     {
       fPositionCoefficient = 1.0;
     }
-    else if(strncmp(positionUnit, "CM", 3) == 0)
+    else if(record.integer[1] == 2)
     {
       fPositionCoefficient = 10.0;
     }
   }
-  else if(key == 'F')
+  else if(record.key == 'F')
   {
-    rc = bufferStream.ReadInt(fID1)
-      && bufferStream.ReadInt(fID2)
-      && bufferStream.ReadDbl(fX1)
-      && bufferStream.ReadDbl(fX2)
-      && bufferStream.ReadDbl(fScalePDF)
-      && bufferStream.ReadDbl(fPDF1)
-      && bufferStream.ReadDbl(fPDF2);
-
-    if(!rc)
+    if(!record.valid)
     {
       cerr << "** ERROR: " << "invalid PDF format" << endl;
       return kFALSE;
     }
+
+    fID1 = record.integer[0];
+    fID2 = record.integer[1];
+    fX1 = record.real[0];
+    fX2 = record.real[1];
+    fScalePDF = record.real[2];
+    fPDF1 = record.real[3];
+    fPDF2 = record.real[4];
   }
-  else if(key == 'V' && fVertexCounter > 0)
+  else if(record.key == 'V' && fVertexCounter > 0)
   {
-    rc = bufferStream.ReadInt(fOutVertexCode)
-      && bufferStream.ReadInt(fVertexID)
-      && bufferStream.ReadDbl(fX)
-      && bufferStream.ReadDbl(fY)
-      && bufferStream.ReadDbl(fZ)
-      && bufferStream.ReadDbl(fT)
-      && bufferStream.ReadInt(fInCounter)
-      && bufferStream.ReadInt(fOutCounter);
-
-    if(!rc)
+    if(!record.valid)
     {
       cerr << "** ERROR: " << "invalid vertex format" << endl;
       return kFALSE;
     }
+
+    fOutVertexCode = record.integer[0];
+    fVertexID = record.integer[1];
+    fX = record.real[0];
+    fY = record.real[1];
+    fZ = record.real[2];
+    fT = record.real[3];
+    fInCounter = record.integer[2];
+    fOutCounter = record.integer[3];
+
     --fVertexCounter;
   }
-  else if(key == 'P' && fOutCounter > 0)
+  else if(record.key == 'P' && fOutCounter > 0)
   {
-    rc = bufferStream.ReadInt(fParticleCode)
-      && bufferStream.ReadInt(fPID)
-      && bufferStream.ReadDbl(fPx)
-      && bufferStream.ReadDbl(fPy)
-      && bufferStream.ReadDbl(fPz)
-      && bufferStream.ReadDbl(fE)
-      && bufferStream.ReadDbl(fMass)
-      && bufferStream.ReadInt(fStatus)
-      && bufferStream.ReadDbl(fTheta)
-      && bufferStream.ReadDbl(fPhi)
-      && bufferStream.ReadInt(fInVertexCode);
-
-    if(!rc)
+    if(!record.valid)
     {
       cerr << "** ERROR: " << "invalid particle format" << endl;
       return kFALSE;
     }
 
+    fParticleCode = record.integer[0];
+    fPID = record.integer[1];
+    fPx = record.real[0];
+    fPy = record.real[1];
+    fPz = record.real[2];
+    fE = record.real[3];
+    fMass = record.real[4];
+    fStatus = record.integer[2];
+    fTheta = record.real[5];
+    fPhi = record.real[6];
+    fInVertexCode = record.integer[3];
+
+    // only vertices with negative codes are looked up in FinalizeParticles
     if(fInVertexCode < 0)
     {
-      itMotherMap = fMotherMap.find(fInVertexCode);
-      if(itMotherMap == fMotherMap.end())
+      vertex = &AddVertex(fMotherIndex, fMotherMap, fInVertexCode);
+      if(vertex->first < 0)
       {
-        fMotherMap[fInVertexCode] = make_pair(fParticleCounter, -1);
+        *vertex = make_pair(fParticleCounter, -1);
       }
       else
       {
-        itMotherMap->second.second = fParticleCounter;
+        vertex->second = fParticleCounter;
       }
     }
 
-    if(fInCounter <= 0)
+    if(fInCounter <= 0 && fOutVertexCode < 0)
     {
-      itDaughterMap = fDaughterMap.find(fOutVertexCode);
-      if(itDaughterMap == fDaughterMap.end())
+      vertex = &AddVertex(fDaughterIndex, fDaughterMap, fOutVertexCode);
+      if(vertex->first < 0)
       {
-        fDaughterMap[fOutVertexCode] = make_pair(fParticleCounter, fParticleCounter);
+        *vertex = make_pair(fParticleCounter, fParticleCounter);
       }
       else
       {
-        itDaughterMap->second.second = fParticleCounter;
+        vertex->second = fParticleCounter;
       }
     }
 
@@ -280,16 +506,141 @@ bool DelphesHepMCReader::ReadBlock(DelphesFactory *factory,
     ++fParticleCounter;
   }
 
-  if(EventReady())
+  return kTRUE;
+}
+
+//---------------------------------------------------------------------------
+
+bool DelphesHepMCReader::ReadNextBlock()
+{
+  char *begin, *end, *target, *line;
+  size_t size, count, length;
+  int i, threads;
+  vector< TThread * > workers;
+
+  fChunk = 0;
+  fRecord = 0;
+  for(i = 0; i < fThreads; ++i)
   {
-    FinalizeParticles(allParticleOutputArray);
+    fChunks[i].records.clear();
+  }
+
+  // the lines after the last newline are kept for the next block,
+  // the buffer grows when a single line does not fit
+  while(true)
+  {
+    if(fEndOfFile && fBlockUsed == 0) return kFALSE;
+
+    if(!fEndOfFile)
+    {
+      if(fBlockUsed + 1 >= fBlock.size()) fBlock.resize(2*fBlock.size());
+      count = fread(&fBlock[fBlockUsed], 1, fBlock.size() - 1 - fBlockUsed, fInputFile);
+      fBlockUsed += count;
+      if(count == 0 || feof(fInputFile) || ferror(fInputFile)) fEndOfFile = true;
+    }
+
+    if(fBlockUsed == 0) continue;
+
+    begin = &fBlock[0];
+    end = begin + fBlockUsed;
+    if(!fEndOfFile)
+    {
+      while(end > begin && end[-1] != '\n') --end;
+      if(end == begin) continue;
+    }
+    break;
+  }
+
+  size = end - begin;
+
+  // split at E lines into parts of similar size
+  threads = fThreads;
+  if(size_t(threads) > size/kMinChunkSize) threads = max(size_t(1), size/kMinChunkSize);
+
+  for(i = 0; i < threads; ++i)
+  {
+    fChunks[i].begin = (i == 0) ? begin : fChunks[i - 1].end;
+    fChunks[i].end = end;
+    if(i == threads - 1) break;
+
+    target = begin + (i + 1)*size/threads;
+    if(target <= fChunks[i].begin) target = fChunks[i].begin;
+
+    line = static_cast< char * >(memchr(target, '\n', end - target));
+    while(line && line + 1 < end && line[1] != 'E')
+    {
+      line = static_cast< char * >(memchr(line + 1, '\n', end - line - 1));
+    }
+    if(line) fChunks[i].end = line + 1;
+  }
+  for(++i; i < fThreads; ++i)
+  {
+    fChunks[i].begin = end;
+    fChunks[i].end = end;
+  }
+
+  for(i = 1; i < threads; ++i)
+  {
+    workers.push_back(new TThread(ParseThread, &fChunks[i]));
+    workers.back()->Run();
   }
 
+  ParseThread(&fChunks[0]);
+
+  for(i = 0; i < Int_t(workers.size()); ++i)
+  {
+    workers[i]->Join();
+    delete workers[i];
+  }
+
+  // keep the incomplete last line
+  length = fBlockUsed - (end - begin);
+  if(length > 0) memmove(begin, end, length);
+  fBlockUsed = length;
+
   return kTRUE;
 }
 
 //---------------------------------------------------------------------------
 
+void *DelphesHepMCReader::ParseThread(void *chunk)
+{
+  HepMCChunk *parts = static_cast< HepMCChunk * >(chunk);
+  char buffer[kBufferSize];
+  char *position, *next, *newline;
+  size_t length;
+
+  parts->states.clear();
+  parts->weights.clear();
+
+  // split lines as fgets does in line mode, at most kBufferSize - 1 characters at a time
+  for(position = parts->begin; position < parts->end; position = next)
+  {
+    length = min(size_t(parts->end - position), size_t(kBufferSize - 1));
+    newline = static_cast< char * >(memchr(position, '\n', length));
+
+    parts->records.resize(parts->records.size() + 1);
+
+    if(newline)
+    {
+      next = newline + 1;
+      *newline = '\0';
+      ParseRecord(position, parts->records.back(), *parts);
+    }
+    else
+    {
+      next = position + length;
+      memcpy(buffer, position, length);
+      buffer[length] = '\0';
+      ParseRecord(buffer, parts->records.back(), *parts);
+    }
+  }
+
+  return 0;
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesHepMCReader::AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
   TStopwatch *readStopWatch, TStopwatch *procStopWatch)
 {
@@ -325,7 +676,6 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
   int pdgCode;
 
   candidate = factory->NewCandidate();
@@ -335,8 +685,7 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
 
   candidate->Status = fStatus;
 
-  pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+  candidate->Charge = fPDG->GetCharge(fPID);
   candidate->Mass = fMass;
 
   candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
@@ -372,9 +721,9 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
 
   allParticleOutputArray->Add(candidate);
 
-  if(!pdgParticle) return;
+  if(!fPDG->IsKnown(fPID)) return;
 
-  if(fStatus == 1 && pdgParticle->Stable())
+  if(fStatus == 1 && fPDG->IsStable(fPID))
   {
     stableParticleOutputArray->Add(candidate);
   }
@@ -386,11 +735,41 @@ void DelphesHepMCReader::AnalyzeParticle(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
+pair< int, int > &DelphesHepMCReader::AddVertex(vector< pair< int, int > > &index,
+  map< int, pair< int, int > > &overflow, int vertexCode)
+{
+  if(vertexCode < -kMaxVertexIndex)
+  {
+    return overflow.insert(make_pair(vertexCode, make_pair(-1, -1))).first->second;
+  }
+
+  if(size_t(-vertexCode) >= index.size()) index.resize(-vertexCode + 1, make_pair(-1, -1));
+  return index[-vertexCode];
+}
+
+//---------------------------------------------------------------------------
+
+pair< int, int > DelphesHepMCReader::FindVertex(const vector< pair< int, int > > &index,
+  const map< int, pair< int, int > > &overflow, int vertexCode) const
+{
+  map< int, pair< int, int > >::const_iterator itOverflow;
+
+  if(vertexCode < -kMaxVertexIndex)
+  {
+    itOverflow = overflow.find(vertexCode);
+    return itOverflow == overflow.end() ? make_pair(-1, -1) : itOverflow->second;
+  }
+
+  if(vertexCode > 0 || size_t(-vertexCode) >= index.size()) return make_pair(-1, -1);
+  return index[-vertexCode];
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesHepMCReader::FinalizeParticles(TObjArray *allParticleOutputArray)
 {
   Candidate *candidate;
-  map< int, pair< int, int > >::iterator itMotherMap;
-  map< int, pair< int, int > >::iterator itDaughterMap;
+  pair< int, int > vertex;
   int i;
 
   for(i = 0; i < allParticleOutputArray->GetEntriesFast(); ++i)
@@ -404,17 +783,9 @@ void DelphesHepMCReader::FinalizeParticles(TObjArray *allParticleOutputArray)
     }
     else
     {
-      itMotherMap = fMotherMap.find(candidate->M1);
-      if(itMotherMap == fMotherMap.end())
-      {
-        candidate->M1 = -1;
-        candidate->M2 = -1;
-      }
-      else
-      {
-        candidate->M1 = itMotherMap->second.first;
-        candidate->M2 = itMotherMap->second.second;
-      }
+      vertex = FindVertex(fMotherIndex, fMotherMap, candidate->M1);
+      candidate->M1 = vertex.first;
+      candidate->M2 = vertex.second;
     }
     if(candidate->D1 > 0)
     {
@@ -423,17 +794,9 @@ void DelphesHepMCReader::FinalizeParticles(TObjArray *allParticleOutputArray)
     }
     else
     {
-      itDaughterMap = fDaughterMap.find(candidate->D1);
-      if(itDaughterMap == fDaughterMap.end())
-      {
-        candidate->D1 = -1;
-        candidate->D2 = -1;
-      }
-      else
-      {
-        candidate->D1 = itDaughterMap->second.first;
-        candidate->D2 = itDaughterMap->second.second;
-      }
+      vertex = FindVertex(fDaughterIndex, fDaughterMap, candidate->D1);
+      candidate->D1 = vertex.first;
+      candidate->D2 = vertex.second;
     }
   }
 }
@@ -21,10 +21,13 @@
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
 
+struct HepMCRecord;
+struct HepMCChunk;
+
 class DelphesHepMCReader
 {
 public:
@@ -34,6 +37,10 @@ public:
 
   void SetInputFile(FILE *inputFile);
 
+  // threads > 0 reads the input in large blocks whose lines are parsed by
+  // threads threads, 0 reads and parses one line at a time
+  void SetNumberOfThreads(int threads);
+
   void Clear();
   bool EventReady();
 
@@ -54,11 +61,40 @@ private:
 
   void FinalizeParticles(TObjArray *allParticleOutputArray);
 
+  bool ApplyRecord(const HepMCRecord &record, const HepMCChunk &chunk,
+    DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+
+  bool ReadNextBlock();
+
+  static void *ParseThread(void *chunk);
+
+  std::pair< int, int > &AddVertex(std::vector< std::pair< int, int > > &index,
+    std::map< int, std::pair< int, int > > &overflow, int vertexCode);
+
+  std::pair< int, int > FindVertex(const std::vector< std::pair< int, int > > &index,
+    const std::map< int, std::pair< int, int > > &overflow, int vertexCode) const;
+
   FILE *fInputFile;
 
   char *fBuffer;
 
-  TDatabasePDG *fPDG;
+  // line being parsed in line mode
+  HepMCRecord *fLineRecord;
+  HepMCChunk *fLineChunk;
+
+  // block mode: the block, its parsed chunks and the next record to apply
+  int fThreads;
+  std::vector< char > fBlock;
+  size_t fBlockUsed;
+  bool fEndOfFile;
+  HepMCChunk *fChunks;
+  int fChunk;
+  size_t fRecord;
+
+  const DelphesPDGTable *fPDG;
 
   int fEventNumber, fMPI, fProcessID, fSignalCode, fVertexCounter, fBeamCode[2];
   double fScale, fAlphaQCD, fAlphaQED;
@@ -82,6 +118,10 @@ private:
 
   int fParticleCounter;
 
+  // first and last mother (daughter) of the vertex with code -i at index i,
+  // the maps hold the vertices with very large codes
+  std::vector< std::pair < int, int > > fMotherIndex;
+  std::vector< std::pair < int, int > > fDaughterIndex;
   std::map< int, std::pair < int, int > > fMotherMap;
   std::map< int, std::pair < int, int > > fDaughterMap;
 };
@@ -0,0 +1,457 @@
+
+/** \class DelphesInputStream
+ *
+ *  Opens an input file for the readers, decompressing it when needed.
+ *
+ *  gzip and zstd files are recognized by their first bytes and
+ *  decompressed by a background thread into a pipe, which the readers
+ *  read as any other FILE. Files made of several concatenated gzip
+ *  members or zstd frames are read as one stream. Other files, and the
+ *  standard input when it is not compressed, are read directly.
+ *
+ */
+
+#include "classes/DelphesInputStream.h"
+
+#include "TThread.h"
+#include "TMutex.h"
+
+#include <stdexcept>
+#include <sstream>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <zlib.h>
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+// blocks read from the file and written to the pipe
+static const size_t kBlockSize = 4*1024*1024;
+
+// buffer of the pipe and of the FILE reading it
+static const int kPipeSize = 1024*1024;
+static const size_t kFileBufferSize = 1024*1024;
+
+static const unsigned char kGzipMagic[2] = {0x1f, 0x8b};
+static const unsigned char kZstdMagic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+//------------------------------------------------------------------------------
+
+DelphesInputStream::DelphesInputStream() :
+  fFormat(kPlain), fInput(0), fFile(0),
+  fSize(-1), fPosition(0), fHeadSize(0),
+  fThread(0), fMutex(0)
+{
+  fPipe[0] = -1;
+  fPipe[1] = -1;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesInputStream::~DelphesInputStream()
+{
+  try
+  {
+    Close();
+  }
+  catch(runtime_error &e)
+  {
+  }
+
+  if(fMutex) delete fMutex;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::Open(const char *fileName)
+{
+  stringstream message;
+
+  Close();
+
+  fFileName = fileName;
+  fFormat = kPlain;
+  fSize = -1;
+  fPosition = 0;
+  fError.clear();
+
+  if(strcmp(fileName, "-") == 0)
+  {
+    fInput = stdin;
+  }
+  else
+  {
+    fInput = fopen(fileName, "r");
+
+    if(fInput == NULL)
+    {
+      message << "can't open " << fileName;
+      throw runtime_error(message.str());
+    }
+
+    fseeko(fInput, 0, SEEK_END);
+    fSize = ftello(fInput);
+    fseeko(fInput, 0, SEEK_SET);
+  }
+
+  fHeadSize = fread(fHead, 1, sizeof(fHead), fInput);
+
+  if(fHeadSize >= sizeof(kGzipMagic) && memcmp(fHead, kGzipMagic, sizeof(kGzipMagic)) == 0)
+  {
+    fFormat = kGzip;
+  }
+  else if(fHeadSize >= sizeof(kZstdMagic) && memcmp(fHead, kZstdMagic, sizeof(kZstdMagic)) == 0)
+  {
+#ifdef HAS_ZSTD
+    fFormat = kZstd;
+#else
+    if(fInput != stdin) fclose(fInput);
+    fInput = 0;
+    message << fileName << " is compressed with zstd, Delphes has to be built with ZSTD set to read it";
+    throw runtime_error(message.str());
+#endif
+  }
+  else if(fseeko(fInput, 0, SEEK_SET) == 0)
+  {
+    // plain seekable input is read directly
+    fHeadSize = 0;
+    fPosition = 0;
+    fFile = fInput;
+    return;
+  }
+
+  // the head bytes can't be put back, they are passed on by the thread
+
+  if(pipe(fPipe) != 0)
+  {
+    if(fInput != stdin) fclose(fInput);
+    fInput = 0;
+    message << "can't create a pipe to read " << fileName;
+    throw runtime_error(message.str());
+  }
+
+#ifdef F_SETPIPE_SZ
+  fcntl(fPipe[1], F_SETPIPE_SZ, kPipeSize);
+#endif
+
+  fFile = fdopen(fPipe[0], "r");
+
+  fFileBuffer.resize(kFileBufferSize);
+  setvbuf(fFile, &fFileBuffer[0], _IOFBF, fFileBuffer.size());
+
+  fInputBuffer.resize(kBlockSize);
+  if(fFormat != kPlain) fOutputBuffer.resize(kBlockSize);
+
+  if(!fMutex)
+  {
+    TThread::Initialize();
+    fMutex = new TMutex;
+  }
+
+  fThread = new TThread(DecompressThread, this);
+  fThread->Run();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::Close()
+{
+  stringstream message;
+
+  if(fThread)
+  {
+    fclose(fFile);
+
+    fThread->Join();
+    delete fThread;
+    fThread = 0;
+  }
+  else if(fFile && fFile != fInput)
+  {
+    fclose(fFile);
+  }
+
+  if(fInput && fInput != stdin) fclose(fInput);
+
+  fFile = 0;
+  fInput = 0;
+  fPipe[0] = -1;
+  fPipe[1] = -1;
+
+  if(!fError.empty())
+  {
+    message << "error reading " << fFileName << ": " << fError;
+    fError.clear();
+    throw runtime_error(message.str());
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const char *DelphesInputStream::GetFormatName() const
+{
+  switch(fFormat)
+  {
+    case kGzip: return "gzip";
+    case kZstd: return "zstd";
+    default: return "plain";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesInputStream::GetPosition() const
+{
+  Long64_t position;
+
+  if(fThread)
+  {
+    fMutex->Lock();
+    position = fPosition;
+    fMutex->UnLock();
+    return position;
+  }
+
+  return fFile ? ftello(fFile) : 0;
+}
+
+//------------------------------------------------------------------------------
+
+void *DelphesInputStream::DecompressThread(void *stream)
+{
+  static_cast<DelphesInputStream *>(stream)->Decompress();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::Decompress()
+{
+  sigset_t mask;
+
+  // when the input is closed before its end, the next write fails with EPIPE
+  // instead of raising SIGPIPE; the signal is blocked on this thread only
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &mask, 0);
+
+  switch(fFormat)
+  {
+    case kGzip:
+      InflateGzip();
+      break;
+    case kZstd:
+      DecompressZstd();
+      break;
+    default:
+      CopyPlain();
+      break;
+  }
+
+  // the reader sees the end of the file
+  close(fPipe[1]);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::CopyPlain()
+{
+  size_t size;
+
+  while((size = ReadInput(&fInputBuffer[0], fInputBuffer.size())) > 0)
+  {
+    if(!WriteOutput(&fInputBuffer[0], size)) break;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::InflateGzip()
+{
+  z_stream stream;
+  size_t size;
+  int rc;
+  bool ended = false, full = false;
+
+  memset(&stream, 0, sizeof(stream));
+
+  // 15 + 32: largest window, gzip or zlib header
+  if(inflateInit2(&stream, 15 + 32) != Z_OK)
+  {
+    SetError("can't initialize zlib");
+    return;
+  }
+
+  while(true)
+  {
+    // with a full output buffer inflate may have more to give without new input
+    if(stream.avail_in == 0 && !full)
+    {
+      size = ReadInput(&fInputBuffer[0], fInputBuffer.size());
+      if(size == 0)
+      {
+        if(!ended && fError.empty()) SetError("unexpected end of gzip data");
+        break;
+      }
+      stream.next_in = reinterpret_cast<Bytef *>(&fInputBuffer[0]);
+      stream.avail_in = size;
+    }
+
+    if(ended)
+    {
+      // another member follows, anything else is trailing garbage as for gzip
+      if(stream.avail_in > 0 && stream.next_in[0] != kGzipMagic[0]) break;
+      inflateReset(&stream);
+      ended = false;
+    }
+
+    stream.next_out = reinterpret_cast<Bytef *>(&fOutputBuffer[0]);
+    stream.avail_out = fOutputBuffer.size();
+
+    rc = inflate(&stream, Z_NO_FLUSH);
+
+    if(rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR)
+    {
+      SetError(stream.msg ? stream.msg : "corrupt gzip data");
+      break;
+    }
+
+    full = (stream.avail_out == 0);
+
+    if(!WriteOutput(&fOutputBuffer[0], fOutputBuffer.size() - stream.avail_out)) break;
+
+    if(rc == Z_STREAM_END)
+    {
+      ended = true;
+      full = false;
+    }
+  }
+
+  inflateEnd(&stream);
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::DecompressZstd()
+{
+#ifdef HAS_ZSTD
+  ZSTD_DStream *stream;
+  ZSTD_inBuffer input;
+  ZSTD_outBuffer output;
+  size_t size, rc = 1;
+  bool full = false;
+
+  stream = ZSTD_createDStream();
+  if(!stream || ZSTD_isError(ZSTD_initDStream(stream)))
+  {
+    SetError("can't initialize zstd");
+    if(stream) ZSTD_freeDStream(stream);
+    return;
+  }
+
+  input.src = &fInputBuffer[0];
+  input.size = 0;
+  input.pos = 0;
+
+  while(true)
+  {
+    if(input.pos == input.size && !full)
+    {
+      size = ReadInput(&fInputBuffer[0], fInputBuffer.size());
+      if(size == 0)
+      {
+        // rc is 0 at the end of a frame
+        if(rc != 0 && fError.empty()) SetError("unexpected end of zstd data");
+        break;
+      }
+      input.size = size;
+      input.pos = 0;
+    }
+
+    output.dst = &fOutputBuffer[0];
+    output.size = fOutputBuffer.size();
+    output.pos = 0;
+
+    // frames following each other are decoded one after the other
+    rc = ZSTD_decompressStream(stream, &output, &input);
+
+    if(ZSTD_isError(rc))
+    {
+      SetError(ZSTD_getErrorName(rc));
+      break;
+    }
+
+    full = (output.pos == output.size);
+
+    if(!WriteOutput(&fOutputBuffer[0], output.pos)) break;
+  }
+
+  ZSTD_freeDStream(stream);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+size_t DelphesInputStream::ReadInput(char *buffer, size_t size)
+{
+  size_t done = 0;
+
+  if(fHeadSize > 0)
+  {
+    memcpy(buffer, fHead, fHeadSize);
+    done = fHeadSize;
+    fHeadSize = 0;
+  }
+
+  done += fread(buffer + done, 1, size - done, fInput);
+
+  if(ferror(fInput)) SetError(strerror(errno));
+
+  fMutex->Lock();
+  fPosition += done;
+  fMutex->UnLock();
+
+  return done;
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesInputStream::WriteOutput(const char *buffer, size_t size)
+{
+  ssize_t done;
+
+  while(size > 0)
+  {
+    done = write(fPipe[1], buffer, size);
+    if(done < 0)
+    {
+      if(errno == EINTR) continue;
+      // EPIPE: the input was closed before its end
+      if(errno != EPIPE) SetError(strerror(errno));
+      return false;
+    }
+    buffer += done;
+    size -= done;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesInputStream::SetError(const char *error)
+{
+  if(fError.empty()) fError = error;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,89 @@
+#ifndef DelphesInputStream_h
+#define DelphesInputStream_h
+
+/** \class DelphesInputStream
+ *
+ *  Opens an input file for the readers, decompressing it when needed.
+ *
+ *  gzip and zstd files are recognized by their first bytes and
+ *  decompressed by a background thread into a pipe, which the readers
+ *  read as any other FILE. Files made of several concatenated gzip
+ *  members or zstd frames are read as one stream. Other files, and the
+ *  standard input when it is not compressed, are read directly.
+ *
+ *  GetPosition counts the bytes of the file as stored, so it can be
+ *  compared with GetSize for compressed files too.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+class TThread;
+class TMutex;
+
+class DelphesInputStream
+{
+public:
+
+  enum Format { kPlain, kGzip, kZstd };
+
+  DelphesInputStream();
+  ~DelphesInputStream();
+
+  // opens fileName, - for the standard input
+  void Open(const char *fileName);
+
+  // closes the input, throws if the decompression failed
+  void Close();
+
+  FILE *GetFile() const { return fFile; }
+
+  Format GetFormat() const { return fFormat; }
+  const char *GetFormatName() const;
+
+  // size of the file as stored, -1 when unknown
+  Long64_t GetSize() const { return fSize; }
+
+  // bytes of the file as stored read so far
+  Long64_t GetPosition() const;
+
+private:
+
+  static void *DecompressThread(void *stream);
+
+  void Decompress();
+  void CopyPlain();
+  void InflateGzip();
+  void DecompressZstd();
+
+  size_t ReadInput(char *buffer, size_t size);
+  bool WriteOutput(const char *buffer, size_t size);
+  void SetError(const char *error);
+
+  std::string fFileName;
+  Format fFormat;
+
+  FILE *fInput;
+  FILE *fFile;
+  int fPipe[2];
+
+  Long64_t fSize;
+  Long64_t fPosition;
+
+  // first bytes of the file, read to find its format
+  char fHead[4];
+  size_t fHeadSize;
+
+  std::vector<char> fInputBuffer, fOutputBuffer, fFileBuffer;
+
+  TThread *fThread;
+  TMutex *fMutex;
+  std::string fError;
+};
+
+#endif // DelphesInputStream_h
@@ -22,12 +22,11 @@
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 #include "classes/DelphesStream.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -44,7 +43,7 @@ DelphesLHEFReader::DelphesLHEFReader() :
 {
   fBuffer = new char[kBufferSize];
 
-  fPDG = TDatabasePDG::Instance();
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
@@ -168,7 +167,6 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
   int pdgCode;
 
   candidate = factory->NewCandidate();
@@ -178,8 +176,7 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
 
   candidate->Status = fStatus;
 
-  pdgParticle = fPDG->GetParticle(fPID);
-  candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+  candidate->Charge = fPDG->GetCharge(fPID);
   candidate->Mass = fMass;
 
   candidate->Momentum.SetPxPyPzE(fPx, fPy, fPz, fE);
@@ -193,9 +190,9 @@ void DelphesLHEFReader::AnalyzeParticle(DelphesFactory *factory,
 
   allParticleOutputArray->Add(candidate);
 
-  if(!pdgParticle) return;
+  if(!fPDG->IsKnown(fPID)) return;
 
-  if(fStatus == 1 && pdgParticle->Stable())
+  if(fStatus == 1 && fPDG->IsStable(fPID))
   {
     stableParticleOutputArray->Add(candidate);
   }
@@ -18,7 +18,7 @@
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
 
@@ -53,7 +53,7 @@ private:
 
   char *fBuffer;
 
-  TDatabasePDG *fPDG;
+  const DelphesPDGTable *fPDG;
 
   int fEventCounter;
 
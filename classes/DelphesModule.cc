@@ -100,6 +100,13 @@ TObjArray *DelphesModule::ExportArray(const char *name)
 //------------------------------------------------------------------------------
 
 ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
+{
+  return GetTreeWriter()->NewBranch(name, cl);
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeWriter *DelphesModule::GetTreeWriter()
 {
   stringstream message;
   if(!fTreeWriter)
@@ -111,7 +118,7 @@ ExRootTreeBranch *DelphesModule::NewBranch(const char *name, TClass *cl)
       throw runtime_error(message.str());
     }
   }
-  return fTreeWriter->NewBranch(name, cl);
+  return fTreeWriter;
 }
 
 //------------------------------------------------------------------------------
@@ -41,6 +41,7 @@ public:
   TObjArray *ExportArray(const char *name);
 
   ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
+  ExRootTreeWriter *GetTreeWriter();
 
   ExRootResult *GetPlots();
   DelphesFactory *GetFactory();
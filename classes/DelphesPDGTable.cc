@@ -0,0 +1,72 @@
+
+/** \class DelphesPDGTable
+ *
+ *  Charge, mass and stability of all particles known to TDatabasePDG,
+ *  copied once into flat arrays: one entry per PDG code for |pid| < 10000,
+ *  a map for the other codes. The table is read-only after it is built,
+ *  so it can be used from several threads.
+ *
+ */
+
+#include "classes/DelphesPDGTable.h"
+
+#include "TThread.h"
+#include "TDatabasePDG.h"
+#include "TParticlePDG.h"
+
+using namespace std;
+
+DelphesPDGTable *DelphesPDGTable::fgInstance = 0;
+
+//------------------------------------------------------------------------------
+
+const DelphesPDGTable *DelphesPDGTable::Instance()
+{
+  // TThread::Lock does nothing until threads are initialized
+  TThread::Lock();
+  if(!fgInstance) fgInstance = new DelphesPDGTable;
+  TThread::UnLock();
+
+  return fgInstance;
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPDGTable::DelphesPDGTable()
+{
+  TDatabasePDG *pdg = TDatabasePDG::Instance();
+  TParticlePDG *pdgParticle;
+  Entry entry;
+  Int_t pid;
+
+  fUnknown.known = kFALSE;
+  fUnknown.stable = kFALSE;
+  fUnknown.charge = -999;
+  fUnknown.mass = -999.9;
+
+  fDense.assign(2*kDenseSize, fUnknown);
+
+  if(!pdg->ParticleList()) pdg->ReadPDGTable();
+
+  TIter itParticles(pdg->ParticleList());
+  while((pdgParticle = static_cast<TParticlePDG *>(itParticles.Next())))
+  {
+    pid = pdgParticle->PdgCode();
+
+    entry.known = kTRUE;
+    entry.stable = pdgParticle->Stable();
+    entry.charge = Int_t(pdgParticle->Charge()/3.0);
+    entry.mass = pdgParticle->Mass();
+
+    if(pid > -kDenseSize && pid < kDenseSize)
+    {
+      fDense[pid + kDenseSize] = entry;
+    }
+    else
+    {
+      fSparse[pid] = entry;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+#ifndef DelphesPDGTable_h
+#define DelphesPDGTable_h
+
+/** \class DelphesPDGTable
+ *
+ *  Charge, mass and stability of all particles known to TDatabasePDG,
+ *  copied once into flat arrays: one entry per PDG code for |pid| < 10000,
+ *  a map for the other codes. The table is read-only after it is built,
+ *  so it can be used from several threads.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <vector>
+
+class DelphesPDGTable
+{
+public:
+
+  // builds the table on first use, call it once before starting threads
+  static const DelphesPDGTable *Instance();
+
+  Bool_t IsKnown(Int_t pid) const { return Find(pid).known; }
+  Bool_t IsStable(Int_t pid) const { return Find(pid).stable; }
+
+  // charge in units of e, -999 for unknown particles
+  Int_t GetCharge(Int_t pid) const { return Find(pid).charge; }
+
+  // mass in GeV, -999.9 for unknown particles
+  Double_t GetMass(Int_t pid) const { return Find(pid).mass; }
+
+private:
+
+  struct Entry
+  {
+    Bool_t known, stable;
+    Int_t charge;
+    Double_t mass;
+  };
+
+  DelphesPDGTable();
+
+  const Entry &Find(Int_t pid) const
+  {
+    std::map<Int_t, Entry>::const_iterator itSparse;
+    if(pid > -kDenseSize && pid < kDenseSize) return fDense[pid + kDenseSize];
+    itSparse = fSparse.find(pid);
+    return itSparse != fSparse.end() ? itSparse->second : fUnknown;
+  }
+
+  static const Int_t kDenseSize = 10000;
+
+  std::vector<Entry> fDense;
+  std::map<Int_t, Entry> fSparse;
+  Entry fUnknown;
+
+  static DelphesPDGTable *fgInstance;
+};
+
+#endif // DelphesPDGTable_h
@@ -0,0 +1,172 @@
+#ifndef DelphesPileUpFormat_h
+#define DelphesPileUpFormat_h
+
+/** \file DelphesPileUpFormat.h
+ *
+ *  Layout of the version 2 pile-up binary file, shared by
+ *  DelphesPileUpWriter and DelphesPileUpReader.
+ *
+ *  header  : magic "DPUF", version, flags, metadata size, metadata text
+ *  events  : particle count, stored size, stored columns
+ *  index   : offset of each event, number of events
+ *
+ *  All integers are little-endian (4 bytes, 8 bytes for the index).
+ *  The columns of one event are pid (int32), charge (int8), mass (float32),
+ *  x, y, z, t (float16), px, py, pz, e (float32), one little-endian array
+ *  after the other. By default the events are stored as is, the stored
+ *  size then equals the size of the columns and the reader decodes them
+ *  directly from the file mapping.
+ *
+ *  Compression is optional. Each multi-byte column of a compressed event
+ *  is stored byte plane after byte plane, which groups the exponent bytes
+ *  together, and the whole event is compressed with the ROOT zip
+ *  algorithm. An event that compression does not make smaller is stored
+ *  as is.
+ *
+ *  With kPileUpOrderedByPT set, the particles of each event are sorted
+ *  by decreasing transverse momentum.
+ *
+ */
+
+#include <string.h>
+
+static const char kPileUpMagic[4] = {'D', 'P', 'U', 'F'};
+static const unsigned int kPileUpVersion = 2;
+static const unsigned int kPileUpHeaderSize = 16;
+static const unsigned int kPileUpEventHeaderSize = 8;
+
+// bytes per particle in the columns of one event
+static const unsigned int kPileUpParticleSize = 4 + 1 + 4 + 4*2 + 4*4;
+
+// bytes per value of each column, in the order of the columns
+static const unsigned int kPileUpColumns = 11;
+static const unsigned int kPileUpColumnSize[kPileUpColumns] = {4, 1, 4, 2, 2, 2, 2, 4, 4, 4, 4};
+
+// maximum number of particles in one event
+static const unsigned int kPileUpMaxParticles = 0x7fffffff/kPileUpParticleSize;
+
+// charge stored for particles unknown to TDatabasePDG
+static const signed char kPileUpUnknownCharge = -128;
+
+enum PileUpFlags
+{
+  kPileUpOrderedByPT = 1
+};
+
+//------------------------------------------------------------------------------
+
+inline void PileUpEncodeWord(unsigned char *data, unsigned int value)
+{
+  data[0] = value; data[1] = value >> 8; data[2] = value >> 16; data[3] = value >> 24;
+}
+
+inline unsigned int PileUpDecodeWord(const unsigned char *data)
+{
+  return (unsigned int)data[0] | (unsigned int)data[1] << 8 |
+         (unsigned int)data[2] << 16 | (unsigned int)data[3] << 24;
+}
+
+//------------------------------------------------------------------------------
+
+// byte planes of the columns of n particles, as stored in compressed events
+
+inline void PileUpShuffle(unsigned char *output, const unsigned char *data, int n)
+{
+  unsigned int column, size, k;
+  int i;
+
+  for(column = 0; column < kPileUpColumns; ++column)
+  {
+    size = kPileUpColumnSize[column];
+    for(i = 0; i < n; ++i)
+    {
+      for(k = 0; k < size; ++k) output[k*n + i] = data[i*size + k];
+    }
+    output += size*n;
+    data += size*n;
+  }
+}
+
+inline void PileUpUnshuffle(unsigned char *output, const unsigned char *data, int n)
+{
+  unsigned int column, size, k;
+  int i;
+
+  for(column = 0; column < kPileUpColumns; ++column)
+  {
+    size = kPileUpColumnSize[column];
+    for(i = 0; i < n; ++i)
+    {
+      for(k = 0; k < size; ++k) output[i*size + k] = data[k*n + i];
+    }
+    output += size*n;
+    data += size*n;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// IEEE 754 half precision, rounded to nearest even, saturated to the largest finite value
+
+inline unsigned short PileUpFloatToHalf(float value)
+{
+  unsigned int bits, sign, mantissa;
+  int exponent;
+
+  memcpy(&bits, &value, 4);
+
+  sign = (bits >> 16) & 0x8000;
+  exponent = int((bits >> 23) & 0xff) - 127 + 15;
+  mantissa = bits & 0x7fffff;
+
+  if(exponent >= 31)
+  {
+    // keep NaN, saturate everything else
+    if(((bits >> 23) & 0xff) == 0xff && mantissa) return sign | 0x7e00;
+    return sign | 0x7bff;
+  }
+
+  if(exponent <= 0)
+  {
+    if(exponent < -10) return sign;
+    mantissa |= 0x800000;
+    bits = mantissa >> (14 - exponent);
+    if((mantissa >> (13 - exponent) & 1) && ((mantissa & ((1u << (13 - exponent)) - 1)) || (bits & 1))) ++bits;
+    return sign | bits;
+  }
+
+  bits = (exponent << 10) | (mantissa >> 13);
+  if((mantissa & 0x1000) && ((mantissa & 0xfff) || (bits & 1))) ++bits;
+  if(bits >= 0x7c00) bits = 0x7bff;
+  return sign | bits;
+}
+
+inline float PileUpHalfToFloat(unsigned short half)
+{
+  unsigned int sign = (half & 0x8000) << 16;
+  unsigned int exponent = (half >> 10) & 0x1f;
+  unsigned int mantissa = half & 0x3ff;
+  unsigned int bits;
+  float value;
+
+  if(exponent == 0)
+  {
+    // zero or subnormal
+    value = mantissa*(1.0f/16777216.0f);
+    return sign ? -value : value;
+  }
+
+  if(exponent == 31)
+  {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else
+  {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+
+  memcpy(&value, &bits, 4);
+  return value;
+}
+
+#endif // DelphesPileUpFormat_h
@@ -0,0 +1,159 @@
+
+/** \class DelphesPileUpPool
+ *
+ *  Pile-up events decoded once into memory, stored as one array per
+ *  particle field, with PDG charge and mass already resolved.
+ *  Event i holds the particles [GetBegin(i), GetEnd(i)).
+ *
+ *  Pools are shared read-only: all the users asking for the same
+ *  file and the same subset get the same pool.
+ *
+ */
+
+#include "classes/DelphesPileUpPool.h"
+#include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPDGTable.h"
+
+#include "TRandom3.h"
+#include "TStopwatch.h"
+#include "TThread.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+map<string, DelphesPileUpPool *> DelphesPileUpPool::fgPools;
+
+//------------------------------------------------------------------------------
+
+DelphesPileUpPool *DelphesPileUpPool::Acquire(const char *fileName, Long64_t maxEntries, UInt_t seed)
+{
+  DelphesPileUpPool *pool = 0;
+  map<string, DelphesPileUpPool *>::iterator itPools;
+  stringstream key;
+
+  key << fileName << ':' << (maxEntries > 0 ? maxEntries : 0) << ':' << (maxEntries > 0 ? seed : 0);
+
+  // TThread::Lock does nothing until threads are initialized
+  TThread::Lock();
+  try
+  {
+    itPools = fgPools.find(key.str());
+    if(itPools != fgPools.end())
+    {
+      pool = itPools->second;
+    }
+    else
+    {
+      pool = new DelphesPileUpPool(fileName, maxEntries, seed);
+      pool->fKey = key.str();
+      fgPools[pool->fKey] = pool;
+    }
+    ++pool->fUsers;
+  }
+  catch(...)
+  {
+    TThread::UnLock();
+    throw;
+  }
+  TThread::UnLock();
+
+  return pool;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpPool::Release(DelphesPileUpPool *pool)
+{
+  if(!pool) return;
+
+  TThread::Lock();
+  if(--pool->fUsers == 0)
+  {
+    fgPools.erase(pool->fKey);
+    delete pool;
+  }
+  TThread::UnLock();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPileUpPool::DelphesPileUpPool(const char *fileName, Long64_t maxEntries, UInt_t seed) :
+  fUsers(0), fLoadTime(0.0), fOrderedByPT(kFALSE)
+{
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  DelphesPileUpReader reader(fileName);
+  TStopwatch stopwatch;
+  TRandom3 random(seed);
+  Long64_t entry, allEntries, needed, first, size, i;
+
+  stopwatch.Start();
+
+  allEntries = reader.GetEntries();
+  fOrderedByPT = reader.IsOrderedByPT();
+  needed = (maxEntries > 0 && maxEntries < allEntries) ? maxEntries : allEntries;
+
+  fBegin.reserve(needed + 1);
+  fBegin.push_back(0);
+
+  for(entry = 0; entry < allEntries && needed > 0; ++entry)
+  {
+    // selection sampling: each remaining event is kept with probability needed/remaining,
+    // the subset is uniform and the file is read in order
+    if(needed < allEntries - entry && random.Rndm()*(allEntries - entry) >= needed) continue;
+    --needed;
+
+    reader.ReadEntry(entry);
+
+    first = fPID.size();
+    size = reader.GetEntrySize();
+
+    fPID.resize(first + size);
+    fX.resize(first + size); fY.resize(first + size); fZ.resize(first + size); fT.resize(first + size);
+    fPx.resize(first + size); fPy.resize(first + size); fPz.resize(first + size); fE.resize(first + size);
+
+    fCharge.resize(first + size);
+    fMass.resize(first + size);
+
+    if(size > 0)
+    {
+      reader.ReadParticles(&fPID[first],
+        &fX[first], &fY[first], &fZ[first], &fT[first],
+        &fPx[first], &fPy[first], &fPz[first], &fE[first]);
+      reader.ReadProperties(&fCharge[first], &fMass[first]);
+    }
+
+    fBegin.push_back(first + size);
+  }
+
+  // resolve PDG properties, version 2 files store them
+  size = (reader.GetVersion() == 1) ? fPID.size() : 0;
+  for(i = 0; i < size; ++i)
+  {
+    fCharge[i] = pdg->GetCharge(fPID[i]);
+    fMass[i] = pdg->GetMass(fPID[i]);
+  }
+
+  stopwatch.Stop();
+  fLoadTime = stopwatch.RealTime();
+}
+
+//------------------------------------------------------------------------------
+
+DelphesPileUpPool::~DelphesPileUpPool()
+{
+}
+
+//------------------------------------------------------------------------------
+
+Long64_t DelphesPileUpPool::GetMemorySize() const
+{
+  return fBegin.capacity()*sizeof(Long64_t) +
+    (fPID.capacity() + fCharge.capacity())*sizeof(Int_t) +
+    (fMass.capacity() + fX.capacity() + fY.capacity() + fZ.capacity() + fT.capacity() +
+     fPx.capacity() + fPy.capacity() + fPz.capacity() + fE.capacity())*sizeof(Float_t);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+#ifndef DelphesPileUpPool_h
+#define DelphesPileUpPool_h
+
+/** \class DelphesPileUpPool
+ *
+ *  Pile-up events decoded once into memory, stored as one array per
+ *  particle field, with PDG charge and mass already resolved.
+ *  Event i holds the particles [GetBegin(i), GetEnd(i)).
+ *
+ *  Pools are shared read-only: all the users asking for the same
+ *  file and the same subset get the same pool.
+ *
+ */
+
+#include "Rtypes.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class DelphesPileUpPool
+{
+public:
+
+  // maxEntries > 0 keeps a random subset of maxEntries events drawn with seed
+  static DelphesPileUpPool *Acquire(const char *fileName, Long64_t maxEntries = 0, UInt_t seed = 0);
+  static void Release(DelphesPileUpPool *pool);
+
+  Long64_t GetEntries() const { return fBegin.size() - 1; }
+  Long64_t GetParticles() const { return fPID.size(); }
+
+  Long64_t GetBegin(Long64_t entry) const { return fBegin[entry]; }
+  Long64_t GetEnd(Long64_t entry) const { return fBegin[entry + 1]; }
+
+  // arrays over all particles of the pool, indexed from GetBegin(entry) to GetEnd(entry)
+  const Int_t *GetPID() const { return fPID.empty() ? 0 : &fPID[0]; }
+  const Int_t *GetCharge() const { return fCharge.empty() ? 0 : &fCharge[0]; }
+  const Float_t *GetMass() const { return fMass.empty() ? 0 : &fMass[0]; }
+
+  const Float_t *GetX() const { return fX.empty() ? 0 : &fX[0]; }
+  const Float_t *GetY() const { return fY.empty() ? 0 : &fY[0]; }
+  const Float_t *GetZ() const { return fZ.empty() ? 0 : &fZ[0]; }
+  const Float_t *GetT() const { return fT.empty() ? 0 : &fT[0]; }
+
+  const Float_t *GetPx() const { return fPx.empty() ? 0 : &fPx[0]; }
+  const Float_t *GetPy() const { return fPy.empty() ? 0 : &fPy[0]; }
+  const Float_t *GetPz() const { return fPz.empty() ? 0 : &fPz[0]; }
+  const Float_t *GetE() const { return fE.empty() ? 0 : &fE[0]; }
+
+  // memory used by the pool in bytes
+  Long64_t GetMemorySize() const;
+
+  // time spent decoding the file in seconds
+  Double_t GetLoadTime() const { return fLoadTime; }
+
+  // particles of each event sorted by decreasing pT
+  Bool_t IsOrderedByPT() const { return fOrderedByPT; }
+
+private:
+
+  DelphesPileUpPool(const char *fileName, Long64_t maxEntries, UInt_t seed);
+  ~DelphesPileUpPool();
+
+  std::string fKey;
+  Int_t fUsers;
+
+  Double_t fLoadTime;
+  Bool_t fOrderedByPT;
+
+  std::vector<Long64_t> fBegin;
+
+  std::vector<Int_t> fPID, fCharge;
+  std::vector<Float_t> fMass;
+  std::vector<Float_t> fX, fY, fZ, fT;
+  std::vector<Float_t> fPx, fPy, fPz, fE;
+
+  static std::map<std::string, DelphesPileUpPool *> fgPools;
+};
+
+#endif // DelphesPileUpPool_h
@@ -3,6 +3,12 @@
  *
  *  Reads pile-up binary file
  *
+ *  The file is memory-mapped, the index of events is validated once
+ *  when the file is opened and the big-endian records are decoded
+ *  directly from the mapping, one particle or one full event at a time.
+ *
+ *  Version 2 files (see DelphesPileUpFormat.h) are recognized by their
+ *  header, compressed events are decompressed when they are selected.
  *
  *  $Date: 2013-03-08 09:25:30 +0100 (Fri, 08 Mar 2013) $
  *  $Revision: 1046 $
@@ -13,76 +19,290 @@
  */
 
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpFormat.h"
+
+#include "RZip.h"
 
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 
-#include <stdio.h>
-#include <rpc/types.h>
-#include <rpc/xdr.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
-static const int kIndexSize = 10000000;
-static const int kBufferSize = 1000000;
 static const int kRecordSize = 9;
 
 //------------------------------------------------------------------------------
 
+// XDR stores 32-bit and 64-bit words in big-endian order
+
+static inline unsigned int DecodeWord(const unsigned char *data)
+{
+  return (unsigned int)data[0] << 24 | (unsigned int)data[1] << 16 |
+         (unsigned int)data[2] << 8 | (unsigned int)data[3];
+}
+
+static inline int DecodeInt(const unsigned char *data)
+{
+  return int(DecodeWord(data));
+}
+
+static inline float DecodeFloat(const unsigned char *data)
+{
+  unsigned int word = DecodeWord(data);
+  float value;
+  memcpy(&value, &word, 4);
+  return value;
+}
+
+static inline quad_t DecodeHyper(const unsigned char *data)
+{
+  return quad_t((u_quad_t)DecodeWord(data) << 32 | DecodeWord(data + 4));
+}
+
+//------------------------------------------------------------------------------
+
+// version 2 stores little-endian values column after column
+
+static inline quad_t DecodeHyperV2(const unsigned char *data)
+{
+  return quad_t((u_quad_t)PileUpDecodeWord(data + 4) << 32 | PileUpDecodeWord(data));
+}
+
+static inline bool IsLittleEndian()
+{
+  unsigned int one = 1;
+  return *reinterpret_cast<unsigned char *>(&one) == 1;
+}
+
+static inline float UnpackFloat(const unsigned char *column, int i)
+{
+  unsigned int word = PileUpDecodeWord(column + 4*i);
+  float value;
+  memcpy(&value, &word, 4);
+  return value;
+}
+
+// copies a column of n 4-byte values, as they are on little-endian hosts
+
+static inline void UnpackColumn(void *output, const unsigned char *column, int n)
+{
+  unsigned char *data = static_cast<unsigned char *>(output);
+  unsigned int word;
+  int i;
+
+  if(IsLittleEndian())
+  {
+    memcpy(data, column, 4*n);
+    return;
+  }
+
+  for(i = 0; i < n; ++i)
+  {
+    word = PileUpDecodeWord(column + 4*i);
+    memcpy(data + 4*i, &word, 4);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// float values of all half precision numbers, computed once
+
+class DelphesPileUpHalfTable
+{
+public:
+  DelphesPileUpHalfTable()
+  {
+    unsigned int half;
+    for(half = 0; half < 65536; ++half) fValues[half] = PileUpHalfToFloat(half);
+  }
+  float fValues[65536];
+};
+
+static const DelphesPileUpHalfTable kHalfTable;
+
+static inline float UnpackHalf(const unsigned char *column, int i)
+{
+  return kHalfTable.fValues[column[2*i] | column[2*i + 1] << 8];
+}
+
+//------------------------------------------------------------------------------
+
 DelphesPileUpReader::DelphesPileUpReader(const char *fileName) :
+  fVersion(1), fOrderedByPT(false),
   fEntries(0), fEntrySize(0), fCounter(0),
-  fPileUpFile(0), fIndex(0), fBuffer(0),
-  fInputXDR(0), fIndexXDR(0), fBufferXDR(0)
+  fPileUpFile(-1), fFileSize(0),
+  fData(0), fIndex(0), fRecord(0)
 {
   stringstream message;
+  struct stat fileStat;
+  void *data;
 
-  fIndex = new char[kIndexSize*8];
-  fBuffer = new char[kBufferSize*kRecordSize*4];
-  fInputXDR = new XDR;
-  fIndexXDR = new XDR;
-  fBufferXDR = new XDR;
-  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_DECODE);
-  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_DECODE);
+  fPileUpFile = open(fileName, O_RDONLY);
 
-  fPileUpFile = fopen(fileName, "r");
-
-  if(fPileUpFile == NULL)
+  if(fPileUpFile < 0)
   {
     message << "can't open pile-up file " << fileName;
     throw runtime_error(message.str());
   }
 
-  xdrstdio_create(fInputXDR, fPileUpFile, XDR_DECODE);
+  if(fstat(fPileUpFile, &fileStat) != 0 || fileStat.st_size < 8)
+  {
+    close(fPileUpFile);
+    message << "can't read pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fFileSize = fileStat.st_size;
+
+  data = mmap(0, fFileSize, PROT_READ, MAP_SHARED, fPileUpFile, 0);
+
+  if(data == MAP_FAILED)
+  {
+    close(fPileUpFile);
+    message << "can't map pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fData = static_cast<const unsigned char *>(data);
+
+  // events are picked at random
+  madvise(data, fFileSize, MADV_RANDOM);
+
+  if(fFileSize >= kPileUpHeaderSize && memcmp(fData, kPileUpMagic, 4) == 0)
+  {
+    OpenV2(fileName);
+  }
+  else
+  {
+    OpenV1(fileName);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::OpenV1(const char *fileName)
+{
+  stringstream message;
+  quad_t entry, offset, indexOffset;
+
+  fVersion = 1;
 
   // read number of events
-  fseek(fPileUpFile, -8, SEEK_END);
-  xdr_hyper(fInputXDR, &fEntries);
+  fEntries = DecodeHyper(fData + fFileSize - 8);
 
-  if(fEntries >= kIndexSize)
+  if(fEntries < 0 || quad_t(fFileSize - 8)/8 < fEntries)
   {
-    message << "too many events in pile-up file " << fileName;
+    Close();
+    message << "corrupted index in pile-up file " << fileName;
     throw runtime_error(message.str());
   }
 
-  // read index of events
-  fseek(fPileUpFile, -8 - 8*fEntries, SEEK_END);
-  xdr_opaque(fInputXDR, fIndex, fEntries*8);
+  // validate index of events
+  indexOffset = fFileSize - 8 - 8*fEntries;
+  fIndex = fData + indexOffset;
+
+  for(entry = 0; entry < fEntries; ++entry)
+  {
+    offset = DecodeHyper(fIndex + 8*entry);
+    if(offset < 0 || offset + 4 > indexOffset ||
+       DecodeWord(fData + offset) > (u_quad_t)(indexOffset - offset - 4)/(kRecordSize*4))
+    {
+      Close();
+      message << "corrupted event " << entry << " in pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::OpenV2(const char *fileName)
+{
+  stringstream message;
+  quad_t entry, offset, indexOffset, dataOffset;
+  unsigned int version, metadataSize, size, storedSize;
+
+  version = PileUpDecodeWord(fData + 4);
+  metadataSize = PileUpDecodeWord(fData + 12);
+
+  if(version != kPileUpVersion)
+  {
+    Close();
+    message << "unsupported version " << version << " of pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  if(fFileSize < kPileUpHeaderSize + 8 || metadataSize > fFileSize - kPileUpHeaderSize - 8)
+  {
+    Close();
+    message << "corrupted header in pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  fVersion = 2;
+  fOrderedByPT = PileUpDecodeWord(fData + 8) & kPileUpOrderedByPT;
+  fMetadata.assign(reinterpret_cast<const char *>(fData + kPileUpHeaderSize), metadataSize);
+
+  dataOffset = kPileUpHeaderSize + metadataSize;
+
+  // read number of events
+  fEntries = DecodeHyperV2(fData + fFileSize - 8);
+
+  if(fEntries < 0 || quad_t(fFileSize - 8 - dataOffset)/8 < fEntries)
+  {
+    Close();
+    message << "corrupted index in pile-up file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  // validate index of events
+  indexOffset = fFileSize - 8 - 8*fEntries;
+  fIndex = fData + indexOffset;
+
+  for(entry = 0; entry < fEntries; ++entry)
+  {
+    offset = DecodeHyperV2(fIndex + 8*entry);
+    if(offset < dataOffset || offset + kPileUpEventHeaderSize > indexOffset)
+    {
+      size = 0;
+      storedSize = 1;
+    }
+    else
+    {
+      size = PileUpDecodeWord(fData + offset);
+      storedSize = PileUpDecodeWord(fData + offset + 4);
+    }
+    if(size > kPileUpMaxParticles || storedSize > size*kPileUpParticleSize ||
+       storedSize > (u_quad_t)(indexOffset - offset - kPileUpEventHeaderSize))
+    {
+      Close();
+      message << "corrupted event " << entry << " in pile-up file " << fileName;
+      throw runtime_error(message.str());
+    }
+  }
 }
 
 //------------------------------------------------------------------------------
 
 DelphesPileUpReader::~DelphesPileUpReader()
 {
-  xdr_destroy(fInputXDR);
-  if(fPileUpFile) fclose(fPileUpFile);
-  xdr_destroy(fBufferXDR);
-  xdr_destroy(fIndexXDR);
-  if(fBufferXDR) delete fBufferXDR;
-  if(fIndexXDR) delete fIndexXDR;
-  if(fInputXDR) delete fInputXDR;
-  if(fBuffer) delete[] fBuffer;
-  if(fIndex) delete[] fIndex;
+  Close();
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::Close()
+{
+  if(fData) munmap(const_cast<unsigned char *>(fData), fFileSize);
+  if(fPileUpFile >= 0) close(fPileUpFile);
+  fData = 0;
+  fPileUpFile = -1;
 }
 
 //------------------------------------------------------------------------------
@@ -91,17 +311,43 @@ bool DelphesPileUpReader::ReadParticle(int &pid,
   float &x, float &y, float &z, float &t,
   float &px, float &py, float &pz, float &e)
 {
+  const unsigned char *data;
+  int i, n;
+
   if(fCounter >= fEntrySize) return false;
 
-  xdr_int(fBufferXDR, &pid);
-  xdr_float(fBufferXDR, &x);
-  xdr_float(fBufferXDR, &y);
-  xdr_float(fBufferXDR, &z);
-  xdr_float(fBufferXDR, &t);
-  xdr_float(fBufferXDR, &px);
-  xdr_float(fBufferXDR, &py);
-  xdr_float(fBufferXDR, &pz);
-  xdr_float(fBufferXDR, &e);
+  if(fVersion == 2)
+  {
+    data = fRecord;
+    i = fCounter;
+    n = fEntrySize;
+
+    pid = int(PileUpDecodeWord(data + 4*i));
+    x = UnpackHalf(data + 9*n, i);
+    y = UnpackHalf(data + 11*n, i);
+    z = UnpackHalf(data + 13*n, i);
+    t = UnpackHalf(data + 15*n, i);
+    px = UnpackFloat(data + 17*n, i);
+    py = UnpackFloat(data + 21*n, i);
+    pz = UnpackFloat(data + 25*n, i);
+    e = UnpackFloat(data + 29*n, i);
+
+    ++fCounter;
+
+    return true;
+  }
+
+  data = fRecord + fCounter*kRecordSize*4;
+
+  pid = DecodeInt(data);
+  x = DecodeFloat(data + 4);
+  y = DecodeFloat(data + 8);
+  z = DecodeFloat(data + 12);
+  t = DecodeFloat(data + 16);
+  px = DecodeFloat(data + 20);
+  py = DecodeFloat(data + 24);
+  pz = DecodeFloat(data + 28);
+  e = DecodeFloat(data + 32);
 
   ++fCounter;
 
@@ -110,28 +356,157 @@ bool DelphesPileUpReader::ReadParticle(int &pid,
 
 //------------------------------------------------------------------------------
 
+void DelphesPileUpReader::ReadParticles(int *pid,
+  float *x, float *y, float *z, float *t,
+  float *px, float *py, float *pz, float *e)
+{
+  const unsigned char *data = fRecord;
+  int i, n = fEntrySize;
+
+  if(fVersion == 2)
+  {
+    UnpackColumn(pid, data, n);
+    for(i = 0; i < n; ++i) x[i] = UnpackHalf(data + 9*n, i);
+    for(i = 0; i < n; ++i) y[i] = UnpackHalf(data + 11*n, i);
+    for(i = 0; i < n; ++i) z[i] = UnpackHalf(data + 13*n, i);
+    for(i = 0; i < n; ++i) t[i] = UnpackHalf(data + 15*n, i);
+    UnpackColumn(px, data + 17*n, n);
+    UnpackColumn(py, data + 21*n, n);
+    UnpackColumn(pz, data + 25*n, n);
+    UnpackColumn(e, data + 29*n, n);
+
+    fCounter = fEntrySize;
+    return;
+  }
+
+  // one pass per record without calls: the compiler turns the decoding into byte swaps
+  for(i = 0; i < fEntrySize; ++i, data += kRecordSize*4)
+  {
+    pid[i] = DecodeInt(data);
+    x[i] = DecodeFloat(data + 4);
+    y[i] = DecodeFloat(data + 8);
+    z[i] = DecodeFloat(data + 12);
+    t[i] = DecodeFloat(data + 16);
+    px[i] = DecodeFloat(data + 20);
+    py[i] = DecodeFloat(data + 24);
+    pz[i] = DecodeFloat(data + 28);
+    e[i] = DecodeFloat(data + 32);
+  }
+
+  fCounter = fEntrySize;
+}
+
+//------------------------------------------------------------------------------
+
 bool DelphesPileUpReader::ReadEntry(quad_t entry)
 {
   quad_t offset;
 
-  if(entry >= fEntries) return false;
+  if(entry < 0 || entry >= fEntries) return false;
 
-  // read event position
-  xdr_setpos(fIndexXDR, 8*entry);
-  xdr_hyper(fIndexXDR, &offset);
+  if(fVersion == 2) return ReadEntryV2(entry);
 
-  // read event
-  fseek(fPileUpFile, offset, SEEK_SET);
-  xdr_int(fInputXDR, &fEntrySize);
+  // read event position, checked when the file was opened
+  offset = DecodeHyper(fIndex + 8*entry);
+
+  fEntrySize = DecodeInt(fData + offset);
+  fRecord = fData + offset + 4;
+  fCounter = 0;
 
-  if(fEntrySize >= kBufferSize)
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesPileUpReader::ReadEntryV2(quad_t entry)
+{
+  const unsigned char *data;
+  quad_t offset;
+  int size, storedSize;
+
+  // read event position, checked when the file was opened
+  offset = DecodeHyperV2(fIndex + 8*entry);
+
+  size = PileUpDecodeWord(fData + offset);
+  storedSize = PileUpDecodeWord(fData + offset + 4);
+  data = fData + offset + kPileUpEventHeaderSize;
+
+  fEntrySize = 0;
+  fCounter = 0;
+
+  if(storedSize == int(size*kPileUpParticleSize))
+  {
+    // stored without compression, read directly from the mapping
+    fRecord = data;
+  }
+  else
   {
-    throw runtime_error("too many particles in pile-up event");
+    DecompressEntryV2(entry, data, storedSize, size);
+    fRecord = &fColumns[0];
   }
 
-  xdr_opaque(fInputXDR, fBuffer, fEntrySize*kRecordSize*4);
-  xdr_setpos(fBufferXDR, 0);
-  fCounter = 0;
+  fEntrySize = size;
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpReader::DecompressEntryV2(quad_t entry, const unsigned char *data, int storedSize, int size)
+{
+  unsigned char *output;
+  int rawSize = size*kPileUpParticleSize, srcSize, tgtSize, irep;
+  stringstream message;
+
+  fShuffled.resize(rawSize);
+  output = &fShuffled[0];
+
+  while(storedSize > 0)
+  {
+    if(storedSize < 9 || R__unzip_header(&srcSize, const_cast<unsigned char *>(data), &tgtSize) != 0 ||
+       srcSize > storedSize || tgtSize > rawSize - int(output - &fShuffled[0]))
+    {
+      message << "corrupt compressed block in pile-up event " << entry;
+      throw runtime_error(message.str());
+    }
+
+    R__unzip(&srcSize, const_cast<unsigned char *>(data), &tgtSize, output, &irep);
+    if(irep != tgtSize)
+    {
+      message << "can't decompress pile-up event " << entry;
+      throw runtime_error(message.str());
+    }
+
+    data += srcSize;
+    storedSize -= srcSize;
+    output += tgtSize;
+  }
+
+  if(output != &fShuffled[0] + rawSize)
+  {
+    message << "pile-up event " << entry << " is shorter than its " << size << " particles";
+    throw runtime_error(message.str());
+  }
+
+  fColumns.resize(rawSize);
+  PileUpUnshuffle(&fColumns[0], &fShuffled[0], size);
+}
+
+//------------------------------------------------------------------------------
+
+bool DelphesPileUpReader::ReadProperties(int *charge, float *mass)
+{
+  const unsigned char *data = fRecord;
+  int i, n = fEntrySize;
+
+  if(fVersion != 2) return false;
+
+  for(i = 0; i < n; ++i)
+  {
+    charge[i] = (signed char)(data[4*n + i]);
+    if(charge[i] == kPileUpUnknownCharge) charge[i] = -999;
+  }
+  UnpackColumn(mass, data + 5*n, n);
 
   return true;
 }
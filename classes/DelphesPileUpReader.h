@@ -5,6 +5,12 @@
  *
  *  Reads pile-up binary file
  *
+ *  The file is memory-mapped, the index of events is validated once
+ *  when the file is opened and the big-endian records are decoded
+ *  directly from the mapping, one particle or one full event at a time.
+ *
+ *  Version 2 files (see DelphesPileUpFormat.h) are recognized by their
+ *  header, compressed events are decompressed when they are selected.
  *
  *  $Date: 2013-03-08 09:25:30 +0100 (Fri, 08 Mar 2013) $
  *  $Revision: 1046 $
@@ -14,9 +20,11 @@
  *
  */
 
-#include <stdio.h>
+#include <stddef.h>
 #include <rpc/types.h>
-#include <rpc/xdr.h>
+
+#include <string>
+#include <vector>
 
 class DelphesPileUpReader
 {
@@ -30,24 +38,54 @@ public:
     float &x, float &y, float &z, float &t,
     float &px, float &py, float &pz, float &e);
 
+  // decodes all particles of the current entry, each array must hold GetEntrySize() values
+  void ReadParticles(int *pid,
+    float *x, float *y, float *z, float *t,
+    float *px, float *py, float *pz, float *e);
+
+  // false for an entry out of range, throws for a corrupt compressed entry
   bool ReadEntry(quad_t entry);
 
   quad_t GetEntries() const { return fEntries; }
 
+  int GetEntrySize() const { return fEntrySize; }
+
+  // charge and mass of all particles of the current entry, version 2 files only
+  bool ReadProperties(int *charge, float *mass);
+
+  int GetVersion() const { return fVersion; }
+  const char *GetMetadata() const { return fMetadata.c_str(); }
+
+  // particles of each entry come by decreasing transverse momentum
+  bool IsOrderedByPT() const { return fOrderedByPT; }
+
 private:
 
+  void Close();
+  void OpenV1(const char *fileName);
+  void OpenV2(const char *fileName);
+  bool ReadEntryV2(quad_t entry);
+  void DecompressEntryV2(quad_t entry, const unsigned char *data, int storedSize, int size);
+
+  int fVersion;
+  bool fOrderedByPT;
+  std::string fMetadata;
+
   quad_t fEntries;
 
   int fEntrySize;
   int fCounter;
 
-  FILE *fPileUpFile;
-  char *fIndex;
-  char *fBuffer;
+  int fPileUpFile;
+
+  size_t fFileSize;
+
+  const unsigned char *fData;
+  const unsigned char *fIndex;
+  const unsigned char *fRecord;
 
-  XDR *fInputXDR;
-  XDR *fIndexXDR;
-  XDR *fBufferXDR;
+  // decompressed byte planes and columns of the current version 2 entry
+  std::vector<unsigned char> fShuffled, fColumns;
 };
 
 #endif // DelphesPileUpReader_h
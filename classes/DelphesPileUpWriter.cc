@@ -3,6 +3,8 @@
  *
  *  Writes pile-up binary file
  *
+ *  Version 1 is the original XDR format, version 2 is the columnar
+ *  format described in DelphesPileUpFormat.h, optionally compressed.
  *
  *  $Date: 2013-03-10 01:53:09 +0100 (Sun, 10 Mar 2013) $
  *  $Revision: 1054 $
@@ -13,11 +15,18 @@
  */
 
 #include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesPileUpFormat.h"
+#include "classes/DelphesPDGTable.h"
 
+#include "RZip.h"
+
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 
+#include <math.h>
+
 #include <stdio.h>
 #include <rpc/types.h>
 #include <rpc/xdr.h>
@@ -28,22 +37,76 @@ static const int kIndexSize = 10000000;
 static const int kBufferSize = 1000000;
 static const int kRecordSize = 9;
 
+// largest block accepted by R__zip and compression level
+static const int kMaxZipChunk = 0xffffff;
+static const int kZipHeaderSize = 9;
+static const int kCompressionLevel = 1;
+
+//------------------------------------------------------------------------------
+
+// sorts particle indices by decreasing transverse momentum
+
+class DelphesPileUpComparePT
+{
+public:
+  DelphesPileUpComparePT(const std::vector<float> &pt) : fPT(pt) {}
+  bool operator()(int i, int j) const { return fPT[i] > fPT[j]; }
+private:
+  const std::vector<float> &fPT;
+};
+
+//------------------------------------------------------------------------------
+
+// stores each value as little-endian bytes
+
+template<typename T>
+static unsigned char *PackColumn(unsigned char *data, const std::vector<T> &values, const std::vector<int> &order)
+{
+  int i, n = order.size();
+  unsigned int word;
+  T value;
+
+  for(i = 0; i < n; ++i)
+  {
+    value = values[order[i]];
+    memcpy(&word, &value, 4);
+    PileUpEncodeWord(data + 4*i, word);
+  }
+  return data + 4*n;
+}
+
+static unsigned char *PackHalfColumn(unsigned char *data, const std::vector<float> &values, const std::vector<int> &order)
+{
+  int i, n = order.size();
+  unsigned short half;
+
+  for(i = 0; i < n; ++i)
+  {
+    half = PileUpFloatToHalf(values[order[i]]);
+    data[2*i] = half;
+    data[2*i + 1] = half >> 8;
+  }
+  return data + 2*n;
+}
+
 //------------------------------------------------------------------------------
 
-DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
+DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName, int version,
+  bool orderByPT, const char *metadata, bool compress) :
+  fVersion(version), fOrderByPT(orderByPT), fCompress(compress),
   fEntries(0), fEntrySize(0), fOffset(0),
+  fRawSize(0), fStoredSize(0),
   fPileUpFile(0), fIndex(0), fBuffer(0),
   fOutputXDR(0), fIndexXDR(0), fBufferXDR(0)
 {
   stringstream message;
+  unsigned char header[kPileUpHeaderSize];
 
-  fIndex = new char[kIndexSize*8];
-  fBuffer = new char[kBufferSize*kRecordSize*4];
-  fOutputXDR = new XDR;
-  fIndexXDR = new XDR;
-  fBufferXDR = new XDR;
-  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_ENCODE);
-  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_ENCODE);
+  if(fVersion != 1 && fVersion != 2)
+  {
+    message << "unknown pile-up file version " << fVersion;
+    throw runtime_error(message.str());
+  }
 
   fPileUpFile = fopen(fileName, "w+");
 
@@ -53,6 +116,30 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
     throw runtime_error(message.str());
   }
 
+  if(fVersion == 2)
+  {
+    if(!metadata) metadata = "";
+
+    memcpy(header, kPileUpMagic, 4);
+    PileUpEncodeWord(header + 4, kPileUpVersion);
+    PileUpEncodeWord(header + 8, fOrderByPT ? kPileUpOrderedByPT : 0);
+    PileUpEncodeWord(header + 12, strlen(metadata));
+
+    Write(header, kPileUpHeaderSize);
+    Write(metadata, strlen(metadata));
+
+    fOffset = kPileUpHeaderSize + strlen(metadata);
+    return;
+  }
+
+  fIndex = new char[kIndexSize*8];
+  fBuffer = new char[kBufferSize*kRecordSize*4];
+  fOutputXDR = new XDR;
+  fIndexXDR = new XDR;
+  fBufferXDR = new XDR;
+  xdrmem_create(fIndexXDR, fIndex, kIndexSize*8, XDR_ENCODE);
+  xdrmem_create(fBufferXDR, fBuffer, kBufferSize*kRecordSize*4, XDR_ENCODE);
+
   xdrstdio_create(fOutputXDR, fPileUpFile, XDR_ENCODE);
 }
 
@@ -60,10 +147,10 @@ DelphesPileUpWriter::DelphesPileUpWriter(const char *fileName) :
 
 DelphesPileUpWriter::~DelphesPileUpWriter()
 {
-  xdr_destroy(fOutputXDR);
+  if(fOutputXDR) xdr_destroy(fOutputXDR);
   if(fPileUpFile) fclose(fPileUpFile);
-  xdr_destroy(fBufferXDR);
-  xdr_destroy(fIndexXDR);
+  if(fBufferXDR) xdr_destroy(fBufferXDR);
+  if(fIndexXDR) xdr_destroy(fIndexXDR);
   if(fBufferXDR) delete fBufferXDR;
   if(fIndexXDR) delete fIndexXDR;
   if(fOutputXDR) delete fOutputXDR;
@@ -73,10 +160,35 @@ DelphesPileUpWriter::~DelphesPileUpWriter()
 
 //------------------------------------------------------------------------------
 
+void DelphesPileUpWriter::Write(const void *data, size_t size)
+{
+  if(size > 0 && fwrite(data, 1, size, fPileUpFile) != size)
+  {
+    throw runtime_error("can't write pile-up file");
+  }
+}
+
+//------------------------------------------------------------------------------
+
 void DelphesPileUpWriter::WriteParticle(int pid,
   float x, float y, float z, float t,
   float px, float py, float pz, float e)
 {
+  if(fVersion == 2)
+  {
+    if(fEntrySize >= int(kPileUpMaxParticles))
+    {
+      throw runtime_error("too many particles in pile-up event");
+    }
+
+    fPID.push_back(pid);
+    fX.push_back(x); fY.push_back(y); fZ.push_back(z); fT.push_back(t);
+    fPx.push_back(px); fPy.push_back(py); fPz.push_back(pz); fE.push_back(e);
+
+    ++fEntrySize;
+    return;
+  }
+
   if(fEntrySize >= kBufferSize)
   {
     throw runtime_error("too many particles in pile-up event");
@@ -99,6 +211,12 @@ void DelphesPileUpWriter::WriteParticle(int pid,
 
 void DelphesPileUpWriter::WriteEntry()
 {
+  if(fVersion == 2)
+  {
+    WriteEntryV2();
+    return;
+  }
+
   if(fEntries >= kIndexSize)
   {
     throw runtime_error("too many pile-up events");
@@ -110,6 +228,9 @@ void DelphesPileUpWriter::WriteEntry()
   xdr_hyper(fIndexXDR, &fOffset);
   fOffset += fEntrySize*kRecordSize*4 + 4;
 
+  fRawSize += fEntrySize*kRecordSize*4 + 4;
+  fStoredSize += fEntrySize*kRecordSize*4 + 4;
+
   xdr_setpos(fBufferXDR, 0);
   fEntrySize = 0;
         
@@ -120,8 +241,128 @@ void DelphesPileUpWriter::WriteEntry()
 
 void DelphesPileUpWriter::WriteIndex()
 {
+  if(fVersion == 2)
+  {
+    WriteIndexV2();
+    return;
+  }
+
   xdr_opaque(fOutputXDR, fIndex, fEntries*8);
   xdr_hyper(fOutputXDR, &fEntries);
 }
 
 //------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::WriteEntryV2()
+{
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  vector<signed char> charge;
+  vector<float> mass;
+  unsigned char header[kPileUpEventHeaderSize];
+  unsigned char *data;
+  int i, n = fEntrySize, rawSize, chunkSize, storedSize, capacity, irep;
+
+  fOrder.resize(n);
+  for(i = 0; i < n; ++i) fOrder[i] = i;
+
+  if(fOrderByPT)
+  {
+    fPT.resize(n);
+    for(i = 0; i < n; ++i) fPT[i] = sqrt(fPx[i]*fPx[i] + fPy[i]*fPy[i]);
+    stable_sort(fOrder.begin(), fOrder.end(), DelphesPileUpComparePT(fPT));
+  }
+
+  // resolve PDG charge and mass
+  charge.resize(n);
+  mass.resize(n);
+  for(i = 0; i < n; ++i)
+  {
+    charge[i] = pdg->IsKnown(fPID[i]) ? (signed char)(pdg->GetCharge(fPID[i])) : kPileUpUnknownCharge;
+    mass[i] = pdg->GetMass(fPID[i]);
+  }
+
+  rawSize = n*kPileUpParticleSize;
+  fColumns.resize(rawSize + 1);
+
+  data = &fColumns[0];
+  data = PackColumn(data, fPID, fOrder);
+  for(i = 0; i < n; ++i) data[i] = charge[fOrder[i]];
+  data += n;
+  data = PackColumn(data, mass, fOrder);
+  data = PackHalfColumn(data, fX, fOrder);
+  data = PackHalfColumn(data, fY, fOrder);
+  data = PackHalfColumn(data, fZ, fOrder);
+  data = PackHalfColumn(data, fT, fOrder);
+  data = PackColumn(data, fPx, fOrder);
+  data = PackColumn(data, fPy, fOrder);
+  data = PackColumn(data, fPz, fOrder);
+  data = PackColumn(data, fE, fOrder);
+
+  storedSize = rawSize;
+
+  if(fCompress)
+  {
+    fShuffled.resize(rawSize + 1);
+    PileUpShuffle(&fShuffled[0], &fColumns[0], n);
+
+    // compress in blocks accepted by R__zip, keep the columns as they are if it does not help
+    fStored.resize(rawSize + kZipHeaderSize);
+    storedSize = 0;
+    for(i = 0; i < rawSize; i += chunkSize)
+    {
+      chunkSize = min(rawSize - i, kMaxZipChunk);
+      capacity = rawSize - storedSize;
+      irep = 0;
+      if(capacity > kZipHeaderSize)
+      {
+        R__zip(kCompressionLevel, &chunkSize, reinterpret_cast<char *>(&fShuffled[i]),
+          &capacity, reinterpret_cast<char *>(&fStored[storedSize]), &irep);
+      }
+      if(irep <= 0 || storedSize + irep >= rawSize)
+      {
+        storedSize = rawSize;
+        break;
+      }
+      storedSize += irep;
+    }
+  }
+
+  PileUpEncodeWord(header, n);
+  PileUpEncodeWord(header + 4, storedSize);
+
+  Write(header, kPileUpEventHeaderSize);
+  Write(storedSize == rawSize ? &fColumns[0] : &fStored[0], storedSize);
+
+  fOffsets.push_back(fOffset);
+  fOffset += kPileUpEventHeaderSize + storedSize;
+
+  fRawSize += kPileUpEventHeaderSize + rawSize;
+  fStoredSize += kPileUpEventHeaderSize + storedSize;
+
+  fPID.clear();
+  fX.clear(); fY.clear(); fZ.clear(); fT.clear();
+  fPx.clear(); fPy.clear(); fPz.clear(); fE.clear();
+  fEntrySize = 0;
+
+  ++fEntries;
+}
+
+//------------------------------------------------------------------------------
+
+void DelphesPileUpWriter::WriteIndexV2()
+{
+  vector<unsigned char> index(fOffsets.size()*8 + 8);
+  size_t i;
+
+  for(i = 0; i < fOffsets.size(); ++i)
+  {
+    PileUpEncodeWord(&index[i*8], fOffsets[i]);
+    PileUpEncodeWord(&index[i*8 + 4], (u_quad_t)fOffsets[i] >> 32);
+  }
+  PileUpEncodeWord(&index[i*8], fEntries);
+  PileUpEncodeWord(&index[i*8 + 4], (u_quad_t)fEntries >> 32);
+
+  Write(&index[0], index.size());
+}
+
+//------------------------------------------------------------------------------
@@ -5,6 +5,8 @@
  *
  *  Writes pile-up binary file
  *
+ *  Version 1 is the original XDR format, version 2 is the columnar
+ *  format described in DelphesPileUpFormat.h, optionally compressed.
  *
  *  $Date: 2013-03-10 01:53:09 +0100 (Sun, 10 Mar 2013) $
  *  $Revision: 1054 $
@@ -18,11 +20,15 @@
 #include <rpc/types.h>
 #include <rpc/xdr.h>
 
+#include <vector>
+
 class DelphesPileUpWriter
 {
 public:
 
-  DelphesPileUpWriter(const char *fileName);
+  // orderByPT, metadata and compress only apply to version 2 files
+  DelphesPileUpWriter(const char *fileName, int version = 1,
+    bool orderByPT = false, const char *metadata = "", bool compress = false);
 
   ~DelphesPileUpWriter();
 
@@ -34,12 +40,26 @@ public:
 
   void WriteIndex();
 
+  // total size of the events written so far, before and after compression
+  quad_t GetRawSize() const { return fRawSize; }
+  quad_t GetStoredSize() const { return fStoredSize; }
+
 private:
 
+  void WriteEntryV2();
+  void WriteIndexV2();
+  void Write(const void *data, size_t size);
+
+  int fVersion;
+  bool fOrderByPT;
+  bool fCompress;
+
   quad_t fEntries;
   int fEntrySize;
   quad_t fOffset;
 
+  quad_t fRawSize, fStoredSize;
+
   FILE *fPileUpFile;
   char *fIndex;
   char *fBuffer;
@@ -47,8 +67,15 @@ private:
   XDR *fOutputXDR;
   XDR *fIndexXDR;
   XDR *fBufferXDR;
+
+  // version 2: particles of the current event and event offsets
+  std::vector<int> fPID;
+  std::vector<float> fX, fY, fZ, fT;
+  std::vector<float> fPx, fPy, fPz, fE;
+  std::vector<float> fPT;
+  std::vector<int> fOrder;
+  std::vector<unsigned char> fColumns, fShuffled, fStored;
+  std::vector<quad_t> fOffsets;
 };
 
 #endif // DelphesPileUpWriter_h
-
-
@@ -0,0 +1,431 @@
+#ifndef DelphesReadAhead_h
+#define DelphesReadAhead_h
+
+/** \class DelphesReadAhead
+ *
+ *  Reads the events of a reader (DelphesHepMCReader, DelphesLHEFReader,
+ *  DelphesSTDHEPReader, ...) ahead of processing.
+ *
+ *  With a depth k > 0 a background thread fills the next k events into
+ *  staging factories while Delphes processes the current one. Next moves
+ *  the staged candidates into the arrays of the main factory, which gives
+ *  them their TProcessID numbers in the same order as without read-ahead.
+ *  With a depth of 0 Next reads the event directly, as the readers do.
+ *
+ *  EventClass is the class written by Reader::AnalyzeEvent.
+ *
+ *  A runtime_error thrown by the reader in the background is thrown
+ *  again by Next when the event that failed is reached.
+ *
+ */
+
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+
+#include "TObjArray.h"
+#include "TStopwatch.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+template<typename Reader, typename EventClass>
+class DelphesReadAhead
+{
+public:
+
+  DelphesReadAhead(Reader *reader, Int_t depth = 0);
+  ~DelphesReadAhead();
+
+  // starts reading the current input of the reader
+  void Start();
+
+  // stops reading, the reader can then be given another input
+  void Stop();
+
+  // moves the next event into the arrays of factory, false at the end of the input
+  Bool_t Next(DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+
+  // event information of the event returned by Next
+  void AnalyzeEvent(ExRootTreeBranch *branch, Long64_t eventNumber, TStopwatch *procStopWatch);
+
+  Int_t GetDepth() const { return fDepth; }
+
+  // time spent reading, in the background with read-ahead
+  Double_t GetReadTime() const { return fReadTime; }
+
+  // time spent by Next waiting for the background thread, and number of waits
+  Double_t GetWaitTime() const { return fWaitTime; }
+  Long64_t GetWaits() const { return fWaits; }
+
+  // prints the read and wait times and the fraction of the reading hidden by processing
+  void PrintSummary() const;
+
+private:
+
+  struct Slot
+  {
+    DelphesFactory *factory;
+    TObjArray *allParticles, *stableParticles, *partons;
+    ExRootTreeBranch *eventBranch;
+    EventClass *event;
+    Double_t readTime;
+    Bool_t end;
+    std::string error;
+  };
+
+  static void *ReadThread(void *readAhead);
+
+  void Read();
+  Bool_t ReadEvent(DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray);
+  void Release();
+
+  Reader *fReader;
+  Int_t fDepth;
+
+  Slot *fSlots;
+  Slot *fCurrent;
+  Int_t fHead, fTail, fCount;
+  Bool_t fStop;
+  Long64_t fEventNumber;
+
+  TThread *fThread;
+  TMutex *fMutex;
+  TCondition *fSlotReady, *fSlotFree;
+
+  TStopwatch fReadStopWatch, fWaitStopWatch;
+  Double_t fReadTime, fWaitTime, fCurrentReadTime;
+  Long64_t fWaits;
+};
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+DelphesReadAhead<Reader, EventClass>::DelphesReadAhead(Reader *reader, Int_t depth) :
+  fReader(reader), fDepth(depth > 0 ? depth : 0), fSlots(0), fCurrent(0),
+  fHead(0), fTail(0), fCount(0), fStop(kFALSE), fEventNumber(0),
+  fThread(0), fMutex(0), fSlotReady(0), fSlotFree(0),
+  fReadTime(0.0), fWaitTime(0.0), fCurrentReadTime(0.0), fWaits(0)
+{
+  Int_t i;
+  Slot *slot;
+
+  if(fDepth == 0) return;
+
+  TThread::Initialize();
+  fMutex = new TMutex;
+  fSlotReady = new TCondition(fMutex);
+  fSlotFree = new TCondition(fMutex);
+
+  fSlots = new Slot[fDepth];
+  for(i = 0; i < fDepth; ++i)
+  {
+    slot = &fSlots[i];
+    slot->factory = new DelphesFactory("StagingFactory");
+    slot->factory->SetStaging(kTRUE);
+    slot->allParticles = slot->factory->NewPermanentArray();
+    slot->stableParticles = slot->factory->NewPermanentArray();
+    slot->partons = slot->factory->NewPermanentArray();
+
+    // the reader writes its event information to the only entry of this branch
+    slot->eventBranch = new ExRootTreeBranch("Event", EventClass::Class(), 0);
+    slot->event = static_cast<EventClass *>(slot->eventBranch->NewEntry());
+    slot->readTime = 0.0;
+    slot->end = kFALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+DelphesReadAhead<Reader, EventClass>::~DelphesReadAhead()
+{
+  Int_t i;
+
+  Stop();
+
+  for(i = 0; fSlots && i < fDepth; ++i)
+  {
+    delete fSlots[i].eventBranch;
+    delete fSlots[i].factory;
+  }
+
+  if(fSlots) delete[] fSlots;
+  if(fSlotFree) delete fSlotFree;
+  if(fSlotReady) delete fSlotReady;
+  if(fMutex) delete fMutex;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::Start()
+{
+  Stop();
+
+  fEventNumber = 0;
+  fCurrent = 0;
+
+  if(fDepth == 0) return;
+
+  fHead = 0;
+  fTail = 0;
+  fCount = 0;
+  fStop = kFALSE;
+
+  fThread = new TThread(ReadThread, this);
+  fThread->Run();
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::Stop()
+{
+  if(!fThread) return;
+
+  fMutex->Lock();
+  fStop = kTRUE;
+  fSlotFree->Signal();
+  fMutex->UnLock();
+
+  fThread->Join();
+  delete fThread;
+  fThread = 0;
+  fCurrent = 0;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+Bool_t DelphesReadAhead<Reader, EventClass>::Next(DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  Slot *slot;
+  Candidate *candidate;
+  Int_t i;
+
+  if(fDepth == 0)
+  {
+    fReader->Clear();
+
+    fReadStopWatch.Start();
+    if(!ReadEvent(factory, allParticleOutputArray, stableParticleOutputArray, partonOutputArray)) return kFALSE;
+    fReadStopWatch.Stop();
+
+    fCurrentReadTime = fReadStopWatch.RealTime();
+    fReadTime += fCurrentReadTime;
+    ++fEventNumber;
+    return kTRUE;
+  }
+
+  if(!fThread) return kFALSE;
+
+  // the previous event has been processed and cleared
+  Release();
+
+  fMutex->Lock();
+  if(fCount == 0)
+  {
+    ++fWaits;
+    fWaitStopWatch.Start();
+    while(fCount == 0) fSlotReady->Wait();
+    fWaitStopWatch.Stop();
+    fWaitTime += fWaitStopWatch.RealTime();
+  }
+  slot = &fSlots[fTail];
+  fMutex->UnLock();
+
+  if(!slot->error.empty()) throw std::runtime_error(slot->error);
+
+  if(slot->end) return kFALSE;
+
+  fCurrent = slot;
+  fCurrentReadTime = slot->readTime;
+
+  // number the staged candidates in the order they were created
+  for(i = 0; i < slot->allParticles->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast<Candidate *>(slot->allParticles->At(i));
+    factory->AdoptCandidate(candidate);
+    allParticleOutputArray->Add(candidate);
+  }
+
+  for(i = 0; i < slot->stableParticles->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast<Candidate *>(slot->stableParticles->At(i));
+    if(!candidate->TestBit(TObject::kIsReferenced))
+    {
+      factory->AdoptCandidate(candidate);
+    }
+    stableParticleOutputArray->Add(candidate);
+  }
+
+  for(i = 0; i < slot->partons->GetEntriesFast(); ++i)
+  {
+    candidate = static_cast<Candidate *>(slot->partons->At(i));
+    if(!candidate->TestBit(TObject::kIsReferenced))
+    {
+      factory->AdoptCandidate(candidate);
+    }
+    partonOutputArray->Add(candidate);
+  }
+
+  ++fEventNumber;
+  return kTRUE;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::AnalyzeEvent(ExRootTreeBranch *branch,
+  Long64_t eventNumber, TStopwatch *procStopWatch)
+{
+  EventClass *element;
+
+  if(fDepth == 0)
+  {
+    fReader->AnalyzeEvent(branch, eventNumber, &fReadStopWatch, procStopWatch);
+    return;
+  }
+
+  if(!fCurrent) return;
+
+  element = static_cast<EventClass *>(branch->NewEntry());
+  *element = *fCurrent->event;
+
+  element->ReadTime = fCurrentReadTime;
+  element->ProcTime = procStopWatch->RealTime();
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::PrintSummary() const
+{
+  Double_t overlap;
+
+  if(fDepth == 0 || fReadTime <= 0.0) return;
+
+  overlap = fWaitTime < fReadTime ? 1.0 - fWaitTime/fReadTime : 0.0;
+
+  std::cout << "** INFO: reading ahead " << fDepth << " events took " << fReadTime << " s, ";
+  std::cout << "processing waited " << fWaits << " times for " << fWaitTime << " s, ";
+  std::cout << 100.0*overlap << "% of the reading overlapped with processing" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void *DelphesReadAhead<Reader, EventClass>::ReadThread(void *readAhead)
+{
+  static_cast<DelphesReadAhead<Reader, EventClass> *>(readAhead)->Read();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::Read()
+{
+  Slot *slot;
+  TStopwatch readStopWatch, dummyStopWatch;
+  Long64_t eventNumber = 0;
+  Bool_t end = kFALSE;
+
+  while(!end)
+  {
+    fMutex->Lock();
+    while(fCount == fDepth && !fStop) fSlotFree->Wait();
+    if(fStop)
+    {
+      fMutex->UnLock();
+      break;
+    }
+    slot = &fSlots[fHead];
+    fMutex->UnLock();
+
+    // the free slot belongs to this thread until it is published
+    slot->factory->Clear();
+    slot->error.clear();
+
+    readStopWatch.Start();
+    try
+    {
+      end = !ReadEvent(slot->factory, slot->allParticles, slot->stableParticles, slot->partons);
+    }
+    catch(std::runtime_error &e)
+    {
+      // passed on to Next, an exception can't leave this thread
+      slot->error = e.what();
+      end = kTRUE;
+    }
+    readStopWatch.Stop();
+
+    slot->readTime = readStopWatch.RealTime();
+    slot->end = end;
+
+    if(!end)
+    {
+      slot->eventBranch->Clear();
+      fReader->AnalyzeEvent(slot->eventBranch, ++eventNumber, &dummyStopWatch, &dummyStopWatch);
+      fReader->Clear();
+    }
+
+    fMutex->Lock();
+    fReadTime += slot->readTime;
+    fHead = (fHead + 1) % fDepth;
+    ++fCount;
+    fSlotReady->Signal();
+    fMutex->UnLock();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+Bool_t DelphesReadAhead<Reader, EventClass>::ReadEvent(DelphesFactory *factory,
+  TObjArray *allParticleOutputArray,
+  TObjArray *stableParticleOutputArray,
+  TObjArray *partonOutputArray)
+{
+  while(fReader->ReadBlock(factory, allParticleOutputArray,
+    stableParticleOutputArray, partonOutputArray))
+  {
+    if(fReader->EventReady()) return kTRUE;
+  }
+  return kFALSE;
+}
+
+//------------------------------------------------------------------------------
+
+template<typename Reader, typename EventClass>
+void DelphesReadAhead<Reader, EventClass>::Release()
+{
+  if(!fCurrent) return;
+
+  fMutex->Lock();
+  fTail = (fTail + 1) % fDepth;
+  --fCount;
+  fSlotFree->Signal();
+  fMutex->UnLock();
+
+  fCurrent = 0;
+}
+
+//------------------------------------------------------------------------------
+
+#endif // DelphesReadAhead_h
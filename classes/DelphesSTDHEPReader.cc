@@ -19,42 +19,76 @@
 #include <sstream>
 
 #include <stdio.h>
-#include <errno.h>
-#include <rpc/types.h>
-#include <rpc/xdr.h>
+#include <string.h>
 
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeBranch.h"
 
 using namespace std;
 
-static const int kBufferSize  = 1000000;
+static const int kMaxParticles = 1000000;
+static const u_int kBufferSize = 1024*1024;
+
+//---------------------------------------------------------------------------
+
+// XDR data are big-endian, these work whatever the byte order of the host
+
+static inline u_int DecodeUInt(const char *data)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+  return (u_int(bytes[0]) << 24) | (u_int(bytes[1]) << 16) |
+    (u_int(bytes[2]) << 8) | u_int(bytes[3]);
+}
+
+static inline double DecodeDouble(const char *data)
+{
+  unsigned long long bits;
+  double value;
+
+  bits = (static_cast<unsigned long long>(DecodeUInt(data)) << 32) | DecodeUInt(data + 4);
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// the iterations are independent, these loops compile to one byte swap per word,
+// vectorized when optimizing for processors with SSSE3 or later
+
+static void DecodeInts(const char *data, int *values, int size)
+{
+  int i;
+  for(i = 0; i < size; ++i) values[i] = DecodeUInt(data + 4*i);
+}
+
+static void DecodeDoubles(const char *data, double *values, int size)
+{
+  int i;
+  for(i = 0; i < size; ++i) values[i] = DecodeDouble(data + 8*i);
+}
 
 //---------------------------------------------------------------------------
 
 DelphesSTDHEPReader::DelphesSTDHEPReader() :
-  fInputFile(0), fInputXDR(0), fBuffer(0), fPDG(0), fBlockType(-1)
+  fInputFile(0), fSeekable(false), fBuffer(0),
+  fBufferPosition(0), fBufferEnd(0), fPDG(0), fBlockType(-1)
 {
-  fInputXDR = new XDR;
-  fBuffer = new char[kBufferSize*96 + 24];
+  fBuffer = new char[kBufferSize];
+  fVersion[0] = '\0';
 
-  fPDG = TDatabasePDG::Instance();
+  fPDG = DelphesPDGTable::Instance();
 }
 
 //---------------------------------------------------------------------------
 
 DelphesSTDHEPReader::~DelphesSTDHEPReader()
 {
-  if(fBuffer) delete fBuffer;
-  if(fInputXDR) delete fInputXDR;
+  if(fBuffer) delete[] fBuffer;
 }
 
 //---------------------------------------------------------------------------
@@ -62,7 +96,9 @@ DelphesSTDHEPReader::~DelphesSTDHEPReader()
 void DelphesSTDHEPReader::SetInputFile(FILE *inputFile)
 {
   fInputFile = inputFile;
-  xdrstdio_create(fInputXDR, inputFile, XDR_DECODE);
+  fSeekable = (fseeko(inputFile, 0, SEEK_CUR) == 0);
+  fBufferPosition = 0;
+  fBufferEnd = 0;
   ReadFileHeader();
 }
 
@@ -89,14 +125,14 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
 {
   bool skipNTuples = false;
 
-  if(feof(fInputFile)) return kFALSE;
+  if(!FillBuffer(1)) return kFALSE;
 
-  xdr_int(fInputXDR, &fBlockType);
+  fBlockType = ReadInt();
 
   SkipBytes(4);
 
-  xdr_string(fInputXDR, &fBuffer, 100);
-  if(strncmp(fBuffer, "2.00", 4) == 0)
+  ReadString(100);
+  if(strncmp(fVersion, "2.00", 4) == 0)
   {
     skipNTuples = true;
   }
@@ -137,10 +173,135 @@ bool DelphesSTDHEPReader::ReadBlock(DelphesFactory *factory,
 
 //---------------------------------------------------------------------------
 
+bool DelphesSTDHEPReader::FillBuffer(u_int size)
+{
+  size_t done;
+
+  if(fBufferEnd - fBufferPosition >= size) return true;
+
+  // keep the bytes not yet decoded and read after them
+  memmove(fBuffer, fBuffer + fBufferPosition, fBufferEnd - fBufferPosition);
+  fBufferEnd -= fBufferPosition;
+  fBufferPosition = 0;
+
+  while(fBufferEnd < size)
+  {
+    done = fread(fBuffer + fBufferEnd, 1, kBufferSize - fBufferEnd, fInputFile);
+    if(done == 0) return false;
+    fBufferEnd += done;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesSTDHEPReader::ReadBytes(char *data, u_int size)
+{
+  u_int available;
+
+  available = fBufferEnd - fBufferPosition;
+  if(size <= available)
+  {
+    memcpy(data, fBuffer + fBufferPosition, size);
+    fBufferPosition += size;
+    return;
+  }
+
+  memcpy(data, fBuffer + fBufferPosition, available);
+  data += available;
+  size -= available;
+  fBufferPosition = 0;
+  fBufferEnd = 0;
+
+  // large records are read directly, without going through the buffer
+  if(size >= kBufferSize/2)
+  {
+    if(fread(data, 1, size, fInputFile) != size)
+    {
+      throw runtime_error("Unexpected end of file. File is probably truncated.");
+    }
+    return;
+  }
+
+  if(!FillBuffer(size))
+  {
+    throw runtime_error("Unexpected end of file. File is probably truncated.");
+  }
+
+  memcpy(data, fBuffer, size);
+  fBufferPosition = size;
+}
+
+//---------------------------------------------------------------------------
+
+int DelphesSTDHEPReader::ReadInt()
+{
+  return ReadUInt();
+}
+
+//---------------------------------------------------------------------------
+
+u_int DelphesSTDHEPReader::ReadUInt()
+{
+  u_int value;
+
+  if(!FillBuffer(4))
+  {
+    throw runtime_error("Unexpected end of file. File is probably truncated.");
+  }
+
+  value = DecodeUInt(fBuffer + fBufferPosition);
+  fBufferPosition += 4;
+
+  return value;
+}
+
+//---------------------------------------------------------------------------
+
+double DelphesSTDHEPReader::ReadDouble()
+{
+  double value;
+
+  if(!FillBuffer(8))
+  {
+    throw runtime_error("Unexpected end of file. File is probably truncated.");
+  }
+
+  value = DecodeDouble(fBuffer + fBufferPosition);
+  fBufferPosition += 8;
+
+  return value;
+}
+
+//---------------------------------------------------------------------------
+
+void DelphesSTDHEPReader::ReadString(u_int maxSize)
+{
+  u_int size;
+
+  size = ReadUInt();
+  if(size > maxSize || size >= sizeof(fVersion))
+  {
+    throw runtime_error("String too long. File is probably corrupted.");
+  }
+
+  // the string is padded to a multiple of 4 bytes
+  if(!FillBuffer((size + 3) & ~3U))
+  {
+    throw runtime_error("Unexpected end of file. File is probably truncated.");
+  }
+
+  memcpy(fVersion, fBuffer + fBufferPosition, size);
+  fVersion[size] = '\0';
+  fBufferPosition += (size + 3) & ~3U;
+}
+
+//---------------------------------------------------------------------------
+
 void DelphesSTDHEPReader::SkipBytes(u_int size)
 {
-  int rc;
-  u_int rndup;
+  u_int rndup, available, chunk;
 
   rndup = size % 4;
   if(rndup > 0)
@@ -148,11 +309,30 @@ void DelphesSTDHEPReader::SkipBytes(u_int size)
     rndup = 4 - rndup;
   }
 
-  rc = fseek(fInputFile, size + rndup, SEEK_CUR);
+  size += rndup;
+
+  available = fBufferEnd - fBufferPosition;
+  if(size <= available)
+  {
+    fBufferPosition += size;
+    return;
+  }
+
+  size -= available;
+  fBufferPosition = 0;
+  fBufferEnd = 0;
 
-  if(rc != 0 && errno == ESPIPE)
+  // the buffer is empty, so the file is positioned right after the decoded bytes
+  if(fSeekable && fseeko(fInputFile, size, SEEK_CUR) == 0) return;
+
+  while(size > 0)
   {
-    xdr_opaque(fInputXDR, fBuffer, size);
+    chunk = size < kBufferSize ? size : kBufferSize;
+    if(fread(fBuffer, 1, chunk, fInputFile) != chunk)
+    {
+      throw runtime_error("Unexpected end of file. File is probably truncated.");
+    }
+    size -= chunk;
   }
 }
 
@@ -161,7 +341,7 @@ void DelphesSTDHEPReader::SkipBytes(u_int size)
 void DelphesSTDHEPReader::SkipArray(u_int elsize)
 {
   u_int size;
-  xdr_u_int(fInputXDR, &size);
+  size = ReadUInt();
   SkipBytes(size*elsize);
 }
 
@@ -172,7 +352,7 @@ void DelphesSTDHEPReader::ReadFileHeader()
   u_int i;
   enum STDHEPVersion {UNKNOWN, V1, V2, V21} version;
 
-  xdr_int(fInputXDR, &fBlockType);
+  fBlockType = ReadInt();
   if (fBlockType != FILEHEADER)
   {
     throw runtime_error("Header block not found. File is probably corrupted.");
@@ -181,11 +361,11 @@ void DelphesSTDHEPReader::ReadFileHeader()
   SkipBytes(4);
 
   // version
-  xdr_string(fInputXDR, &fBuffer, 100);
-  if(fBuffer[0] == '\0' || fBuffer[1] == '\0') version = UNKNOWN;
-  else if(fBuffer[0] == '1') version = V1;
-  else if(strncmp(fBuffer, "2.01", 4) == 0) version = V21;
-  else if(fBuffer[0] == '2') version = V2;
+  ReadString(100);
+  if(fVersion[0] == '\0' || fVersion[1] == '\0') version = UNKNOWN;
+  else if(fVersion[0] == '1') version = V1;
+  else if(strncmp(fVersion, "2.01", 4) == 0) version = V21;
+  else if(fVersion[0] == '2') version = V2;
   else version = UNKNOWN;
 
   if (version == UNKNOWN)
@@ -206,19 +386,18 @@ void DelphesSTDHEPReader::ReadFileHeader()
   SkipBytes(4);
 
   // Number of events
-  xdr_u_int(fInputXDR, &fEntries);
+  fEntries = ReadUInt();
 
   SkipBytes(8);
 
   // Number of blocks
-  u_int nBlocks = 0;
-  xdr_u_int(fInputXDR, &nBlocks);
+  u_int nBlocks = ReadUInt();
 
   // Number of NTuples
   u_int nNTuples = 0;
   if(version != V1)
   {
-    xdr_u_int(fInputXDR, &nNTuples);
+    nNTuples = ReadUInt();
   }
 
   if(nNTuples != 0)
@@ -257,14 +436,13 @@ void DelphesSTDHEPReader::ReadSTDHEPHeader(bool skipNTuples)
 {
   SkipBytes(20);
 
-  u_int dimBlocks = 0;
-  xdr_u_int(fInputXDR, &dimBlocks);
+  u_int dimBlocks = ReadUInt();
 
   u_int dimNTuples = 0;
   if(skipNTuples)
   {
     SkipBytes(4);
-    xdr_u_int(fInputXDR, &dimNTuples);
+    dimNTuples = ReadUInt();
   }
 
   // Processing blocks extraction
@@ -289,9 +467,9 @@ void DelphesSTDHEPReader::ReadSTDCM1()
   // skip 5*4 + 2*8 = 36 bytes
   SkipBytes(36);
 
-  if((strncmp(fBuffer, "1.", 2) == 0) || (strncmp(fBuffer, "2.", 2) == 0) ||
-     (strncmp(fBuffer, "3.", 2) == 0) || (strncmp(fBuffer, "4.", 2) == 0) ||
-     (strncmp(fBuffer, "5.00", 4) == 0))
+  if((strncmp(fVersion, "1.", 2) == 0) || (strncmp(fVersion, "2.", 2) == 0) ||
+     (strncmp(fVersion, "3.", 2) == 0) || (strncmp(fVersion, "4.", 2) == 0) ||
+     (strncmp(fVersion, "5.00", 4) == 0))
   {
     return;
   }
@@ -299,7 +477,7 @@ void DelphesSTDHEPReader::ReadSTDCM1()
   SkipArray(1);
   SkipArray(1);
 
-  if(strncmp(fBuffer, "5.01", 4) == 0)
+  if(strncmp(fVersion, "5.01", 4) == 0)
   {
     return;
   }
@@ -312,38 +490,63 @@ void DelphesSTDHEPReader::ReadSTDCM1()
 void DelphesSTDHEPReader::ReadSTDHEP()
 {
   u_int idhepSize, isthepSize, jmohepSize, jdahepSize, phepSize, vhepSize;
+  char *data;
 
   // Extracting the event number
-  xdr_int(fInputXDR, &fEventNumber);
+  fEventNumber = ReadInt();
 
   // Extracting the number of particles
-  xdr_int(fInputXDR, &fEventSize);
+  fEventSize = ReadInt();
 
-  if(fEventSize >= kBufferSize)
+  if(fEventSize >= kMaxParticles)
   {
     throw runtime_error("too many particles in event");
   }
 
+  if(fEventSize < 0)
+  {
+    throw runtime_error("Inconsistent size of arrays. File is probably corrupted.");
+  }
+
   // 4*n + 4*n + 8*n + 8*n + 40*n + 32*n +
   // 4 + 4 + 4 + 4 + 4 + 4 = 96*n + 24
 
-  xdr_opaque(fInputXDR, fBuffer, 96*fEventSize + 24);
+  fRecord.resize(96*fEventSize + 24);
+  data = &fRecord[0];
 
-  idhepSize = ntohl(*(u_int*)(fBuffer));
-  isthepSize = ntohl(*(u_int*)(fBuffer + 4*1 + 4*1*fEventSize));
-  jmohepSize = ntohl(*(u_int*)(fBuffer + 4*2 + 4*2*fEventSize));
-  jdahepSize = ntohl(*(u_int*)(fBuffer + 4*3 + 4*4*fEventSize));
-  phepSize = ntohl(*(u_int*)(fBuffer + 4*4 + 4*6*fEventSize));
-  vhepSize = ntohl(*(u_int*)(fBuffer + 4*5 + 4*16*fEventSize));
+  ReadBytes(data, 96*fEventSize + 24);
 
-  if(fEventSize < 0 ||
-     fEventSize != (int)idhepSize      || fEventSize != (int)isthepSize     ||
+  idhepSize = DecodeUInt(data);
+  isthepSize = DecodeUInt(data + 4*1 + 4*1*fEventSize);
+  jmohepSize = DecodeUInt(data + 4*2 + 4*2*fEventSize);
+  jdahepSize = DecodeUInt(data + 4*3 + 4*4*fEventSize);
+  phepSize = DecodeUInt(data + 4*4 + 4*6*fEventSize);
+  vhepSize = DecodeUInt(data + 4*5 + 4*16*fEventSize);
+
+  if(fEventSize != (int)idhepSize      || fEventSize != (int)isthepSize     ||
      (2*fEventSize) != (int)jmohepSize || (2*fEventSize) != (int)jdahepSize ||
      (5*fEventSize) != (int)phepSize   || (4*fEventSize) != (int)vhepSize)
   {
     throw runtime_error("Inconsistent size of arrays. File is probably corrupted.");
   }
 
+  fStatus.resize(fEventSize);
+  fPID.resize(fEventSize);
+  fMothers.resize(2*fEventSize);
+  fDaughters.resize(2*fEventSize);
+  fMomentum.resize(5*fEventSize);
+  fPosition.resize(4*fEventSize);
+
+  if(fEventSize > 0)
+  {
+    DecodeInts(data + 4*1, &fStatus[0], fEventSize);
+    DecodeInts(data + 4*2 + 4*1*fEventSize, &fPID[0], fEventSize);
+    DecodeInts(data + 4*3 + 4*2*fEventSize, &fMothers[0], 2*fEventSize);
+    DecodeInts(data + 4*4 + 4*4*fEventSize, &fDaughters[0], 2*fEventSize);
+    DecodeDoubles(data + 4*5 + 4*6*fEventSize, &fMomentum[0], 5*fEventSize);
+    DecodeDoubles(data + 4*6 + 4*16*fEventSize, &fPosition[0], 4*fEventSize);
+  }
+
   fWeight = 1.0;
   fAlphaQED = 0.0;
   fAlphaQCD = 0.0;
@@ -358,19 +561,24 @@ void DelphesSTDHEPReader::ReadSTDHEP4()
   u_int number;
 
   // Extracting the event weight
-  xdr_double(fInputXDR, &fWeight);
+  fWeight = ReadDouble();
 
   // Extracting alpha QED
-  xdr_double(fInputXDR, &fAlphaQED);
+  fAlphaQED = ReadDouble();
 
   // Extracting alpha QCD
-  xdr_double(fInputXDR, &fAlphaQCD);
+  fAlphaQCD = ReadDouble();
 
   // Extracting the event scale
-  xdr_u_int(fInputXDR, &fScaleSize);
+  fScaleSize = ReadUInt();
+  if(fScaleSize > 10)
+  {
+    throw runtime_error("Too many event scales. File is probably corrupted.");
+  }
+
   for(number = 0; number < fScaleSize; ++number)
   {
-    xdr_double(fInputXDR, &fScale[number]);
+    fScale[number] = ReadDouble();
   }
 
   SkipArray(8);
@@ -409,7 +617,6 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
   TObjArray *partonOutputArray)
 {
   Candidate *candidate;
-  TParticlePDG *pdgParticle;
   int pdgCode;
 
   int number;
@@ -417,33 +624,25 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
   double px, py, pz, e, mass;
   double x, y, z, t;
 
-  XDR bufferXDR[6];
-  xdrmem_create(&bufferXDR[0], fBuffer + 4*1, 4*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[1], fBuffer + 4*2 + 4*1*fEventSize, 4*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[2], fBuffer + 4*3 + 4*2*fEventSize, 8*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[3], fBuffer + 4*4 + 4*4*fEventSize, 8*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[4], fBuffer + 4*5 + 4*6*fEventSize, 40*fEventSize, XDR_DECODE);
-  xdrmem_create(&bufferXDR[5], fBuffer + 4*6 + 4*16*fEventSize, 32*fEventSize, XDR_DECODE);
-
   for(number = 0; number < fEventSize; ++number)
   {
-    xdr_int(&bufferXDR[0], &status);
-    xdr_int(&bufferXDR[1], &pid);
-    xdr_int(&bufferXDR[2], &m1);
-    xdr_int(&bufferXDR[2], &m2);
-    xdr_int(&bufferXDR[3], &d1);
-    xdr_int(&bufferXDR[3], &d2);
-
-    xdr_double(&bufferXDR[4], &px);
-    xdr_double(&bufferXDR[4], &py);
-    xdr_double(&bufferXDR[4], &pz);
-    xdr_double(&bufferXDR[4], &e);
-    xdr_double(&bufferXDR[4], &mass);
-
-    xdr_double(&bufferXDR[5], &x);
-    xdr_double(&bufferXDR[5], &y);
-    xdr_double(&bufferXDR[5], &z);
-    xdr_double(&bufferXDR[5], &t);
+    status = fStatus[number];
+    pid = fPID[number];
+    m1 = fMothers[2*number];
+    m2 = fMothers[2*number + 1];
+    d1 = fDaughters[2*number];
+    d2 = fDaughters[2*number + 1];
+
+    px = fMomentum[5*number];
+    py = fMomentum[5*number + 1];
+    pz = fMomentum[5*number + 2];
+    e = fMomentum[5*number + 3];
+    mass = fMomentum[5*number + 4];
+
+    x = fPosition[4*number];
+    y = fPosition[4*number + 1];
+    z = fPosition[4*number + 2];
+    t = fPosition[4*number + 3];
 
     candidate = factory->NewCandidate();
 
@@ -458,8 +657,7 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
     candidate->D1 = d1 - 1;
     candidate->D2 = d2 - 1;
 
-    pdgParticle = fPDG->GetParticle(pid);
-    candidate->Charge = pdgParticle ? int(pdgParticle->Charge()/3.0) : -999;
+    candidate->Charge = fPDG->GetCharge(pid);
     candidate->Mass = mass;
 
     candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -468,9 +666,9 @@ void DelphesSTDHEPReader::AnalyzeParticles(DelphesFactory *factory,
 
     allParticleOutputArray->Add(candidate);
 
-    if(!pdgParticle) continue;
+    if(!fPDG->IsKnown(pid)) continue;
 
-    if(status == 1 && pdgParticle->Stable())
+    if(status == 1 && fPDG->IsStable(pid))
     {
       stableParticleOutputArray->Add(candidate);
     }
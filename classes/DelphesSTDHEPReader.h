@@ -5,6 +5,11 @@
  *
  *  Reads STDHEP file
  *
+ *  The file is read through an input buffer and the XDR data are decoded
+ *  from memory. The particle arrays of an event are read in one call and
+ *  decoded array by array, blocks that are not used are skipped within
+ *  the buffer, or by seeking when the input is a plain file.
+ *
  *
  *  $Date: 2013-05-30 00:47:35 +0200 (Thu, 30 May 2013) $
  *  $Revision: 1129 $
@@ -15,12 +20,13 @@
  */
 
 #include <stdio.h>
-#include <rpc/types.h>
-#include <rpc/xdr.h>
+#include <sys/types.h>
+
+#include <vector>
 
 class TObjArray;
 class TStopwatch;
-class TDatabasePDG;
+class DelphesPDGTable;
 class ExRootTreeBranch;
 class DelphesFactory;
 
@@ -62,6 +68,13 @@ private:
     TObjArray *stableParticleOutputArray,
     TObjArray *partonOutputArray);
 
+  bool FillBuffer(u_int size);
+  void ReadBytes(char *data, u_int size);
+  int ReadInt();
+  u_int ReadUInt();
+  double ReadDouble();
+  void ReadString(u_int maxSize);
+
   void SkipBytes(u_int size);
   void SkipArray(u_int elsize);
 
@@ -73,12 +86,21 @@ private:
   void ReadSTDHEP4();
 
   FILE *fInputFile;
+  bool fSeekable;
 
-  XDR *fInputXDR;
-
+  // input buffer, bytes from fBufferPosition to fBufferEnd are not yet decoded
   char *fBuffer;
+  u_int fBufferPosition, fBufferEnd;
+
+  // version string of the current block
+  char fVersion[101];
+
+  // particle arrays of the current event, as read and decoded
+  std::vector<char> fRecord;
+  std::vector<int> fStatus, fPID, fMothers, fDaughters;
+  std::vector<double> fMomentum, fPosition;
 
-  TDatabasePDG *fPDG;
+  const DelphesPDGTable *fPDG;
 
   u_int fEntries;
   int fBlockType, fEventNumber, fEventSize;
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <math.h>
+#include <float.h>
 
 #include <iostream>
 
@@ -27,6 +28,216 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
+// powers of ten exactly representable as double
+static const double kPowersOfTen[] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// powers of five fitting in 64 bits
+static const unsigned long long kPowersOfFive[] =
+{
+  1ULL, 5ULL, 25ULL, 125ULL, 625ULL, 3125ULL, 15625ULL, 78125ULL, 390625ULL,
+  1953125ULL, 9765625ULL, 48828125ULL, 244140625ULL, 1220703125ULL,
+  6103515625ULL, 30517578125ULL, 152587890625ULL, 762939453125ULL,
+  3814697265625ULL, 19073486328125ULL, 95367431640625ULL, 476837158203125ULL,
+  2384185791015625ULL, 11920928955078125ULL, 59604644775390625ULL,
+  298023223876953125ULL, 1490116119384765625ULL, 7450580596923828125ULL
+};
+
+static inline bool IsSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static inline bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned __int128 UInt128_t;
+
+static inline int BitLength(UInt128_t value)
+{
+  unsigned long long high = value >> 64;
+  if(high) return 128 - __builtin_clzll(high);
+  if(value) return 64 - __builtin_clzll((unsigned long long)value);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+// value*2^exponent rounded to nearest even, sticky tells that value is truncated
+
+static double RoundToDouble(UInt128_t value, bool sticky, int exponent)
+{
+  int shift = BitLength(value) - 53;
+  unsigned long long mantissa;
+  UInt128_t rest, half;
+
+  if(shift <= 0) return ldexp(double((unsigned long long)value), exponent);
+
+  mantissa = value >> shift;
+  rest = value & ((UInt128_t(1) << shift) - 1);
+  half = UInt128_t(1) << (shift - 1);
+
+  if(rest > half || (rest == half && (sticky || (mantissa & 1)))) ++mantissa;
+  if(mantissa >> 53)
+  {
+    mantissa >>= 1;
+    ++shift;
+  }
+
+  return ldexp(double(mantissa), shift + exponent);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+
+// Converts plain decimal numbers (no hexadecimal, inf or nan) with up to
+// 19 significant digits, independently of the locale. The result is the
+// correctly rounded double, as returned by strtod. Returns false when the
+// number has to be left to strtod.
+
+static bool ConvertDecimal(char *start, char **end, double &value)
+{
+  char *position = start;
+  unsigned long long mantissa = 0;
+  int digits = 0, fraction = 0, exponent = 0, exponentDigits = 0;
+  bool negative = false, negativeExponent = false, any = false;
+  char *mark;
+
+  while(IsSpace(*position)) ++position;
+
+  if(*position == '-' || *position == '+') negative = (*position++ == '-');
+
+  // hexadecimal numbers start with 0x
+  if(position[0] == '0' && (position[1] == 'x' || position[1] == 'X')) return false;
+
+  for(; IsDigit(*position); ++position)
+  {
+    any = true;
+    if(mantissa == 0 && *position == '0') continue;
+    if(++digits > 19) return false;
+    mantissa = mantissa*10 + (*position - '0');
+  }
+
+  if(*position == '.')
+  {
+    for(++position; IsDigit(*position); ++position)
+    {
+      any = true;
+      ++fraction;
+      if(mantissa == 0 && *position == '0') continue;
+      if(++digits > 19) return false;
+      mantissa = mantissa*10 + (*position - '0');
+    }
+  }
+
+  if(!any) return false;
+
+  // the exponent is only part of the number when it has digits
+  if(*position == 'e' || *position == 'E')
+  {
+    mark = position + 1;
+    if(*mark == '-' || *mark == '+') negativeExponent = (*mark++ == '-');
+    if(IsDigit(*mark))
+    {
+      for(; IsDigit(*mark); ++mark)
+      {
+        if(++exponentDigits > 4) return false;
+        exponent = exponent*10 + (*mark - '0');
+      }
+      position = mark;
+    }
+  }
+
+  *end = position;
+
+  exponent = (negativeExponent ? -exponent : exponent) - fraction;
+
+  if(mantissa == 0)
+  {
+    value = negative ? -0.0 : 0.0;
+    return true;
+  }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  // mantissa and power of ten are exact, one rounding
+  if(mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+  {
+    value = exponent < 0 ? double(mantissa)/kPowersOfTen[-exponent] : double(mantissa)*kPowersOfTen[exponent];
+    if(negative) value = -value;
+    return true;
+  }
+#endif
+
+#ifdef __SIZEOF_INT128__
+  UInt128_t numerator, denominator, quotient;
+  int shift;
+
+  // mantissa*10^exponent = mantissa*5^exponent*2^exponent, computed with integers
+  if(exponent >= 0 && exponent <= 27)
+  {
+    value = RoundToDouble(UInt128_t(mantissa)*kPowersOfFive[exponent], false, exponent);
+    if(negative) value = -value;
+    return true;
+  }
+
+  // the quotient keeps at least 55 significant bits while 5^-exponent < 2^72
+  if(exponent < 0 && exponent >= -31)
+  {
+    denominator = exponent >= -27 ? UInt128_t(kPowersOfFive[-exponent]) :
+      UInt128_t(kPowersOfFive[27])*kPowersOfFive[-exponent - 27];
+
+    shift = 127 - BitLength(mantissa);
+    numerator = UInt128_t(mantissa) << shift;
+    quotient = numerator/denominator;
+
+    value = RoundToDouble(quotient, quotient*denominator != numerator, exponent - shift);
+    if(negative) value = -value;
+    return true;
+  }
+#endif
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+
+// Converts decimal integers with up to 9 digits, which always fit in int.
+// Returns false when the number has to be left to strtol.
+
+static bool ConvertInteger(char *start, char **end, int &value)
+{
+  char *position = start;
+  int digits = 0;
+  bool negative = false;
+
+  while(IsSpace(*position)) ++position;
+
+  if(*position == '-' || *position == '+') negative = (*position++ == '-');
+
+  value = 0;
+  for(; IsDigit(*position); ++position)
+  {
+    if(++digits > 9) return false;
+    value = value*10 + (*position - '0');
+  }
+
+  if(digits == 0) return false;
+
+  if(negative) value = -value;
+  *end = position;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
 bool DelphesStream::fFirstLongMin = true;
 bool DelphesStream::fFirstLongMax = true;
 bool DelphesStream::fFirstHugePos = true;
@@ -45,6 +256,7 @@ DelphesStream::DelphesStream(char *buffer) :
 bool DelphesStream::ReadDbl(double &value)
 {
   char *start = fBuffer;
+  if(ConvertDecimal(start, &fBuffer, value)) return true;
   errno = 0;
   value = strtod(start, &fBuffer);
   if(errno == ERANGE)
@@ -74,6 +286,7 @@ bool DelphesStream::ReadDbl(double &value)
 bool DelphesStream::ReadInt(int &value)
 {
   char *start = fBuffer;
+  if(ConvertInteger(start, &fBuffer, value)) return true;
   errno = 0;
   value = strtol(start, &fBuffer, 10);
   if(errno == ERANGE)
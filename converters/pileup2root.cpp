@@ -2,6 +2,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <stdlib.h>
 #include <signal.h>
@@ -16,14 +17,13 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "classes/DelphesStream.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -36,14 +36,20 @@ using namespace std;
 void ProcessEvent(DelphesPileUpReader *reader, ExRootTreeBranch *branch)
 {
   GenParticle *particle;
-  Int_t pid;
+  Int_t pid, counter;
   Float_t x, y, z, t;
   Float_t px, py, pz, e;
-  TDatabasePDG *pdg = TDatabasePDG::Instance();
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
   TLorentzVector momentum;
   Double_t pt, signPz, cosTheta, eta, rapidity;
+  vector<Int_t> charge(reader->GetEntrySize() + 1);
+  vector<Float_t> mass(reader->GetEntrySize() + 1);
+  Bool_t stored;
 
+  // version 2 files store charge and mass
+  stored = reader->ReadProperties(&charge[0], &mass[0]);
+
+  counter = 0;
   while(reader->ReadParticle(pid, x, y, z, t, px, py, pz, e))
   {
     particle = static_cast<GenParticle*>(branch->NewEntry());
@@ -67,10 +73,18 @@ void ProcessEvent(DelphesPileUpReader *reader, ExRootTreeBranch *branch)
     particle->D1 = -1;
     particle->D2 = -1;
 
-    pdgParticle = pdg->GetParticle(pid);
-    particle->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    if(stored)
+    {
+      particle->Charge = charge[counter];
+      particle->Mass = mass[counter];
+    }
+    else
+    {
+      particle->Charge = pdg->GetCharge(pid);
 
-    particle->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+      particle->Mass = pdg->GetMass(pid);
+    }
+    ++counter;
 
     momentum.SetPxPyPzE(px, py, pz, e);
     pt = momentum.Pt();
@@ -140,6 +154,12 @@ int main(int argc, char *argv[])
     allEntries = reader->GetEntries();
 
     cout << "** Input file contains " << allEntries << " events" << endl;
+    if(reader->GetVersion() > 1)
+    {
+      cout << "** Format version " << reader->GetVersion();
+      if(reader->IsOrderedByPT()) cout << ", particles ordered by pT";
+      cout << ", written by: " << reader->GetMetadata() << endl;
+    }
 
     if(allEntries > 0)
     {
@@ -4,6 +4,7 @@
 #include <string>
 
 #include <signal.h>
+#include <string.h>
 
 #include "TROOT.h"
 #include "TApplication.h"
@@ -41,11 +42,42 @@ int main(int argc, char *argv[])
   GenParticle *particle = 0;
   DelphesPileUpWriter *writer = 0;
   Long64_t entry, allEntries;
-  Int_t i;
+  Int_t i, version = 1;
+  Bool_t orderByPT = kFALSE, compress = kFALSE;
+  string metadata;
+
+  // leading options select the version 2 format
+  for(i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; ++i)
+  {
+    if(strcmp(argv[i], "--v2") == 0)
+    {
+      version = 2;
+    }
+    else if(strcmp(argv[i], "--order-pt") == 0)
+    {
+      version = 2;
+      orderByPT = kTRUE;
+    }
+    else if(strcmp(argv[i], "--compress") == 0)
+    {
+      version = 2;
+      compress = kTRUE;
+    }
+    else
+    {
+      cout << "** ERROR: unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+  argv += i - 1;
+  argc -= i - 1;
 
   if(argc < 3)
   {
-    cout << " Usage: " << appName << " output_file" << " input_file(s)" << endl;
+    cout << " Usage: " << appName << " [--v2] [--order-pt] [--compress]" << " output_file" << " input_file(s)" << endl;
+    cout << " --v2 - write columnar pile-up file (version 2)," << endl;
+    cout << " --order-pt - write version 2 with particles sorted by decreasing pT," << endl;
+    cout << " --compress - write version 2 with compressed events, smaller but slower to read," << endl;
     cout << " output_file - output binary pile-up file," << endl;
     cout << " input_file(s) - input file(s) in ROOT format." << endl;
     return 1;
@@ -71,7 +103,14 @@ int main(int argc, char *argv[])
     branchParticle = treeReader->UseBranch("Particle");
     itParticle = branchParticle->MakeIterator();
 
-    writer = new DelphesPileUpWriter(argv[1]);
+    metadata = appName;
+    for(i = 2; i < argc; ++i)
+    {
+      metadata += " ";
+      metadata += argv[i];
+    }
+
+    writer = new DelphesPileUpWriter(argv[1], version, orderByPT, metadata.c_str(), compress);
 
     allEntries = treeReader->GetEntries();
     cout << "** Input file(s) contain(s) " << allEntries << " events" << endl;
@@ -103,6 +142,12 @@ int main(int argc, char *argv[])
       progressBar.Finish();
 
       writer->WriteIndex();
+
+      if(compress)
+      {
+        cout << "** Pile-up events take " << writer->GetStoredSize()/1048576.0 << " MB (";
+        cout << writer->GetRawSize()/1048576.0 << " MB before compression)" << endl;
+      }
     }
 
     cout << "** Exiting..." << endl;
@@ -1,6 +1,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
+#include <string>
 
 #include <signal.h>
 
@@ -18,6 +19,7 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesSTDHEPReader.h"
 #include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesInputStream.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -39,22 +41,52 @@ void SignalHandler(int sig)
 int main(int argc, char *argv[])
 {
   char appName[] = "stdhep2pileup";
-  stringstream message;
-  FILE *inputFile = 0;
+  DelphesInputStream *inputStream = 0;
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   TIterator *itParticle = 0;
   Candidate *candidate = 0;
   DelphesPileUpWriter *writer = 0;
   DelphesSTDHEPReader *reader = 0;
-  Int_t i;
-  Long64_t length, eventCounter;
+  Int_t i, version = 1;
+  Bool_t orderByPT = kFALSE, compress = kFALSE;
+  string metadata;
+  Long64_t eventCounter;
+
+  // leading options select the version 2 format
+  for(i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; ++i)
+  {
+    if(strcmp(argv[i], "--v2") == 0)
+    {
+      version = 2;
+    }
+    else if(strcmp(argv[i], "--order-pt") == 0)
+    {
+      version = 2;
+      orderByPT = kTRUE;
+    }
+    else if(strcmp(argv[i], "--compress") == 0)
+    {
+      version = 2;
+      compress = kTRUE;
+    }
+    else
+    {
+      cout << "** ERROR: unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+  argv += i - 1;
+  argc -= i - 1;
 
   if(argc < 2)
   {
-    cout << " Usage: " << appName << " output_file" << " [input_file(s)]" << endl;
+    cout << " Usage: " << appName << " [--v2] [--order-pt] [--compress]" << " output_file" << " [input_file(s)]" << endl;
+    cout << " --v2 - write columnar pile-up file (version 2)," << endl;
+    cout << " --order-pt - write version 2 with particles sorted by decreasing pT," << endl;
+    cout << " --compress - write version 2 with compressed events, smaller but slower to read," << endl;
     cout << " output_file - output binary pile-up file," << endl;
-    cout << " input_file(s) - input file(s) in STDHEP format," << endl;
+    cout << " input_file(s) - input file(s) in STDHEP format, possibly gzip or zstd compressed," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
     return 1;
   }
@@ -69,7 +101,14 @@ int main(int argc, char *argv[])
 
   try
   {
-    writer = new DelphesPileUpWriter(argv[1]);
+    metadata = appName;
+    for(i = 2; i < argc; ++i)
+    {
+      metadata += " ";
+      metadata += argv[i];
+    }
+
+    writer = new DelphesPileUpWriter(argv[1], version, orderByPT, metadata.c_str(), compress);
 
     factory = new DelphesFactory("ObjectFactory");
     allParticleOutputArray = factory->NewPermanentArray();
@@ -80,6 +119,9 @@ int main(int argc, char *argv[])
 
     reader = new DelphesSTDHEPReader;
 
+    // decompresses gzip and zstd input on a separate thread
+    inputStream = new DelphesInputStream;
+
     i = 2;
     do
     {
@@ -88,35 +130,30 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputStream->Open("-");
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
-
-        if(inputFile == NULL)
-        {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+        inputStream->Open(argv[i]);
 
-        if(length <= 0)
+        if(inputStream->GetSize() <= 0)
         {
-          fclose(inputFile);
+          inputStream->Close();
           ++i;
           continue;
         }
       }
 
-      reader->SetInputFile(inputFile);
+      if(inputStream->GetFormat() != DelphesInputStream::kPlain)
+      {
+        cout << "** Decompressing " << inputStream->GetFormatName() << " input" << endl;
+      }
+
+      reader->SetInputFile(inputStream->GetFile());
 
-      ExRootProgressBar progressBar(length);
+      // progress in bytes of the file as stored
+      ExRootProgressBar progressBar(inputStream->GetSize());
 
       // Loop over all objects
       eventCounter = 0;
@@ -144,14 +181,13 @@ int main(int argc, char *argv[])
           factory->Clear();
           reader->Clear();
         }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(inputStream->GetPosition(), eventCounter);
       }
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(inputStream->GetSize(), eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      inputStream->Close();
 
       ++i;
     }
@@ -159,8 +195,15 @@ int main(int argc, char *argv[])
 
     writer->WriteIndex();
 
+    if(compress)
+    {
+      cout << "** Pile-up events take " << writer->GetStoredSize()/1048576.0 << " MB (";
+      cout << writer->GetRawSize()/1048576.0 << " MB before compression)" << endl;
+    }
+
     cout << "** Exiting..." << endl;
 
+    delete inputStream;
     delete reader;
     delete factory;
     delete writer;
@@ -169,6 +212,7 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(inputStream) delete inputStream;
     if(writer) delete writer;
     cerr << "** ERROR: " << e.what() << endl;
     return 1;
@@ -214,7 +214,7 @@ FASTJET_INCLUDE  =$(subst INCLUDE=,,$(FASTJET_INCLUDE_TMP))
 
 CXXFLAGS += $(ROOTCFLAGS) -Wno-write-strings -D_FILE_OFFSET_BITS=64 -DDROP_CGAL -I. -Iexternal -Iexternal/tcl -I$(FASTJET_INCLUDE)  -Iexternal/LHEActions
 
-DELPHES_LIBS = $(shell $(RC) --libs) -lEG $(SYSLIBS)
+DELPHES_LIBS = $(shell $(RC) --libs) -lEG -lz $(SYSLIBS)
 DISPLAY_LIBS = $(shell $(RC) --evelibs) $(SYSLIBS)
 
 ifneq ($(CMSSW_FWLITE_INCLUDE_PATH),)
@@ -230,6 +230,11 @@ endif
 DELPHES_LIBS += -lFWCoreFWLite -lDataFormatsFWLite -lDataFormatsPatCandidates -lDataFormatsLuminosity -lCommonToolsUtils -lMathCore -lDataFormatsMath  -lGenVector -lGenVector -lfastjet -lfastjetcontribfragile -lfastjetplugins -lfastjettools -lsiscone -lsiscone_spherical
 endif
 
+ifneq ($(ZSTD),)
+CXXFLAGS += -DHAS_ZSTD -I$(ZSTD)/include
+DELPHES_LIBS += -L$(ZSTD)/lib -lzstd
+endif
+
 ifneq ($(PROMC),)
 HAS_PROMC = true
 CXXFLAGS += -I$(PROMC)/include
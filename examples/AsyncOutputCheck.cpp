@@ -0,0 +1,183 @@
+/*
+Writes the same synthetic events with ExRootTreeWriter twice, with the tree
+filled on the main thread and with AsyncOutput, and compares the two files
+with CompareTrees.C. The events have particles, tracks referring to the
+particles and jets referring to the tracks, their sizes vary so that the
+branch buffers grow while they are swapped. Returns 0 when the files have
+no difference.
+
+AsyncOutputCheck [number_of_events]
+*/
+
+#include <stdexcept>
+#include <iostream>
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TApplication.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TClass.h"
+#include "TDataMember.h"
+#include "TObjString.h"
+#include "TClonesArray.h"
+#include "TProcessID.h"
+#include "TRandom3.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+#include "CompareTrees.C"
+
+//------------------------------------------------------------------------------
+
+void WriteEvents(const char *fileName, Bool_t async, Long64_t numberOfEntries)
+{
+  TFile *outputFile = TFile::Open(fileName, "RECREATE");
+  if(!outputFile)
+  {
+    throw runtime_error(string("can't create output file ") + fileName);
+  }
+
+  ExRootTreeWriter *treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+  treeWriter->SetAsyncOutput(async);
+
+  ExRootTreeBranch *branchParticle = treeWriter->NewBranch("Particle", GenParticle::Class());
+  ExRootTreeBranch *branchTrack = treeWriter->NewBranch("Track", Track::Class());
+  ExRootTreeBranch *branchJet = treeWriter->NewBranch("Jet", Jet::Class());
+
+  // the same seed for both files
+  TRandom3 random(4357);
+  GenParticle *particle;
+  Track *track;
+  Jet *jet;
+  TObjArray particles, tracks;
+  Long64_t entry;
+  Int_t i, j, numberOfParticles, numberOfJets;
+
+  for(entry = 0; entry < numberOfEntries; ++entry)
+  {
+    // from a few to a few hundred particles, larger events now and then
+    numberOfParticles = 5 + random.Integer(entry % 50 == 49 ? 2000 : 300);
+
+    particles.Clear();
+    tracks.Clear();
+
+    for(i = 0; i < numberOfParticles; ++i)
+    {
+      // entries are reused from earlier events, all members are reset
+      particle = static_cast<GenParticle *>(branchParticle->NewEntry());
+      *particle = GenParticle();
+      particle->PID = random.Rndm() < 0.5 ? 211 : -211;
+      particle->Status = 1;
+      particle->Charge = particle->PID > 0 ? 1 : -1;
+      particle->PT = random.Exp(0.5);
+      particle->Eta = random.Uniform(-5.0, 5.0);
+      particle->Phi = random.Uniform(-M_PI, M_PI);
+      particles.Add(particle);
+
+      // one particle in three is tracked
+      if(i % 3 != 0) continue;
+
+      track = static_cast<Track *>(branchTrack->NewEntry());
+      *track = Track();
+      track->PID = particle->PID;
+      track->Charge = particle->Charge;
+      track->PT = particle->PT;
+      track->Eta = particle->Eta;
+      track->Phi = particle->Phi;
+      track->Particle = particle;
+      tracks.Add(track);
+    }
+
+    numberOfJets = random.Integer(6);
+    for(i = 0; i < numberOfJets && tracks.GetEntriesFast() > 0; ++i)
+    {
+      jet = static_cast<Jet *>(branchJet->NewEntry());
+      *jet = Jet();
+      jet->PT = 0.0;
+      for(j = i; j < tracks.GetEntriesFast(); j += numberOfJets)
+      {
+        track = static_cast<Track *>(tracks.At(j));
+        jet->PT += track->PT;
+        jet->Constituents.Add(track);
+        jet->Particles.Add(track->Particle.GetObject());
+      }
+    }
+
+    treeWriter->Fill();
+    treeWriter->Clear();
+
+    // as DelphesFactory::Clear does after each event
+    TProcessID::SetObjectCount(0);
+  }
+
+  treeWriter->Write();
+  treeWriter->PrintSummary();
+
+  delete treeWriter;
+  delete outputFile;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "AsyncOutputCheck";
+  const char *fileSync = "AsyncOutputCheck_sync.root";
+  const char *fileAsync = "AsyncOutputCheck_async.root";
+  Long64_t numberOfEntries = 2000;
+  Int_t result;
+
+  if(argc > 2)
+  {
+    cout << " Usage: " << appName << " [number_of_events]" << endl;
+    cout << " number_of_events - number of synthetic events written in each mode (2000)." << endl;
+    return 1;
+  }
+
+  if(argc > 1) numberOfEntries = atol(argv[1]);
+
+  if(numberOfEntries <= 0)
+  {
+    cout << "** ERROR: the number of events must be positive" << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    WriteEvents(fileSync, kFALSE, numberOfEntries);
+    WriteEvents(fileAsync, kTRUE, numberOfEntries);
+
+    result = CompareTrees(fileSync, fileAsync);
+
+    gSystem->Unlink(fileSync);
+    gSystem->Unlink(fileAsync);
+
+    return result != 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
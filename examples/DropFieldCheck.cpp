@@ -0,0 +1,258 @@
+/*
+Writes the same synthetic events with ExRootTreeWriter twice, with all
+fields and with fields dropped by ExRootTreeBranch::DropField, among them
+the array members Tower.Edges[4] and Rho.Edges[2] and the references
+Tower.Particles. Reads both files back with CompareTrees.C: the dropped
+leaves must be missing from the second file and all other leaves and
+references must be the same. Returns 0 when the check passes.
+
+DropFieldCheck [number_of_events]
+*/
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TApplication.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TClass.h"
+#include "TDataMember.h"
+#include "TObjString.h"
+#include "TClonesArray.h"
+#include "TProcessID.h"
+#include "TRandom3.h"
+#include "TRegexp.h"
+
+#include "classes/DelphesClasses.h"
+
+#include "ExRootAnalysis/ExRootTreeReader.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+#include "CompareTrees.C"
+
+//------------------------------------------------------------------------------
+
+static const char *kDroppedLeaves = "Tower.Edges* Tower.Particles* Jet.Tau? Rho.Edges*";
+
+//------------------------------------------------------------------------------
+
+// array members are listed without their dimension and dropped by name
+
+Int_t DropFields(ExRootTreeBranch *branch, const char *fields[])
+{
+  vector<string> branchFields;
+  Int_t errors = 0;
+
+  branch->GetFields(branchFields);
+
+  for(; *fields; ++fields)
+  {
+    if(find(branchFields.begin(), branchFields.end(), *fields) == branchFields.end())
+    {
+      cout << "** ERROR: field " << *fields << " is not listed for branch " << branch->GetName() << endl;
+      ++errors;
+      continue;
+    }
+
+    branch->DropField(*fields);
+
+    if(branch->HasField(*fields))
+    {
+      cout << "** ERROR: field " << *fields << " of branch " << branch->GetName() << " is still written" << endl;
+      ++errors;
+    }
+  }
+
+  return errors;
+}
+
+//------------------------------------------------------------------------------
+
+Int_t WriteEvents(const char *fileName, Bool_t slim, Long64_t numberOfEntries)
+{
+  static const char *towerFields[] = {"Edges", "Particles", 0};
+  static const char *jetFields[] = {"Tau1", "Tau2", "Tau3", 0};
+  static const char *rhoFields[] = {"Edges", 0};
+
+  TFile *outputFile = TFile::Open(fileName, "RECREATE");
+  if(!outputFile)
+  {
+    throw runtime_error(string("can't create output file ") + fileName);
+  }
+
+  ExRootTreeWriter *treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+
+  ExRootTreeBranch *branchParticle = treeWriter->NewBranch("Particle", GenParticle::Class());
+  ExRootTreeBranch *branchTower = treeWriter->NewBranch("Tower", Tower::Class());
+  ExRootTreeBranch *branchJet = treeWriter->NewBranch("Jet", Jet::Class());
+  ExRootTreeBranch *branchRho = treeWriter->NewBranch("Rho", Rho::Class());
+
+  Int_t errors = 0;
+
+  if(slim)
+  {
+    errors += DropFields(branchTower, towerFields);
+    errors += DropFields(branchJet, jetFields);
+    errors += DropFields(branchRho, rhoFields);
+
+    // a field that does not exist is an error
+    try
+    {
+      branchJet->DropField("NoSuchField");
+      cout << "** ERROR: dropping an unknown field did not fail" << endl;
+      ++errors;
+    }
+    catch(runtime_error &e)
+    {
+    }
+  }
+
+  // the same seed for both files
+  TRandom3 random(4357);
+  GenParticle *particle;
+  Tower *tower;
+  Jet *jet;
+  Rho *rho;
+  TObjArray particles, towers;
+  Long64_t entry;
+  Int_t i, j, numberOfParticles, numberOfJets;
+
+  for(entry = 0; entry < numberOfEntries; ++entry)
+  {
+    numberOfParticles = 5 + random.Integer(300);
+
+    particles.Clear();
+    towers.Clear();
+
+    for(i = 0; i < numberOfParticles; ++i)
+    {
+      // entries are reused from earlier events, all members are reset
+      particle = static_cast<GenParticle *>(branchParticle->NewEntry());
+      *particle = GenParticle();
+      particle->PID = random.Rndm() < 0.5 ? 22 : 211;
+      particle->Status = 1;
+      particle->PT = random.Exp(0.5);
+      particle->Eta = random.Uniform(-5.0, 5.0);
+      particle->Phi = random.Uniform(-M_PI, M_PI);
+      particles.Add(particle);
+
+      // one tower for every two particles
+      if(i % 2 != 0) continue;
+
+      tower = static_cast<Tower *>(branchTower->NewEntry());
+      *tower = Tower();
+      tower->ET = particle->PT;
+      tower->Eta = particle->Eta;
+      tower->Phi = particle->Phi;
+      tower->Edges[0] = particle->Eta - 0.05;
+      tower->Edges[1] = particle->Eta + 0.05;
+      tower->Edges[2] = particle->Phi - 0.05;
+      tower->Edges[3] = particle->Phi + 0.05;
+      tower->Particles.Add(particle);
+      towers.Add(tower);
+    }
+
+    numberOfJets = 1 + random.Integer(5);
+    for(i = 0; i < numberOfJets && towers.GetEntriesFast() > 0; ++i)
+    {
+      jet = static_cast<Jet *>(branchJet->NewEntry());
+      *jet = Jet();
+      jet->PT = 0.0;
+      jet->Tau1 = random.Rndm();
+      jet->Tau2 = jet->Tau1*random.Rndm();
+      jet->Tau3 = jet->Tau2*random.Rndm();
+      for(j = i; j < towers.GetEntriesFast(); j += numberOfJets)
+      {
+        tower = static_cast<Tower *>(towers.At(j));
+        jet->PT += tower->ET;
+        jet->Constituents.Add(tower);
+        jet->Particles.Add(tower->Particles.At(0));
+      }
+    }
+
+    rho = static_cast<Rho *>(branchRho->NewEntry());
+    *rho = Rho();
+    rho->Rho = random.Exp(10.0);
+    rho->Edges[0] = -2.5;
+    rho->Edges[1] = 2.5;
+
+    treeWriter->Fill();
+    treeWriter->Clear();
+
+    // as DelphesFactory::Clear does after each event
+    TProcessID::SetObjectCount(0);
+  }
+
+  treeWriter->Write();
+
+  delete treeWriter;
+  delete outputFile;
+
+  return errors;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "DropFieldCheck";
+  const char *fileFull = "DropFieldCheck_full.root";
+  const char *fileSlim = "DropFieldCheck_slim.root";
+  Long64_t numberOfEntries = 1000;
+  Int_t errors;
+
+  if(argc > 2)
+  {
+    cout << " Usage: " << appName << " [number_of_events]" << endl;
+    cout << " number_of_events - number of synthetic events written in each file (1000)." << endl;
+    return 1;
+  }
+
+  if(argc > 1) numberOfEntries = atol(argv[1]);
+
+  if(numberOfEntries <= 0)
+  {
+    cout << "** ERROR: the number of events must be positive" << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    errors = WriteEvents(fileFull, kFALSE, numberOfEntries);
+    errors += WriteEvents(fileSlim, kTRUE, numberOfEntries);
+
+    if(CompareTrees(fileFull, fileSlim, kDroppedLeaves) != 0) ++errors;
+
+    gSystem->Unlink(fileFull);
+    gSystem->Unlink(fileSlim);
+
+    return errors != 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
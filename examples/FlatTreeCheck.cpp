@@ -0,0 +1,315 @@
+/*
+Checks the output of FlatTreeWriter in two steps:
+
+- 64-bit columns: Long64_t and ULong64_t values that a Double_t can not hold
+  exactly are written to L and l columns and must be read back unchanged;
+
+- flat columns: synthetic particles go through ParticlePropagator, TreeWriter
+  and FlatTreeWriter write the particles and tracks to the same tree, and
+  CompareFlatTree.C reads the flat columns through the header written by
+  FlatTreeWriter and compares them, including the track to particle links,
+  with the TreeWriter branches.
+
+Returns 0 when both steps pass.
+
+FlatTreeCheck [number_of_events]
+*/
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TApplication.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TClass.h"
+#include "TBaseClass.h"
+#include "TDataMember.h"
+#include "TDataType.h"
+#include "TObjString.h"
+#include "TArrayI.h"
+#include "TClonesArray.h"
+#include "TRandom3.h"
+
+#include "modules/Delphes.h"
+#include "classes/DelphesClasses.h"
+#include "classes/DelphesFactory.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
+#include "ExRootAnalysis/ExRootTreeReader.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+#include "CompareFlatTree.C"
+
+//------------------------------------------------------------------------------
+
+static const char *kCardFile = "FlatTreeCheck.tcl";
+static const char *kHeaderFile = "FlatTreeCheck.h";
+
+static const char *kCard =
+  "set ExecutionPath {ParticlePropagator TreeWriter FlatTreeWriter}\n"
+  "module ParticlePropagator ParticlePropagator {\n"
+  "  set InputArray Delphes/stableParticles\n"
+  "  set OutputArray stableParticles\n"
+  "  set ChargedHadronOutputArray chargedHadrons\n"
+  "  set ElectronOutputArray electrons\n"
+  "  set MuonOutputArray muons\n"
+  "  set Radius 1.29\n"
+  "  set HalfLength 3.00\n"
+  "  set Bz 3.8\n"
+  "}\n"
+  "module TreeWriter TreeWriter {\n"
+  "  add Branch Delphes/stableParticles Particle GenParticle\n"
+  "  add Branch ParticlePropagator/chargedHadrons Track Track\n"
+  "}\n"
+  "module FlatTreeWriter FlatTreeWriter {\n"
+  "  add Branch Delphes/stableParticles Particle GenParticle\n"
+  "  add Branch ParticlePropagator/chargedHadrons Track Track\n"
+  "  set HeaderFile FlatTreeCheck.h\n"
+  "}\n";
+
+//------------------------------------------------------------------------------
+
+// values around the 53 bits of a Double_t mantissa and the limits of the types
+
+Int_t CheckIntegerColumns(const char *fileName, Long64_t numberOfEntries)
+{
+  const Long64_t one = 1;
+  const Long64_t values[] =
+  {
+    0, 1, -1, (one << 53) + 1, -(one << 53) - 1, (one << 62) + 3, -(one << 62) - 3,
+    Long64_t(~(ULong64_t(1) << 63)), Long64_t(ULong64_t(1) << 63)
+  };
+  const Int_t kValues = sizeof(values)/sizeof(values[0]);
+
+  TFile *outputFile = TFile::Open(fileName, "RECREATE");
+  if(!outputFile)
+  {
+    throw runtime_error(string("can't create output file ") + fileName);
+  }
+
+  ExRootTreeWriter *treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+  ExRootTreeBranch *counter = treeWriter->NewColumnBranch("nValue", 'I');
+  ExRootTreeBranch *columnSigned = treeWriter->NewColumnBranch("Value_Signed", 'L', "nValue");
+  ExRootTreeBranch *columnUnsigned = treeWriter->NewColumnBranch("Value_Unsigned", 'l', "nValue");
+
+  Long64_t entry;
+  Int_t i, size, errors = 0;
+
+  for(entry = 0; entry < numberOfEntries; ++entry)
+  {
+    size = entry % (kValues + 1);
+    counter->AddValue(size);
+    for(i = 0; i < size; ++i)
+    {
+      columnSigned->AddInteger(values[(entry + i) % kValues]);
+      columnUnsigned->AddInteger(values[(entry + i) % kValues]);
+    }
+
+    treeWriter->Fill();
+    treeWriter->Clear();
+  }
+
+  treeWriter->Write();
+
+  delete treeWriter;
+  delete outputFile;
+
+  // read back into arrays of the column types
+
+  TFile *inputFile = TFile::Open(fileName);
+  TTree *tree = inputFile ? (TTree *) inputFile->Get("Delphes") : 0;
+  if(!tree)
+  {
+    throw runtime_error(string("can't read tree Delphes from ") + fileName);
+  }
+
+  vector<Long64_t> valuesSigned(kValues);
+  vector<ULong64_t> valuesUnsigned(kValues);
+
+  tree->SetBranchAddress("nValue", &size);
+  tree->SetBranchAddress("Value_Signed", &valuesSigned[0]);
+  tree->SetBranchAddress("Value_Unsigned", &valuesUnsigned[0]);
+
+  for(entry = 0; entry < tree->GetEntries(); ++entry)
+  {
+    tree->GetEntry(entry);
+    if(size != entry % (kValues + 1))
+    {
+      cout << "** ERROR: entry " << entry << " has " << size << " values" << endl;
+      ++errors;
+      continue;
+    }
+    for(i = 0; i < size; ++i)
+    {
+      if(valuesSigned[i] != values[(entry + i) % kValues] ||
+         valuesUnsigned[i] != ULong64_t(values[(entry + i) % kValues]))
+      {
+        cout << "** ERROR: entry " << entry << ", value " << i << " is " << valuesSigned[i] << " and ";
+        cout << valuesUnsigned[i] << " instead of " << values[(entry + i) % kValues] << endl;
+        ++errors;
+      }
+    }
+  }
+
+  if(tree->GetEntries() != numberOfEntries)
+  {
+    cout << "** ERROR: " << tree->GetEntries() << " entries instead of " << numberOfEntries << endl;
+    ++errors;
+  }
+
+  delete inputFile;
+
+  cout << "** INFO: " << numberOfEntries << " entries of 64-bit columns checked, " << errors << " errors" << endl;
+
+  return errors;
+}
+
+//------------------------------------------------------------------------------
+
+void WriteEvents(const char *fileName, Long64_t numberOfEntries)
+{
+  static const Int_t pids[] = {211, -211, 321, -321, 2212, 22, 22, 130};
+  static const Double_t masses[] = {0.1396, 0.1396, 0.4937, 0.4937, 0.9383, 0.0, 0.0, 0.4976};
+  static const Int_t charges[] = {1, -1, 1, -1, 1, 0, 0, 0};
+
+  ofstream card(kCardFile);
+  card << kCard;
+  card.close();
+
+  TFile *outputFile = TFile::Open(fileName, "RECREATE");
+  if(!outputFile)
+  {
+    throw runtime_error(string("can't create output file ") + fileName);
+  }
+
+  ExRootTreeWriter *treeWriter = new ExRootTreeWriter(outputFile, "Delphes");
+
+  ExRootConfReader *confReader = new ExRootConfReader;
+  confReader->ReadFile(kCardFile);
+
+  Delphes *modularDelphes = new Delphes("Delphes");
+  modularDelphes->SetConfReader(confReader);
+  modularDelphes->SetTreeWriter(treeWriter);
+
+  DelphesFactory *factory = modularDelphes->GetFactory();
+  TObjArray *allParticleOutputArray = modularDelphes->ExportArray("allParticles");
+  TObjArray *stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
+  modularDelphes->ExportArray("partons");
+
+  modularDelphes->InitTask();
+
+  TRandom3 random(4357);
+  Candidate *candidate;
+  Long64_t entry;
+  Int_t i, type, numberOfParticles;
+
+  treeWriter->Clear();
+  modularDelphes->Clear();
+
+  for(entry = 0; entry < numberOfEntries; ++entry)
+  {
+    numberOfParticles = 5 + random.Integer(300);
+
+    for(i = 0; i < numberOfParticles; ++i)
+    {
+      type = random.Integer(sizeof(pids)/sizeof(pids[0]));
+
+      candidate = factory->NewCandidate();
+      candidate->PID = pids[type];
+      candidate->Status = 1;
+      candidate->Charge = charges[type];
+      candidate->Mass = masses[type];
+      candidate->M1 = candidate->M2 = candidate->D1 = candidate->D2 = -1;
+      candidate->Momentum.SetPtEtaPhiM(0.2 + random.Exp(1.0), random.Uniform(-4.0, 4.0),
+        random.Uniform(-M_PI, M_PI), masses[type]);
+      candidate->Position.SetXYZT(random.Gaus(0.0, 0.01), random.Gaus(0.0, 0.01), random.Gaus(0.0, 50.0), 0.0);
+
+      allParticleOutputArray->Add(candidate);
+      stableParticleOutputArray->Add(candidate);
+    }
+
+    modularDelphes->ProcessTask();
+
+    treeWriter->Fill();
+    treeWriter->Clear();
+
+    modularDelphes->Clear();
+  }
+
+  // writes the header
+  modularDelphes->FinishTask();
+  treeWriter->Write();
+
+  delete modularDelphes;
+  delete confReader;
+  delete treeWriter;
+  delete outputFile;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "FlatTreeCheck";
+  const char *fileColumns = "FlatTreeCheck_columns.root";
+  const char *fileFlat = "FlatTreeCheck.root";
+  Long64_t numberOfEntries = 1000;
+  Int_t errors;
+
+  if(argc > 2)
+  {
+    cout << " Usage: " << appName << " [number_of_events]" << endl;
+    cout << " number_of_events - number of synthetic events written (1000)." << endl;
+    return 1;
+  }
+
+  if(argc > 1) numberOfEntries = atol(argv[1]);
+
+  if(numberOfEntries <= 0)
+  {
+    cout << "** ERROR: the number of events must be positive" << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    errors = CheckIntegerColumns(fileColumns, numberOfEntries);
+
+    // both writers fill the same tree, it is the flat and the object file
+    WriteEvents(fileFlat, numberOfEntries);
+    if(CompareFlatTree(fileFlat, fileFlat, kHeaderFile) != 0) ++errors;
+
+    gSystem->Unlink(fileColumns);
+    gSystem->Unlink(fileFlat);
+    gSystem->Unlink(kCardFile);
+
+    return errors != 0;
+  }
+  catch(runtime_error &e)
+  {
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,322 @@
+/*
+Writes the same synthetic pile-up events as version 1, version 2, version 2
+ordered by pT and version 2 compressed, reads them back, compares the
+particles with the events written and reports the size of each file and
+the decoding rate. Returns 0 when all files read back correctly.
+
+PileUpFormatCheck [number_of_events] [number_of_passes]
+*/
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "TROOT.h"
+#include "TApplication.h"
+
+#include "TRandom3.h"
+#include "TStopwatch.h"
+
+#include "classes/DelphesPileUpWriter.h"
+#include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpFormat.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+
+static const int kFormats = 4;
+static const char *kFormatNames[kFormats] = {"v1", "v2", "v2 ordered by pT", "v2 compressed"};
+static const char *kFileNames[kFormats] =
+{
+  "PileUpFormatCheck_v1.pileup",
+  "PileUpFormatCheck_v2.pileup",
+  "PileUpFormatCheck_v2_pt.pileup",
+  "PileUpFormatCheck_v2_zip.pileup"
+};
+
+struct PileUpEvent
+{
+  vector<int> pid;
+  vector<float> x, y, z, t, px, py, pz, e;
+};
+
+//------------------------------------------------------------------------------
+
+// minimum bias like events: prompt hadrons produced at the origin, photons
+// from pi0 decays a few tens of nm away and pions from K0S decays displaced
+// by centimeters, as stored by the converters before vertex smearing
+
+void GenerateEvent(TRandom3 &random, PileUpEvent &event)
+{
+  static const int pids[] = {211, -211, 211, -211, 321, -321, 130, 2212, -2212, 2112};
+  int i, n = 50 + random.Integer(200);
+  float pt, eta, phi, mass, length, kind;
+
+  event.pid.resize(n);
+  event.x.resize(n); event.y.resize(n); event.z.resize(n); event.t.resize(n);
+  event.px.resize(n); event.py.resize(n); event.pz.resize(n); event.e.resize(n);
+
+  for(i = 0; i < n; ++i)
+  {
+    kind = random.Rndm();
+    pt = random.Exp(0.5);
+    eta = random.Uniform(-5.0, 5.0);
+    phi = random.Uniform(-M_PI, M_PI);
+
+    if(kind < 0.4)
+    {
+      event.pid[i] = 22;
+      length = random.Exp(2.5e-5);
+    }
+    else if(kind < 0.5)
+    {
+      event.pid[i] = random.Rndm() < 0.5 ? 211 : -211;
+      length = random.Exp(26.8);
+    }
+    else
+    {
+      event.pid[i] = pids[random.Integer(sizeof(pids)/sizeof(pids[0]))];
+      length = 0.0;
+    }
+
+    mass = event.pid[i] == 22 ? 0.0 : 0.14;
+
+    event.px[i] = pt*cos(phi);
+    event.py[i] = pt*sin(phi);
+    event.pz[i] = pt*sinh(eta);
+    event.e[i] = sqrt(mass*mass + pt*pt*cosh(eta)*cosh(eta));
+
+    // decay vertex along the momentum of the particle
+    event.x[i] = length*cos(phi);
+    event.y[i] = length*sin(phi);
+    event.z[i] = length*sinh(eta);
+    event.t[i] = length*cosh(eta);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int CompareEvent(DelphesPileUpReader *reader, int format, const PileUpEvent &event, Long64_t entry)
+{
+  int i, n = event.pid.size(), errors = 0;
+  vector<int> pid(n + 1), charge(n + 1);
+  vector<float> x(n + 1), y(n + 1), z(n + 1), t(n + 1);
+  vector<float> px(n + 1), py(n + 1), pz(n + 1), e(n + 1), mass(n + 1);
+  float positions[4], ptPrevious = 0.0, pt;
+  bool half = format > 0, ordered = format == 2;
+
+  if(!reader->ReadEntry(entry) || reader->GetEntrySize() != n)
+  {
+    cout << "** ERROR: " << kFormatNames[format] << ", entry " << entry << " has ";
+    cout << reader->GetEntrySize() << " particles instead of " << n << endl;
+    return 1;
+  }
+
+  reader->ReadParticles(&pid[0], &x[0], &y[0], &z[0], &t[0], &px[0], &py[0], &pz[0], &e[0]);
+
+  if(reader->ReadProperties(&charge[0], &mass[0]) != (format > 0)) ++errors;
+
+  for(i = 0; i < n; ++i)
+  {
+    if(ordered)
+    {
+      // each particle comes after the ones with a larger pT
+      pt = sqrt(px[i]*px[i] + py[i]*py[i]);
+      if(i > 0 && pt > ptPrevious) ++errors;
+      ptPrevious = pt;
+      continue;
+    }
+
+    // positions are rounded to half precision in version 2
+    positions[0] = half ? PileUpHalfToFloat(PileUpFloatToHalf(event.x[i])) : event.x[i];
+    positions[1] = half ? PileUpHalfToFloat(PileUpFloatToHalf(event.y[i])) : event.y[i];
+    positions[2] = half ? PileUpHalfToFloat(PileUpFloatToHalf(event.z[i])) : event.z[i];
+    positions[3] = half ? PileUpHalfToFloat(PileUpFloatToHalf(event.t[i])) : event.t[i];
+
+    if(pid[i] != event.pid[i] ||
+       x[i] != positions[0] || y[i] != positions[1] || z[i] != positions[2] || t[i] != positions[3] ||
+       px[i] != event.px[i] || py[i] != event.py[i] || pz[i] != event.pz[i] || e[i] != event.e[i])
+    {
+      ++errors;
+    }
+  }
+
+  // particle by particle reading gives the same values
+  reader->ReadEntry(entry);
+  for(i = 0; reader->ReadParticle(pid[n], x[n], y[n], z[n], t[n], px[n], py[n], pz[n], e[n]); ++i)
+  {
+    if(i >= n || pid[n] != pid[i] || x[n] != x[i] || t[n] != t[i] || px[n] != px[i] || e[n] != e[i]) ++errors;
+  }
+  if(i != n) ++errors;
+
+  if(errors > 0)
+  {
+    cout << "** ERROR: " << kFormatNames[format] << ", entry " << entry << " has " << errors << " differences" << endl;
+  }
+
+  return errors > 0;
+}
+
+//------------------------------------------------------------------------------
+
+// events decoded per second, all entries are read the given number of times
+
+double MeasureRate(DelphesPileUpReader *reader, int passes)
+{
+  TStopwatch stopwatch;
+  Long64_t entry;
+  int i, size = 0;
+
+  for(entry = 0; entry < reader->GetEntries(); ++entry)
+  {
+    reader->ReadEntry(entry);
+    if(reader->GetEntrySize() > size) size = reader->GetEntrySize();
+  }
+
+  vector<int> pid(size + 1);
+  vector<float> x(size + 1), y(size + 1), z(size + 1), t(size + 1);
+  vector<float> px(size + 1), py(size + 1), pz(size + 1), e(size + 1);
+
+  stopwatch.Start();
+  for(i = 0; i < passes; ++i)
+  {
+    for(entry = 0; entry < reader->GetEntries(); ++entry)
+    {
+      reader->ReadEntry(entry);
+      reader->ReadParticles(&pid[0], &x[0], &y[0], &z[0], &t[0], &px[0], &py[0], &pz[0], &e[0]);
+    }
+  }
+  stopwatch.Stop();
+
+  return passes*reader->GetEntries()/stopwatch.RealTime();
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+  char appName[] = "PileUpFormatCheck";
+  DelphesPileUpWriter *writers[kFormats] = {0, 0, 0, 0};
+  DelphesPileUpReader *readers[kFormats] = {0, 0, 0, 0};
+  vector<PileUpEvent> events;
+  TRandom3 random(4357);
+  Long64_t entry, numberOfEntries = 1000, particles = 0;
+  int i, format, passes = 20, errors = 0;
+  double rates[kFormats];
+
+  if(argc > 3)
+  {
+    cout << " Usage: " << appName << " [number_of_events] [number_of_passes]" << endl;
+    cout << " number_of_events - number of synthetic events written in each format (1000)," << endl;
+    cout << " number_of_passes - number of times all events are decoded to measure the rate (20)." << endl;
+    return 1;
+  }
+
+  if(argc > 1) numberOfEntries = atol(argv[1]);
+  if(argc > 2) passes = atoi(argv[2]);
+
+  if(numberOfEntries <= 0 || passes <= 0)
+  {
+    cout << "** ERROR: the numbers of events and passes must be positive" << endl;
+    return 1;
+  }
+
+  gROOT->SetBatch();
+
+  int appargc = 1;
+  char *appargv[] = {appName};
+  TApplication app(appName, &appargc, appargv);
+
+  try
+  {
+    events.resize(numberOfEntries);
+    for(entry = 0; entry < numberOfEntries; ++entry)
+    {
+      GenerateEvent(random, events[entry]);
+      particles += events[entry].pid.size();
+    }
+
+    writers[0] = new DelphesPileUpWriter(kFileNames[0]);
+    writers[1] = new DelphesPileUpWriter(kFileNames[1], 2, false, appName);
+    writers[2] = new DelphesPileUpWriter(kFileNames[2], 2, true, appName);
+    writers[3] = new DelphesPileUpWriter(kFileNames[3], 2, false, appName, true);
+
+    for(entry = 0; entry < numberOfEntries; ++entry)
+    {
+      const PileUpEvent &event = events[entry];
+      for(format = 0; format < kFormats; ++format)
+      {
+        for(i = 0; i < int(event.pid.size()); ++i)
+        {
+          writers[format]->WriteParticle(event.pid[i],
+            event.x[i], event.y[i], event.z[i], event.t[i],
+            event.px[i], event.py[i], event.pz[i], event.e[i]);
+        }
+        writers[format]->WriteEntry();
+      }
+    }
+
+    for(format = 0; format < kFormats; ++format)
+    {
+      writers[format]->WriteIndex();
+      cout << "** " << kFormatNames[format] << ": " << writers[format]->GetStoredSize()/1048576.0 << " MB" << endl;
+      delete writers[format];
+      writers[format] = 0;
+    }
+
+    // contents
+
+    for(format = 0; format < kFormats; ++format)
+    {
+      readers[format] = new DelphesPileUpReader(kFileNames[format]);
+      if(readers[format]->GetEntries() != numberOfEntries || readers[format]->GetVersion() != (format > 0 ? 2 : 1) ||
+         readers[format]->IsOrderedByPT() != (format == 2))
+      {
+        cout << "** ERROR: " << kFormatNames[format] << " has a wrong header or index" << endl;
+        ++errors;
+        continue;
+      }
+      for(entry = 0; entry < numberOfEntries; ++entry)
+      {
+        errors += CompareEvent(readers[format], format, events[entry], entry);
+      }
+    }
+
+    // decoding rate, the files are already in the page cache
+
+    for(format = 0; format < kFormats; ++format)
+    {
+      rates[format] = MeasureRate(readers[format], passes);
+      cout << "** " << kFormatNames[format] << ": " << rates[format] << " events/s, ";
+      cout << rates[format]*particles/numberOfEntries << " particles/s" << endl;
+    }
+
+    cout << "** v2 decodes " << rates[1]/rates[0] << " times as fast as v1" << endl;
+
+    for(format = 0; format < kFormats; ++format)
+    {
+      delete readers[format];
+      remove(kFileNames[format]);
+    }
+
+    cout << "** " << numberOfEntries << " events checked in " << kFormats << " formats, " << errors << " errors" << endl;
+
+    return errors > 0;
+  }
+  catch(runtime_error &e)
+  {
+    for(format = 0; format < kFormats; ++format)
+    {
+      if(writers[format]) delete writers[format];
+      if(readers[format]) delete readers[format];
+    }
+    cerr << "** ERROR: " << e.what() << endl;
+    return 1;
+  }
+}
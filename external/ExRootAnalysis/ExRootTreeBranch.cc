@@ -16,9 +16,16 @@
 
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
+#include "TObjArray.h"
 #include "TString.h"
 #include "TClonesArray.h"
+#include "TDataMember.h"
+#include "TBaseClass.h"
+#include "TClass.h"
+#include "TList.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
@@ -26,9 +33,83 @@
 using namespace std;
 
 //------------------------------------------------------------------------------
+// apply output settings to a branch and to all its sub-branches
 
-ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
-    fSize(0), fCapacity(1),fDataFloat(0), fData(0)
+static void ConfigureBranch(TBranch *branch, Int_t algorithm, Int_t level, Int_t basketSize)
+{
+    TObjArray *branches;
+    Int_t i;
+
+    if(!branch) return;
+
+    if(algorithm >= 0) branch->SetCompressionAlgorithm(algorithm);
+    if(level >= 0) branch->SetCompressionLevel(level);
+    if(basketSize > 0) branch->SetBasketSize(basketSize);
+
+    branches = branch->GetListOfBranches();
+    for(i = 0; i < branches->GetEntriesFast(); ++i)
+    {
+	ConfigureBranch(static_cast<TBranch *>(branches->At(i)), algorithm, level, basketSize);
+    }
+}
+
+//------------------------------------------------------------------------------
+// remove the leaves of a branch and of its sub-branches from the tree
+
+static void RemoveLeaves(TTree *tree, TBranch *branch)
+{
+    TObjArray *leaves, *branches;
+    Int_t i;
+
+    leaves = branch->GetListOfLeaves();
+    for(i = 0; i < leaves->GetEntriesFast(); ++i)
+    {
+	tree->GetListOfLeaves()->Remove(leaves->At(i));
+    }
+    tree->GetListOfLeaves()->Compress();
+
+    branches = branch->GetListOfBranches();
+    for(i = 0; i < branches->GetEntriesFast(); ++i)
+    {
+	RemoveLeaves(tree, static_cast<TBranch *>(branches->At(i)));
+    }
+}
+
+//------------------------------------------------------------------------------
+// persistent data members of a class and of its base classes, but TObject
+
+static void AddDataMembers(TClass *cl, vector<string> &members)
+{
+    TIter itBases(cl->GetListOfBases());
+    TIter itMembers(cl->GetListOfDataMembers());
+    TBaseClass *base;
+    TDataMember *member;
+
+    while((base = static_cast<TBaseClass *>(itBases.Next())))
+    {
+	if(base->GetClassPointer() && base->GetClassPointer() != TObject::Class())
+	{
+	    AddDataMembers(base->GetClassPointer(), members);
+	}
+    }
+
+    while((member = static_cast<TDataMember *>(itMembers.Next())))
+    {
+	if(member->IsPersistent() && !(member->Property() & kIsStatic))
+	{
+	    members.push_back(member->GetName());
+	}
+    }
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree,
+  Int_t basketSize, Int_t splitLevel) :
+    fName(name), fSize(0), fCapacity(1),fDataFloat(0), fData(0),
+    fTreeSize(0), fTreeCapacity(1), fTreeDataFloat(0), fTreeData(0),
+    fColumnType(0), fColumnTypeSize(0), fDataColumn(0), fTreeDataColumn(0),
+    fBranch(0), fSizeBranch(0)
 {
     stringstream message;
 //  cl->IgnoreTObjectStreamer();
@@ -40,10 +121,11 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
 	fData->SetName(name);
 	fData->ExpandCreateFast(fCapacity);
 	fData->Clear();
+	fTreeData = fData;
 	if(tree)
 	{
-	    tree->Branch(name, &fData, 64000);
-	    tree->Branch(TString(name) + "_size", &fSize, TString(name) + "_size/I");
+	    fBranch = tree->Branch(name, &fTreeData, basketSize, splitLevel);
+	    fSizeBranch = tree->Branch(TString(name) + "_size", &fTreeSize, TString(name) + "_size/I");
 	}
     }
     else
@@ -57,11 +139,52 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TClass *cl, TTree *tree) :
 // construct a plain branch
 
 ExRootTreeBranch::ExRootTreeBranch(const char *name, TTree *tree) :
-    fDataFloat(0), fData(0)
+    fName(name), fSize(0), fCapacity(0), fDataFloat(0), fData(0),
+    fTreeSize(0), fTreeCapacity(0), fTreeDataFloat(0), fTreeData(0),
+    fColumnType(0), fColumnTypeSize(0), fDataColumn(0), fTreeDataColumn(0),
+    fBranch(0), fSizeBranch(0)
 {
+    // allocated here rather than by the tree, so that it can be swapped
+    fDataFloat = new vector<float>;
+    fTreeDataFloat = fDataFloat;
     if(tree)
     {
-	tree->Branch(name, &fDataFloat);
+	fBranch = tree->Branch(name, &fTreeDataFloat);
+    }
+}
+
+//------------------------------------------------------------------------------
+// construct a column branch
+
+ExRootTreeBranch::ExRootTreeBranch(const char *name, Char_t type, const char *counter, TTree *tree) :
+    fName(name), fSize(0), fCapacity(0), fDataFloat(0), fData(0),
+    fTreeSize(0), fTreeCapacity(0), fTreeDataFloat(0), fTreeData(0),
+    fColumnType(type), fCounterName(counter ? counter : ""), fColumnTypeSize(0),
+    fDataColumn(0), fTreeDataColumn(0),
+    fBranch(0), fSizeBranch(0)
+{
+    stringstream message;
+    TString leaves;
+
+    switch(type)
+    {
+	case 'F': case 'I': case 'i': fColumnTypeSize = 4; break;
+	case 'D': case 'L': case 'l': fColumnTypeSize = 8; break;
+	default:
+	    message << "unknown type '" << type << "' of column '" << name << "'";
+	    throw runtime_error(message.str());
+    }
+
+    // never empty, so that the tree always has an address
+    fDataColumn = new vector<char>(16*fColumnTypeSize);
+    fTreeDataColumn = fDataColumn;
+
+    if(counter && counter[0]) leaves.Form("%s[%s]/%c", name, counter, type);
+    else leaves.Form("%s/%c", name, type);
+
+    if(tree)
+    {
+	fBranch = tree->Branch(name, &(*fTreeDataColumn)[0], leaves);
     }
 }
 
@@ -69,8 +192,12 @@ ExRootTreeBranch::ExRootTreeBranch(const char *name, TTree *tree) :
 
 ExRootTreeBranch::~ExRootTreeBranch()
 {
+    if(fTreeData && fTreeData != fData) delete fTreeData;
     if(fData) delete fData;
-//    if(fDataFloat) delete fDataFloat;
+    if(fTreeDataFloat && fTreeDataFloat != fDataFloat) delete fTreeDataFloat;
+    if(fDataFloat) delete fDataFloat;
+    if(fTreeDataColumn && fTreeDataColumn != fDataColumn) delete fTreeDataColumn;
+    if(fDataColumn) delete fDataColumn;
 }
 
 //------------------------------------------------------------------------------
@@ -98,6 +225,13 @@ TObject *ExRootTreeBranch::NewEntry()
 
 //------------------------------------------------------------------------------
 
+TObject *ExRootTreeBranch::GetEntry(Int_t i) const
+{
+    return (fData && i < fSize) ? fData->At(i) : 0;
+}
+
+//------------------------------------------------------------------------------
+
 vector<float>* ExRootTreeBranch::NewFloatEntry()
 {
     fDataFloat->clear();
@@ -106,6 +240,61 @@ vector<float>* ExRootTreeBranch::NewFloatEntry()
 
 //------------------------------------------------------------------------------
 
+char *ExRootTreeBranch::NewValue()
+{
+    if(size_t(fSize + 1)*fColumnTypeSize > fDataColumn->size())
+    {
+	fDataColumn->resize(2*fDataColumn->size());
+    }
+
+    return &(*fDataColumn)[(fSize++)*fColumnTypeSize];
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::AddValue(Double_t value)
+{
+    char *address;
+
+    if(!fDataColumn) return;
+
+    address = NewValue();
+
+    switch(fColumnType)
+    {
+	case 'F': *reinterpret_cast<Float_t *>(address) = value; break;
+	case 'D': *reinterpret_cast<Double_t *>(address) = value; break;
+	case 'I': *reinterpret_cast<Int_t *>(address) = Int_t(value); break;
+	case 'i': *reinterpret_cast<UInt_t *>(address) = UInt_t(value); break;
+	case 'L': *reinterpret_cast<Long64_t *>(address) = Long64_t(value); break;
+	case 'l': *reinterpret_cast<ULong64_t *>(address) = ULong64_t(value); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+// a double holds integers exactly only up to 2^53
+
+void ExRootTreeBranch::AddInteger(Long64_t value)
+{
+    char *address;
+
+    if(!fDataColumn) return;
+
+    address = NewValue();
+
+    switch(fColumnType)
+    {
+	case 'F': *reinterpret_cast<Float_t *>(address) = value; break;
+	case 'D': *reinterpret_cast<Double_t *>(address) = value; break;
+	case 'I': *reinterpret_cast<Int_t *>(address) = Int_t(value); break;
+	case 'i': *reinterpret_cast<UInt_t *>(address) = UInt_t(value); break;
+	case 'L': *reinterpret_cast<Long64_t *>(address) = value; break;
+	case 'l': *reinterpret_cast<ULong64_t *>(address) = ULong64_t(value); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void ExRootTreeBranch::Clear()
 {
     fSize = 0;
@@ -114,3 +303,192 @@ void ExRootTreeBranch::Clear()
 
 //------------------------------------------------------------------------------
 
+void ExRootTreeBranch::SetCompression(Int_t algorithm, Int_t level)
+{
+    ConfigureBranch(fBranch, algorithm, level, -1);
+    ConfigureBranch(fSizeBranch, algorithm, level, -1);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::SetBasketSize(Int_t size)
+{
+    ConfigureBranch(fBranch, -1, -1, size);
+}
+
+//------------------------------------------------------------------------------
+// the sub-branches of a split branch are named <branch>.<field>, followed by
+// the dimension for an array member such as Edges[4]; empty for other names
+
+static string GetFieldName(const string &branchName, const string &name)
+{
+    if(name.compare(0, branchName.size() + 1, branchName + ".") != 0) return "";
+    return name.substr(branchName.size() + 1, name.find('[') - branchName.size() - 1);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::GetFields(vector<string> &fields) const
+{
+    TObjArray *branches;
+    string field;
+    Int_t i;
+
+    fields.clear();
+
+    if(!fData) return;
+
+    // a branch outside of a tree has the data members of its class as fields
+    if(!fBranch)
+    {
+	AddDataMembers(fData->GetClass(), fields);
+	for(set<string>::const_iterator it = fDroppedFields.begin(); it != fDroppedFields.end(); ++it)
+	{
+	    fields.erase(remove(fields.begin(), fields.end(), *it), fields.end());
+	}
+	return;
+    }
+
+    branches = fBranch->GetListOfBranches();
+    for(i = 0; i < branches->GetEntriesFast(); ++i)
+    {
+	field = GetFieldName(fName, branches->At(i)->GetName());
+	if(!field.empty()) fields.push_back(field);
+    }
+}
+
+//------------------------------------------------------------------------------
+// as TTree::CloneTree does for inactive branches, the sub-branch is removed
+// together with its leaves, and the file can be read without it
+
+void ExRootTreeBranch::DropField(const char *field)
+{
+    stringstream message;
+    TObjArray *branches;
+    TBranch *branch;
+    vector<string> fields;
+    Int_t i;
+    Bool_t dropped = kFALSE;
+
+    // outside of a tree the field is only marked, for the writer of the entries
+    if(fData && !fBranch)
+    {
+	AddDataMembers(fData->GetClass(), fields);
+	if(find(fields.begin(), fields.end(), field) != fields.end())
+	{
+	    fDroppedFields.insert(field);
+	    return;
+	}
+    }
+
+    if(fData && fBranch)
+    {
+	branches = fBranch->GetListOfBranches();
+	for(i = 0; i < branches->GetEntriesFast(); ++i)
+	{
+	    branch = static_cast<TBranch *>(branches->At(i));
+	    if(GetFieldName(fName, branch->GetName()) != field) continue;
+
+	    RemoveLeaves(fBranch->GetTree(), branch);
+	    branches->RemoveAt(i);
+	    delete branch;
+	    dropped = kTRUE;
+	}
+	branches->Compress();
+    }
+
+    if(dropped)
+    {
+	// the offsets of the remaining sub-branches are computed again
+	fBranch->SetAddress(&fTreeData);
+
+	fDroppedFields.insert(field);
+	return;
+    }
+
+    message << "can't drop field '" << field << "' of branch '" << fName << "'";
+    message << (fBranch && fBranch->GetListOfBranches()->GetEntriesFast() == 0 ? ", the branch is not split" : "");
+    throw runtime_error(message.str());
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t ExRootTreeBranch::HasField(const char *field) const
+{
+    return fDroppedFields.empty() || fDroppedFields.find(field) == fDroppedFields.end();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::SetDoubleBuffer()
+{
+    if(fData && fTreeData == fData)
+    {
+	fTreeData = new TClonesArray(fData->GetClass(), fCapacity);
+	fTreeData->SetName(fData->GetName());
+	fTreeData->ExpandCreateFast(fCapacity);
+	fTreeData->Clear();
+	fTreeCapacity = fCapacity;
+	fTreeSize = 0;
+    }
+
+    if(fDataFloat && fTreeDataFloat == fDataFloat)
+    {
+	fTreeDataFloat = new vector<float>;
+    }
+
+    if(fDataColumn && fTreeDataColumn == fDataColumn)
+    {
+	fTreeDataColumn = new vector<char>(fDataColumn->size());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeBranch::Swap()
+{
+    TClonesArray *data;
+    vector<float> *dataFloat;
+    vector<char> *dataColumn;
+    Int_t capacity;
+
+    fTreeSize = fSize;
+
+    if(fTreeData != fData)
+    {
+	// the tree notices the new address when it is filled
+	data = fTreeData;
+	fTreeData = fData;
+	fData = data;
+
+	capacity = fTreeCapacity;
+	fTreeCapacity = fCapacity;
+	fCapacity = capacity;
+
+	Clear();
+    }
+
+    if(fTreeDataFloat != fDataFloat)
+    {
+	dataFloat = fTreeDataFloat;
+	fTreeDataFloat = fDataFloat;
+	fDataFloat = dataFloat;
+	fDataFloat->clear();
+    }
+
+    if(fDataColumn)
+    {
+	if(fTreeDataColumn != fDataColumn)
+	{
+	    dataColumn = fTreeDataColumn;
+	    fTreeDataColumn = fDataColumn;
+	    fDataColumn = dataColumn;
+	    Clear();
+	}
+
+	// the buffer may have grown or been swapped since the last entry
+	if(fBranch) fBranch->SetAddress(&(*fTreeDataColumn)[0]);
+    }
+}
+
+//------------------------------------------------------------------------------
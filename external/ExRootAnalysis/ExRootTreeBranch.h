@@ -6,6 +6,9 @@
  *  Class handling object creation.
  *  It is also used for output ROOT tree branches
  *
+ *  Column branches hold plain values in a leaf list, one per event or
+ *  an array of as many as the value of a counter column, as name[counter].
+ *
  *  $Date: 2008-06-04 13:57:27 $
  *  $Revision: 1.1 $
  *
@@ -17,27 +20,92 @@
 #include "Rtypes.h"
 
 #include <vector>
+#include <string>
+#include <set>
 
 class TTree;
+class TBranch;
 class TClonesArray;
 
 class ExRootTreeBranch
 {
 public:
 
-  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0);
+  ExRootTreeBranch(const char *name, TClass *cl, TTree *tree = 0,
+    Int_t basketSize = 64000, Int_t splitLevel = 99);
   ExRootTreeBranch(const char *name, TTree *tree = 0); // mod  
+
+  // column of type F, D, I, i (unsigned) or L, counted by the column counter if given
+  ExRootTreeBranch(const char *name, Char_t type, const char *counter, TTree *tree = 0);
   ~ExRootTreeBranch();
 
   TObject *NewEntry();
   std::vector<float>* NewFloatEntry(); // mod  
   void Clear();
 
+  // entries created since the last Clear
+  Int_t GetEntries() const { return fSize; }
+  TObject *GetEntry(Int_t i) const;
+
+  // appends a value to a column, converted to its type
+  void AddValue(Double_t value);
+
+  // appends an integer without converting it to Double_t, for the 64-bit columns;
+  // an unsigned column (type 'l') stores the bits of the value
+  void AddInteger(Long64_t value);
+
+  const char *GetName() const { return fName.c_str(); }
+
+  Char_t GetColumnType() const { return fColumnType; }
+  const char *GetCounterName() const { return fCounterName.c_str(); }
+
+  // output settings of the branch and its sub-branches, -1 leaves a setting unchanged
+  void SetCompression(Int_t algorithm, Int_t level);
+  void SetBasketSize(Int_t size);
+
+  // fields of a split branch, its sub-branches without the branch name;
+  // outside of a tree, the data members of the class but the ones of TObject
+  void GetFields(std::vector<std::string> &fields) const;
+
+  // removes a field from the output, before the first entry is written;
+  // outside of a tree, marks it for the writer of the entries
+  void DropField(const char *field);
+
+  // false for a dropped field, whose value needs not be filled
+  Bool_t HasField(const char *field) const;
+
+  // gives the tree its own buffer, so the next entries can be created while it is written
+  void SetDoubleBuffer();
+
+  // hands the entries created since the last Clear to the tree
+  void Swap();
+
 private:
 
+  // address of the next value of a column, growing its buffer when it is full
+  char *NewValue();
+
+  std::string fName; //!
+
   Int_t fSize, fCapacity; //!
   std::vector<float>* fDataFloat; // mod  
   TClonesArray *fData; //!
+
+  // buffer read by the tree, the same as the one above unless double buffered
+  Int_t fTreeSize, fTreeCapacity; //!
+  std::vector<float> *fTreeDataFloat; //!
+  TClonesArray *fTreeData; //!
+
+  Char_t fColumnType; //!
+  std::string fCounterName; //!
+  Int_t fColumnTypeSize; //!
+  std::vector<char> *fDataColumn, *fTreeDataColumn; //!
+
+  TBranch *fBranch, *fSizeBranch; //!
+
+#ifndef __CINT__
+  std::set<std::string> fDroppedFields; //!
+#endif
 };
 
 #endif /* ExRootTreeBranch */
@@ -18,24 +18,39 @@
 #include "TFile.h"
 #include "TTree.h"
 #include "TClonesArray.h"
+#include "TStopwatch.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
 
+#include <string.h>
+
 using namespace std;
 
 //-----------------------------------------------------------------------------
 
 ExRootTreeWriter::ExRootTreeWriter(TFile *file, const char *treeName) :
-  fFile(file), fTree(0), fTreeName(treeName)
+  fFile(file), fTree(0), fTreeName(treeName),
+  fAutoFlush(-30000000), fAutoSave(10000000), fAsync(kFALSE),
+  fThread(0), fMutex(0), fFillStart(0), fFillDone(0), fFilling(kFALSE), fStop(kFALSE),
+  fFillTime(0.0), fWaitTime(0.0), fWaits(0)
 {
+  fSettings.algorithm = -1;
+  fSettings.level = -1;
+  fSettings.basketSize = -1;
+  fSettings.splitLevel = -1;
 }
 
 //------------------------------------------------------------------------------
 
 ExRootTreeWriter::~ExRootTreeWriter()
 {
+  StopThread();
+
   set<ExRootTreeBranch*>::iterator itBranches;
   for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
   {
@@ -50,7 +65,11 @@ ExRootTreeWriter::~ExRootTreeWriter()
 ExRootTreeBranch *ExRootTreeWriter::NewBranch(const char *name, TClass *cl)
 {
   if(!fTree) fTree = NewTree();
-  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree);
+  BranchSettings settings = GetBranchSettings(name);
+  ExRootTreeBranch *branch = new ExRootTreeBranch(name, cl, fTree,
+    settings.basketSize > 0 ? settings.basketSize : 64000,
+    settings.splitLevel >= 0 ? settings.splitLevel : 99);
+  branch->SetCompression(settings.algorithm, settings.level);
   fBranches.insert(branch);
   return branch;
 }
@@ -62,21 +81,155 @@ ExRootTreeBranch *ExRootTreeWriter::NewFloatBranch(const char *name)
 {
   if(!fTree) fTree = NewTree();
   ExRootTreeBranch *branch = new ExRootTreeBranch(name, fTree);
+  ApplySettings(branch);
   fBranches.insert(branch);
   return branch;
 }
 
 //------------------------------------------------------------------------------
 
+ExRootTreeBranch *ExRootTreeWriter::NewColumnBranch(const char *name, Char_t type, const char *counter)
+{
+  if(!fTree) fTree = NewTree();
+  ExRootTreeBranch *branch = new ExRootTreeBranch(name, type, counter, fTree);
+  ApplySettings(branch);
+  fBranches.insert(branch);
+  return branch;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetCompression(Int_t algorithm, Int_t level)
+{
+  fSettings.algorithm = algorithm;
+  fSettings.level = level;
+
+  set<ExRootTreeBranch*>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    ApplySettings(*itBranches);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetBasketSize(Int_t size)
+{
+  fSettings.basketSize = size;
+
+  set<ExRootTreeBranch*>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    ApplySettings(*itBranches);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetSplitLevel(Int_t level)
+{
+  fSettings.splitLevel = level;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetBranchSettings(const char *name, Int_t algorithm, Int_t level,
+  Int_t basketSize, Int_t splitLevel)
+{
+  BranchSettings settings;
+  settings.algorithm = algorithm;
+  settings.level = level;
+  settings.basketSize = basketSize;
+  settings.splitLevel = splitLevel;
+  fBranchSettings[name] = settings;
+
+  set<ExRootTreeBranch*>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    if(strcmp((*itBranches)->GetName(), name) == 0) ApplySettings(*itBranches);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetAutoFlush(Long64_t autoFlush)
+{
+  fAutoFlush = autoFlush;
+  if(fTree) fTree->SetAutoFlush(fAutoFlush);
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::SetAutoSave(Long64_t autoSave)
+{
+  fAutoSave = autoSave;
+  if(fTree) fTree->SetAutoSave(fAutoSave);
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeWriter::BranchSettings ExRootTreeWriter::GetBranchSettings(const char *name) const
+{
+  BranchSettings settings = fSettings;
+  map<string, BranchSettings>::const_iterator itSettings = fBranchSettings.find(name);
+
+  if(itSettings != fBranchSettings.end())
+  {
+    if(itSettings->second.algorithm >= 0) settings.algorithm = itSettings->second.algorithm;
+    if(itSettings->second.level >= 0) settings.level = itSettings->second.level;
+    if(itSettings->second.basketSize > 0) settings.basketSize = itSettings->second.basketSize;
+    if(itSettings->second.splitLevel >= 0) settings.splitLevel = itSettings->second.splitLevel;
+  }
+
+  return settings;
+}
+
+//------------------------------------------------------------------------------
+// settings that can be changed after the branch is created
+
+void ExRootTreeWriter::ApplySettings(ExRootTreeBranch *branch)
+{
+  BranchSettings settings = GetBranchSettings(branch->GetName());
+  branch->SetCompression(settings.algorithm, settings.level);
+  branch->SetBasketSize(settings.basketSize);
+}
+
+//------------------------------------------------------------------------------
+
 void ExRootTreeWriter::Fill()
 {
-  if(fTree) fTree->Fill();
+  set<ExRootTreeBranch*>::iterator itBranches;
+
+  if(!fTree) return;
+
+  if(fAsync && !fThread) StartThread();
+
+  // the buffers of the previous event are reused
+  Wait();
+
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    (*itBranches)->Swap();
+  }
+
+  if(!fThread)
+  {
+    fTree->Fill();
+    return;
+  }
+
+  fMutex->Lock();
+  fFilling = kTRUE;
+  fFillStart->Signal();
+  fMutex->UnLock();
 }
 
 //------------------------------------------------------------------------------
 
 void ExRootTreeWriter::Write()
 {
+  Wait();
+
   fFile = fTree ? fTree->GetCurrentFile() : 0;
   if(fFile) fFile->Write();
 }
@@ -111,7 +264,123 @@ TTree *ExRootTreeWriter::NewTree()
   }
 
   tree->SetDirectory(fFile);
-  tree->SetAutoSave(10000000);  // autosave when 10 MB written
+  tree->SetAutoSave(fAutoSave);  // autosave when 10 MB written by default
+  tree->SetAutoFlush(fAutoFlush);
 
   return tree;
 }
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::PrintSummary() const
+{
+  Double_t overlap;
+
+  if(!fThread || fFillTime <= 0.0) return;
+
+  overlap = fWaitTime < fFillTime ? 1.0 - fWaitTime/fFillTime : 0.0;
+
+  cout << "** INFO: filling the tree on a separate thread took " << fFillTime << " s, ";
+  cout << "processing waited " << fWaits << " times for " << fWaitTime << " s, ";
+  cout << 100.0*overlap << "% of the filling overlapped with processing" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::StartThread()
+{
+  set<ExRootTreeBranch*>::iterator itBranches;
+  for(itBranches = fBranches.begin(); itBranches != fBranches.end(); ++itBranches)
+  {
+    (*itBranches)->SetDoubleBuffer();
+  }
+
+  TThread::Initialize();
+  fMutex = new TMutex;
+  fFillStart = new TCondition(fMutex);
+  fFillDone = new TCondition(fMutex);
+
+  fFilling = kFALSE;
+  fStop = kFALSE;
+
+  fThread = new TThread(FillThread, this);
+  fThread->Run();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::StopThread()
+{
+  if(!fThread) return;
+
+  fMutex->Lock();
+  fStop = kTRUE;
+  fFillStart->Signal();
+  fMutex->UnLock();
+
+  fThread->Join();
+  delete fThread;
+  fThread = 0;
+
+  delete fFillDone;
+  delete fFillStart;
+  delete fMutex;
+  fFillDone = 0;
+  fFillStart = 0;
+  fMutex = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void *ExRootTreeWriter::FillThread(void *treeWriter)
+{
+  static_cast<ExRootTreeWriter *>(treeWriter)->FillTree();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::FillTree()
+{
+  TStopwatch fillStopWatch;
+
+  fMutex->Lock();
+  while(kTRUE)
+  {
+    while(!fFilling && !fStop) fFillStart->Wait();
+
+    // an event handed over before the stop is still written
+    if(!fFilling) break;
+
+    fMutex->UnLock();
+
+    // compresses and writes the baskets that are full
+    fillStopWatch.Start();
+    fTree->Fill();
+    fillStopWatch.Stop();
+
+    fMutex->Lock();
+    fFillTime += fillStopWatch.RealTime();
+    fFilling = kFALSE;
+    fFillDone->Signal();
+  }
+  fMutex->UnLock();
+}
+
+//------------------------------------------------------------------------------
+
+void ExRootTreeWriter::Wait()
+{
+  if(!fThread) return;
+
+  fMutex->Lock();
+  if(fFilling)
+  {
+    TStopwatch waitStopWatch;
+    ++fWaits;
+    while(fFilling) fFillDone->Wait();
+    waitStopWatch.Stop();
+    fWaitTime += waitStopWatch.RealTime();
+  }
+  fMutex->UnLock();
+}
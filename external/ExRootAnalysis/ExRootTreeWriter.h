@@ -5,6 +5,15 @@
  *
  *  Class handling output ROOT tree
  *
+ *  With asynchronous output the tree is filled on a separate thread.
+ *  The branches are then double buffered: Fill hands the entries of the
+ *  event to the tree and the next event is created in the other buffers.
+ *  Fill and Write wait for the previous event to be written.
+ *
+ *  The compression, basket size and split level of the branches can be
+ *  set for all branches and for single branches by name. Settings left
+ *  at -1 keep the defaults of ROOT and of the output file.
+ *
  *  $Date: 2008-06-04 13:57:27 $
  *  $Revision: 1.1 $
  *
@@ -16,11 +25,16 @@
 #include "TNamed.h"
 
 #include <set>
+#include <map>
+#include <string>
 
 class TFile;
 class TTree;
 class TString;
 class TClass;
+class TThread;
+class TMutex;
+class TCondition;
 class ExRootTreeBranch;
 
 class ExRootTreeWriter : public TNamed
@@ -35,15 +49,67 @@ public:
 
   ExRootTreeBranch *NewBranch(const char *name, TClass *cl);
   ExRootTreeBranch *NewFloatBranch(const char *name); // mod
+
+  // leaf list column of type F, D, I, i, L or l, an array sized by the column counter if given
+  ExRootTreeBranch *NewColumnBranch(const char *name, Char_t type, const char *counter = 0);
+
+  // settings of all branches, the split level only applies to the branches created next;
+  // compression algorithms as for TFile: 1 zlib, 2 lzma, 4 lz4, 5 zstd
+  void SetCompression(Int_t algorithm, Int_t level);
+  void SetBasketSize(Int_t size);
+  void SetSplitLevel(Int_t level);
+
+  // settings of the branch called name, taking precedence over the ones above
+  void SetBranchSettings(const char *name, Int_t algorithm, Int_t level,
+    Int_t basketSize, Int_t splitLevel);
+
+  // entries (> 0) or bytes (< 0) between flushes of the baskets, 0 to disable
+  void SetAutoFlush(Long64_t autoFlush);
+  Long64_t GetAutoFlush() const { return fAutoFlush; }
+
+  // bytes between saves of the tree header
+  void SetAutoSave(Long64_t autoSave);
+  Long64_t GetAutoSave() const { return fAutoSave; }
   
+  // fills the tree on a separate thread, set before the first Fill
+  void SetAsyncOutput(Bool_t async) { fAsync = async; }
+  Bool_t GetAsyncOutput() const { return fAsync; }
+
   void Clear();
   void Fill();
   void Write();
 
+  // time spent filling the tree, on the separate thread with asynchronous output
+  Double_t GetFillTime() const { return fFillTime; }
+
+  // time Fill and Write waited for the previous event to be written, and number of waits
+  Double_t GetWaitTime() const { return fWaitTime; }
+  Long64_t GetWaits() const { return fWaits; }
+
+  // prints the fill and wait times with asynchronous output
+  void PrintSummary() const;
+
 private:
 
   TTree *NewTree();
 
+#ifndef __CINT__
+  struct BranchSettings
+  {
+    Int_t algorithm, level, basketSize, splitLevel;
+  };
+
+  BranchSettings GetBranchSettings(const char *name) const;
+  void ApplySettings(ExRootTreeBranch *branch);
+#endif
+
+  static void *FillThread(void *treeWriter);
+
+  void StartThread();
+  void StopThread();
+  void FillTree();
+  void Wait();
+
   TFile *fFile; //!
   TTree *fTree; //!
 
@@ -51,6 +117,23 @@ private:
 
   std::set<ExRootTreeBranch*> fBranches; //!
 
+  Long64_t fAutoFlush, fAutoSave; //!
+
+  Bool_t fAsync; //!
+
+  TThread *fThread; //!
+  TMutex *fMutex; //!
+  TCondition *fFillStart, *fFillDone; //!
+  Bool_t fFilling, fStop; //!
+
+  Double_t fFillTime, fWaitTime; //!
+  Long64_t fWaits; //!
+
+#ifndef __CINT__
+  BranchSettings fSettings; //!
+  std::map<std::string, BranchSettings> fBranchSettings; //!
+#endif
+
   ClassDef(ExRootTreeWriter, 1)
 };
 
@@ -1,6 +1,9 @@
 #ifndef BACONANA_DATAFORMATS_RECOOBJ_HH
 #define BACONANA_DATAFORMATS_RECOOBJ_HH
 
+#include <vector>
+#include <cstddef>
+
 class RecoObj 
 {
 public:
@@ -25,6 +28,37 @@ public:
     float         dZ;
     float         d0;
 };
+
+// input particles of puppi stored as one array per field, index i is the i-th particle
+class RecoObjCollection 
+{
+public:
+    RecoObjCollection(){}
+    ~RecoObjCollection(){}
+
+    void clear(){
+      pt.clear(); eta.clear(); phi.clear(); m.clear();
+      pfType.clear(); vtxId.clear(); id.clear(); dZ.clear();
+    }
+
+    void reserve(size_t n){
+      pt.reserve(n); eta.reserve(n); phi.reserve(n); m.reserve(n);
+      pfType.reserve(n); vtxId.reserve(n); id.reserve(n); dZ.reserve(n);
+    }
+
+    void push_back(float iPt, float iEta, float iPhi, float iM, int iPfType, int iVtxId, int iId, float iDZ){
+      pt.push_back(iPt); eta.push_back(iEta); phi.push_back(iPhi); m.push_back(iM);
+      pfType.push_back(iPfType); vtxId.push_back(iVtxId); id.push_back(iId); dZ.push_back(iDZ);
+    }
+
+    size_t size() const { return pt.size(); }
+
+    std::vector<float> pt, eta, phi, m;  // kinematics
+    std::vector<int>   pfType;
+    std::vector<int>   vtxId;            // Vertex Id from Vertex Collection
+    std::vector<int>   id;
+    std::vector<float> dZ;
+};
 #endif
 
 // Only need 4-vector and ID
@@ -69,6 +69,15 @@ class puppiAlgoBin {
     else return false;
   };
 
+  void reset(){ // clear the results of the previous event, the vectors keep their size
+    fRMS_    = 0.;
+    fMean_   = 0.;
+    fMedian_ = 0.;
+    fPuppiParticlesPU_.clear();
+    fPuppiParticlesPV_.clear();
+    fPuppiParticlesNULL_.clear();
+  };
+
   void setPuppiParticles(const std::vector<puppiParticle> & puppiParticles){ // set the particles used by the current algorithm                                             
     fPuppiParticlesPU_.clear();
     fPuppiParticlesPV_.clear();
@@ -7,6 +7,7 @@
 #include <algorithm>
 
 #include "TMath.h"
+#include "TThread.h"
 #include "Math/QuantFuncMathCore.h"
 #include "Math/SpecFuncMathCore.h"
 #include "Math/ProbFunc.h"
@@ -14,14 +15,11 @@
 using namespace std;
 
 // ------------- Constructor
-puppiCleanContainer::puppiCleanContainer(std::vector<RecoObj> inParticles, 
-                                         std::vector<puppiAlgoBin> puppiAlgo,
+puppiCleanContainer::puppiCleanContainer(const std::vector<puppiAlgoBin> & puppiAlgo,
                                          float minPuppiWeight,
                                          bool  fUseExp){
 
-    // take the input particles
-    fRecoParticles_.clear();
-    fRecoParticles_ = inParticles;
+    fRecoParticles_ = 0;
 
     // puppi algo 
     puppiAlgo_.clear();
@@ -30,7 +28,39 @@ puppiCleanContainer::puppiCleanContainer(std::vector<RecoObj> inParticles,
     // min puppi weight
     fMinPuppiWeight_ = minPuppiWeight;
 
-    //Clear everything
+    fNPV_    = 1 ;
+    fPVFrac_ = 0.;
+    fUseExp_ = fUseExp;
+    fNumberOfThreads_ = 1;
+
+    // eta lookup: the algorithms active between two consecutive eta boundaries are always the same
+    fEtaBounds_.clear();
+    for(size_t iAlgo = 0; iAlgo < puppiAlgo_.size(); iAlgo++){
+      fEtaBounds_.push_back(puppiAlgo_[iAlgo].fEtaMin_);
+      fEtaBounds_.push_back(puppiAlgo_[iAlgo].fEtaMax_);
+    }
+    std::sort(fEtaBounds_.begin(),fEtaBounds_.end());
+    fEtaBounds_.erase(std::unique(fEtaBounds_.begin(),fEtaBounds_.end()),fEtaBounds_.end());
+
+    fEtaAlgos_.assign(fEtaBounds_.size() > 0 ? fEtaBounds_.size()-1 : 0, std::vector<int>());
+    for(size_t iBin = 0; iBin < fEtaAlgos_.size(); iBin++){
+      for(size_t iAlgo = 0; iAlgo < puppiAlgo_.size(); iAlgo++){
+        if(puppiAlgo_[iAlgo].fEtaMin_ <= fEtaBounds_[iBin] and fEtaBounds_[iBin+1] <= puppiAlgo_[iAlgo].fEtaMax_) fEtaAlgos_[iBin].push_back(int(iAlgo));
+      }
+    }
+
+    fAlgoParticles_.assign(puppiAlgo_.size(), std::vector<puppiParticle>());
+}
+
+// ------------- De-Constructor
+puppiCleanContainer::~puppiCleanContainer(){}
+
+// ------------- take the particles of a new event
+void puppiCleanContainer::setParticles(const RecoObjCollection & inParticles){
+
+    fRecoParticles_ = &inParticles;
+
+    //Clear everything, the buffers keep their size
     fPFParticles_.clear();
     fPFchsParticles_.clear();
     fChargedPV_.clear();
@@ -39,52 +69,49 @@ puppiCleanContainer::puppiCleanContainer(std::vector<RecoObj> inParticles,
 
     fNPV_    = 1 ;
     fPVFrac_ = 0.;
-    fUseExp_ = fUseExp;
+
+    for(size_t iAlgo = 0; iAlgo < puppiAlgo_.size(); iAlgo++) puppiAlgo_[iAlgo].reset();
 
     //Link to the RecoObjects --> loop on the input particles
-    for (unsigned int i = 0; i < fRecoParticles_.size(); i++){
+    fPFParticles_.reserve(inParticles.size());
+    for (unsigned int i = 0; i < inParticles.size(); i++){
         fastjet::PseudoJet curPseudoJet;
-        curPseudoJet.reset_PtYPhiM (fRecoParticles_[i].pt,fRecoParticles_[i].eta,fRecoParticles_[i].phi,fRecoParticles_[i].m);
-        curPseudoJet.set_user_index(fRecoParticles_[i].id);  
+        curPseudoJet.reset_PtYPhiM (inParticles.pt[i],inParticles.eta[i],inParticles.phi[i],inParticles.m[i]);
+        curPseudoJet.set_user_index(inParticles.id[i]);  
         // fill vector of pseudojets for internal references
         fPFParticles_.push_back(curPseudoJet);
-        if(fRecoParticles_[i].id <= 1) fPFchsParticles_.push_back(curPseudoJet);    //Remove Charged particles associated to other vertex
-        if(fRecoParticles_[i].id == 1) fChargedPV_.push_back(curPseudoJet);         //Take Charged particles associated to PV
-        if(fRecoParticles_[i].id == 2) fChargedNoPV_.push_back(curPseudoJet);
-        if(fRecoParticles_[i].id >= 0) fPVFrac_++ ;
-	if(fNPV_ < fRecoParticles_[i].vtxId) fNPV_ = fRecoParticles_[i].vtxId;
+        if(inParticles.id[i] <= 1) fPFchsParticles_.push_back(curPseudoJet);    //Remove Charged particles associated to other vertex
+        if(inParticles.id[i] == 1) fChargedPV_.push_back(curPseudoJet);         //Take Charged particles associated to PV
+        if(inParticles.id[i] == 2) fChargedNoPV_.push_back(curPseudoJet);
+        if(inParticles.id[i] >= 0) fPVFrac_++ ;
+	if(fNPV_ < inParticles.vtxId[i]) fNPV_ = inParticles.vtxId[i];
 
     }
 
     fPVFrac_ = double(fChargedPV_.size())/fPVFrac_;
 }
 
-// ------------- De-Constructor
-puppiCleanContainer::~puppiCleanContainer(){}
-
 // main function to compute puppi Event
-std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
+const std::vector<float> & puppiCleanContainer::puppiEvent(const RecoObjCollection & inParticles){
+
+    setParticles(inParticles);
 
-    // output particles
-    std::vector<fastjet::PseudoJet> particles;
-    particles.clear();
+    // output weights, one for each input particle
+    fPuppiWeights_.reserve(fPFParticles_.size());
 
-    std::vector<int> pPupId ; 
-    std::vector<puppiParticle> partTmp ; // temp puppi particle vector; make a clone of the same particle for all the algo in which it is contained
+    const RecoObjCollection & fRecoParticles = *fRecoParticles_;
+    std::vector<puppiParticle> & partTmp = fPartTmp_; // temp puppi particle vector; make a clone of the same particle for all the algo in which it is contained
+    size_t nPart = fPFParticles_.size();
   
-    // calculate puppi metric, RMS and mean value for all the algorithms
-    for(size_t iPuppiAlgo = 0; iPuppiAlgo < puppiAlgo_.size(); iPuppiAlgo++){
-      getRMSAvg(iPuppiAlgo,fPFParticles_,fChargedPV_); // give all the particles in the event and the charged one
-    }
+    // calculate puppi metric for all the algorithms, then RMS and mean value for each of them
+    computeMetrics();
+    getRMSAvg();
   
-    int npart = 0;  
-
     // Loop on all the incoming particles
     for(size_t iPart = 0; iPart < fPFParticles_.size(); iPart++) {
 
       float pWeight = 1; // default weight
-      pPupId.clear();
-      pPupId = getPuppiId(fPFParticles_[iPart].pt(),fPFParticles_[iPart].eta(),puppiAlgo_); // take into account only algo eta
+      const std::vector<int> & pPupId = getPuppiId(fEta_[iPart]); // take into account only algo eta
 
       //////////////////////////////////////////      
       // acceptance check of the puppi algorithm
@@ -92,9 +119,6 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
 
       if(pPupId.empty()) { // out acceptance... no algorithm found
         fPuppiWeights_.push_back(pWeight); // take the particle as it is
-        fastjet::PseudoJet curjet(pWeight*fPFParticles_[iPart].px(),pWeight*fPFParticles_[iPart].py(),pWeight*fPFParticles_[iPart].pz(),pWeight*fPFParticles_[iPart].e());    
-        curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-        particles.push_back(curjet); // fill the output collection                                                                                                            
 	continue; //go to the next particle
       }
       
@@ -120,9 +144,9 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
       double pChi2 = 0;   
       if(fUseExp_){ // use vertex-z resolution
        //Compute an Experimental Puppi Weight with delta Z info (very simple example)
-       if(iPart <= fRecoParticles_.size() and fRecoParticles_[iPart].id == fPFParticles_.at(iPart).user_index()){
-	pChi2 = getChi2FromdZ(fRecoParticles_[iPart].dZ); // get the probability fiven the dZ of the particle wrt the leading vertex
-        if(fRecoParticles_[iPart].pfType > 3) pChi2 = 0; // not use this info for neutrals
+       if(iPart < fRecoParticles.size() and fRecoParticles.id[iPart] == fPFParticles_.at(iPart).user_index()){
+	pChi2 = getChi2FromdZ(fRecoParticles.dZ[iPart]); // get the probability fiven the dZ of the particle wrt the leading vertex
+        if(fRecoParticles.pfType[iPart] > 3) pChi2 = 0; // not use this info for neutrals
        }
       }
       
@@ -132,48 +156,13 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
       /////////////////////////////////////      
       partTmp.clear();
       for(size_t iAlgo = 0; iAlgo < pPupId.size(); iAlgo++){ // loop on all the algo found
-
-       int found = 0;  //  found index
-       if(fabs(fPFParticles_[iPart].user_index()) <= 1 and puppiAlgo_.at(pPupId.at(iAlgo)).fUseCharged_){ // charged or neutral from PV
-	 for(size_t puppiIt = 0 ; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.size(); puppiIt++){ // Loop on PV particles
-	   if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.at(puppiIt).fPosition_ == int(iPart)){
-	    partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPV_.at(puppiIt));  // take the puppi particle
-            found = 1 ;
-            break;
-	  }
-	}
-       }
-       else if ((fabs(fPFParticles_[iPart].user_index()) <= 1 and !puppiAlgo_.at(pPupId.at(iAlgo)).fUseCharged_) or fabs(fPFParticles_[iPart].user_index()) >= 2){
-	for(size_t puppiIt = 0; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.size(); puppiIt++){
-          if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.at(puppiIt).fPosition_ == int(iPart)){
-            partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesPU_.at(puppiIt));
-            found = 1;
-            break;
-	  }
-	}
-       }
-      
-      /////////////////////////////////////      
-       // means that is inside the NULL vector for some reasons
-      /////////////////////////////////////      
-
-       if(found == 0){
-	for(size_t puppiIt = 0; puppiIt < puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.size(); puppiIt++){
-          if(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.at(puppiIt).fPosition_ == int(iPart)){
-            partTmp.push_back(puppiAlgo_.at(pPupId.at(iAlgo)).fPuppiParticlesNULL_.at(puppiIt));
-            found = 1 ;
-            break;
-	  }
-	}
-       }
+        const puppiParticle * puppiPart = fAlgoPositions_[pPupId[iAlgo]*nPart + iPart]; // from the PV, PU or NULL vector
+        if(puppiPart) partTmp.push_back(*puppiPart);
       }
 
       if(partTmp.size() != pPupId.size()){ // not found the particle in one of the algorithms 
         pWeight = 1 ;
-	fPuppiWeights_.push_back(pWeight);
-        fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());    
-        curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-        particles.push_back(curjet); // by default is one, so 4V is not chaged                                                                                                
+	fPuppiWeights_.push_back(pWeight); // by default is one, so 4V is not chaged
         continue;
       }
       
@@ -191,9 +180,6 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
 
       if(badPVal){
  	 fPuppiWeights_.push_back(pWeight);
-         fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());    
-         curjet.set_user_index(fPFParticles_[iPart].user_index());                                                                                                      
-         particles.push_back(curjet);                                                                                                                                                
          continue;
 	
       }
@@ -220,95 +206,197 @@ std::vector<fastjet::PseudoJet> puppiCleanContainer::puppiEvent(){
       }
 
       fPuppiWeights_.push_back(pWeight); // push back the weight
-
-      //Now get rid of the thrown out weights for the particle collection
-      if(pWeight == 0) continue; // if zero don't fill the particle in the output
-      npart++;
-
-      //Produce
-      fastjet::PseudoJet curjet( pWeight*fPFParticles_[iPart].px(), pWeight*fPFParticles_[iPart].py(), pWeight*fPFParticles_[iPart].pz(), pWeight*fPFParticles_[iPart].e());           
-      curjet.set_user_index(iPart);                                                                                                                            
-      particles.push_back(curjet);
-      
     }
     
-    return particles;
+    return fPuppiWeights_;
       
 }
 
-// compute puppi metric, RMS and median for PU particle for each algo
-void puppiCleanContainer::getRMSAvg(const int & iPuppiAlgo, std::vector<fastjet::PseudoJet> & particlesAll, std::vector<fastjet::PseudoJet> &chargedPV) { 
+// compute the puppi metric of all the particles for all the algorithms: one neighbour search per particle
+// in a (rapidity, phi) grid replaces the fastjet::SelectorCircle scan of the full event for each algorithm
+struct puppiMetricTask {
+  puppiCleanContainer *container;
+  size_t first, last;
+};
+
+void *puppiCleanContainer::computeMetricsThread(void *arg){
+  puppiMetricTask *task = static_cast<puppiMetricTask *>(arg);
+  task->container->computeMetrics(task->first, task->last);
+  return 0;
+}
 
-  std::vector<puppiParticle> puppiParticles; // puppi particles to be set for a specific algo
-  puppiParticles.clear();
+void puppiCleanContainer::computeMetrics(){
 
-  // Loop on all the particles of the event  
-    
-  for(size_t iPart = 0; iPart < particlesAll.size(); iPart++ ) { 
-
-    float pVal    = -999;
-    bool  pPupId  = isGoodPuppiId(particlesAll[iPart].pt(),particlesAll[iPart].eta(),puppiAlgo_.at(iPuppiAlgo)); // get the puppi id algo asaf of eta and phi of the particle
-    // does not exsist and algorithm for this particle, store -999 as pVal
-    if(pPupId == false) continue;
-    // apply CHS in puppi metric computation -> use only LV hadrons to compute the metric for each particle
-    if(puppiAlgo_.at(iPuppiAlgo).fUseCharged_)  
-       pVal = goodVar(particlesAll[iPart], chargedPV,    puppiAlgo_.at(iPuppiAlgo).fMetricId_,puppiAlgo_.at(iPuppiAlgo).fConeSize_);
-    else if(!puppiAlgo_.at(iPuppiAlgo).fUseCharged_) 
-       pVal = goodVar(particlesAll[iPart], particlesAll, puppiAlgo_.at(iPuppiAlgo).fMetricId_,puppiAlgo_.at(iPuppiAlgo).fConeSize_);
-
-    // fill the value
-    if(std::isnan(pVal) || std::isinf(pVal)) std::cout << "====>  Value is Nan " << pVal << " == " << particlesAll[iPart].pt() << " -- " << particlesAll[iPart].eta() << std::endl;
-    if(std::isnan(pVal) || std::isinf(pVal)) continue;
-    
-    puppiParticles.push_back(puppiParticle(particlesAll.at(iPart).pt(),particlesAll.at(iPart).eta(),pVal,particlesAll.at(iPart).user_index(),iPart));
+  size_t nPart = fPFParticles_.size();
+  size_t nAlgo = puppiAlgo_.size();
+  float maxConeSize = 0.;
+
+  fPt_.resize(nPart);
+  fEta_.resize(nPart);
+  fRap_.resize(nPart);
+  fPhi_.resize(nPart);
+
+  for(size_t iAlgo = 0; iAlgo < nAlgo; iAlgo++){
+    if(puppiAlgo_[iAlgo].fConeSize_ > maxConeSize) maxConeSize = puppiAlgo_[iAlgo].fConeSize_;
+  }
+
+  fGrid_.Clear();
+  fGrid_.SetCellSize(maxConeSize > 0.1 ? maxConeSize : 0.1);
+  for(size_t iPart = 0; iPart < nPart; iPart++){
+    fPt_[iPart]  = fPFParticles_[iPart].pt();
+    fEta_[iPart] = fPFParticles_[iPart].eta();
+    fRap_[iPart] = fPFParticles_[iPart].rap();
+    fPhi_[iPart] = fPFParticles_[iPart].phi();
+    fGrid_.Add(fRap_[iPart], fPhi_[iPart]);
+  }
+  fGrid_.Build();
+
+  fMetrics_.assign(nPart*nAlgo, 0.);
+
+  // particles are independent: split them in contiguous ranges, the last one is done by this thread
+  size_t nThreads = fNumberOfThreads_ > 1 ? fNumberOfThreads_ : 1;
+  if(nThreads > nPart) nThreads = nPart > 0 ? nPart : 1;
+
+  if(nThreads == 1){
+    computeMetrics(0, nPart);
+    return;
+  }
+
+  std::vector<puppiMetricTask> tasks(nThreads);
+  std::vector<TThread *> threads(nThreads - 1);
+
+  for(size_t iThread = 0; iThread < nThreads; iThread++){
+    tasks[iThread].container = this;
+    tasks[iThread].first = nPart*iThread/nThreads;
+    tasks[iThread].last  = nPart*(iThread + 1)/nThreads;
+  }
+
+  for(size_t iThread = 0; iThread < nThreads - 1; iThread++){
+    threads[iThread] = new TThread(computeMetricsThread, &tasks[iThread]);
+    threads[iThread]->Run();
+  }
+
+  computeMetrics(tasks[nThreads - 1].first, tasks[nThreads - 1].last);
+
+  for(size_t iThread = 0; iThread < nThreads - 1; iThread++){
+    threads[iThread]->Join();
+    delete threads[iThread];
   }
-  
-  // set the puppi particles for the algorithm
-  puppiAlgo_.at(iPuppiAlgo).setPuppiParticles(puppiParticles);
-  // compute RMS, median and mean value  
-  computeMedRMS(iPuppiAlgo);
-  
 }
 
+void puppiCleanContainer::computeMetrics(size_t first, size_t last){
+
+  size_t nAlgo = puppiAlgo_.size();
+  std::vector<int> algos, neighbours;
+  std::vector<float> vars;
+  float coneSize;
 
-float puppiCleanContainer::goodVar(const fastjet::PseudoJet & particle, const std::vector<fastjet::PseudoJet> & particleAll, const int & pPupId, const float & coneSize) {
-  float lPup = 0;
-  lPup = var_within_R(pPupId,particleAll,particle,coneSize);
-  return lPup;
+  for(size_t iPart = first; iPart < last; iPart++){
+
+    // algorithms defined for this particle
+    algos.clear();
+    coneSize = 0.;
+    const std::vector<int> & pPupId = getPuppiId(fEta_[iPart]);
+    for(size_t iPupId = 0; iPupId < pPupId.size(); iPupId++){
+      size_t iAlgo = pPupId[iPupId];
+      if(puppiAlgo_[iAlgo].fMetricId_ == -1){
+        fMetrics_[iPart*nAlgo + iAlgo] = 1;
+        continue;
+      }
+      algos.push_back(iAlgo);
+      if(puppiAlgo_[iAlgo].fConeSize_ > coneSize) coneSize = puppiAlgo_[iAlgo].fConeSize_;
+    }
+    if(algos.empty()) continue;
+
+    vars.assign(algos.size(), 0.);
+
+    // the grid cone is slightly larger, the exact fastjet circle selection is applied below
+    neighbours.clear();
+    fGrid_.FindNeighbours(fRap_[iPart], fPhi_[iPart], coneSize*(1. + 1.e-6), neighbours);
+
+    for(size_t iNear = 0; iNear < neighbours.size(); iNear++){
+      int jPart = neighbours[iNear];
+
+      double dPhi = fabs(fPhi_[jPart] - fPhi_[iPart]);
+      if(dPhi > TMath::Pi()) dPhi = TMath::TwoPi() - dPhi;
+      double dRap = fRap_[jPart] - fRap_[iPart];
+      double distance2 = dPhi*dPhi + dRap*dRap;
+
+      double pDEta = fEta_[jPart]-fEta_[iPart];
+      double pDPhi = fabs(fPhi_[jPart]-fPhi_[iPart]);
+      if(pDPhi > 2.*3.14159265-pDPhi) pDPhi = 2.*3.14159265-pDPhi;
+      double pDR = sqrt(pDEta*pDEta+pDPhi*pDPhi);
+
+      if(pDR < 0.01) continue;
+
+      for(size_t iAlgo = 0; iAlgo < algos.size(); iAlgo++){
+        const puppiAlgoBin & algo = puppiAlgo_[algos[iAlgo]];
+        double R = algo.fConeSize_;
+        if(distance2 > R*R) continue;
+        // apply CHS in puppi metric computation -> use only LV hadrons to compute the metric for each particle
+        if(algo.fUseCharged_ && fPFParticles_[jPart].user_index() != 1) continue;
+
+        float & var = vars[iAlgo];
+        if(algo.fMetricId_ == 0) var += (fPt_[jPart]/pDR/pDR);
+        if(algo.fMetricId_ == 1) var += fPt_[jPart];
+        if(algo.fMetricId_ == 2) var += (1./pDR)*(1./pDR);
+        if(algo.fMetricId_ == 3) var += (1./pDR)*(1./pDR);
+        if(algo.fMetricId_ == 4) var += fPt_[jPart];
+        if(algo.fMetricId_ == 5) var += (fPt_[jPart]/pDR)*(fPt_[jPart]/pDR);
+      }
+    }
+
+    for(size_t iAlgo = 0; iAlgo < algos.size(); iAlgo++){
+      int metricId = puppiAlgo_[algos[iAlgo]].fMetricId_;
+      float var = vars[iAlgo];
+      if(metricId == 0 && var != 0) var = log(var);
+      if(metricId == 3 && var != 0) var = log(var);
+      if(metricId == 5 && var != 0) var = log(var);
+      fMetrics_[iPart*nAlgo + algos[iAlgo]] = var;
+    }
+  }
 }
 
-float puppiCleanContainer::var_within_R(const int & pPupId, const vector<fastjet::PseudoJet> & particles, const fastjet::PseudoJet& centre, const float & R){
+// compute RMS and median for PU particle for each algo
+void puppiCleanContainer::getRMSAvg() { 
 
-  if(pPupId == -1) return 1;
-  fastjet::Selector sel = fastjet::SelectorCircle(R);
-  sel.set_reference(centre);
-  std::vector<fastjet::PseudoJet> near_particles = sel(particles);
-  float var = 0;
+  size_t nPart = fPFParticles_.size();
+  size_t nAlgo = puppiAlgo_.size();
+
+  for(size_t iAlgo = 0; iAlgo < nAlgo; iAlgo++) fAlgoParticles_[iAlgo].clear();
 
-  for(size_t iPart = 0; iPart < near_particles.size(); iPart++){
+  // Loop on all the particles of the event and give them to the algorithms of their eta region
+    
+  for(size_t iPart = 0; iPart < nPart; iPart++ ) { 
 
-    double pDEta = near_particles[iPart].eta()-centre.eta();
-    double pDPhi = fabs(near_particles[iPart].phi()-centre.phi());
-    if(pDPhi > 2.*3.14159265-pDPhi) pDPhi = 2.*3.14159265-pDPhi;
-    double pDR = sqrt(pDEta*pDEta+pDPhi*pDPhi);
+    const std::vector<int> & pPupId = getPuppiId(fEta_[iPart]); // get the puppi id algo asaf of eta of the particle
 
-    if(pDR < 0.001) continue;
-    if(pDR < 0.01)  continue;//pDR = 0.01;
-    if(pDR == 0)    continue;
+    for(size_t iAlgo = 0; iAlgo < pPupId.size(); iAlgo++){
+      float pVal = fMetrics_[iPart*nAlgo + pPupId[iAlgo]];
 
-    if(pPupId == 0) var += (near_particles[iPart].pt()/pDR/pDR);
-    if(pPupId == 1) var += near_particles[iPart].pt();
-    if(pPupId == 2) var += (1./pDR)*(1./pDR);
-    if(pPupId == 3) var += (1./pDR)*(1./pDR);
-    if(pPupId == 4) var += near_particles[iPart].pt();
-    if(pPupId == 5) var += (near_particles[iPart].pt()/pDR)*(near_particles[iPart].pt()/pDR);
+      // fill the value
+      if(std::isnan(pVal) || std::isinf(pVal)) std::cout << "====>  Value is Nan " << pVal << " == " << fPt_[iPart] << " -- " << fEta_[iPart] << std::endl;
+      if(std::isnan(pVal) || std::isinf(pVal)) continue;
+    
+      fAlgoParticles_[pPupId[iAlgo]].push_back(puppiParticle(fPt_[iPart],fEta_[iPart],pVal,fPFParticles_[iPart].user_index(),iPart));
+    }
+  }
+  
+  for(size_t iAlgo = 0; iAlgo < nAlgo; iAlgo++){
+    // set the puppi particles for the algorithm
+    puppiAlgo_[iAlgo].setPuppiParticles(fAlgoParticles_[iAlgo]);
+    // compute RMS, median and mean value  
+    computeMedRMS(iAlgo);
   }
 
-  if(pPupId == 0 && var != 0) var = log(var);
-  if(pPupId == 3 && var != 0) var = log(var);
-  if(pPupId == 5 && var != 0) var = log(var);
-  return var;
- 
+  // index the puppi particles of each algorithm by their position, once all the vectors are sorted
+  fAlgoPositions_.assign(nAlgo*nPart, 0);
+  for(size_t iAlgo = 0; iAlgo < nAlgo; iAlgo++){
+    const puppiAlgoBin & algo = puppiAlgo_[iAlgo];
+    for(size_t i0 = 0; i0 < algo.fPuppiParticlesNULL_.size(); i0++) fAlgoPositions_[iAlgo*nPart + algo.fPuppiParticlesNULL_[i0].fPosition_] = &algo.fPuppiParticlesNULL_[i0];
+    for(size_t i0 = 0; i0 < algo.fPuppiParticlesPU_.size(); i0++)   fAlgoPositions_[iAlgo*nPart + algo.fPuppiParticlesPU_[i0].fPosition_]   = &algo.fPuppiParticlesPU_[i0];
+    for(size_t i0 = 0; i0 < algo.fPuppiParticlesPV_.size(); i0++)   fAlgoPositions_[iAlgo*nPart + algo.fPuppiParticlesPV_[i0].fPosition_]   = &algo.fPuppiParticlesPV_[i0];
+  }
 }
 
 
@@ -398,26 +486,13 @@ float puppiCleanContainer::getNeutralPtCut(const float & fNeutralMinE, const flo
 }
 
 // take the type of algorithm : return a vector since more than one algo can be defined for the same eta region
-std::vector<int> puppiCleanContainer::getPuppiId(const float & pt, const float & eta, const std::vector<puppiAlgoBin> & puppiAlgos){
-  std::vector<int> PuppiId ;
-  for(size_t iPuppiAlgo = 0; iPuppiAlgo < puppiAlgos.size() ; iPuppiAlgo++){
-    if(fabs(eta) <= puppiAlgos[iPuppiAlgo].fEtaMin_) continue;
-    if(fabs(eta) > puppiAlgos[iPuppiAlgo].fEtaMax_) continue;
-    PuppiId.push_back(int(iPuppiAlgo));
-  }
-  return PuppiId;  
+const std::vector<int> & puppiCleanContainer::getPuppiId(const float & eta) const {
+  // algorithm iPuppiAlgo is used for fEtaMin_ < |eta| <= fEtaMax_
+  size_t iBin = std::lower_bound(fEtaBounds_.begin(),fEtaBounds_.end(),float(fabs(eta))) - fEtaBounds_.begin();
+  if(iBin == 0 || iBin == fEtaBounds_.size()) return fNoAlgos_;
+  return fEtaAlgos_[iBin-1];
 }
 
-//check if a particle is good for an Algo definition
-bool puppiCleanContainer::isGoodPuppiId(const float & pt, const float & eta, const puppiAlgoBin & puppiAlgo){
-  if(fabs(eta) <= puppiAlgo.fEtaMin_) return false;
-  if(fabs(eta) > puppiAlgo.fEtaMax_) return false;
-  return true;
-
-}
-
-
-
 // ----------------------
 float puppiCleanContainer::compute(const float & chi2, const std::vector<puppiParticle> & particles, const std::vector<puppiAlgoBin> & puppiAlgos, const std::vector<int> & pPupId) {
 
@@ -6,6 +6,8 @@
 #include "PUPPI/puppiParticle.hh"
 #include "PUPPI/puppiAlgoBin.hh"
 
+#include "classes/DelphesEtaPhiGrid.h"
+
 #include "fastjet/internal/base.hh"
 #include "fastjet/PseudoJet.hh"
 #include <algorithm>
@@ -18,9 +20,8 @@ class puppiCleanContainer{
 
  public:
 
-  // basic constructor which takes input particles as RecoObj, the tracker eta extension and other two boolean info
-  puppiCleanContainer(std::vector<RecoObj> inParticles,    // incoming particles of the event
-                      std::vector<puppiAlgoBin> puppiAlgo, // vector with the definition of the puppi algorithm in different eta region (one for each eta) 
+  // basic constructor which takes the algorithm definitions and other two info, built once and used for all the events
+  puppiCleanContainer(const std::vector<puppiAlgoBin> & puppiAlgo, // vector with the definition of the puppi algorithm in different eta region (one for each eta) 
                       float minPuppiWeight  = 0.01,        // min puppi weight cut
                       bool  useExp = false                 // useDz vertex probability
   ); 
@@ -30,40 +31,45 @@ class puppiCleanContainer{
   // ----- get methods
 
   // get all the PF particles
-  std::vector<fastjet::PseudoJet> pfParticles()  { return  fPFParticles_; }    
+  const std::vector<fastjet::PseudoJet> & pfParticles() const { return  fPFParticles_; }    
   // get all the PF charged from PV
-  std::vector<fastjet::PseudoJet> pvParticles()  { return  fChargedPV_; }        
+  const std::vector<fastjet::PseudoJet> & pvParticles() const { return  fChargedPV_; }        
   // get all the PF charged from PU
-  std::vector<fastjet::PseudoJet> puParticles()  { return  fChargedNoPV_; }    
+  const std::vector<fastjet::PseudoJet> & puParticles() const { return  fChargedNoPV_; }    
   // get CHS particle collection
-  std::vector<fastjet::PseudoJet> pfchsParticles(){ return fPFchsParticles_; }    
+  const std::vector<fastjet::PseudoJet> & pfchsParticles() const { return fPFchsParticles_; }    
   // get puppi weight for all particles 
-  std::vector<float> getPuppiWeights() { return fPuppiWeights_; };
+  const std::vector<float> & getPuppiWeights() const { return fPuppiWeights_; };
+
+  // number of threads used to compute the puppi metric (default is 1)
+  void setNumberOfThreads(int nThreads) { fNumberOfThreads_ = nThreads; }
 
-  // process puppi
-  std::vector<fastjet::PseudoJet> puppiEvent();
+  // process puppi on the incoming particles of the event (not copied, they must not change until the next call):
+  // returns one weight per input particle, in input order (0 means rejected)
+  const std::vector<float> & puppiEvent(const RecoObjCollection & inParticles);
  
  protected:
 
-   void    getRMSAvg(const int &, std::vector<fastjet::PseudoJet> &, std::vector<fastjet::PseudoJet> &);        
-   float   goodVar  (const fastjet::PseudoJet &, const std::vector<fastjet::PseudoJet> &, const int &, const float &);    
+   void    computeMetrics();
+   void    computeMetrics(size_t, size_t);
+   static void *computeMetricsThread(void *);
+   void    setParticles(const RecoObjCollection &);
+   void    getRMSAvg();        
    void    computeMedRMS(const int &);  
    float   compute(const float &, const std::vector<puppiParticle> &, const std::vector<puppiAlgoBin> &, const std::vector<int> &);
 
    // some get functions
    float getNeutralPtCut(const float&, const float&, const int&);
-   std::vector<int> getPuppiId(const float &, const float &, const std::vector<puppiAlgoBin> &);
-   bool  isGoodPuppiId(const float &, const float &, const puppiAlgoBin &);
+   const std::vector<int> & getPuppiId(const float &) const;
    float getChi2FromdZ(float);
    // other functions
-   float  var_within_R(const int &, const vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
    float  pt_within_R(const std::vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
    fastjet::PseudoJet flow_within_R(const vector<fastjet::PseudoJet> &, const fastjet::PseudoJet &, const float &);
    
   
  private:    
  
-  std::vector<RecoObj>            fRecoParticles_;
+  const RecoObjCollection *       fRecoParticles_;
   std::vector<fastjet::PseudoJet> fPFParticles_;
   std::vector<fastjet::PseudoJet> fPFchsParticles_;    
   std::vector<fastjet::PseudoJet> fChargedPV_;
@@ -72,11 +78,30 @@ class puppiCleanContainer{
   std::vector<puppiAlgoBin> puppiAlgo_;
   std::vector<float> fPuppiWeights_;
 
+  // |eta| in (fEtaBounds_[k], fEtaBounds_[k+1]] is covered by the algorithms fEtaAlgos_[k]
+  std::vector<float> fEtaBounds_;
+  std::vector< std::vector<int> > fEtaAlgos_;
+  std::vector<int> fNoAlgos_;
+
+  // scratch buffers kept across the events: particles given to each algorithm,
+  // and the puppi particle of particle i in algorithm j stored at j*fPFParticles_.size() + i
+  std::vector< std::vector<puppiParticle> > fAlgoParticles_;
+  std::vector<const puppiParticle *> fAlgoPositions_;
+  std::vector<puppiParticle> fPartTmp_;
+
+  // cached kinematics of fPFParticles_ and their (rapidity, phi) index
+  std::vector<double> fPt_, fEta_, fRap_, fPhi_;
+  DelphesEtaPhiGrid  fGrid_;
+
+  // puppi metric of particle i for algorithm j stored at i*puppiAlgo_.size() + j
+  std::vector<float> fMetrics_;
+
   float  fMinPuppiWeight_;
   float  fPVFrac_;
 
   int    fNPV_;  
   bool   fUseExp_ ;
+  int    fNumberOfThreads_;
     
 };
 
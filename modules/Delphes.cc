@@ -24,6 +24,7 @@
 #include "ExRootAnalysis/ExRootConfReader.h"
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 
+#include "RConfigure.h"
 #include "TROOT.h"
 #include "TMath.h"
 #include "TFolder.h"
@@ -93,6 +94,8 @@ void Delphes::Init()
 {
   stringstream message;
   ExRootConfReader *confReader = GetConfReader();
+  ExRootTreeWriter *treeWriter;
+  Int_t threads;
   confReader->SetName("ConfReader");
   GetFolder()->Add(confReader);
 
@@ -106,6 +109,32 @@ void Delphes::Init()
 
   gRandom->SetSeed(confReader->GetInt("::RandomSeed", 0));
 
+  treeWriter = static_cast<ExRootTreeWriter *>(GetObject("TreeWriter", ExRootTreeWriter::Class()));
+  if(treeWriter)
+  {
+    // fill the output tree on a separate thread while the next event is processed
+    treeWriter->SetAsyncOutput(confReader->GetBool("::AsyncOutput", false));
+
+    // output settings of all branches, TreeWriter can set them per branch
+    treeWriter->SetCompression(confReader->GetInt("::CompressionAlgorithm", -1),
+      confReader->GetInt("::CompressionLevel", -1));
+    treeWriter->SetBasketSize(confReader->GetInt("::BasketSize", -1));
+    treeWriter->SetSplitLevel(confReader->GetInt("::SplitLevel", -1));
+    treeWriter->SetAutoFlush(confReader->GetLong("::AutoFlush", treeWriter->GetAutoFlush()));
+    treeWriter->SetAutoSave(confReader->GetLong("::AutoSave", treeWriter->GetAutoSave()));
+  }
+
+  // threads used by ROOT to compress the baskets of the output tree
+  threads = confReader->GetInt("::ImplicitMT", 0);
+  if(threads > 0)
+  {
+#ifdef R__USE_IMT
+    ROOT::EnableImplicitMT(threads);
+#else
+    cout << "** WARNING: ROOT is built without implicit multithreading, ImplicitMT is ignored" << endl;
+#endif
+  }
+
   for(i = 0; i < size; ++i)
   {
     name = param[i].GetString();
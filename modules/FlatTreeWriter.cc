@@ -0,0 +1,506 @@
+
+/** \class FlatTreeWriter
+ *
+ *  Fills the output tree with flat columns instead of objects.
+ *
+ *  The branches are configured as for TreeWriter, with the same
+ *  Branch and BranchFields parameters. Each branch is written as a
+ *  counter, nName, and a column per data member, Name_Member[nName].
+ *
+ *  References are written as indices: Name_MemberIdx is the index of
+ *  the referenced entry in its collection and Name_MemberColl the number
+ *  of that collection, its position in the Branch list, both -1 when
+ *  the entry is not written. Arrays of references and vectors are
+ *  flattened in a column counted by nName_Member, with Name_nMember
+ *  values for each entry.
+ *
+ */
+
+#include "modules/FlatTreeWriter.h"
+
+#include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
+
+#include "TClass.h"
+#include "TList.h"
+#include "TRef.h"
+#include "TRefArray.h"
+#include "TString.h"
+#include "TDataType.h"
+#include "TDataMember.h"
+#include "TBaseClass.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// type of the column holding a member of a basic type, 0 if not supported
+
+static Char_t GetColumnType(Int_t dataType)
+{
+  switch(dataType)
+  {
+    case kFloat_t: case kFloat16_t:
+      return 'F';
+    case kDouble_t: case kDouble32_t:
+      return 'D';
+    case kBool_t: case kChar_t: case kUChar_t: case kShort_t: case kUShort_t: case kInt_t:
+      return 'I';
+    case kUInt_t:
+      return 'i';
+    case kLong_t: case kLong64_t:
+      return 'L';
+    case kULong_t: case kULong64_t:
+      return 'l';
+    default:
+      return 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static Double_t GetValue(const char *address, Int_t dataType)
+{
+  switch(dataType)
+  {
+    case kFloat_t: case kFloat16_t: return *reinterpret_cast<const Float_t *>(address);
+    case kDouble_t: case kDouble32_t: return *reinterpret_cast<const Double_t *>(address);
+    case kBool_t: return *reinterpret_cast<const Bool_t *>(address);
+    case kChar_t: return *reinterpret_cast<const Char_t *>(address);
+    case kUChar_t: return *reinterpret_cast<const UChar_t *>(address);
+    case kShort_t: return *reinterpret_cast<const Short_t *>(address);
+    case kUShort_t: return *reinterpret_cast<const UShort_t *>(address);
+    case kInt_t: return *reinterpret_cast<const Int_t *>(address);
+    case kUInt_t: return *reinterpret_cast<const UInt_t *>(address);
+    case kLong_t: return *reinterpret_cast<const Long_t *>(address);
+    case kULong_t: return *reinterpret_cast<const ULong_t *>(address);
+    case kLong64_t: return *reinterpret_cast<const Long64_t *>(address);
+    case kULong64_t: return *reinterpret_cast<const ULong64_t *>(address);
+    default: return 0.0;
+  }
+}
+
+//------------------------------------------------------------------------------
+// 64-bit members are copied as integers, unsigned ones through their bits
+
+static Long64_t GetIntegerValue(const char *address, Int_t dataType)
+{
+  switch(dataType)
+  {
+    case kLong_t: return *reinterpret_cast<const Long_t *>(address);
+    case kULong_t: return Long64_t(*reinterpret_cast<const ULong_t *>(address));
+    case kLong64_t: return *reinterpret_cast<const Long64_t *>(address);
+    case kULong64_t: return Long64_t(*reinterpret_cast<const ULong64_t *>(address));
+    default: return 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+FlatTreeWriter::FlatTreeWriter()
+{
+}
+
+//------------------------------------------------------------------------------
+
+FlatTreeWriter::~FlatTreeWriter()
+{
+  vector< Collection >::iterator itCollection;
+
+  // the columns belong to the tree writer, the entries are only kept here
+  for(itCollection = fCollections.begin(); itCollection != fCollections.end(); ++itCollection)
+  {
+    delete itCollection->entries;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Init()
+{
+  vector< Collection >::iterator itCollection;
+
+  fHeaderFile = GetString("HeaderFile", "");
+
+  // creates the entries of the collections and selects their fields
+  TreeWriter::Init();
+
+  for(itCollection = fCollections.begin(); itCollection != fCollections.end(); ++itCollection)
+  {
+    itCollection->counter = NewColumn("n" + itCollection->name, 'I', "");
+    AddColumns(*itCollection, itCollection->branchClass, 0);
+  }
+
+  cout << "** INFO: FlatTreeWriter writes " << fColumns.size() << " columns for ";
+  cout << fCollections.size() << " collections" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Finish()
+{
+  if(fHeaderFile.Length() > 0) WriteHeader();
+}
+
+//------------------------------------------------------------------------------
+// the entries are kept out of the output tree and written as columns
+
+ExRootTreeBranch *FlatTreeWriter::CreateBranch(const char *name, TClass *branchClass)
+{
+  Collection collection;
+
+  collection.name = name;
+  collection.branchClass = branchClass;
+  collection.entries = new ExRootTreeBranch(name, branchClass);
+  collection.counter = 0;
+
+  fCollections.push_back(collection);
+
+  return collection.entries;
+}
+
+//------------------------------------------------------------------------------
+
+ExRootTreeBranch *FlatTreeWriter::NewColumn(const string &name, Char_t type, const string &counter)
+{
+  ExRootTreeBranch *column = GetTreeWriter()->NewColumnBranch(name.c_str(), type, counter.c_str());
+  fColumns.push_back(column);
+  return column;
+}
+
+//------------------------------------------------------------------------------
+// columns of the data members of a class and of its base classes, but TObject
+
+void FlatTreeWriter::AddColumns(Collection &collection, TClass *cl, Long_t offset)
+{
+  TIter itBases(cl->GetListOfBases());
+  TIter itMembers(cl->GetListOfDataMembers());
+  TBaseClass *base;
+  TDataMember *member;
+  TString typeName;
+  Column column;
+  string name, counter;
+  Char_t type;
+  Int_t i;
+
+  while((base = static_cast<TBaseClass *>(itBases.Next())))
+  {
+    if(base->GetClassPointer() && base->GetClassPointer() != TObject::Class())
+    {
+      AddColumns(collection, base->GetClassPointer(), offset + base->GetDelta());
+    }
+  }
+
+  counter = "n" + collection.name;
+
+  while((member = static_cast<TDataMember *>(itMembers.Next())))
+  {
+    if(!member->IsPersistent() || (member->Property() & kIsStatic)) continue;
+    if(!collection.entries->HasField(member->GetName())) continue;
+
+    name = collection.name + "_" + member->GetName();
+    typeName = member->GetTypeName();
+
+    column.offset = offset + member->GetOffset();
+    column.dataType = 0;
+    column.values = column.collections = column.sizes = column.counter = 0;
+
+    if(member->IsBasic() && !member->IsaPointer() && member->GetArrayDim() <= 1
+       && (type = GetColumnType(member->GetDataType()->GetType())))
+    {
+      column.kind = kValue;
+      column.dataType = member->GetDataType()->GetType();
+
+      if(member->GetArrayDim() == 0)
+      {
+        column.values = NewColumn(name, type, counter);
+        collection.columns.push_back(column);
+      }
+      else
+      {
+        // one column per element of a fixed array
+        for(i = 0; i < member->GetMaxIndex(0); ++i)
+        {
+          column.values = NewColumn(name + TString::Format("%d", i).Data(), type, counter);
+          collection.columns.push_back(column);
+          column.offset += member->GetUnitSize();
+        }
+      }
+    }
+    else if(typeName == "TRef")
+    {
+      column.kind = kRef;
+      column.values = NewColumn(name + "Idx", 'I', counter);
+      column.collections = NewColumn(name + "Coll", 'I', counter);
+      collection.columns.push_back(column);
+    }
+    else if(typeName == "TRefArray" || typeName == "vector<float>")
+    {
+      column.kind = (typeName == "TRefArray") ? kRefArray : kFloatVector;
+      column.sizes = NewColumn(collection.name + "_n" + member->GetName(), 'I', counter);
+      column.counter = NewColumn("n" + name, 'I', "");
+      if(column.kind == kRefArray)
+      {
+        column.values = NewColumn(name + "Idx", 'I', "n" + name);
+        column.collections = NewColumn(name + "Coll", 'I', "n" + name);
+      }
+      else
+      {
+        column.values = NewColumn(name, 'F', "n" + name);
+      }
+      collection.columns.push_back(column);
+    }
+    else
+    {
+      cout << "** WARNING: member " << member->GetName() << " of type " << typeName;
+      cout << " of class " << cl->GetName() << " is not written by FlatTreeWriter" << endl;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::Process()
+{
+  vector< Collection >::iterator itCollection;
+  TObject *entry;
+  UInt_t uniqueID;
+  Int_t collection, i;
+
+  for(itCollection = fCollections.begin(); itCollection != fCollections.end(); ++itCollection)
+  {
+    itCollection->entries->Clear();
+  }
+
+  // entries of all the collections
+  TreeWriter::Process();
+
+  // unique IDs are numbered from 1 in each event, as DelphesFactory::Clear
+  // resets the object count, so the entries are found in a plain vector
+  fEntryMap.clear();
+  for(collection = 0; collection < Int_t(fCollections.size()); ++collection)
+  {
+    ExRootTreeBranch *entries = fCollections[collection].entries;
+    for(i = 0; i < entries->GetEntries(); ++i)
+    {
+      entry = entries->GetEntry(i);
+      uniqueID = entry->GetUniqueID() & 0xffffff;
+      if(uniqueID == 0) continue;
+      if(uniqueID >= fEntryMap.size()) fEntryMap.resize(uniqueID + 1, make_pair(-1, -1));
+      fEntryMap[uniqueID] = make_pair(collection, i);
+    }
+  }
+
+  for(itCollection = fCollections.begin(); itCollection != fCollections.end(); ++itCollection)
+  {
+    FillColumns(*itCollection);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::FindEntry(UInt_t uniqueID, Int_t &collection, Int_t &index)
+{
+  uniqueID &= 0xffffff;
+
+  if(uniqueID > 0 && uniqueID < fEntryMap.size())
+  {
+    collection = fEntryMap[uniqueID].first;
+    index = fEntryMap[uniqueID].second;
+  }
+  else
+  {
+    collection = -1;
+    index = -1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void FlatTreeWriter::FillColumns(Collection &collection)
+{
+  vector< Column >::iterator itColumn;
+  ExRootTreeBranch *entries = collection.entries;
+  const char *address;
+  const TRefArray *references;
+  const vector< float > *values;
+  TObject *object;
+  Int_t entry, size, total, i, index, target;
+
+  size = entries->GetEntries();
+  collection.counter->AddValue(size);
+
+  for(itColumn = collection.columns.begin(); itColumn != collection.columns.end(); ++itColumn)
+  {
+    Column &column = *itColumn;
+    total = 0;
+
+    for(entry = 0; entry < size; ++entry)
+    {
+      address = reinterpret_cast<const char *>(entries->GetEntry(entry)) + column.offset;
+
+      switch(column.kind)
+      {
+        case kValue:
+          if(column.values->GetColumnType() == 'L' || column.values->GetColumnType() == 'l')
+          {
+            column.values->AddInteger(GetIntegerValue(address, column.dataType));
+          }
+          else
+          {
+            column.values->AddValue(GetValue(address, column.dataType));
+          }
+          break;
+
+        case kRef:
+          FindEntry(reinterpret_cast<const TRef *>(address)->GetUniqueID(), target, index);
+          column.values->AddValue(index);
+          column.collections->AddValue(target);
+          break;
+
+        case kRefArray:
+          references = reinterpret_cast<const TRefArray *>(address);
+          column.sizes->AddValue(references->GetEntriesFast());
+          for(i = 0; i < references->GetEntriesFast(); ++i)
+          {
+            object = references->At(i);
+            FindEntry(object ? object->GetUniqueID() : 0, target, index);
+            column.values->AddValue(index);
+            column.collections->AddValue(target);
+          }
+          total += references->GetEntriesFast();
+          break;
+
+        case kFloatVector:
+          values = reinterpret_cast<const vector< float > *>(address);
+          column.sizes->AddValue(values->size());
+          for(i = 0; i < Int_t(values->size()); ++i)
+          {
+            column.values->AddValue((*values)[i]);
+          }
+          total += values->size();
+          break;
+      }
+    }
+
+    if(column.counter) column.counter->AddValue(total);
+  }
+}
+
+//------------------------------------------------------------------------------
+// the arrays of the header are sized for the largest event of this job
+
+void FlatTreeWriter::WriteHeader()
+{
+  vector< Collection >::iterator itCollection;
+  vector< Column >::iterator itColumn;
+  vector< ExRootTreeBranch * >::iterator itColumns;
+  vector< string > counters;
+  vector< string >::iterator itCounters;
+  string fileName, structName, guard, counter, typeName;
+  stringstream message;
+  size_t position;
+  Int_t collection;
+
+  for(itCollection = fCollections.begin(); itCollection != fCollections.end(); ++itCollection)
+  {
+    counters.push_back(itCollection->counter->GetName());
+    for(itColumn = itCollection->columns.begin(); itColumn != itCollection->columns.end(); ++itColumn)
+    {
+      if(itColumn->counter) counters.push_back(itColumn->counter->GetName());
+    }
+  }
+
+  // the structure is named after the file, made a valid identifier
+  fileName = fHeaderFile.Data();
+  position = fileName.find_last_of('/');
+  structName = fileName.substr(position == string::npos ? 0 : position + 1);
+  structName = structName.substr(0, structName.find('.'));
+  for(position = 0; position < structName.size(); ++position)
+  {
+    if(!isalnum(structName[position])) structName[position] = '_';
+  }
+  if(structName.empty() || isdigit(structName[0])) structName = "Flat_" + structName;
+  guard = structName + "_h";
+
+  ofstream out(fileName.c_str());
+  if(!out)
+  {
+    message << "can't create header file " << fileName;
+    throw runtime_error(message.str());
+  }
+
+  out << "#ifndef " << guard << endl;
+  out << "#define " << guard << endl << endl;
+  out << "// columns of the tree written by FlatTreeWriter, generated at the end of the job;" << endl;
+  out << "// SetBranchAddresses sizes the arrays for the largest event of the tree it is given" << endl << endl;
+  out << "#include \"TTree.h\"" << endl << endl;
+  out << "#include <vector>" << endl << endl;
+  out << "struct " << structName << endl << "{" << endl;
+
+  out << "  // collections of the Coll columns" << endl;
+  for(collection = 0; collection < Int_t(fCollections.size()); ++collection)
+  {
+    out << "  static const Int_t k" << fCollections[collection].name << "Collection = " << collection << ";" << endl;
+  }
+  out << endl;
+
+  for(itColumns = fColumns.begin(); itColumns != fColumns.end(); ++itColumns)
+  {
+    switch((*itColumns)->GetColumnType())
+    {
+      case 'F': typeName = "Float_t"; break;
+      case 'D': typeName = "Double_t"; break;
+      case 'i': typeName = "UInt_t"; break;
+      case 'L': typeName = "Long64_t"; break;
+      case 'l': typeName = "ULong64_t"; break;
+      default: typeName = "Int_t"; break;
+    }
+
+    counter = (*itColumns)->GetCounterName();
+    if(counter.empty())
+    {
+      out << "  " << typeName << " " << (*itColumns)->GetName() << ";" << endl;
+    }
+    else
+    {
+      out << "  std::vector< " << typeName << " > " << (*itColumns)->GetName() << ";" << endl;
+    }
+  }
+
+  // a counter never exceeds its maximum over the tree, so GetEntry can't overflow the arrays
+  out << endl << "  // call again after switching to a tree with larger events" << endl;
+  out << "  void SetBranchAddresses(TTree *tree)" << endl << "  {" << endl;
+  for(itCounters = counters.begin(); itCounters != counters.end(); ++itCounters)
+  {
+    out << "    Int_t max" << itCounters->substr(1) << " = Int_t(tree->GetMaximum(\"" << *itCounters << "\"));" << endl;
+    out << "    if(max" << itCounters->substr(1) << " < 1) max" << itCounters->substr(1) << " = 1;" << endl;
+  }
+  out << endl;
+  for(itColumns = fColumns.begin(); itColumns != fColumns.end(); ++itColumns)
+  {
+    counter = (*itColumns)->GetCounterName();
+    if(counter.empty())
+    {
+      out << "    tree->SetBranchAddress(\"" << (*itColumns)->GetName() << "\", &" << (*itColumns)->GetName() << ");" << endl;
+    }
+    else
+    {
+      out << "    " << (*itColumns)->GetName() << ".resize(max" << counter.substr(1) << ");" << endl;
+      out << "    tree->SetBranchAddress(\"" << (*itColumns)->GetName() << "\", &" << (*itColumns)->GetName() << "[0]);" << endl;
+    }
+  }
+  out << "  }" << endl;
+
+  out << "};" << endl << endl;
+  out << "#endif // " << guard << endl;
+
+  cout << "** INFO: analysis header written to " << fileName << endl;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,95 @@
+#ifndef FlatTreeWriter_h
+#define FlatTreeWriter_h
+
+/** \class FlatTreeWriter
+ *
+ *  Fills the output tree with flat columns instead of objects.
+ *
+ *  The branches are configured as for TreeWriter, with the same
+ *  Branch and BranchFields parameters. Each branch is written as a
+ *  counter, nName, and a column per data member, Name_Member[nName].
+ *
+ *  References are written as indices: Name_MemberIdx is the index of
+ *  the referenced entry in its collection and Name_MemberColl the number
+ *  of that collection, its position in the Branch list, both -1 when
+ *  the entry is not written. Arrays of references and vectors are
+ *  flattened in a column counted by nName_Member, with Name_nMember
+ *  values for each entry.
+ *
+ *  No TObject is written, so the columns can be read without TRef
+ *  and TProcessID. HeaderFile names a header, written at the end of
+ *  the job, with a structure holding the columns and connecting them
+ *  to the tree, its arrays sized for the largest event of that tree.
+ *
+ */
+
+#include "modules/TreeWriter.h"
+
+#include <vector>
+#include <string>
+
+class TClass;
+class TObject;
+
+class ExRootTreeBranch;
+
+class FlatTreeWriter: public TreeWriter
+{
+public:
+
+  FlatTreeWriter();
+  ~FlatTreeWriter();
+
+  void Init();
+  void Process();
+  void Finish();
+
+protected:
+
+  ExRootTreeBranch *CreateBranch(const char *name, TClass *branchClass);
+
+private:
+
+#ifndef __CINT__
+  enum ColumnKind { kValue, kRef, kRefArray, kFloatVector };
+
+  struct Column
+  {
+    ColumnKind kind;
+    Long_t offset;
+    Int_t dataType;
+    ExRootTreeBranch *values; // values or indices of the references
+    ExRootTreeBranch *collections; // collections of the references
+    ExRootTreeBranch *sizes; // number of values of each entry
+    ExRootTreeBranch *counter; // number of values of the event
+  };
+
+  struct Collection
+  {
+    std::string name;
+    TClass *branchClass;
+    ExRootTreeBranch *entries, *counter;
+    std::vector< Column > columns;
+  };
+
+  ExRootTreeBranch *NewColumn(const std::string &name, Char_t type, const std::string &counter);
+  void AddColumns(Collection &collection, TClass *cl, Long_t offset);
+  void FillColumns(Collection &collection);
+  void FindEntry(UInt_t uniqueID, Int_t &collection, Int_t &index);
+  void WriteHeader();
+
+  std::vector< Collection > fCollections; //!
+
+  // all columns in the order they were created
+  std::vector< ExRootTreeBranch * > fColumns; //!
+
+  // collection and index of the entries by unique ID
+  std::vector< std::pair< Int_t, Int_t > > fEntryMap; //!
+#endif
+
+  TString fHeaderFile;
+
+  ClassDef(FlatTreeWriter, 1)
+};
+
+#endif
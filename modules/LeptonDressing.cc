@@ -14,6 +14,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -37,7 +38,7 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 LeptonDressing::LeptonDressing() :
- fItDressingInputArray(0), fItCandidateInputArray(0)
+ fDressingGrid(0), fItDressingInputArray(0), fItCandidateInputArray(0)
 {
 }
 
@@ -53,6 +54,8 @@ void LeptonDressing::Init()
 {
   fDeltaR = GetDouble("DeltaRMax", 0.4);
 
+  fDressingGrid = new DelphesEtaPhiGrid(fDeltaR);
+
   // import input array(s)
 
   fDressingInputArray = ImportArray(GetString("DressingInputArray", "Calorimeter/photons"));
@@ -72,6 +75,7 @@ void LeptonDressing::Finish()
 {
   if(fItCandidateInputArray) delete fItCandidateInputArray;
   if(fItDressingInputArray) delete fItDressingInputArray;
+  if(fDressingGrid) delete fDressingGrid;
 }
 
 //------------------------------------------------------------------------------
@@ -80,26 +84,46 @@ void LeptonDressing::Process()
 {
   Candidate *candidate, *dressing, *mother;
   TLorentzVector momentum;
-  
+  vector< Int_t >::const_iterator itNeighbours;
+
+  // cache directions of all dressing candidates once per event
+  fDressingGrid->Clear();
+  fDressingCandidates.clear();
+
+  fItDressingInputArray->Reset();
+  while((dressing = static_cast<Candidate*>(fItDressingInputArray->Next())))
+  {
+    const TLorentzVector &dressingMomentum = dressing->Momentum;
+    if(dressingMomentum.Pt() > 0.1)
+    {
+      fDressingGrid->Add(dressingMomentum.Eta(), dressingMomentum.Phi());
+      fDressingCandidates.push_back(dressing);
+    }
+  }
+
+  fDressingGrid->Build();
+
   // loop over all input candidate
   fItCandidateInputArray->Reset();
   while((candidate = static_cast<Candidate*>(fItCandidateInputArray->Next())))
   {
     const TLorentzVector &candidateMomentum = candidate->Momentum;
 
-    // loop over all input tracks
-    fItDressingInputArray->Reset();
+    // sum dressing candidates inside the cone, in input order
+    fNeighbours.clear();
+    fDressingGrid->FindNeighbours(candidateMomentum.Eta(), candidateMomentum.Phi(), fDeltaR, fNeighbours);
+
+    // nothing to add, keep the original candidate
+    if(fNeighbours.empty())
+    {
+      fOutputArray->Add(candidate);
+      continue;
+    }
+
     momentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-    while((dressing = static_cast<Candidate*>(fItDressingInputArray->Next())))
+    for(itNeighbours = fNeighbours.begin(); itNeighbours != fNeighbours.end(); ++itNeighbours)
     {
-      const TLorentzVector &dressingMomentum = dressing->Momentum;
-      if (dressingMomentum.Pt() > 0.1)
-      {
-        if(candidateMomentum.DeltaR(dressingMomentum) <= fDeltaR)
-        {
-          momentum += dressingMomentum;
-        }
-      }
+      momentum += fDressingCandidates[*itNeighbours]->Momentum;
     }
 
     mother = candidate;
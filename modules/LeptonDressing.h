@@ -10,8 +10,12 @@
 
 #include "classes/DelphesModule.h"
 
+#include <vector>
+
 class TIterator;
 class TObjArray;
+class Candidate;
+class DelphesEtaPhiGrid;
 
 class LeptonDressing: public DelphesModule
 {
@@ -27,7 +31,14 @@ public:
 private:
 
   Double_t fDeltaR;
-  
+
+  // dressing candidates above threshold of the current event
+  DelphesEtaPhiGrid *fDressingGrid; //!
+
+  std::vector< Candidate * > fDressingCandidates; //!
+
+  std::vector< Int_t > fNeighbours; //!
+
   TIterator *fItDressingInputArray; //!
   
   TIterator *fItCandidateInputArray; //!
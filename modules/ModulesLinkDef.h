@@ -26,6 +26,7 @@
 #include "modules/BTagging.h"
 #include "modules/TauTagging.h"
 #include "modules/TreeWriter.h"
+#include "modules/FlatTreeWriter.h"
 #include "modules/Merger.h"
 #include "modules/LeptonDressing.h"
 #include "modules/PileUpMerger.h"
@@ -66,6 +67,7 @@
 #pragma link C++ class BTagging+;
 #pragma link C++ class TauTagging+;
 #pragma link C++ class TreeWriter+;
+#pragma link C++ class FlatTreeWriter+;
 #pragma link C++ class Merger+;
 #pragma link C++ class LeptonDressing+;
 #pragma link C++ class PileUpMerger+;
@@ -3,6 +3,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -14,20 +15,22 @@
 #include "TRandom3.h"
 #include "TObjArray.h"
 #include "TLorentzVector.h"
-#include "TVectorD.h"
-#include "TMatrixDSymEigen.h"
+#include "TVector2.h"
 
 #include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <assert.h>   
+#include <limits>
+#include <string>
 
 using namespace std;
 
 //------------------------------------------------------------------------------
 
 PileUpJetID::PileUpJetID() :
+  fTrackGrid(0),fNeutralGrid(0),
   fItJetInputArray(0),fTrackInputArray(0),fNeutralInputArray(0){}
 
 //------------------------------------------------------------------------------
@@ -42,6 +45,9 @@ void PileUpJetID::Init(){
   fParameterR      = GetDouble("ParameterR",   0.5);
   fUseConstituents = GetInt("UseConstituents", 0);
 
+  fTrackGrid   = new DelphesEtaPhiGrid(fParameterR);
+  fNeutralGrid = new DelphesEtaPhiGrid(fParameterR);
+
   // import input array(s)
   fJetInputArray     = ImportArray(GetString("JetInputArray", "FastJetFinder/jets"));
   fTrackInputArray   = ImportArray(GetString("TrackInputArray", "ParticlePropagator/tracks"));
@@ -61,140 +67,83 @@ void PileUpJetID::Init(){
   // create output array(s)
   fOutputArray           = ExportArray(GetString("OutputArray", "jets"));
 
-  // Tight Id
-  param = GetParam("Pt010_Tight_betaStar");
-  Pt010_Tight_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Tight_betaStar.push_back(param[iMap].GetFloat());
+  // reject cards still using the old per bin cut vectors
+  if(GetParam("Pt010_Tight_betaStar").GetSize() > 0)
+  {
+    throw runtime_error("PileUpJetID: Pt*_<WP>_<variable> cut vectors are no longer supported, use CutPTBins, CutEtaBins and Cuts");
+  }
+
+  // read lower edges of the pt and |eta| bins of the cut table
+  param = GetParam("CutPTBins");
+  fCutPTBins.clear();
+  for(int iMap = 0; iMap < param.GetSize(); ++iMap) fCutPTBins.push_back(param[iMap].GetDouble());
+  if(fCutPTBins.empty()) fCutPTBins.push_back(0.0);
+
+  param = GetParam("CutEtaBins");
+  fCutEtaBins.clear();
+  for(int iMap = 0; iMap < param.GetSize(); ++iMap) fCutEtaBins.push_back(param[iMap].GetDouble());
+  if(fCutEtaBins.empty()) fCutEtaBins.push_back(0.0);
+
+  // read cuts: {working point, variable} followed by one cut per (pt, |eta|) bin;
+  // working points are numbered, and set the bits of the flag, in order of appearance
+  ExRootConfParam paramCuts;
+  std::vector<std::string> workingPoints;
+  std::vector<Int_t> cutWorkingPoint, cutVariable, cutIndex;
+  std::string name, variable;
+  int iCut, iWP, iVar, iPT, iEta, nPT, nEta, size;
+
+  nPT  = fCutPTBins.size();
+  nEta = fCutEtaBins.size();
+
+  param = GetParam("Cuts");
+  size = param.GetSize();
+
+  for(iCut = 0; iCut < size/2; ++iCut){
+    paramCuts = param[iCut*2];
+    if(paramCuts.GetSize() != 2){
+      throw runtime_error("PileUpJetID: each entry of Cuts must start with {<working point> <variable>}");
+    }
 
-  param = GetParam("Pt1020_Tight_betaStar");
-  Pt1020_Tight_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Tight_betaStar.push_back(param[iMap].GetFloat());
+    name     = paramCuts[0].GetString();
+    variable = paramCuts[1].GetString();
 
-  param = GetParam("Pt2030_Tight_betaStar");
-  Pt2030_Tight_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Tight_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Tight_betaStar");
-  Pt3050_Tight_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Tight_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt010_Tight_RMS");
-  Pt010_Tight_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Tight_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt1020_Tight_RMS");
-  Pt1020_Tight_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Tight_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt2030_Tight_RMS");
-  Pt2030_Tight_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Tight_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Tight_RMS");
-  Pt3050_Tight_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Tight_RMS.push_back(param[iMap].GetFloat());
-
-  // Medium Id
-  param = GetParam("Pt010_Medium_betaStar");
-  Pt010_Medium_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Medium_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt1020_Medium_betaStar");
-  Pt1020_Medium_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Medium_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt2030_Medium_betaStar");
-  Pt2030_Medium_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Medium_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Medium_betaStar");
-  Pt3050_Medium_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Medium_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt010_Medium_RMS");
-  Pt010_Medium_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Medium_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt1020_Medium_RMS");
-  Pt1020_Medium_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Medium_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt2030_Medium_RMS");
-  Pt2030_Medium_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Medium_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Medium_RMS");
-  Pt3050_Medium_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Medium_RMS.push_back(param[iMap].GetFloat());
-
-  // Loose Id
-  param = GetParam("Pt010_Loose_betaStar");
-  Pt010_Loose_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Loose_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt1020_Loose_betaStar");
-  Pt1020_Loose_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Loose_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt2030_Loose_betaStar");
-  Pt2030_Loose_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Loose_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Loose_betaStar");
-  Pt3050_Loose_betaStar.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Loose_betaStar.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt010_Loose_RMS");
-  Pt010_Loose_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt010_Loose_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt1020_Loose_RMS");
-  Pt1020_Loose_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt1020_Loose_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt2030_Loose_RMS");
-  Pt2030_Loose_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt2030_Loose_RMS.push_back(param[iMap].GetFloat());
-
-  param = GetParam("Pt3050_Loose_RMS");
-  Pt3050_Loose_RMS.clear();
-  for(int iMap = 0; iMap < param.GetSize(); ++iMap) Pt3050_Loose_RMS.push_back(param[iMap].GetFloat());
-
-  //-------------------------
-  for(int i0 = 0; i0 < 3; i0++) {  // number of WP
-    if(i0 == 0){
-
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][0][i2] = Pt010_Tight_betaStar[i2];     
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][1][i2] = Pt1020_Tight_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][2][i2] = Pt2030_Tight_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][3][i2] = Pt3050_Tight_betaStar[i2];
-
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][0][i2] = Pt010_Tight_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][1][i2] = Pt1020_Tight_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][2][i2] = Pt2030_Tight_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][3][i2] = Pt3050_Tight_RMS[i2];
+    iWP = std::find(workingPoints.begin(), workingPoints.end(), name) - workingPoints.begin();
+    if(iWP == int(workingPoints.size())) workingPoints.push_back(name);
+
+    if(variable == "betaStar") iVar = kBetaStar;
+    else if(variable == "RMS") iVar = kRMS;
+    else{
+      throw runtime_error("PileUpJetID: unknown cut variable '" + variable + "', expected betaStar or RMS");
     }
-    else if(i0 == 1){
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][0][i2] = Pt010_Medium_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][1][i2] = Pt1020_Medium_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][2][i2] = Pt2030_Medium_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][3][i2] = Pt3050_Medium_betaStar[i2];
-
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][0][i2] = Pt010_Medium_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][1][i2] = Pt1020_Medium_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][2][i2] = Pt2030_Medium_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][3][i2] = Pt3050_Medium_RMS[i2];
+
+    if(param[iCut*2 + 1].GetSize() != nPT*nEta){
+      stringstream message;
+      message << "PileUpJetID: cuts for " << name << " " << variable << " have " << param[iCut*2 + 1].GetSize();
+      message << " values, expected " << nPT << " pt bins x " << nEta << " |eta| bins";
+      throw runtime_error(message.str());
     }
-    else if(i0 == 2){
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][0][i2] = Pt010_Loose_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][1][i2] = Pt1020_Loose_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][2][i2] = Pt2030_Loose_betaStar[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_betaStar[i0][3][i2] = Pt3050_Loose_betaStar[i2];
-
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][0][i2] = Pt010_Loose_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][1][i2] = Pt1020_Loose_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][2][i2] = Pt2030_Loose_RMS[i2];
-     for(int i2 = 0; i2 < 4; i2++) pileUpIDCut_RMS[i0][3][i2] = Pt3050_Loose_RMS[i2];
+
+    cutWorkingPoint.push_back(iWP);
+    cutVariable.push_back(iVar);
+    cutIndex.push_back(iCut*2 + 1);
+  }
+
+  if(workingPoints.size() > 8*sizeof(Int_t) - 1){
+    throw runtime_error("PileUpJetID: too many working points for the cut based flag");
+  }
+
+  // cut table indexed by ((pt bin*N(|eta|) + |eta| bin)*N(WP) + WP)*N(variables) + variable,
+  // variables without cuts never fail
+  fNumberOfWorkingPoints = workingPoints.size();
+  fCutTable.assign(nPT*nEta*fNumberOfWorkingPoints*kNumberOfCutVariables, numeric_limits<Float_t>::max());
+
+  for(iCut = 0; iCut < int(cutIndex.size()); ++iCut){
+    paramCuts = param[cutIndex[iCut]];
+    for(iPT = 0; iPT < nPT; ++iPT){
+      for(iEta = 0; iEta < nEta; ++iEta){
+        fCutTable[((iPT*nEta + iEta)*fNumberOfWorkingPoints + cutWorkingPoint[iCut])*kNumberOfCutVariables + cutVariable[iCut]] =
+          paramCuts[iPT*nEta + iEta].GetDouble();
+      }
     }
   }
 }
@@ -206,6 +155,8 @@ void PileUpJetID::Finish(){
   if(fItTrackInputArray)   delete fItTrackInputArray;
   if(fItNeutralInputArray) delete fItNeutralInputArray;
   if(fItPVInputArray)      delete fItPVInputArray;
+  if(fTrackGrid)           delete fTrackGrid;
+  if(fNeutralGrid)         delete fNeutralGrid;
   fCones.clear();
 }
 
@@ -213,13 +164,29 @@ void PileUpJetID::Finish(){
 
 void PileUpJetID::Process(){
 
-  Candidate *jetCandidate, *constituent;
-  TLorentzVector momentum, area;
+  Candidate *jetCandidate, *constituent, *leadCand, *secondCand;
+  Double_t leadPT, secondPT, jetPT, jetEta, jetPhi, candEta, candPhi, deltaEta, deltaPhi, deltaR;
+  Double_t cov00, cov01, cov11, traceHalf, diffHalf, root;
+  Bool_t isPhoton, isNeutralHadron;
+  Int_t source, flag, pass, iWP, iVar, nvtx;
+  size_t i, iCone, iJet, cell;
+
+  // index tracks and neutrals once per event for the DeltaR matching
+  if(!fUseConstituents){
+    FillGrid(fItTrackInputArray, fTrackGrid, fTracks);
+    FillGrid(fItNeutralInputArray, fNeutralGrid, fNeutrals);
+  }
 
   // loop over all input candidates
 
   fItJetInputArray->Reset();
 
+  fJets.clear();
+  fJetCutCells.clear();
+  fJetCutValues.clear();
+
+  nvtx = fPVInputArray->GetSize();
+
   std::vector<float> FracPt, emFracPt, neutFracPt, chFracPt;
 
   FracPt.assign(fCones.size(),0.);
@@ -229,18 +196,11 @@ void PileUpJetID::Process(){
 
   std::vector<float> frac, fracCh, fracEm, fracNeut;
 
-  // Loop on the constituent of each jet
-  Candidate leadCand, trailCand, secondCand;
-  Candidate leadCandEM;
-  Candidate leadCandNeutral;
-  Candidate leadCandCh;
-
-  TMatrixDSym covMatrix(2); 
-
   while((jetCandidate = static_cast<Candidate*>(fItJetInputArray->Next()))){
-    
-    momentum = jetCandidate->Momentum;
-    area     = jetCandidate->Area;
+
+    jetPT  = jetCandidate->Momentum.Pt();
+    jetEta = jetCandidate->Momentum.Eta();
+    jetPhi = jetCandidate->Momentum.Phi();
 
     // clean the collections
     jetCandidate->FracPt.clear();     
@@ -248,14 +208,11 @@ void PileUpJetID::Process(){
     jetCandidate->neutFracPt.clear();     
     jetCandidate->chFracPt.clear();     
 
-    covMatrix = 0.;
+    cov00 = 0.; cov01 = 0.; cov11 = 0.;
 
-    leadCand.Clear();
-    trailCand.Clear(); 
-    secondCand.Clear();
-    leadCandEM.Clear();
-    leadCandNeutral.Clear();
-    leadCandCh.Clear();
+    // leading and second leading candidates are tracked by pointer
+    leadCand = 0; secondCand = 0;
+    leadPT = 0.; secondPT = 0.;
    
     for( size_t iFrac = 0; iFrac < FracPt.size() ; iFrac++){
       FracPt.at(iFrac)     = 0;
@@ -326,235 +283,139 @@ void PileUpJetID::Process(){
     jetCandidate->fourthNeutFrac = 0;
     jetCandidate->pileupIDFlagCutBased = 0;
 
+    // collect the candidates to consider: jet constituents,
+    // or tracks followed by neutrals found in the grids around the jet axis
+    fCandidates.clear(); fSources.clear(); fEtas.clear(); fPhis.clear();
+
     if (fUseConstituents) {
       TIter itConstituents(jetCandidate->GetCandidates());      
       while((constituent = static_cast<Candidate*>(itConstituents.Next()))) {
-        float candPt     = constituent->Momentum.Pt();
-        float candDr     = jetCandidate->Momentum.DeltaR(constituent->Momentum);
-	float candPtFrac = candPt/jetCandidate->Momentum.Pt();
-	float candDeta   = fabs(jetCandidate->Momentum.Eta()-constituent->Momentum.Eta());
-	float candDphi   = jetCandidate->Momentum.DeltaPhi(constituent->Momentum);
-	float candPtDr   = candPt * candDr;
-
-	if(candPt > leadCand.Momentum.Pt()) {
-	  secondCand = leadCand;
-	  leadCand  = *constituent; 
-	} 
-        else if(candPt > secondCand.Momentum.Pt() && candPt < leadCand.Momentum.Pt()) {
-	  secondCand = *constituent;
-	}
-
-        jetCandidate->dRMean  += candPtDr;
-        jetCandidate->dR2Mean += candPtDr*candPtDr;
-        covMatrix(0,0)     += candPt*candPt*candDeta*candDeta;
-        covMatrix(0,1)     += candPt*candPt*candDeta*candDphi;
-        covMatrix(1,1)     += candPt*candPt*candDphi*candDphi;
-        jetCandidate->ptD     += candPt*candPt;
-        jetCandidate->sumPt   += candPt;
-        jetCandidate->sumPt2  += candPt*candPt;
-
-	sum_deta   = candPt*candPt*candDeta;
-	sum_dphi   = candPt*candPt*candDphi;
-       
-	size_t iCone = std::lower_bound(fCones.begin(),fCones.end(),candDr)-fCones.begin();        
-	frac.push_back(candPtFrac);
-
-	if( iCone < fCones.size()) FracPt[iCone] += candPt;
-	
-        if( TMath::Abs(constituent->PID) == 22){ // look for gamma
-	  if(candPt > leadCandEM.Momentum.Pt()) leadCandEM = *constituent; 
-          if(iCone  < fCones.size() ) FracPt[iCone] += candPt; 
-          fracEm.push_back(candPtFrac);
-          jetCandidate->dRMeanEm  += candPtDr;
-          jetCandidate->ptDNe     += candPt*candPt;
-          jetCandidate->sumPtNe   += candPt;
-          jetCandidate->neuEMfrac += constituent->Momentum.E();
-          jetCandidate->nNeutral ++;
-	}
-
-        else if(constituent->Charge == 0 and TMath::Abs(constituent->PID) > 18 and TMath::Abs(constituent->PID) !=21 and TMath::Abs(constituent->PID) !=22 and 
-                TMath::Abs(constituent->PID) !=25){ // look for neutral hadrons
- 	          if(candPt > leadCandNeutral.Momentum.Pt()) leadCandNeutral = *constituent; 
-                  if(iCone < fCones.size()) jetCandidate->FracPt[iCone] += candPt;
-                  fracNeut.push_back(candPtFrac);
-                  jetCandidate->dRMeanNeut += candPtDr;
-                  jetCandidate->ptDNe      += candPt*candPt;
-                  jetCandidate->sumPtNe    += candPt;
-                  jetCandidate->neuHadfrac += constituent->Momentum.E();
-                  jetCandidate->nNeutral ++;
-	}
-
-        else if(constituent->Charge != 0){ // look for charged particles
- 	     if(candPt > leadCandCh.Momentum.Pt()) leadCandCh = *constituent; 
-             if(iCone  < fCones.size()) chFracPt[iCone] += candPt;
-             fracCh.push_back(candPtFrac);
-
-             jetCandidate->dRMeanCh  += candPtDr;
-             jetCandidate->ptDCh     += candPt*candPt;
-             jetCandidate->sumPtCh   += candPt;
-             jetCandidate->nCharged ++;
-
-             float tkpt = constituent->Momentum.Pt(); 
-   	     sumTkPt += tkpt;
-
-             if(TMath::Abs(constituent->PID) >= 11 and TMath::Abs(constituent->PID) < 18) jetCandidate->chgEMfrac += constituent->Momentum.E(); // EM charged objects
-             else jetCandidate->chgHadfrac += constituent->Momentum.E();
-
-             if(constituent->IsRecoPU == 0)   jetCandidate->betaClassic += tkpt;
-             if(constituent->IsRecoPU != 0 )  jetCandidate->betaClassicStar += tkpt;
-	     if(fabs(constituent->IsPU == 0)) jetCandidate->beta += tkpt;
-	     if(fabs(constituent->IsPU != 0)) jetCandidate->betaStar += tkpt;
-
-	}
-      	
-	// trailing candidate
-	if(candPt < trailCand.Momentum.Pt()) {
-	  trailCand = *constituent; 
-	}
-	
+        fCandidates.push_back(constituent);
+        fSources.push_back(kConstituent);
+        fEtas.push_back(constituent->Momentum.Eta());
+        fPhis.push_back(constituent->Momentum.Phi());
       }
     }
-
     else {
-      // Not using constituents, using dr
-      fItTrackInputArray->Reset();
-      while ((constituent = static_cast<Candidate*>(fItTrackInputArray->Next()))) { // loop on charged particles 
-        if (constituent->Momentum.DeltaR(jetCandidate->Momentum) < fParameterR) { // check for particles mathced to the jet
-
-         float candPt     = constituent->Momentum.Pt();
-         float candDr     = jetCandidate->Momentum.DeltaR(constituent->Momentum);
-  	 float candPtFrac = candPt/jetCandidate->Momentum.Pt();
-	 float candDeta   = fabs(jetCandidate->Momentum.Eta()-constituent->Momentum.Eta());
-	 float candDphi   = jetCandidate->Momentum.DeltaPhi(constituent->Momentum);
-	 float candPtDr   = candPt * candDr;
-
-	 if(candPt > leadCand.Momentum.Pt()) {
-	  secondCand = leadCand;
-	  leadCand  = *constituent; 
-	 } 
-         else if(candPt > secondCand.Momentum.Pt() && candPt < leadCand.Momentum.Pt()) {
-	  secondCand = *constituent;
-	 }
-
-         jetCandidate->dRMean  += candPtDr;
-         jetCandidate->dR2Mean += candPtDr*candPtDr;
-         covMatrix(0,0)     += candPt*candPt*candDeta*candDeta;
-         covMatrix(0,1)     += candPt*candPt*candDeta*candDphi;
-         covMatrix(1,1)     += candPt*candPt*candDphi*candDphi;
-         jetCandidate->ptD     += candPt*candPt;
-         jetCandidate->sumPt   += candPt;
-         jetCandidate->sumPt2  += candPt*candPt;
-
-	 sum_deta   = candPt*candPt*candDeta;
-  	 sum_dphi   = candPt*candPt*candDphi;
-
-	 size_t iCone = std::lower_bound(fCones.begin(),fCones.end(),candDr)-fCones.begin();        
-	 frac.push_back(candPtFrac);
-	 if( iCone < fCones.size()) FracPt[iCone] += candPt;
-
-         if( TMath::Abs(constituent->PID) == 22) continue; // should be a problem
-         if(constituent->Charge == 0) continue;
-
- 	 if(candPt > leadCandCh.Momentum.Pt()) leadCandCh = *constituent; 
-         if(iCone  < fCones.size()) chFracPt[iCone] += candPt;
-         fracCh.push_back(candPtFrac);
-
-         jetCandidate->dRMeanCh  += candPtDr;
-         jetCandidate->ptDCh     += candPt*candPt;
-         jetCandidate->sumPtCh   += candPt;
-         jetCandidate->nCharged ++;
-
-         float tkpt = constituent->Momentum.Pt(); 
-   	 sumTkPt += tkpt;
-
-         if(TMath::Abs(constituent->PID) >= 11 and TMath::Abs(constituent->PID) < 18) jetCandidate->chgEMfrac += constituent->Momentum.E(); // EM charged objects
-         else jetCandidate->chgHadfrac += constituent->Momentum.E();
-
-         if(constituent->IsRecoPU == 0)   jetCandidate->betaClassic += tkpt;
-         if(constituent->IsRecoPU != 0 )  jetCandidate->betaClassicStar += tkpt;
-	 if(fabs(constituent->IsPU == 0)) jetCandidate->beta += tkpt;
-	 if(fabs(constituent->IsPU != 0)) jetCandidate->betaStar += tkpt;	 
-	}
-	// trailing candidate
-	if(constituent->Momentum.Pt() < trailCand.Momentum.Pt()) {
-	  trailCand = *constituent; 
-	}      
+      // the grid cone is slightly larger, the exact cut is applied below
+      fNeighbours.clear();
+      fTrackGrid->FindNeighbours(jetEta, jetPhi, fParameterR*(1.0 + 1.0e-9), fNeighbours);
+      for(i = 0; i < fNeighbours.size(); ++i){
+        fCandidates.push_back(fTracks[fNeighbours[i]]);
+        fSources.push_back(kTrack);
+        fEtas.push_back(fTrackGrid->GetEta(fNeighbours[i]));
+        fPhis.push_back(fTrackGrid->GetPhi(fNeighbours[i]));
+      }
+
+      fNeighbours.clear();
+      fNeutralGrid->FindNeighbours(jetEta, jetPhi, fParameterR*(1.0 + 1.0e-9), fNeighbours);
+      for(i = 0; i < fNeighbours.size(); ++i){
+        fCandidates.push_back(fNeutrals[fNeighbours[i]]);
+        fSources.push_back(kNeutral);
+        fEtas.push_back(fNeutralGrid->GetEta(fNeighbours[i]));
+        fPhis.push_back(fNeutralGrid->GetPhi(fNeighbours[i]));
+      }
+    }
+
+    for(i = 0; i < fCandidates.size(); ++i){
+      constituent = fCandidates[i];
+      source      = fSources[i];
+      candEta     = fEtas[i];
+      candPhi     = fPhis[i];
+
+      deltaEta = jetEta - candEta;
+      deltaPhi = TVector2::Phi_mpi_pi(jetPhi - candPhi);
+      deltaR   = TMath::Sqrt(deltaEta*deltaEta + deltaPhi*deltaPhi);
+
+      if(source != kConstituent && !(deltaR < fParameterR)) continue; // check for particles mathced to the jet
+
+      float candPt     = constituent->Momentum.Pt();
+      float candDr     = deltaR;
+      float candPtFrac = candPt/jetPT;
+      float candDeta   = fabs(deltaEta);
+      float candDphi   = deltaPhi;
+      float candPtDr   = candPt * candDr;
+
+      if(candPt > leadPT) {
+        secondCand = leadCand; secondPT = leadPT;
+        leadCand   = constituent; leadPT = candPt;
+      } 
+      else if(candPt > secondPT && candPt < leadPT) {
+        secondCand = constituent; secondPT = candPt;
       }
 
-      fItNeutralInputArray->Reset();
-      while ((constituent = static_cast<Candidate*>(fItNeutralInputArray->Next()))) { // Loop on neutral PF jetCandidates
-	if (constituent->Momentum.DeltaR(jetCandidate->Momentum) < fParameterR) { // check within the jet
-
-         float candPt     = constituent->Momentum.Pt();
-         float candDr     = jetCandidate->Momentum.DeltaR(constituent->Momentum);
-  	 float candPtFrac = candPt/jetCandidate->Momentum.Pt();
-	 float candDeta   = fabs(jetCandidate->Momentum.Eta()-constituent->Momentum.Eta());
-	 float candDphi   = jetCandidate->Momentum.DeltaPhi(constituent->Momentum);
-	 float candPtDr   = candPt * candDr;
-
-	 if(candPt > leadCand.Momentum.Pt()) {
-	  secondCand = leadCand;
-	  leadCand  = *constituent; 
-	 } 
-         else if(candPt > secondCand.Momentum.Pt() && candPt < leadCand.Momentum.Pt()) {
-	  secondCand = *constituent;
-	 }
-
-         jetCandidate->dRMean  += candPtDr;
-         jetCandidate->dR2Mean += candPtDr*candPtDr;
-         covMatrix(0,0)     += candPt*candPt*candDeta*candDeta;
-         covMatrix(0,1)     += candPt*candPt*candDeta*candDphi;
-         covMatrix(1,1)     += candPt*candPt*candDphi*candDphi;
-         jetCandidate->ptD     += candPt*candPt;
-         jetCandidate->sumPt   += candPt;
-         jetCandidate->sumPt2  += candPt*candPt;
-
- 	 sum_deta   = candPt*candPt*candDeta;
-	 sum_dphi   = candPt*candPt*candDphi;
-
-	 size_t iCone = std::lower_bound(fCones.begin(),fCones.end(),candDr)-fCones.begin();        
-	 frac.push_back(candPtFrac);
-	 if( iCone < fCones.size()) FracPt[iCone] += candPt;
-
-         if(constituent->Charge != 0 ) continue; // in principle should be a problem
-
-         if( TMath::Abs(constituent->PID) == 22){ // look for gamma
-	  if(candPt > leadCandEM.Momentum.Pt()) leadCandEM = *constituent; 
-          if(iCone  < fCones.size() ) emFracPt[iCone] += candPt; 
-          fracEm.push_back(candPtFrac);
-          jetCandidate->dRMeanEm  += candPtDr;
-          jetCandidate->ptDNe     += candPt*candPt;
-          jetCandidate->sumPtNe   += candPt;
-          jetCandidate->neuEMfrac += constituent->Momentum.E();
-          jetCandidate->nNeutral ++;
-	 }
-
-         else if(constituent->Charge == 0 and TMath::Abs(constituent->PID) > 18 and TMath::Abs(constituent->PID) !=21 and TMath::Abs(constituent->PID) !=22 and 
-                 TMath::Abs(constituent->PID) !=25){ // look for neutral hadrons
- 	          if(candPt > leadCandNeutral.Momentum.Pt()) leadCandNeutral = *constituent; 
-                  if(iCone < fCones.size()) neutFracPt[iCone] += candPt;
-                  fracNeut.push_back(candPtFrac);
-                  jetCandidate->dRMeanNeut += candPtDr;
-                  jetCandidate->ptDNe      += candPt*candPt;
-                  jetCandidate->sumPtNe    += candPt;
-                  jetCandidate->neuHadfrac += constituent->Momentum.E();
-                  jetCandidate->nNeutral ++;
-	 }
-	 // trailing candidate
-	 if(candPt < trailCand.Momentum.Pt()) {
-	  trailCand = *constituent; 
-	 }
-	}
+      jetCandidate->dRMean  += candPtDr;
+      jetCandidate->dR2Mean += candPtDr*candPtDr;
+      cov00 += candPt*candPt*candDeta*candDeta;
+      cov01 += candPt*candPt*candDeta*candDphi;
+      cov11 += candPt*candPt*candDphi*candDphi;
+      jetCandidate->ptD     += candPt*candPt;
+      jetCandidate->sumPt   += candPt;
+      jetCandidate->sumPt2  += candPt*candPt;
+
+      sum_deta   = candPt*candPt*candDeta;
+      sum_dphi   = candPt*candPt*candDphi;
+       
+      iCone = std::lower_bound(fCones.begin(),fCones.end(),candDr)-fCones.begin();        
+      frac.push_back(candPtFrac);
+
+      if( iCone < fCones.size()) FracPt[iCone] += candPt;
+
+      isPhoton        = TMath::Abs(constituent->PID) == 22;
+      isNeutralHadron = constituent->Charge == 0 and TMath::Abs(constituent->PID) > 18 and TMath::Abs(constituent->PID) != 21 and
+                        TMath::Abs(constituent->PID) != 22 and TMath::Abs(constituent->PID) != 25;
+
+      if(source == kTrack && (isPhoton || constituent->Charge == 0)) continue; // should be a problem
+      if(source == kNeutral && constituent->Charge != 0) continue; // in principle should be a problem
+
+      if(isPhoton){ // look for gamma
+        // jet constituents have always filled FracPt here
+        if(iCone < fCones.size()){
+          if(source == kConstituent) FracPt[iCone] += candPt;
+          else emFracPt[iCone] += candPt;
+        }
+        fracEm.push_back(candPtFrac);
+        jetCandidate->dRMeanEm  += candPtDr;
+        jetCandidate->ptDNe     += candPt*candPt;
+        jetCandidate->sumPtNe   += candPt;
+        jetCandidate->neuEMfrac += constituent->Momentum.E();
+        jetCandidate->nNeutral ++;
+      }
+
+      else if(isNeutralHadron){ // look for neutral hadrons
+        if(iCone < fCones.size() && source == kNeutral) neutFracPt[iCone] += candPt;
+        fracNeut.push_back(candPtFrac);
+        jetCandidate->dRMeanNeut += candPtDr;
+        jetCandidate->ptDNe      += candPt*candPt;
+        jetCandidate->sumPtNe    += candPt;
+        jetCandidate->neuHadfrac += constituent->Momentum.E();
+        jetCandidate->nNeutral ++;
+      }
+
+      else if(constituent->Charge != 0){ // look for charged particles
+        if(iCone  < fCones.size()) chFracPt[iCone] += candPt;
+        fracCh.push_back(candPtFrac);
+
+        jetCandidate->dRMeanCh  += candPtDr;
+        jetCandidate->ptDCh     += candPt*candPt;
+        jetCandidate->sumPtCh   += candPt;
+        jetCandidate->nCharged ++;
+
+        float tkpt = candPt; 
+        sumTkPt += tkpt;
+
+        if(TMath::Abs(constituent->PID) >= 11 and TMath::Abs(constituent->PID) < 18) jetCandidate->chgEMfrac += constituent->Momentum.E(); // EM charged objects
+        else jetCandidate->chgHadfrac += constituent->Momentum.E();
+
+        if(constituent->IsRecoPU == 0)   jetCandidate->betaClassic += tkpt;
+        if(constituent->IsRecoPU != 0 )  jetCandidate->betaClassicStar += tkpt;
+        if(constituent->IsPU == 0) jetCandidate->beta += tkpt;
+        if(constituent->IsPU != 0) jetCandidate->betaStar += tkpt;
       }
     }
 
     // fix the final values
-    assert(leadCand.Momentum.Pt() != 0);
-    
-    if (secondCand.Momentum.Pt() == 0 )     secondCand      = trailCand; 
-    if (leadCandNeutral.Momentum.Pt() ==0 ) leadCandNeutral = trailCand; 
-    if (leadCandEM.Momentum.Pt() ==0 )      leadCandEM = trailCand; 
-    if (leadCandCh.Momentum.Pt() ==0 )      leadCandCh = trailCand; 
+    assert(leadPT != 0);
 
     jetCandidate->chgEMfrac  /= jetCandidate->Momentum.E();
     jetCandidate->neuEMfrac  /= jetCandidate->Momentum.E();
@@ -566,48 +427,34 @@ void PileUpJetID::Process(){
     jetCandidate->dZ = fabs(jetCandidate->Position.Z()-dynamic_cast<Candidate*>(fPVInputArray->At(0))->Position.Z());
     jetCandidate->d0 = (-jetCandidate->Position.X()*dynamic_cast<Candidate*>(fPVInputArray->At(0))->Position.Y()+jetCandidate->Position.Y()*dynamic_cast<Candidate*>(fPVInputArray->At(0))->Position.X())/jetCandidate->Position.Pt();
     
-    std::sort(frac.begin(),frac.end(),std::greater<float>());
-    std::sort(fracCh.begin(),fracCh.end(),std::greater<float>());
-    std::sort(fracEm.begin(),fracEm.end(),std::greater<float>());
-    std::sort(fracNeut.begin(),fracNeut.end(),std::greater<float>());
-
-    jetCandidate->leadFrac = 0; jetCandidate->secondFrac = 0; jetCandidate->thirdFrac = 0; jetCandidate->fourthFrac = 0; 
-    jetCandidate->leadChFrac = 0; jetCandidate->secondChFrac = 0; jetCandidate->thirdChFrac = 0; jetCandidate->fourthChFrac = 0; 
-    jetCandidate->leadEmFrac = 0; jetCandidate->secondEmFrac = 0; jetCandidate->thirdEmFrac = 0; jetCandidate->fourthEmFrac = 0; 
-    jetCandidate->leadNeutFrac = 0; jetCandidate->secondNeutFrac = 0; jetCandidate->thirdNeutFrac = 0; jetCandidate->fourthNeutFrac = 0; 
-
     assign(frac,    jetCandidate->leadFrac,    jetCandidate->secondFrac,    jetCandidate->thirdFrac,    jetCandidate->fourthFrac);
     assign(fracCh,  jetCandidate->leadChFrac,  jetCandidate->secondChFrac,  jetCandidate->thirdChFrac,  jetCandidate->fourthChFrac);
     assign(fracEm,  jetCandidate->leadEmFrac,  jetCandidate->secondEmFrac,  jetCandidate->thirdEmFrac,  jetCandidate->fourthEmFrac);
     assign(fracNeut,jetCandidate->leadNeutFrac,jetCandidate->secondNeutFrac,jetCandidate->thirdNeutFrac,jetCandidate->fourthNeutFrac);
     
-    covMatrix(0,0) /= jetCandidate->sumPt2;
-    covMatrix(0,1) /= jetCandidate->sumPt2;
-    covMatrix(1,1) /= jetCandidate->sumPt2;
-    covMatrix(1,0)  = covMatrix(0,1);
-
-    jetCandidate->etaW = 0.;
-    jetCandidate->phiW = 0.;
-    jetCandidate->jetW = 0.;
+    cov00 /= jetCandidate->sumPt2;
+    cov01 /= jetCandidate->sumPt2;
+    cov11 /= jetCandidate->sumPt2;
 
-    jetCandidate->etaW = sqrt(covMatrix(0,0));
-    jetCandidate->phiW = sqrt(covMatrix(1,1));
+    jetCandidate->etaW = sqrt(cov00);
+    jetCandidate->phiW = sqrt(cov11);
     jetCandidate->jetW = 0.5*(jetCandidate->etaW+jetCandidate->phiW);
 
-    TVectorD eigVals(2);
-    eigVals = TMatrixDSymEigen(covMatrix).GetEigenValues();
-    jetCandidate->majW = 0.; jetCandidate->minW = 0.; jetCandidate->dRLeadCent = 0.;
-    jetCandidate->majW = sqrt(fabs(eigVals(0)));
-    jetCandidate->minW = sqrt(fabs(eigVals(1)));
+    // eigenvalues of the symmetric 2x2 covariance matrix
+    traceHalf = 0.5*(cov00 + cov11);
+    diffHalf  = 0.5*(cov00 - cov11);
+    root      = sqrt(diffHalf*diffHalf + cov01*cov01);
+
+    jetCandidate->majW = sqrt(fabs(traceHalf + root));
+    jetCandidate->minW = sqrt(fabs(traceHalf - root));
 
     if(jetCandidate->majW < jetCandidate->minW ) std::swap(jetCandidate->majW,jetCandidate->minW);
-    jetCandidate->dRLeadCent = jetCandidate->Momentum.DeltaR(leadCand.Momentum);
-    jetCandidate->dRLead2nd  = 0.; 
-    if(secondCand.Momentum.Pt() > 0) jetCandidate->dRLead2nd = jetCandidate->Momentum.DeltaR(secondCand.Momentum);
-    jetCandidate->dRMean     /= jetCandidate->Momentum.Pt();
-    jetCandidate->dRMeanNeut /= jetCandidate->Momentum.Pt();
-    jetCandidate->dRMeanEm   /= jetCandidate->Momentum.Pt();
-    jetCandidate->dRMeanCh   /= jetCandidate->Momentum.Pt();
+    if(leadCand) jetCandidate->dRLeadCent = jetCandidate->Momentum.DeltaR(leadCand->Momentum);
+    if(secondCand && secondPT > 0) jetCandidate->dRLead2nd = jetCandidate->Momentum.DeltaR(secondCand->Momentum);
+    jetCandidate->dRMean     /= jetPT;
+    jetCandidate->dRMeanNeut /= jetPT;
+    jetCandidate->dRMeanEm   /= jetPT;
+    jetCandidate->dRMeanCh   /= jetPT;
     jetCandidate->dR2Mean    /= jetCandidate->sumPt2;
 
     jetCandidate->FracPt     = FracPt ;
@@ -615,11 +462,11 @@ void PileUpJetID::Process(){
     jetCandidate->neutFracPt = neutFracPt;
     jetCandidate->chFracPt   = chFracPt;
 
-    for(size_t iCone = 0; iCone < fCones.size(); ++iCone){
-        jetCandidate->FracPt[iCone]     /= jetCandidate->Momentum.Pt();
-	jetCandidate->emFracPt[iCone]   /= jetCandidate->Momentum.Pt();
-	jetCandidate->neutFracPt[iCone] /= jetCandidate->Momentum.Pt();
-	jetCandidate->chFracPt[iCone]   /= jetCandidate->Momentum.Pt();
+    for(iCone = 0; iCone < fCones.size(); ++iCone){
+      jetCandidate->FracPt[iCone]     /= jetPT;
+      jetCandidate->emFracPt[iCone]   /= jetPT;
+      jetCandidate->neutFracPt[iCone] /= jetPT;
+      jetCandidate->chFracPt[iCone]   /= jetPT;
     }
 
     double ptMean = jetCandidate->sumPt/jetCandidate->constituents;
@@ -628,14 +475,12 @@ void PileUpJetID::Process(){
     ptRMS /= jetCandidate->constituents;
     ptRMS  = sqrt(ptRMS);
 
-    jetCandidate->ptMean = 0.; jetCandidate->ptRMS = 0.; jetCandidate->pt2A = 0.; 
     jetCandidate->ptMean   = ptMean;
-    jetCandidate->ptRMS    = ptRMS/jetCandidate->Momentum.Pt();
-    jetCandidate->pt2A     = sqrt( jetCandidate->ptD/jetCandidate->constituents)/jetCandidate->Momentum.Pt();
+    jetCandidate->ptRMS    = ptRMS/jetPT;
+    jetCandidate->pt2A     = sqrt( jetCandidate->ptD/jetCandidate->constituents)/jetPT;
     jetCandidate->ptD      = sqrt( jetCandidate->ptD) / jetCandidate->sumPt;
     jetCandidate->ptDCh    = sqrt( jetCandidate->ptDCh) / jetCandidate->sumPtCh;
     jetCandidate->ptDNe    = sqrt( jetCandidate->ptDNe)  / jetCandidate->sumPtNe;
-    jetCandidate->sumPt    = jetCandidate->sumPt;
     jetCandidate->sumChPt  = jetCandidate->sumPtCh;
     jetCandidate->sumNePt  = jetCandidate->sumPtNe;
 
@@ -651,60 +496,73 @@ void PileUpJetID::Process(){
     if(jetCandidate->sumPt2 > 0){
       ave_deta = sum_deta/jetCandidate->sumPt2;
       ave_dphi = sum_dphi/jetCandidate->sumPt2;
-      ave_deta2 = covMatrix(0,0)/jetCandidate->sumPt2;
-      ave_dphi2 = covMatrix(1,1)/jetCandidate->sumPt2;
+      ave_deta2 = cov00/jetCandidate->sumPt2;
+      ave_dphi2 = cov11/jetCandidate->sumPt2;
       a = ave_deta2 - ave_deta*ave_deta;                          
       b = ave_dphi2 - ave_dphi*ave_dphi;                          
-      c = -(covMatrix(0,1)/jetCandidate->sumPt2-ave_deta*ave_dphi);                
+      c = -(cov01/jetCandidate->sumPt2-ave_deta*ave_dphi);                
     }
     float delta = sqrt(fabs((a-b)*(a-b)+4*c*c));
     if(a+b-delta > 0) jetCandidate->axis2 = sqrt(0.5*(a+b-delta));
     else jetCandidate->axis2 = 0;
     
-    jetCandidate->pileupIDFlagCutBased = computeCutIDflag(jetCandidate->betaClassicStar,jetCandidate->dR2Mean,fPVInputArray->GetSize(),jetCandidate->Momentum.Pt(),jetCandidate->Momentum.Eta());
+    // store the cut table cell and the cut variables of the jet
+    fJets.push_back(jetCandidate);
+    fJetCutCells.push_back(FindBin(fCutPTBins, jetPT)*fCutEtaBins.size() + FindBin(fCutEtaBins, fabs(jetEta)));
+    fJetCutValues.push_back(jetCandidate->betaClassicStar/log(nvtx - 0.64));
+    fJetCutValues.push_back(jetCandidate->dR2Mean);
     
     // fill output jetCandidate without cutting
     fOutputArray->Add(jetCandidate);    
   }
 
-  FracPt.clear();
-  emFracPt.clear();
-  neutFracPt.clear();
-  chFracPt.clear();
-
+  // evaluate the cut based flag for all jets at once
+  for(iJet = 0; iJet < fJets.size(); ++iJet){
+    cell = fJetCutCells[iJet]*fNumberOfWorkingPoints*kNumberOfCutVariables;
+    flag = 0;
+    for(iWP = 0; iWP < fNumberOfWorkingPoints; ++iWP){
+      pass = 1;
+      for(iVar = 0; iVar < kNumberOfCutVariables; ++iVar){
+        pass &= fJetCutValues[iJet*kNumberOfCutVariables + iVar] < fCutTable[cell + iWP*kNumberOfCutVariables + iVar];
+      }
+      flag |= pass << iWP;
+    }
+    fJets[iJet]->pileupIDFlagCutBased = flag;
+  }
 }
 
+//------------------------------------------------------------------------------
+
+void PileUpJetID::FillGrid(TIterator *iterator, DelphesEtaPhiGrid *grid, std::vector<Candidate *> &candidates){
+  Candidate *candidate;
+
+  grid->Clear();
+  candidates.clear();
+
+  iterator->Reset();
+  while((candidate = static_cast<Candidate*>(iterator->Next()))){
+    grid->Add(candidate->Momentum.Eta(), candidate->Momentum.Phi());
+    candidates.push_back(candidate);
+  }
+
+  grid->Build();
+}
 
 //------------------------------------------------------------------------------
-void PileUpJetID::assign(const std::vector<float> & vec, float & a, float & b, float & c, float & d ){
+void PileUpJetID::assign(std::vector<float> & vec, float & a, float & b, float & c, float & d ){
   size_t sz = vec.size();
+  // only the four largest fractions are needed, sorted in decreasing order
+  std::partial_sort(vec.begin(), vec.begin() + std::min(sz, size_t(4)), vec.end(), std::greater<float>());
   a = ( sz > 0 ? vec[0] : 0. );
   b = ( sz > 1 ? vec[1] : 0. );
   c = ( sz > 2 ? vec[2] : 0. );
   d = ( sz > 3 ? vec[3] : 0. );
 }
 
-std::pair<int,int> PileUpJetID::getJetIdKey(float jetPt, float jetEta){
-  int ptId = 0;                                                                                                                                    
-  if(jetPt > 10 && jetPt < 20) ptId = 1;                                                                                 
-  if(jetPt > 20 && jetPt < 30) ptId = 2;                                                                                 
-  if(jetPt > 30              ) ptId = 3;                                                                                          
-  int etaId = 0;                                                                                                                                   
-  if(fabs(jetEta) > 2.5  && fabs(jetEta) < 2.75) etaId = 1;                                                              
-  if(fabs(jetEta) > 2.75 && fabs(jetEta) < 3.0 ) etaId = 2;                                                              
-  if(fabs(jetEta) > 3.0  && fabs(jetEta) < 5.0 ) etaId = 3;                                 
-  return std::pair<int,int>(ptId,etaId);
-}
+//------------------------------------------------------------------------------
 
-int PileUpJetID::computeCutIDflag(float betaClassicStar,float dR2Mean,float nvtx, float jetPt, float jetEta){
-  std::pair<int,int> jetIdKey = getJetIdKey(jetPt,jetEta);
-  float betaStarModified      = betaClassicStar/log(nvtx-0.64);
-  int idFlag(0);
-  if(betaStarModified < pileUpIDCut_betaStar[0][jetIdKey.first][jetIdKey.second] and 
-     dR2Mean          < pileUpIDCut_RMS[0][jetIdKey.first][jetIdKey.second] ) idFlag += 1 <<  0;
-  if(betaStarModified < pileUpIDCut_betaStar[1][jetIdKey.first][jetIdKey.second] and 
-     dR2Mean          < pileUpIDCut_RMS[1][jetIdKey.first][jetIdKey.second] ) idFlag += 1 <<  1;
-  if(betaStarModified < pileUpIDCut_betaStar[2][jetIdKey.first][jetIdKey.second] and 
-     dR2Mean          < pileUpIDCut_RMS[2][jetIdKey.first][jetIdKey.second] ) idFlag += 1 <<  2;
-  return idFlag;
+Int_t PileUpJetID::FindBin(const std::vector<Double_t> &edges, Double_t value){
+  // the lower edge belongs to the previous bin, values outside go to the first or last bin
+  Int_t bin = std::lower_bound(edges.begin(), edges.end(), value) - edges.begin() - 1;
+  return TMath::Max(0, TMath::Min(bin, Int_t(edges.size()) - 1));
 }
@@ -2,12 +2,14 @@
 #define PileUpJetID_h
 
 #include "classes/DelphesModule.h"
-#include "TMatrixDSym.h"
 
 #include <deque>
+#include <vector>
 
 class TObjArray;
+class Candidate;
 class DelphesFormula;
+class DelphesEtaPhiGrid;
 
 class PileUpJetID: public DelphesModule {
 
@@ -19,12 +21,17 @@ class PileUpJetID: public DelphesModule {
   void Init();
   void Process();
   void Finish();
-  void assign(const std::vector<float> &, float &, float &, float &, float &);
-  std::pair<int,int> getJetIdKey(float jetPt, float jetEta);
-  int computeCutIDflag(float,float,float,float,float);
+  void assign(std::vector<float> &, float &, float &, float &, float &);
 
  private:
 
+  enum { kConstituent, kTrack, kNeutral };
+  enum { kBetaStar, kRMS, kNumberOfCutVariables };
+
+  static Int_t FindBin(const std::vector<Double_t> &edges, Double_t value);
+
+  void FillGrid(TIterator *iterator, DelphesEtaPhiGrid *grid, std::vector<Candidate *> &candidates);
+
   Double_t fJetPTMin;
   Double_t fParameterR;
 
@@ -32,38 +39,31 @@ class PileUpJetID: public DelphesModule {
 
   std::vector<double> fCones ;
 
-  std::vector<double> Pt010_Tight_betaStar ;
-  std::vector<double> Pt1020_Tight_betaStar ;
-  std::vector<double> Pt2030_Tight_betaStar ;
-  std::vector<double> Pt3050_Tight_betaStar ;
-
-  std::vector<double> Pt010_Medium_betaStar ;
-  std::vector<double> Pt1020_Medium_betaStar ;
-  std::vector<double> Pt2030_Medium_betaStar ;
-  std::vector<double> Pt3050_Medium_betaStar ;
-
-  std::vector<double> Pt010_Loose_betaStar ;
-  std::vector<double> Pt1020_Loose_betaStar ;
-  std::vector<double> Pt2030_Loose_betaStar ;
-  std::vector<double> Pt3050_Loose_betaStar;
-
-  std::vector<double> Pt010_Tight_RMS ;
-  std::vector<double> Pt1020_Tight_RMS ;
-  std::vector<double> Pt2030_Tight_RMS ;
-  std::vector<double> Pt3050_Tight_RMS ;
-
-  std::vector<double> Pt010_Medium_RMS ;
-  std::vector<double> Pt1020_Medium_RMS ;
-  std::vector<double> Pt2030_Medium_RMS ;
-  std::vector<double> Pt3050_Medium_RMS ;
-
-  std::vector<double> Pt010_Loose_RMS ;
-  std::vector<double> Pt1020_Loose_RMS ;
-  std::vector<double> Pt2030_Loose_RMS ;
-  std::vector<double> Pt3050_Loose_RMS;
-
-  Float_t pileUpIDCut_betaStar [3][4][4];
-  Float_t pileUpIDCut_RMS [3][4][4];
+  // cut based ID: lower edges of the pt and |eta| bins and the flattened
+  // (pt, |eta|, working point, variable) cut table
+  std::vector<Double_t> fCutPTBins, fCutEtaBins;
+
+  Int_t fNumberOfWorkingPoints;
+
+  std::vector<Float_t> fCutTable;
+
+  // jets of the current event with their cut table cell and cut variables
+  std::vector<Candidate *> fJets; //!
+  std::vector<Int_t> fJetCutCells; //!
+  std::vector<Float_t> fJetCutValues; //!
+
+  // tracks and neutrals of the current event indexed in (eta, phi)
+  DelphesEtaPhiGrid *fTrackGrid; //!
+  DelphesEtaPhiGrid *fNeutralGrid; //!
+
+  std::vector<Candidate *> fTracks, fNeutrals; //!
+
+  // candidates considered for the current jet
+  std::vector<Candidate *> fCandidates; //!
+  std::vector<Int_t> fSources; //!
+  std::vector<Double_t> fEtas, fPhis; //!
+
+  std::vector<Int_t> fNeighbours; //!
  
   TIterator *fItJetInputArray; //!
   TIterator *fItTrackInputArray; // SCZ
@@ -14,18 +14,24 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPileUpPool.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootClassifier.h"
+#include "ExRootAnalysis/ExRootConfReader.h"
 
 #include "TMath.h"
 #include "TString.h"
 #include "TFormula.h"
 #include "TRandom3.h"
 #include "TObjArray.h"
-#include "TDatabasePDG.h"
 #include "TLorentzVector.h"
+#include "TStopwatch.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
 
 #include <algorithm>
 #include <stdexcept>
@@ -43,15 +49,40 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
+// pile-up of one event: vertex smearing and particles of each pile-up interaction
+
+struct PileUpBundle
+{
+  Int_t poisson;
+  Bool_t properties;
+
+  vector<Double_t> dz, dphi, dt;
+  vector<Long64_t> begin;
+
+  vector<Int_t> pid, charge;
+  vector<Float_t> mass;
+  vector<Float_t> x, y, z, t;
+  vector<Float_t> px, py, pz, e;
+};
+
+//------------------------------------------------------------------------------
+
 PileUpMerger::PileUpMerger() :
-  fReader(0), fItInputArray(0)
+  fReader(0), fPool(0), fSamplingTime(0),
+  fPrefetchDepth(0), fBundles(0), fPrefetchRandom(0), fPrefetchThread(0),
+  fPrefetchMutex(0), fBundleReady(0), fBundleFree(0), fStallTime(0),
+  fItInputArray(0)
 {
+  fSamplingTime = new TStopwatch;
+  fStallTime = new TStopwatch;
 }
 
 //------------------------------------------------------------------------------
 
 PileUpMerger::~PileUpMerger()
 {
+  if(fStallTime) delete fStallTime;
+  if(fSamplingTime) delete fSamplingTime;
 }
 
 //------------------------------------------------------------------------------
@@ -59,6 +90,10 @@ PileUpMerger::~PileUpMerger()
 void PileUpMerger::Init()
 {
   const char *fileName;
+  Long64_t preloadMaxEvents;
+  ExRootConfParam param;
+  Long_t i, size;
+  UInt_t seed;
 
   fMeanPileUp  = GetDouble("MeanPileUp", 10);
   fZVertexSpread = GetDouble("ZVertexSpread", 0.05)*1.0E3;
@@ -68,9 +103,84 @@ void PileUpMerger::Init()
   fOutputBSX = GetDouble("OutputBSX",0.);
   fOutputBSY = GetDouble("OutputBSY",0.);
 
+  // keep only particles with pT > PTMin and |eta| < EtaMax whose |PID| is not in SkipPID,
+  // zero disables the cut
+  fPTMin = GetDouble("PTMin", 0.0);
+  fEtaMax = GetDouble("EtaMax", 0.0);
+
+  // compare squares and pz/p, the cuts do not change under the rotation around z
+  fPTMin2 = fPTMin*fPTMin;
+  fPzFractionMax = TMath::TanH(fEtaMax);
+
+  param = GetParam("SkipPID");
+  size = param.GetSize();
+  fSkipPID.clear();
+  for(i = 0; i < size; ++i)
+  {
+    fSkipPID.push_back(TMath::Abs(param[i].GetInt()));
+  }
+  sort(fSkipPID.begin(), fSkipPID.end());
+
+  fSkippedPT = 0;
+  fSkippedEta = 0;
+  fSkippedPID = 0;
 
   fileName = GetString("PileUpFile", "MinBias.pileup");
-  fReader = new DelphesPileUpReader(fileName);
+
+  // decode the whole library (or PreloadMaxEvents random events) once,
+  // the pool is shared by all instances using the same file and subset
+  if(GetInt("PreloadPileUp", 0))
+  {
+    preloadMaxEvents = GetInt("PreloadMaxEvents", 0);
+    fPool = DelphesPileUpPool::Acquire(fileName, preloadMaxEvents, GetInt("PreloadSeed", 0));
+
+    if(fPool->GetEntries() <= 0)
+    {
+      throw runtime_error("no events in pile-up pool");
+    }
+
+    cout << "** INFO: pile-up pool with " << fPool->GetEntries() << " events, ";
+    cout << fPool->GetParticles() << " particles, ";
+    cout << fPool->GetMemorySize()/1048576.0 << " MB, decoded in " << fPool->GetLoadTime() << " s" << endl;
+  }
+  else
+  {
+    fReader = new DelphesPileUpReader(fileName);
+  }
+
+  fSampledEvents = 0;
+  fSampledParticles = 0;
+  fSamplingTime->Reset();
+
+  // read pile-up of the next PrefetchDepth events in the background,
+  // with its own random numbers so that the sequence does not depend on timing
+  fPrefetchDepth = fReader ? GetInt("PrefetchDepth", 0) : 0;
+  fStalls = 0;
+  fStallTime->Reset();
+
+  if(fPrefetchDepth > 0)
+  {
+    fBundles = new PileUpBundle[fPrefetchDepth];
+    fBundleHead = 0;
+    fBundleTail = 0;
+    fBundleCount = 0;
+    fPrefetchStop = kFALSE;
+
+    // TRandom3 seeded with 0 takes its seed from the clock, fall back to a seed
+    // derived from RandomSeed and the module name so that the output is reproducible
+    seed = GetInt("PrefetchSeed", 0);
+    if(seed == 0) seed = (GetConfReader()->GetInt("::RandomSeed", 0) + TString(GetName()).Hash()) % 900000000 + 1;
+    fPrefetchRandom = new TRandom3(seed);
+    fPrefetchError.clear();
+
+    TThread::Initialize();
+    fPrefetchMutex = new TMutex;
+    fBundleReady = new TCondition(fPrefetchMutex);
+    fBundleFree = new TCondition(fPrefetchMutex);
+
+    fPrefetchThread = new TThread(PrefetchThread, this);
+    fPrefetchThread->Run();
+  }
 
   // import input array
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -86,23 +196,179 @@ void PileUpMerger::Init()
 
 void PileUpMerger::Finish()
 {
+  Double_t time = fSamplingTime->RealTime();
+
+  if(fPool && time > 0.0)
+  {
+    cout << "** INFO: sampled " << fSampledEvents << " pile-up events (";
+    cout << fSampledParticles << " particles) in " << time << " s, ";
+    cout << fSampledEvents/time << " events/s" << endl;
+  }
+
+  if(fPTMin > 0.0 || fEtaMax > 0.0 || !fSkipPID.empty())
+  {
+    cout << "** INFO: pile-up filters skipped " << fSkippedPT + fSkippedEta + fSkippedPID;
+    cout << " of " << fSampledParticles << " particles (pT: " << fSkippedPT;
+    cout << ", |eta|: " << fSkippedEta << ", PID: " << fSkippedPID << ")" << endl;
+  }
+
+  if(fPrefetchThread)
+  {
+    fPrefetchMutex->Lock();
+    fPrefetchStop = kTRUE;
+    fBundleFree->Signal();
+    fPrefetchMutex->UnLock();
+
+    fPrefetchThread->Join();
+
+    cout << "** INFO: pile-up prefetch stalled " << fStalls << " times, ";
+    cout << fStallTime->RealTime() << " s in total" << endl;
+  }
+
+  if(fPrefetchThread) delete fPrefetchThread;
+  if(fBundleFree) delete fBundleFree;
+  if(fBundleReady) delete fBundleReady;
+  if(fPrefetchMutex) delete fPrefetchMutex;
+  if(fPrefetchRandom) delete fPrefetchRandom;
+  if(fBundles) delete[] fBundles;
+  fPrefetchThread = 0;
+  fBundleFree = 0;
+  fBundleReady = 0;
+  fPrefetchMutex = 0;
+  fPrefetchRandom = 0;
+  fBundles = 0;
+
   if(fReader) delete fReader;
+  DelphesPileUpPool::Release(fPool);
+  fReader = 0;
+  fPool = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void *PileUpMerger::PrefetchThread(void *merger)
+{
+  static_cast<PileUpMerger *>(merger)->Prefetch();
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMerger::Prefetch()
+{
+  PileUpBundle *bundle;
+  string error;
+
+  while(true)
+  {
+    fPrefetchMutex->Lock();
+    while(fBundleCount == fPrefetchDepth && !fPrefetchStop) fBundleFree->Wait();
+    if(fPrefetchStop)
+    {
+      fPrefetchMutex->UnLock();
+      break;
+    }
+    bundle = &fBundles[fBundleHead];
+    fPrefetchMutex->UnLock();
+
+    // the free slot belongs to this thread until it is published,
+    // an error is passed to Process and stops the thread
+    try
+    {
+      FillBundle(bundle);
+    }
+    catch(exception &e)
+    {
+      error = e.what();
+    }
+
+    fPrefetchMutex->Lock();
+    if(!error.empty())
+    {
+      fPrefetchError = error;
+      fBundleReady->Signal();
+      fPrefetchMutex->UnLock();
+      break;
+    }
+    fBundleHead = (fBundleHead + 1) % fPrefetchDepth;
+    ++fBundleCount;
+    fBundleReady->Signal();
+    fPrefetchMutex->UnLock();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMerger::FillBundle(PileUpBundle *bundle)
+{
+  TRandom *random = fPrefetchRandom;
+  Int_t event;
+  Long64_t allEntries, entry, first, size;
+
+  // same sequence of random numbers as in Process
+  bundle->poisson = random->Poisson(fMeanPileUp);
+  bundle->properties = kTRUE;
+
+  bundle->dz.resize(bundle->poisson);
+  bundle->dphi.resize(bundle->poisson);
+  bundle->dt.resize(bundle->poisson);
+  bundle->begin.assign(1, 0);
+
+  bundle->pid.clear(); bundle->charge.clear(); bundle->mass.clear();
+  bundle->x.clear(); bundle->y.clear(); bundle->z.clear(); bundle->t.clear();
+  bundle->px.clear(); bundle->py.clear(); bundle->pz.clear(); bundle->e.clear();
+
+  allEntries = fReader->GetEntries();
+  for(event = 0; event < bundle->poisson; ++event)
+  {
+    do
+    {
+      entry = TMath::Nint(random->Rndm()*allEntries);
+    }
+    while(entry >= allEntries);
+
+    fReader->ReadEntry(entry);
+
+    first = bundle->pid.size();
+    size = fReader->GetEntrySize();
+
+    bundle->pid.resize(first + size); bundle->charge.resize(first + size); bundle->mass.resize(first + size);
+    bundle->x.resize(first + size); bundle->y.resize(first + size); bundle->z.resize(first + size); bundle->t.resize(first + size);
+    bundle->px.resize(first + size); bundle->py.resize(first + size); bundle->pz.resize(first + size); bundle->e.resize(first + size);
+
+    if(size > 0)
+    {
+      fReader->ReadParticles(&bundle->pid[first],
+        &bundle->x[first], &bundle->y[first], &bundle->z[first], &bundle->t[first],
+        &bundle->px[first], &bundle->py[first], &bundle->pz[first], &bundle->e[first]);
+
+      // version 1 files have no charge and mass, they are looked up in Process
+      if(!fReader->ReadProperties(&bundle->charge[first], &bundle->mass[first])) bundle->properties = kFALSE;
+    }
+
+    bundle->begin.push_back(first + size);
+
+    bundle->dz[event] = random->Gaus(0.0, fZVertexSpread);
+    bundle->dphi[event] = random->Uniform(-TMath::Pi(), TMath::Pi());
+    bundle->dt[event] = random->Gaus(0., fZVertexSpread*(mm/ns)/c_light);
+  }
 }
 
 //------------------------------------------------------------------------------
 
 void PileUpMerger::Process()
 {
-  TDatabasePDG *pdg = TDatabasePDG::Instance();
-  TParticlePDG *pdgParticle;
-  Int_t pid;
-  Float_t x, y, z, t;
-  Float_t px, py, pz, e;
-  Double_t dz, dt, dphi;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
+  const Int_t *pid = 0, *charge = 0;
+  const Float_t *mass = 0, *px = 0, *py = 0, *pz = 0, *e = 0, *xv = 0, *yv = 0;
+  Float_t x, y;
+  Double_t dz, dt, dphi, pt2, p;
+  Bool_t orderedByPT;
   Int_t poisson, event;
-  Long64_t allEntries, entry;
+  Long64_t allEntries, entry, i, begin, end;
   Candidate *candidate;
   DelphesFactory *factory;
+  PileUpBundle *bundle = 0;
 
   fItInputArray->Reset();
   while((candidate = static_cast<Candidate*>(fItInputArray->Next())))
@@ -110,44 +376,190 @@ void PileUpMerger::Process()
     fOutputArray->Add(candidate);
   }
 
+  fSamplingTime->Start(kFALSE);
+
   factory = GetFactory();
-  poisson = gRandom->Poisson(fMeanPileUp);
 
-  allEntries = fReader->GetEntries();
+  if(fBundles)
+  {
+    // wait for the background thread if it is behind
+    fPrefetchMutex->Lock();
+    if(fBundleCount == 0)
+    {
+      ++fStalls;
+      fStallTime->Start(kFALSE);
+      while(fBundleCount == 0 && fPrefetchError.empty()) fBundleReady->Wait();
+      fStallTime->Stop();
+    }
+    if(fBundleCount == 0)
+    {
+      // bundles filled before the error are used first
+      fPrefetchMutex->UnLock();
+      fSamplingTime->Stop();
+      stringstream message;
+      message << "pile-up prefetch failed: " << fPrefetchError;
+      throw runtime_error(message.str());
+    }
+    bundle = &fBundles[fBundleTail];
+    fPrefetchMutex->UnLock();
+
+    poisson = bundle->poisson;
+    orderedByPT = fReader->IsOrderedByPT();
+    pid = 0; charge = 0; mass = 0;
+    if(!bundle->pid.empty())
+    {
+      pid = &bundle->pid[0];
+      if(bundle->properties)
+      {
+        charge = &bundle->charge[0];
+        mass = &bundle->mass[0];
+      }
+      xv = &bundle->x[0]; yv = &bundle->y[0];
+      px = &bundle->px[0]; py = &bundle->py[0]; pz = &bundle->pz[0]; e = &bundle->e[0];
+    }
+  }
+  else
+  {
+    poisson = gRandom->Poisson(fMeanPileUp);
+
+    if(fPool)
+    {
+      allEntries = fPool->GetEntries();
+      pid = fPool->GetPID(); charge = fPool->GetCharge(); mass = fPool->GetMass();
+      xv = fPool->GetX(); yv = fPool->GetY();
+      px = fPool->GetPx(); py = fPool->GetPy(); pz = fPool->GetPz(); e = fPool->GetE();
+      orderedByPT = fPool->IsOrderedByPT();
+    }
+    else
+    {
+      allEntries = fReader->GetEntries();
+      orderedByPT = fReader->IsOrderedByPT();
+      charge = 0;
+      mass = 0;
+    }
+  }
+
   for(event = 0; event < poisson; ++event)
   {
-    do
+    if(bundle)
     {
-      entry = TMath::Nint(gRandom->Rndm()*allEntries);
+      // already drawn and read in the background
+      begin = bundle->begin[event];
+      end = bundle->begin[event + 1];
+
+      dz = bundle->dz[event];
+      dphi = bundle->dphi[event];
+      dt = bundle->dt[event];
+    }
+    else
+    {
+      do
+      {
+        entry = TMath::Nint(gRandom->Rndm()*allEntries);
+      }
+      while(entry >= allEntries);
+
+      if(fPool)
+      {
+        // the event is a range of the pool arrays
+        begin = fPool->GetBegin(entry);
+        end = fPool->GetEnd(entry);
+      }
+      else
+      {
+        fReader->ReadEntry(entry);
+
+        begin = 0;
+        end = fReader->GetEntrySize();
+        if(end > Long64_t(fPID.size()))
+        {
+          fPID.resize(end);
+          fX.resize(end); fY.resize(end); fZ.resize(end); fT.resize(end);
+          fPx.resize(end); fPy.resize(end); fPz.resize(end); fE.resize(end);
+          fCharge.resize(end); fMass.resize(end);
+        }
+        if(end > 0)
+        {
+          fReader->ReadParticles(&fPID[0], &fX[0], &fY[0], &fZ[0], &fT[0], &fPx[0], &fPy[0], &fPz[0], &fE[0]);
+          pid = &fPID[0];
+          xv = &fX[0]; yv = &fY[0];
+          px = &fPx[0]; py = &fPy[0]; pz = &fPz[0]; e = &fE[0];
+
+          // version 2 files store charge and mass
+          if(fReader->ReadProperties(&fCharge[0], &fMass[0]))
+          {
+            charge = &fCharge[0];
+            mass = &fMass[0];
+          }
+        }
+      }
+
+      dz = gRandom->Gaus(0.0, fZVertexSpread);
+      dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
+      dt = gRandom->Gaus(0., fZVertexSpread*(mm/ns)/c_light);
     }
-    while(entry >= allEntries);
 
-    fReader->ReadEntry(entry);
+    ++fSampledEvents;
+    fSampledParticles += end - begin;
+
+    for(i = begin; i < end; ++i)
+    {
+      if(fPTMin > 0.0)
+      {
+        pt2 = px[i]*px[i] + py[i]*py[i];
+        if(pt2 <= fPTMin2)
+        {
+          // all the following particles are softer
+          if(orderedByPT)
+          {
+            fSkippedPT += end - i;
+            break;
+          }
+          ++fSkippedPT;
+          continue;
+        }
+      }
+
+      if(fEtaMax > 0.0)
+      {
+        p = TMath::Sqrt(px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i]);
+        if(TMath::Abs(pz[i]) >= fPzFractionMax*p)
+        {
+          ++fSkippedEta;
+          continue;
+        }
+      }
+
+      if(!fSkipPID.empty() && binary_search(fSkipPID.begin(), fSkipPID.end(), TMath::Abs(pid[i])))
+      {
+        ++fSkippedPID;
+        continue;
+      }
 
-    dz = gRandom->Gaus(0.0, fZVertexSpread);
-    dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
-    dt = gRandom->Gaus(0., fZVertexSpread*(mm/ns)/c_light);
-   
-     
-    while(fReader->ReadParticle(pid, x, y, z, t, px, py, pz, e))
-    {  
       candidate = factory->NewCandidate();
 
       // Get rid of BS position in PU
       // To deal with http://red-gridftp11.unl.edu/Snowmass/MinBias100K_14TeV.pileup fInputBSX = 2.44 and fInputBSY = 3.93
-      x = x - fInputBSX;
-      y = y - fInputBSY;
+      x = xv[i] - fInputBSX;
+      y = yv[i] - fInputBSY;
 
-      candidate->PID = pid;
+      candidate->PID = pid[i];
 
       candidate->Status = 1;
-      pdgParticle = pdg->GetParticle(pid);
-      candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
-      candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+      if(charge)
+      {
+        candidate->Charge = charge[i];
+        candidate->Mass = mass[i];
+      }
+      else
+      {
+        candidate->Charge = pdg->GetCharge(pid[i]);
+        candidate->Mass = pdg->GetMass(pid[i]);
+      }
 
       candidate->IsPU = event+1; // might as well store which PU vertex this comes from so they can be separated
 
-      candidate->Momentum.SetPxPyPzE(px, py, pz, e);
+      candidate->Momentum.SetPxPyPzE(px[i], py[i], pz[i], e[i]);
       candidate->Momentum.RotateZ(dphi);
 
       candidate->Position.SetXYZT(x,y,dz,dt); // Use CMSSW dz,dt (ignoring old values), keep x y
@@ -162,6 +574,18 @@ void PileUpMerger::Process()
     }
   }
 
+  fSamplingTime->Stop();
+
+  // hand the slot back to the background thread
+  if(bundle)
+  {
+    fPrefetchMutex->Lock();
+    fBundleTail = (fBundleTail + 1) % fPrefetchDepth;
+    --fBundleCount;
+    fBundleFree->Signal();
+    fPrefetchMutex->UnLock();
+  }
+
   // Store true number of pileup vertices
   candidate = factory->NewCandidate();
   candidate->Momentum.SetPtEtaPhiE((float)poisson, 0.0, 0.0, (float)poisson); // cheating and storing NPU as a float
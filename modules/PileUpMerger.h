@@ -17,8 +17,18 @@
 #include "classes/DelphesModule.h"
 #include "TRandom3.h"
 
+#include <vector>
+#include <string>
+
 class TObjArray;
+class TStopwatch;
+class TThread;
+class TMutex;
+class TCondition;
 class DelphesPileUpReader;
+class DelphesPileUpPool;
+
+struct PileUpBundle;
 
 class PileUpMerger: public DelphesModule
 {
@@ -33,14 +43,55 @@ public:
 
 private:
 
+  static void *PrefetchThread(void *merger);
+
+  void Prefetch();
+  void FillBundle(PileUpBundle *bundle);
+
   Double_t fMeanPileUp;
   Double_t fZVertexSpread;
 
   Double_t fInputBSX, fInputBSY;
   Double_t fOutputBSX, fOutputBSY;
 
+  // acceptance applied to pile-up particles before candidates are created
+  Double_t fPTMin, fEtaMax;
+  Double_t fPTMin2, fPzFractionMax;
+  std::vector<Int_t> fSkipPID; //!
+
+  Long64_t fSkippedPT, fSkippedEta, fSkippedPID;
+
   DelphesPileUpReader *fReader;
 
+  // whole library decoded at Init, shared with other instances
+  DelphesPileUpPool *fPool; //!
+
+  TStopwatch *fSamplingTime; //!
+  Long64_t fSampledEvents, fSampledParticles;
+
+  // pile-up of the next PrefetchDepth events, drawn and read by a background thread
+  Int_t fPrefetchDepth;
+  PileUpBundle *fBundles; //!
+  Int_t fBundleHead, fBundleTail, fBundleCount;
+  Bool_t fPrefetchStop;
+  std::string fPrefetchError; //!
+
+  TRandom3 *fPrefetchRandom; //!
+  TThread *fPrefetchThread; //!
+  TMutex *fPrefetchMutex; //!
+  TCondition *fBundleReady; //!
+  TCondition *fBundleFree; //!
+
+  TStopwatch *fStallTime; //!
+  Long64_t fStalls;
+
+  // particles of the current pile-up event, decoded at once
+  std::vector<Int_t> fPID; //!
+  std::vector<Float_t> fX, fY, fZ, fT; //!
+  std::vector<Float_t> fPx, fPy, fPz, fE; //!
+  std::vector<Int_t> fCharge; //!
+  std::vector<Float_t> fMass; //!
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
@@ -49,7 +100,7 @@ private:
 
   TObjArray *fNPUOutputArray; //!                                                                                                                                                    
 
-  ClassDef(PileUpMerger, 2)
+  ClassDef(PileUpMerger, 4)
 };
 
 #endif
@@ -17,6 +17,7 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 #include "classes/DelphesPileUpReader.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -29,8 +30,13 @@
 #include "TFormula.h"
 #include "TRandom3.h"
 #include "TObjArray.h"
-#include "TDatabasePDG.h"
 #include "TLorentzVector.h"
+#include "TStopwatch.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
+
+#include "ExRootAnalysis/ExRootConfReader.h"
 
 #include <algorithm>
 #include <stdexcept>
@@ -41,15 +47,85 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
+// visible stable particles of one pile-up vertex
+
+struct PileUpVertex
+{
+  vector<Int_t> pid;
+  vector<Float_t> x, y, z, t;
+  vector<Float_t> px, py, pz, e;
+
+  void Swap(PileUpVertex &other)
+  {
+    pid.swap(other.pid);
+    x.swap(other.x); y.swap(other.y); z.swap(other.z); t.swap(other.t);
+    px.swap(other.px); py.swap(other.py); pz.swap(other.pz); e.swap(other.e);
+  }
+};
+
+//------------------------------------------------------------------------------
+
+// one generator with its queue of vertices, read in turn by Process
+
+struct PileUpWorker
+{
+  Pythia8::Pythia *pythia;
+  Double_t ptMin;
+
+  TThread *thread;
+  TMutex *mutex;
+  TCondition *ready, *free;
+
+  vector<PileUpVertex> queue;
+  Int_t head, tail, count;
+  Bool_t stop;
+
+  Long64_t generated, waits;
+};
+
+//------------------------------------------------------------------------------
+
+static void FillVertex(Pythia8::Pythia *pythia, Double_t ptMin, PileUpVertex &vertex)
+{
+  Int_t i;
+
+  vertex.pid.clear();
+  vertex.x.clear(); vertex.y.clear(); vertex.z.clear(); vertex.t.clear();
+  vertex.px.clear(); vertex.py.clear(); vertex.pz.clear(); vertex.e.clear();
+
+  for(i = 0; i < pythia->event.size(); ++i)
+  {
+    Pythia8::Particle &particle = pythia->event[i];
+
+    if(particle.status() != 1 || !particle.isVisible() || particle.pT() <= ptMin) continue;
+
+    vertex.pid.push_back(particle.id());
+    vertex.x.push_back(particle.xProd()); vertex.y.push_back(particle.yProd());
+    vertex.z.push_back(particle.zProd()); vertex.t.push_back(particle.tProd());
+    vertex.px.push_back(particle.px()); vertex.py.push_back(particle.py());
+    vertex.pz.push_back(particle.pz()); vertex.e.push_back(particle.e());
+  }
+}
+
+//------------------------------------------------------------------------------
+
 PileUpMergerPythia8::PileUpMergerPythia8() :
-  fPythia(0), fItInputArray(0)
+  fPythia(0), fVertex(0), fNumberOfThreads(0), fQueueSize(0),
+  fWorkers(0), fNextWorker(0), fRunTime(0), fStallTime(0),
+  fItInputArray(0)
 {
+  fVertex = new PileUpVertex;
+  fRunTime = new TStopwatch;
+  fStallTime = new TStopwatch;
 }
 
 //------------------------------------------------------------------------------
 
 PileUpMergerPythia8::~PileUpMergerPythia8()
 {
+  if(fStallTime) delete fStallTime;
+  if(fRunTime) delete fRunTime;
+  if(fVertex) delete fVertex;
 }
 
 //------------------------------------------------------------------------------
@@ -57,6 +133,9 @@ PileUpMergerPythia8::~PileUpMergerPythia8()
 void PileUpMergerPythia8::Init()
 {
   const char *fileName;
+  stringstream message, seed;
+  Int_t i, randomSeed;
+  PileUpWorker *worker;
 
   fMeanPileUp  = GetDouble("MeanPileUp", 10);
   fZVertexSpread = GetDouble("ZVertexSpread", 0.05)*1.0E3;
@@ -64,8 +143,66 @@ void PileUpMergerPythia8::Init()
   fPTMin = GetDouble("PTMin", 0.0);
 
   fileName = GetString("ConfigFile", "MinBias.cmnd");
-  fPythia = new Pythia8::Pythia();
-  fPythia->readFile(fileName);
+
+  fNumberOfThreads = GetInt("NumberOfThreads", 0);
+  fQueueSize = GetInt("QueueSize", 16);
+  fStalls = 0;
+  fConsumed = 0;
+
+  if(fNumberOfThreads <= 0)
+  {
+    fPythia = new Pythia8::Pythia();
+    fPythia->readFile(fileName);
+  }
+  else
+  {
+    // worker i is seeded with RandomSeed + i + 1, vertices are taken from the
+    // workers in turn so that the sequence does not depend on thread timing
+    randomSeed = GetInt("RandomSeed", GetConfReader()->GetInt("::RandomSeed", 0));
+
+    TThread::Initialize();
+    fWorkers = new PileUpWorker[fNumberOfThreads];
+    for(i = 0; i < fNumberOfThreads; ++i)
+    {
+      worker = &fWorkers[i];
+      worker->ptMin = fPTMin;
+      worker->queue.resize(max(1, fQueueSize/fNumberOfThreads));
+      worker->head = 0;
+      worker->tail = 0;
+      worker->count = 0;
+      worker->stop = kFALSE;
+      worker->generated = 0;
+      worker->waits = 0;
+
+      seed.str("");
+      seed << "Random:seed = " << (randomSeed + i + 1) % 900000000;
+
+      worker->pythia = new Pythia8::Pythia();
+      worker->pythia->readFile(fileName);
+      worker->pythia->readString("Random:setSeed = on");
+      worker->pythia->readString(seed.str());
+
+      if(!worker->pythia->init())
+      {
+        message << "can't initialize Pythia with " << fileName;
+        throw runtime_error(message.str());
+      }
+
+      worker->mutex = new TMutex;
+      worker->ready = new TCondition(worker->mutex);
+      worker->free = new TCondition(worker->mutex);
+      worker->thread = new TThread(GenerateThread, worker);
+    }
+
+    for(i = 0; i < fNumberOfThreads; ++i)
+    {
+      fWorkers[i].thread->Run();
+    }
+  }
+
+  fNextWorker = 0;
+  fStallTime->Reset();
+  fRunTime->Start();
 
   // import input array
   fInputArray = ImportArray(GetString("InputArray", "Delphes/stableParticles"));
@@ -79,20 +216,123 @@ void PileUpMergerPythia8::Init()
 
 void PileUpMergerPythia8::Finish()
 {
+  PileUpWorker *worker;
+  Long64_t generated = 0, waits = 0;
+  Double_t time;
+  Int_t i;
+
+  fRunTime->Stop();
+  time = fRunTime->RealTime();
+
+  if(fWorkers)
+  {
+    for(i = 0; i < fNumberOfThreads; ++i)
+    {
+      worker = &fWorkers[i];
+
+      worker->mutex->Lock();
+      worker->stop = kTRUE;
+      worker->free->Signal();
+      worker->mutex->UnLock();
+
+      worker->thread->Join();
+
+      generated += worker->generated;
+      waits += worker->waits;
+
+      delete worker->thread;
+      delete worker->free;
+      delete worker->ready;
+      delete worker->mutex;
+      delete worker->pythia;
+    }
+    delete[] fWorkers;
+    fWorkers = 0;
+
+    // stalls mean the generators are too slow, waits that they are ahead
+    if(time > 0.0)
+    {
+      cout << "** INFO: pile-up vertices generated at " << generated/time << " per s, ";
+      cout << "consumed at " << fConsumed/time << " per s" << endl;
+    }
+    cout << "** INFO: pile-up merger stalled " << fStalls << " times (" << fStallTime->RealTime() << " s), ";
+    cout << "generators waited on full queues " << waits << " times" << endl;
+  }
+
   if(fPythia) delete fPythia;
+  fPythia = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void *PileUpMergerPythia8::GenerateThread(void *arg)
+{
+  PileUpWorker *worker = static_cast<PileUpWorker *>(arg);
+  PileUpVertex vertex;
+
+  while(true)
+  {
+    while(!worker->pythia->next());
+
+    FillVertex(worker->pythia, worker->ptMin, vertex);
+
+    worker->mutex->Lock();
+    while(worker->count == Int_t(worker->queue.size()) && !worker->stop)
+    {
+      ++worker->waits;
+      worker->free->Wait();
+    }
+    if(worker->stop)
+    {
+      worker->mutex->UnLock();
+      break;
+    }
+    worker->queue[worker->head].Swap(vertex);
+    worker->head = (worker->head + 1) % worker->queue.size();
+    ++worker->count;
+    ++worker->generated;
+    worker->ready->Signal();
+    worker->mutex->UnLock();
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PileUpMergerPythia8::NextVertex()
+{
+  PileUpWorker *worker = &fWorkers[fNextWorker];
+
+  fNextWorker = (fNextWorker + 1) % fNumberOfThreads;
+
+  worker->mutex->Lock();
+  if(worker->count == 0)
+  {
+    ++fStalls;
+    fStallTime->Start(kFALSE);
+    while(worker->count == 0) worker->ready->Wait();
+    fStallTime->Stop();
+  }
+  worker->queue[worker->tail].Swap(*fVertex);
+  worker->tail = (worker->tail + 1) % worker->queue.size();
+  --worker->count;
+  worker->free->Signal();
+  worker->mutex->UnLock();
+
+  ++fConsumed;
 }
 
 //------------------------------------------------------------------------------
 
 void PileUpMergerPythia8::Process()
 {
-  TDatabasePDG *pdg = TDatabasePDG::Instance();
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg = DelphesPDGTable::Instance();
   Int_t pid;
   Float_t x, y, z, t;
   Float_t px, py, pz, e;
   Double_t dz, dphi;
-  Int_t poisson, event, i;
+  Int_t poisson, event, i, size;
   Candidate *candidate;
   DelphesFactory *factory;
 
@@ -108,20 +348,25 @@ void PileUpMergerPythia8::Process()
 
   for(event = 0; event < poisson; ++event)
   {
-    while(!fPythia->next());
+    if(fWorkers)
+    {
+      NextVertex();
+    }
+    else
+    {
+      while(!fPythia->next());
+      FillVertex(fPythia, fPTMin, *fVertex);
+    }
 
     dz = gRandom->Gaus(0.0, fZVertexSpread);
     dphi = gRandom->Uniform(-TMath::Pi(), TMath::Pi());
 
-    for(i = 0; i < fPythia->event.size(); ++i)
+    size = fVertex->pid.size();
+    for(i = 0; i < size; ++i)
     {
-      Pythia8::Particle &particle = fPythia->event[i];
-
-      if(particle.status() != 1 || !particle.isVisible() || particle.pT() <= fPTMin) continue;
-
-      pid = particle.id();
-      px = particle.px(); py = particle.py(); pz = particle.pz(); e = particle.e();
-      x = particle.xProd(); y = particle.yProd(); z = particle.zProd(); t = particle.tProd();
+      pid = fVertex->pid[i];
+      px = fVertex->px[i]; py = fVertex->py[i]; pz = fVertex->pz[i]; e = fVertex->e[i];
+      x = fVertex->x[i]; y = fVertex->y[i]; z = fVertex->z[i]; t = fVertex->t[i];
 
       candidate = factory->NewCandidate();
 
@@ -129,9 +374,8 @@ void PileUpMergerPythia8::Process()
 
       candidate->Status = 1;
 
-      pdgParticle = pdg->GetParticle(pid);
-      candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
-      candidate->Mass = pdgParticle ? pdgParticle->Mass() : -999.9;
+      candidate->Charge = pdg->GetCharge(pid);
+      candidate->Mass = pdg->GetMass(pid);
 
       candidate->IsPU = 1;
 
@@ -17,6 +17,10 @@
 #include "classes/DelphesModule.h"
 
 class TObjArray;
+class TStopwatch;
+
+struct PileUpVertex;
+struct PileUpWorker;
 
 namespace Pythia8
 {
@@ -36,19 +40,36 @@ public:
 
 private:
 
+  static void *GenerateThread(void *worker);
+
+  void NextVertex();
+
   Double_t fMeanPileUp;
   Double_t fZVertexSpread;
   Double_t fPTMin;
 
   Pythia8::Pythia *fPythia; //!
 
+  // filtered particles of the current pile-up vertex
+  PileUpVertex *fVertex; //!
+
+  // independently seeded generators on worker threads, each filling its own queue
+  Int_t fNumberOfThreads;
+  Int_t fQueueSize;
+  PileUpWorker *fWorkers; //!
+  Int_t fNextWorker;
+
+  TStopwatch *fRunTime; //!
+  TStopwatch *fStallTime; //!
+  Long64_t fStalls, fConsumed;
+
   TIterator *fItInputArray; //!
 
   const TObjArray *fInputArray; //!
 
   TObjArray *fOutputArray; //!
 
-  ClassDef(PileUpMergerPythia8, 1)
+  ClassDef(PileUpMergerPythia8, 2)
 };
 
 #endif
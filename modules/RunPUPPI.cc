@@ -9,6 +9,8 @@
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
 
+#include "TThread.h"
+
 #include <algorithm> 
 #include <stdexcept>
 #include <iostream>
@@ -20,7 +22,9 @@ using namespace std;
 //------------------------------------------------------------------------------
 RunPUPPI::RunPUPPI() :
   fItTrackInputArray(0), 
-  fItNeutralInputArray(0)
+  fItNeutralInputArray(0),
+  fRecoObjects(0),
+  fPuppiContainer(0)
 {}
 
 //------------------------------------------------------------------------------
@@ -43,6 +47,10 @@ void RunPUPPI::Init(){
   fMinPuppiWeight = GetFloat("MinPuppiWeight",0.01);
   fUseExp         = GetBool("UseExp",false);
 
+  // threads used to compute the puppi metric of the particles
+  fNumberOfThreads = GetInt("NumberOfThreads",1);
+  if(fNumberOfThreads > 1) TThread::Initialize();
+
   // read eta min ranges                                                                                                                                                           
   ExRootConfParam param = GetParam("EtaMinBin");
   fEtaMinBin.clear();
@@ -103,10 +111,43 @@ void RunPUPPI::Init(){
   fMetricId.clear();
   for(int iMap = 0; iMap < param.GetSize(); ++iMap) fMetricId.push_back(param[iMap].GetInt());
 
+  // Create algorithm list for puppi
+  if(!(fEtaMinBin.size() == fEtaMaxBin.size() and fEtaMinBin.size() == fPtMinBin.size() and fEtaMinBin.size() == fConeSizeBin.size() and fEtaMinBin.size() == fRMSPtMinBin.size()
+       and fEtaMinBin.size() == fRMSScaleFactorBin.size() and fEtaMinBin.size() == fNeutralMinEBin.size() and  fEtaMinBin.size() == fNeutralPtSlope.size() 
+       and fEtaMinBin.size() == fApplyCHS.size()  and fEtaMinBin.size() == fUseCharged.size()
+       and fEtaMinBin.size() == fApplyLowPUCorr.size() and fEtaMinBin.size() == fMetricId.size())) {
+    throw runtime_error("Error in PUPPI configuration, algo info should have the same size");
+  } 
+
+  std::vector<puppiAlgoBin> puppiAlgo;
+  for( size_t iAlgo =  0 ; iAlgo < fEtaMinBin.size() ; iAlgo++){
+    puppiAlgoBin algoTmp ;
+    algoTmp.fEtaMin_ = fEtaMinBin.at(iAlgo);
+    algoTmp.fEtaMax_ = fEtaMaxBin.at(iAlgo);
+    algoTmp.fPtMin_  = fPtMinBin.at(iAlgo);
+    algoTmp.fConeSize_        = fConeSizeBin.at(iAlgo);
+    algoTmp.fRMSPtMin_        = fRMSPtMinBin.at(iAlgo);
+    algoTmp.fRMSScaleFactor_  = fRMSScaleFactorBin.at(iAlgo);
+    algoTmp.fNeutralMinE_     = fNeutralMinEBin.at(iAlgo);
+    algoTmp.fNeutralPtSlope_  = fNeutralPtSlope.at(iAlgo);
+    algoTmp.fApplyCHS_        = fApplyCHS.at(iAlgo);
+    algoTmp.fUseCharged_      = fUseCharged.at(iAlgo);
+    algoTmp.fApplyLowPUCorr_  = fApplyLowPUCorr.at(iAlgo);
+    algoTmp.fMetricId_        = fMetricId.at(iAlgo);
+    if(std::find(puppiAlgo.begin(),puppiAlgo.end(),algoTmp) != puppiAlgo.end()) continue;    
+    puppiAlgo.push_back(algoTmp);     
+  }
+
+  // Create PUPPI container, kept for all the events
+  fPuppiContainer = new puppiCleanContainer(puppiAlgo,fMinPuppiWeight,fUseExp);
+  fPuppiContainer->setNumberOfThreads(fNumberOfThreads);
+
   // create output array
   fOutputArray        = ExportArray(GetString("OutputArray", "puppiParticles"));
   fOutputTrackArray   = ExportArray(GetString("OutputArrayTracks", "puppiTracks"));
   fOutputNeutralArray = ExportArray(GetString("OutputArrayNeutrals", "puppiNeutrals"));
+
+  fRecoObjects = new RecoObjCollection;
 }
 
 //------------------------------------------------------------------------------
@@ -114,6 +155,8 @@ void RunPUPPI::Init(){
 void RunPUPPI::Finish(){
   if(fItTrackInputArray)   delete fItTrackInputArray;
   if(fItNeutralInputArray) delete fItNeutralInputArray;
+  if(fRecoObjects)         delete fRecoObjects;
+  if(fPuppiContainer)      delete fPuppiContainer;
 }
 
 //------------------------------------------------------------------------------
@@ -121,142 +164,83 @@ void RunPUPPI::Finish(){
 void RunPUPPI::Process(){
 
   Candidate *candidate, *particle;
-  TLorentzVector momentum;
-
-  DelphesFactory *factory = GetFactory();
+  int id, vtxId, pfType;
+  size_t i;
 
   // loop over input objects
   fItTrackInputArray->Reset();
   fItNeutralInputArray->Reset();
   fPVItInputArray->Reset();
 
-  std::vector<Candidate> InputParticles;
-  InputParticles.clear();
-
   // take the leading vertex 
   float PVZ = 0.;
   Candidate *pv = static_cast<Candidate*>(fPVItInputArray->Next());
   if (pv) PVZ = pv->Position.Z();
 
-  // Fill input particles for puppi
-  std::vector<RecoObj> puppiInputVector;
+  // Fill input particles for puppi: only pointers to the candidates are kept
+  fInputCandidates.clear();
+  fRecoObjects->clear();
+  fRecoObjects->reserve(fTrackInputArray->GetEntriesFast() + fNeutralInputArray->GetEntriesFast());
 
   // Loop on charge track candidate
   while((candidate = static_cast<Candidate*>(fItTrackInputArray->Next()))){   
 
-      momentum = candidate->Momentum;
-      
-      RecoObj curRecoObj;
-      curRecoObj.pt  = momentum.Pt();
-      curRecoObj.eta = momentum.Eta();
-      curRecoObj.phi = momentum.Phi();
-      curRecoObj.m   = momentum.M();  
       particle = static_cast<Candidate*>(candidate->GetCandidates()->Last());
       if (candidate->IsRecoPU and candidate->Charge !=0) { // if it comes fromPU vertexes after the resolution smearing and the dZ matching within resolution
-	curRecoObj.id    = 2;
-	curRecoObj.vtxId = candidate->IsPU;
-	if(TMath::Abs(candidate->PID) == 11)      curRecoObj.pfType = 2;
-	else if(TMath::Abs(candidate->PID) == 13) curRecoObj.pfType = 3;
-	else if(TMath::Abs(candidate->PID) == 22) curRecoObj.pfType = 4;
-        else curRecoObj.pfType = 1;
-        curRecoObj.dZ = particle->Position.Z()-PVZ;
+	id    = 2;
+	vtxId = candidate->IsPU;
       } 
       else if(!candidate->IsRecoPU and candidate->Charge !=0) {
-	curRecoObj.id    = 1;  // charge from LV
-        curRecoObj.vtxId = 1; // from PV
-	if(TMath::Abs(candidate->PID) == 11)      curRecoObj.pfType = 2;
-	else if(TMath::Abs(candidate->PID) == 13) curRecoObj.pfType = 3;
-	else if(TMath::Abs(candidate->PID) == 22) curRecoObj.pfType = 4;
-        else curRecoObj.pfType = 1;
-        curRecoObj.dZ = particle->Position.Z()-PVZ;
+	id    = 1;  // charge from LV
+        vtxId = 1; // from PV
       }
       else {
 	std::cerr<<" RunPUPPI: problem with a charged track --> it has charge 0 "<<std::endl;
         continue;
       }
 
-      puppiInputVector.push_back(curRecoObj);
-      InputParticles.push_back(*candidate);
+      if(TMath::Abs(candidate->PID) == 11)      pfType = 2;
+      else if(TMath::Abs(candidate->PID) == 13) pfType = 3;
+      else if(TMath::Abs(candidate->PID) == 22) pfType = 4;
+      else pfType = 1;
+
+      fRecoObjects->push_back(candidate->Momentum.Pt(), candidate->Momentum.Eta(), candidate->Momentum.Phi(), candidate->Momentum.M(),
+                              pfType, vtxId, id, particle->Position.Z()-PVZ);
+      fInputCandidates.push_back(candidate);
   }
 
   // Loop on neutral calo cells 
   while((candidate = static_cast<Candidate*>(fItNeutralInputArray->Next()))){
 
-      momentum = candidate->Momentum;
-
-      RecoObj curRecoObj;
-      curRecoObj.pt  = momentum.Pt();
-      curRecoObj.eta = momentum.Eta();
-      curRecoObj.phi = momentum.Phi();
-      curRecoObj.m   = momentum.M();
       particle = static_cast<Candidate*>(candidate->GetCandidates()->Last());
 
-
-      if(candidate->Charge == 0){
-	curRecoObj.id    = 0; // neutrals have id==0
-	curRecoObj.vtxId = 0; // neutrals have vtxId==0 
-	if(TMath::Abs(candidate->PID) == 11)      curRecoObj.pfType = 2;
-	else if(TMath::Abs(candidate->PID) == 13) curRecoObj.pfType = 3;
-	else if(TMath::Abs(candidate->PID) == 22) curRecoObj.pfType = 4;
-        else curRecoObj.pfType = 5;
-        curRecoObj.dZ = particle->Position.Z()-PVZ;
-      }
-      else{
+      if(candidate->Charge != 0){
 	std::cerr<<" RunPUPPI: problem with a neutrals cells --> it has charge !=0 "<<std::endl;
         continue;
       }
-      puppiInputVector.push_back(curRecoObj);
-      InputParticles.push_back(*candidate);
-  }
 
-  // Create algorithm list for puppi
-  std::vector<puppiAlgoBin> puppiAlgo;
-  if(puppiAlgo.empty()){
-   if(!(fEtaMinBin.size() == fEtaMaxBin.size() and fEtaMinBin.size() == fPtMinBin.size() and fEtaMinBin.size() == fConeSizeBin.size() and fEtaMinBin.size() == fRMSPtMinBin.size()
-       and fEtaMinBin.size() == fRMSScaleFactorBin.size() and fEtaMinBin.size() == fNeutralMinEBin.size() and  fEtaMinBin.size() == fNeutralPtSlope.size() 
-       and fEtaMinBin.size() == fApplyCHS.size()  and fEtaMinBin.size() == fUseCharged.size()
-       and fEtaMinBin.size() == fApplyLowPUCorr.size() and fEtaMinBin.size() == fMetricId.size())) {
-    std::cerr<<" Error in PUPPI configuration, algo info should have the same size --> exit from the code"<<std::endl;
-    std::exit(EXIT_FAILURE);
-   } 
+      // neutrals have id==0 and vtxId==0
+      if(TMath::Abs(candidate->PID) == 11)      pfType = 2;
+      else if(TMath::Abs(candidate->PID) == 13) pfType = 3;
+      else if(TMath::Abs(candidate->PID) == 22) pfType = 4;
+      else pfType = 5;
 
-   for( size_t iAlgo =  0 ; iAlgo < fEtaMinBin.size() ; iAlgo++){
-    puppiAlgoBin algoTmp ;
-    algoTmp.fEtaMin_ = fEtaMinBin.at(iAlgo);
-    algoTmp.fEtaMax_ = fEtaMaxBin.at(iAlgo);
-    algoTmp.fPtMin_  = fPtMinBin.at(iAlgo);
-    algoTmp.fConeSize_        = fConeSizeBin.at(iAlgo);
-    algoTmp.fRMSPtMin_        = fRMSPtMinBin.at(iAlgo);
-    algoTmp.fRMSScaleFactor_  = fRMSScaleFactorBin.at(iAlgo);
-    algoTmp.fNeutralMinE_     = fNeutralMinEBin.at(iAlgo);
-    algoTmp.fNeutralPtSlope_  = fNeutralPtSlope.at(iAlgo);
-    algoTmp.fApplyCHS_        = fApplyCHS.at(iAlgo);
-    algoTmp.fUseCharged_      = fUseCharged.at(iAlgo);
-    algoTmp.fApplyLowPUCorr_  = fApplyLowPUCorr.at(iAlgo);
-    algoTmp.fMetricId_        = fMetricId.at(iAlgo);
-    if(std::find(puppiAlgo.begin(),puppiAlgo.end(),algoTmp) != puppiAlgo.end()) continue;    
-    puppiAlgo.push_back(algoTmp);     
-   }
-  }  
-
-  // Create PUPPI container
-  puppiCleanContainer curEvent(puppiInputVector,puppiAlgo,fMinPuppiWeight,fUseExp);
-  std::vector<fastjet::PseudoJet> puppiParticles = curEvent.puppiEvent();
-
-  // Loop on final particles
-  for (std::vector<fastjet::PseudoJet>::iterator it = puppiParticles.begin() ; it != puppiParticles.end() ; it++) {
-    if(it->user_index() <= int(InputParticles.size())){      
-      candidate = factory->NewCandidate();
-      candidate = dynamic_cast<Candidate*>(InputParticles.at(it->user_index()).Clone());
-      candidate->Momentum.SetXYZT(it->px(),it->py(),it->pz(),it->e());
-      fOutputArray->Add(candidate);
-      if( puppiInputVector.at(it->user_index()).id == 1 or puppiInputVector.at(it->user_index()).id == 2) fOutputTrackArray->Add(candidate);
-      else if (puppiInputVector.at(it->user_index()).id == 0) fOutputNeutralArray->Add(candidate);
-    }
-    else{ 
-      std::cerr<<" particle not found in the input Array --> skip "<<std::endl;
-      continue;
-    }     
+      fRecoObjects->push_back(candidate->Momentum.Pt(), candidate->Momentum.Eta(), candidate->Momentum.Phi(), candidate->Momentum.M(),
+                              pfType, 0, 0, particle->Position.Z()-PVZ);
+      fInputCandidates.push_back(candidate);
+  }
+
+  // run PUPPI
+  const std::vector<float> & puppiWeights = fPuppiContainer->puppiEvent(*fRecoObjects);
+
+  // derive the output candidates from the inputs with a non zero weight
+  for (i = 0; i < fInputCandidates.size(); ++i) {
+    if(puppiWeights[i] == 0) continue;
+    candidate = static_cast<Candidate*>(fInputCandidates[i]->Clone());
+    candidate->Momentum *= puppiWeights[i];
+    fOutputArray->Add(candidate);
+    if(fRecoObjects->id[i] == 1 or fRecoObjects->id[i] == 2) fOutputTrackArray->Add(candidate);
+    else if(fRecoObjects->id[i] == 0) fOutputNeutralArray->Add(candidate);
   }
 
 }
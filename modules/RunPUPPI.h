@@ -6,6 +6,9 @@
 
 class TObjArray;
 class TIterator;
+class Candidate;
+class RecoObjCollection;
+class puppiCleanContainer;
 
 
 class RunPUPPI: public DelphesModule {
@@ -32,6 +35,7 @@ class RunPUPPI: public DelphesModule {
   // puppi parameters
   float fMinPuppiWeight;
   bool fUseExp;
+  int  fNumberOfThreads;
   
   std::vector<float> fEtaMinBin ;
   std::vector<float> fEtaMaxBin ;
@@ -46,6 +50,13 @@ class RunPUPPI: public DelphesModule {
   std::vector<bool>  fApplyLowPUCorr;
   std::vector<int>   fMetricId;
 
+  // input candidates of the current event and their puppi view, same indexing
+  std::vector<Candidate *> fInputCandidates; //!
+  RecoObjCollection *fRecoObjects; //!
+
+  // puppi algorithms built at Init, with their buffers kept across the events
+  puppiCleanContainer *fPuppiContainer; //!
+
   TObjArray *fOutputArray;
   TObjArray *fOutputTrackArray;
   TObjArray *fOutputNeutralArray;
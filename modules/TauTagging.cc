@@ -18,6 +18,7 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesFormula.h"
+#include "classes/DelphesEtaPhiGrid.h"
 
 #include "ExRootAnalysis/ExRootResult.h"
 #include "ExRootAnalysis/ExRootFilter.h"
@@ -94,7 +95,7 @@ Int_t TauTaggingPartonClassifier::GetCategory(TObject *object)
 //------------------------------------------------------------------------------
 
 TauTagging::TauTagging() :
-  fClassifier(0), fFilter(0),
+  fTauGrid(0), fClassifier(0), fFilter(0),
   fItPartonInputArray(0), fItJetInputArray(0)
 {
 }
@@ -112,10 +113,12 @@ void TauTagging::Init()
   map< Int_t, DelphesFormula * >::iterator itEfficiencyMap;
   ExRootConfParam param;
   DelphesFormula *formula;
-  Int_t i, size;
+  Int_t i, size, pdgCode, tableSize;
 
   fDeltaR = GetDouble("DeltaR", 0.5);
 
+  fTauGrid = new DelphesEtaPhiGrid(fDeltaR);
+
   // read efficiency formulas
   param = GetParam("EfficiencyFormula");
   size = param.GetSize();
@@ -139,6 +142,21 @@ void TauTagging::Init()
     fEfficiencyMap[0] = formula;
   }
 
+  // fill dense lookup table, codes without formula use the default one
+  tableSize = 1;
+  for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
+  {
+    pdgCode = itEfficiencyMap->first;
+    if(pdgCode >= tableSize) tableSize = pdgCode + 1;
+  }
+
+  fEfficiencyTable.assign(tableSize, fEfficiencyMap[0]);
+  for(itEfficiencyMap = fEfficiencyMap.begin(); itEfficiencyMap != fEfficiencyMap.end(); ++itEfficiencyMap)
+  {
+    pdgCode = itEfficiencyMap->first;
+    if(pdgCode >= 0) fEfficiencyTable[pdgCode] = itEfficiencyMap->second;
+  }
+
   // import input array(s)
 
   fParticleInputArray = ImportArray(GetString("ParticleInputArray", "Delphes/allParticles"));
@@ -165,6 +183,7 @@ void TauTagging::Finish()
 
   if(fFilter) delete fFilter;
   if(fClassifier) delete fClassifier;
+  if(fTauGrid) delete fTauGrid;
   if(fItJetInputArray) delete fItJetInputArray;
   if(fItPartonInputArray) delete fItPartonInputArray;
 
@@ -181,11 +200,10 @@ void TauTagging::Process()
 {
   Candidate *jet, *tau, *daughter;
   TLorentzVector tauMomentum;
-  Double_t pt, eta;
+  Double_t pt, eta, phi;
   TObjArray *tauArray;
-  map< Int_t, DelphesFormula * >::iterator itEfficiencyMap;
   DelphesFormula *formula;
-  Int_t pdgCode, charge, i;
+  Int_t pdgCode, charge, i, tableSize;
 
   // select taus
   fFilter->Reset();
@@ -195,50 +213,63 @@ void TauTagging::Process()
 
   TIter itTauArray(tauArray);
 
+  // sum visible daughters of all input taus once per event
+  fTauGrid->Clear();
+  fTauCharge.clear();
+
+  itTauArray.Reset();
+  while((tau = static_cast<Candidate *>(itTauArray.Next())))
+  {
+    if(tau->D1 < 0) continue;
+
+    if(tau->D1 >= fParticleInputArray->GetEntriesFast() ||
+       tau->D2 >= fParticleInputArray->GetEntriesFast())
+    {
+      throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
+    }
+
+    tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
+
+    for(i = tau->D1; i <= tau->D2; ++i)
+    {
+      daughter = static_cast<Candidate *>(fParticleInputArray->At(i));
+      if(TMath::Abs(daughter->PID) == 16) continue;
+      tauMomentum += daughter->Momentum;
+    }
+
+    fTauGrid->Add(tauMomentum.Eta(), tauMomentum.Phi());
+    fTauCharge.push_back(tau->Charge);
+  }
+
+  fTauGrid->Build();
+
+  tableSize = fEfficiencyTable.size();
+
   // loop over all input jets
   fItJetInputArray->Reset();
   while((jet = static_cast<Candidate *>(fItJetInputArray->Next())))
   {
     const TLorentzVector &jetMomentum = jet->Momentum;
-    pdgCode = 0;
-    charge = gRandom->Uniform() > 0.5 ? 1 : -1;
     eta = jetMomentum.Eta();
+    phi = jetMomentum.Phi();
     pt = jetMomentum.Pt();
 
-    // loop over all input taus
-    itTauArray.Reset();
-    while((tau = static_cast<Candidate *>(itTauArray.Next())))
+    // the last matching tau sets the charge, random charge otherwise
+    fNeighbours.clear();
+    fTauGrid->FindNeighbours(eta, phi, fDeltaR, fNeighbours);
+    if(fNeighbours.empty())
     {
-      if(tau->D1 < 0) continue;
-
-      if(tau->D1 >= fParticleInputArray->GetEntriesFast() ||
-         tau->D2 >= fParticleInputArray->GetEntriesFast())
-      {
-        throw runtime_error("tau's daughter index is greater than the ParticleInputArray size");
-      }
-
-      tauMomentum.SetPxPyPzE(0.0, 0.0, 0.0, 0.0);
-
-      for(i = tau->D1; i <= tau->D2; ++i)
-      {
-        daughter = static_cast<Candidate *>(fParticleInputArray->At(i));
-        if(TMath::Abs(daughter->PID) == 16) continue;
-        tauMomentum += daughter->Momentum;
-      }
-
-      if(jetMomentum.DeltaR(tauMomentum) <= fDeltaR)
-      {
-        pdgCode = 15;
-        charge = tau->Charge;
-      }
+      pdgCode = 0;
+      charge = gRandom->Uniform() > 0.5 ? 1 : -1;
     }
-    // find an efficency formula
-    itEfficiencyMap = fEfficiencyMap.find(pdgCode);
-    if(itEfficiencyMap == fEfficiencyMap.end())
+    else
     {
-      itEfficiencyMap = fEfficiencyMap.find(0);
+      pdgCode = 15;
+      charge = fTauCharge[fNeighbours.back()];
     }
-    formula = itEfficiencyMap->second;
+
+    // find an efficency formula
+    formula = pdgCode < tableSize ? fEfficiencyTable[pdgCode] : fEfficiencyTable[0];
 
     // apply an efficency formula
     jet->TauTag = gRandom->Uniform() <= formula->Eval(pt, eta);
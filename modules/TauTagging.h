@@ -18,9 +18,11 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
 
 class TObjArray;
 class DelphesFormula;
+class DelphesEtaPhiGrid;
 
 class ExRootFilter;
 class TauTaggingPartonClassifier;
@@ -41,7 +43,17 @@ private:
   Double_t fDeltaR;
 
   std::map< Int_t, DelphesFormula * > fEfficiencyMap; //!
-  
+
+  // efficiency formulas indexed by PDG code, default formula for missing codes
+  std::vector< DelphesFormula * > fEfficiencyTable; //!
+
+  // visible tau directions and charges of the current event
+  DelphesEtaPhiGrid *fTauGrid; //!
+
+  std::vector< Int_t > fTauCharge; //!
+
+  std::vector< Int_t > fNeighbours; //!
+
   TauTaggingPartonClassifier *fClassifier; //!
   
   ExRootFilter *fFilter;
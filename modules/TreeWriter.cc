@@ -15,6 +15,7 @@
 #include "ExRootAnalysis/ExRootFilter.h"
 #include "ExRootAnalysis/ExRootClassifier.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
+#include "ExRootAnalysis/ExRootTreeWriter.h"
 
 #include "TROOT.h"
 #include "TMath.h"
@@ -26,12 +27,76 @@
 #include "TLorentzVector.h"
 
 #include <algorithm>
+#include <set>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 
 using namespace std;
 
+//------------------------------------------------------------------------------
+// field profiles of add BranchFields, named after the Jet fields they group
+
+enum { kMinimal, kBTag, kArea, kSubstructure, kPileUpID, kFractions, kReferences };
+
+static const char *kMinimalFields[] = {
+  "PT", "Eta", "Phi", "Mass", "DeltaEta", "DeltaPhi", "Charge", "EhadOverEem",
+  "TauTag", "BTagDefault", "flavourDefault", 0};
+
+static const char *kBTagFields[] = {
+  "BTagAlgo", "BTagDefault", "BTagPhysics", "BTagNearest2", "BTagNearest3", "BTagHeaviest", "BTagHighestPt",
+  "flavourAlgo", "flavourDefault", "flavourPhysics", "flavourNearest2", "flavourNearest3", "flavourHeaviest", "flavourHighestPt", 0};
+
+static const char *kAreaFields[] = {"AreaX", "AreaY", "AreaZ", "AreaT", 0};
+
+static const char *kSubstructureFields[] = {
+  "Tau1", "Tau2", "Tau3",
+  "NSubJetsTrimmed", "TrimmedMass", "TrimmedPt", "TrimmedEta", "TrimmedPhi",
+  "TrimmedMassSub1", "TrimmedPtSub1", "TrimmedEtaSub1", "TrimmedPhiSub1",
+  "TrimmedMassSub2", "TrimmedPtSub2", "TrimmedEtaSub2", "TrimmedPhiSub2",
+  "TrimmedMassSub3", "TrimmedPtSub3", "TrimmedEtaSub3", "TrimmedPhiSub3",
+  "NSubJetsPruned", "PrunedMass", "PrunedPt", "PrunedEta", "PrunedPhi",
+  "PrunedMassSub1", "PrunedPtSub1", "PrunedEtaSub1", "PrunedPhiSub1",
+  "PrunedMassSub2", "PrunedPtSub2", "PrunedEtaSub2", "PrunedPhiSub2",
+  "PrunedMassSub3", "PrunedPtSub3", "PrunedEtaSub3", "PrunedPhiSub3",
+  "NSubJetsSoftDrop", "SoftDropMass", "SoftDropPt", "SoftDropEta", "SoftDropPhi",
+  "SoftDropMassSub1", "SoftDropPtSub1", "SoftDropEtaSub1", "SoftDropPhiSub1",
+  "SoftDropMassSub2", "SoftDropPtSub2", "SoftDropEtaSub2", "SoftDropPhiSub2",
+  "SoftDropMassSub3", "SoftDropPtSub3", "SoftDropEtaSub3", "SoftDropPhiSub3", 0};
+
+static const char *kPileUpIDFields[] = {
+  "dRMean", "dR2Mean", "ptD", "sumPt", "sumPt2",
+  "dRMeanEm", "ptDNe", "sumPtNe", "nNeutral", "neuEMfrac", "dRMeanNeut", "neuHadfrac",
+  "dRMeanCh", "ptDCh", "sumPtCh", "nCharged", "chgEMfrac", "chgHadfrac",
+  "betaClassic", "betaClassicStar", "beta", "betaStar", "constituents", "dZ", "d0",
+  "etaW", "phiW", "jetW", "majW", "minW", "dRLeadCent", "dRLead2nd",
+  "ptMean", "ptRMS", "pt2A", "sumChPt", "sumNePt", "axis2",
+  "leadFrac", "secondFrac", "thirdFrac", "fourthFrac",
+  "leadChFrac", "secondChFrac", "thirdChFrac", "fourthChFrac",
+  "leadEmFrac", "secondEmFrac", "thirdEmFrac", "fourthEmFrac",
+  "leadNeutFrac", "secondNeutFrac", "thirdNeutFrac", "fourthNeutFrac",
+  "pileupIDFlagCutBased", 0};
+
+static const char *kFractionsFields[] = {"FracPt", "emFracPt", "neutFracPt", "chFracPt", 0};
+
+static const char *kReferencesFields[] = {"Constituents", "Particles", "Particle", 0};
+
+struct FieldProfile
+{
+  const char *name;
+  const char **fields;
+};
+
+static const FieldProfile kFieldProfiles[] = {
+  {"minimal", kMinimalFields},
+  {"btag", kBTagFields},
+  {"area", kAreaFields},
+  {"substructure", kSubstructureFields},
+  {"pileupid", kPileUpIDFields},
+  {"fractions", kFractionsFields},
+  {"references", kReferencesFields},
+  {0, 0}};
+
 //------------------------------------------------------------------------------
 
 TreeWriter::TreeWriter(){}
@@ -66,8 +131,22 @@ void TreeWriter::Init() {
 
   fOffsetFromModifyBeamSpot = GetInt("OffsetFromModifyBeamSpot", 0);
 
-  ExRootConfParam param = GetParam("Branch");
+  // output settings of single branches, before the branches are created
+  ReadBranchSettings();
+
   Long_t i, size;
+
+  // fields written by single branches
+  ExRootConfParam fieldsParam = GetParam("BranchFields");
+  map< TString, Long_t > fieldsMap;
+  map< TString, Long_t >::iterator itFieldsMap;
+
+  size = fieldsParam.GetSize();
+  for(i = 0; i < size/2; ++i){
+    fieldsMap[fieldsParam[i*2].GetString()] = i*2 + 1;
+  }
+
+  ExRootConfParam param = GetParam("Branch");
   TString branchName, branchClassName, branchInputArray;
   TClass *branchClass;
   TObjArray *array;
@@ -94,7 +173,12 @@ void TreeWriter::Init() {
     }
 
     array = ImportArray(branchInputArray);
-    branch = NewBranch(branchName, branchClass);
+    branch = CreateBranch(branchName, branchClass);
+
+    itFieldsMap = fieldsMap.find(branchName);
+    if(itFieldsMap != fieldsMap.end()){
+      SelectFields(branch, fieldsParam[itFieldsMap->second]);
+    }
 
     fBranchMap.insert(make_pair(branch, make_pair(itClassMap->second, array)));
   }
@@ -107,6 +191,133 @@ void TreeWriter::Finish(){}
 
 //------------------------------------------------------------------------------
 
+ExRootTreeBranch *TreeWriter::CreateBranch(const char *name, TClass *branchClass){
+
+  return NewBranch(name, branchClass);
+}
+
+//------------------------------------------------------------------------------
+// add BranchSettings <branch name> {<setting> <value> ...}, with the settings
+// CompressionAlgorithm, CompressionLevel, BasketSize and SplitLevel;
+// the settings not given take the global ones of the card
+
+void TreeWriter::ReadBranchSettings(){
+
+  ExRootConfParam param = GetParam("BranchSettings");
+  ExRootConfParam settings;
+  Long_t i, j, size;
+  TString branchName, key;
+  Int_t value, algorithm, level, basketSize, splitLevel;
+  stringstream message;
+
+  size = param.GetSize();
+  for(i = 0; i < size/2; ++i){
+
+    branchName = param[i*2].GetString();
+    settings = param[i*2 + 1];
+
+    algorithm = level = basketSize = splitLevel = -1;
+
+    for(j = 0; j < settings.GetSize()/2; ++j){
+
+      key = settings[j*2].GetString();
+      value = settings[j*2 + 1].GetInt();
+
+      if(key == "CompressionAlgorithm") algorithm = value;
+      else if(key == "CompressionLevel") level = value;
+      else if(key == "BasketSize") basketSize = value;
+      else if(key == "SplitLevel") splitLevel = value;
+      else{
+        message << "unknown setting '" << key << "' for branch '" << branchName << "'";
+        throw runtime_error(message.str());
+      }
+    }
+
+    GetTreeWriter()->SetBranchSettings(branchName, algorithm, level, basketSize, splitLevel);
+  }
+}
+
+//------------------------------------------------------------------------------
+// add BranchFields <branch name> {keep|drop <field or profile> ...}, where the
+// fields are the data members of the branch class and the profiles name the
+// groups of kFieldProfiles; fUniqueID and fBits are kept for the references
+
+void TreeWriter::SelectFields(ExRootTreeBranch *branch, ExRootConfParam fields){
+
+  vector< string > branchFields;
+  set< string > selected, existing;
+  set< string >::iterator itSelected;
+  vector< string >::iterator itField;
+  const FieldProfile *profile;
+  const char **field;
+  TString mode, name;
+  Long_t i;
+  UInt_t profiles;
+  Bool_t keep;
+  stringstream message;
+
+  mode = fields[0].GetString();
+  if(mode != "keep" && mode != "drop"){
+    message << "BranchFields of branch '" << branch->GetName() << "' has to start with keep or drop";
+    throw runtime_error(message.str());
+  }
+  keep = (mode == "keep");
+
+  branch->GetFields(branchFields);
+  existing.insert(branchFields.begin(), branchFields.end());
+
+  for(i = 1; i < fields.GetSize(); ++i){
+    name = fields[i].GetString();
+
+    for(profile = kFieldProfiles; profile->name; ++profile){
+      if(name == profile->name) break;
+    }
+
+    if(profile->name){
+      // fields of a profile missing in the branch class are ignored
+      for(field = profile->fields; *field; ++field){
+        if(existing.count(*field)) selected.insert(*field);
+      }
+    }
+    else if(existing.count(name.Data())){
+      selected.insert(name.Data());
+    }
+    else{
+      message << "unknown field or profile '" << name << "' for branch '" << branch->GetName() << "'";
+      throw runtime_error(message.str());
+    }
+  }
+
+  for(itField = branchFields.begin(); itField != branchFields.end(); ++itField){
+    if(*itField == "fUniqueID" || *itField == "fBits") continue;
+    if(keep != (selected.count(*itField) > 0)) branch->DropField(itField->c_str());
+  }
+
+  // the Process methods skip the profiles that are not written at all
+  profiles = 0;
+  for(i = 0, profile = kFieldProfiles; profile->name; ++i, ++profile){
+    for(field = profile->fields; *field; ++field){
+      if(existing.count(*field) && branch->HasField(*field)) profiles |= 1 << i;
+    }
+  }
+  fProfileMap[branch] = profiles;
+
+  branch->GetFields(branchFields);
+  cout << "** INFO: branch '" << branch->GetName() << "' writes " << branchFields.size();
+  cout << " of " << existing.size() << " fields" << endl;
+}
+
+//------------------------------------------------------------------------------
+
+UInt_t TreeWriter::GetWrittenProfiles(ExRootTreeBranch *branch){
+
+  map< ExRootTreeBranch *, UInt_t >::iterator itProfileMap = fProfileMap.find(branch);
+
+  return itProfileMap == fProfileMap.end() ? ~0U : itProfileMap->second;
+}
+
+//------------------------------------------------------------------------------
+
 void TreeWriter::FillParticles(Candidate *candidate, TRefArray *array){
 
   TIter it1(candidate->GetCandidates());
@@ -257,6 +468,7 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array){
   Candidate *candidate = 0;
   Tower *entry = 0;
   Double_t pt, signPz, cosTheta, eta;
+  Bool_t particles = branch->HasField("Particles");
 
   // loop over all jets
   iterator.Reset();
@@ -287,7 +499,7 @@ void TreeWriter::ProcessTowers(ExRootTreeBranch *branch, TObjArray *array){
     entry->TOuter = candidate->Position.T();
     entry->nTimes = candidate->nTimes;
 
-    FillParticles(candidate,&entry->Particles); // save the reference
+    if(particles) FillParticles(candidate,&entry->Particles); // save the reference
   }
 }
 
@@ -299,6 +511,7 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array){
   Candidate *candidate = 0;
   Photon *entry = 0;
   Double_t pt, signPz, cosTheta, eta;
+  Bool_t particles = branch->HasField("Particles");
 
   // loop over all photons
   array->Sort();
@@ -335,7 +548,7 @@ void TreeWriter::ProcessPhotons(ExRootTreeBranch *branch, TObjArray *array){
     entry->chargedPUEnergy     = candidate->chargedPUEnergy;
     entry->allParticleEnergy   = candidate->allParticleEnergy;
 
-    FillParticles(candidate, &entry->Particles);
+    if(particles) FillParticles(candidate, &entry->Particles);
   }
 }
 
@@ -481,6 +694,17 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array){
   Double_t pt, signPz, cosTheta, eta;
   Double_t ecalEnergy, hcalEnergy;
 
+  // groups of fields dropped from the output are not filled
+  UInt_t profiles = GetWrittenProfiles(branch);
+  Bool_t substructure = profiles & (1 << kSubstructure);
+  Bool_t btag = profiles & (1 << kBTag);
+  Bool_t area = profiles & (1 << kArea);
+  Bool_t pileUpID = profiles & (1 << kPileUpID);
+  Bool_t fractions = profiles & (1 << kFractions);
+  Bool_t constituents = branch->HasField("Constituents");
+  Bool_t ehadOverEem = branch->HasField("EhadOverEem");
+  Bool_t particles = branch->HasField("Particles");
+
   array->Sort();
 
   // loop over all jets
@@ -505,191 +729,202 @@ void TreeWriter::ProcessJets(ExRootTreeBranch *branch, TObjArray *array){
     entry->DeltaPhi = candidate->DeltaPhi;
 
 
-    entry->Tau1 = candidate->Tau1;
-    entry->Tau2 = candidate->Tau2;
-    entry->Tau3 = candidate->Tau3;
-
-    entry->NSubJetsTrimmed = candidate->NSubJetsTrimmed ;
-
-    entry->TrimmedMass = candidate->TrimmedMass;
-    entry->TrimmedPt   = candidate->TrimmedPt;
-    entry->TrimmedEta  = candidate->TrimmedEta;
-    entry->TrimmedPhi  = candidate->TrimmedPhi;
-
-    entry->TrimmedMassSub1 = candidate->TrimmedMassSub1;
-    entry->TrimmedPtSub1   = candidate->TrimmedPtSub1;
-    entry->TrimmedEtaSub1  = candidate->TrimmedEtaSub1;
-    entry->TrimmedPhiSub1  = candidate->TrimmedPhiSub1;
-
-    entry->TrimmedMassSub2 = candidate->TrimmedMassSub2;
-    entry->TrimmedPtSub2   = candidate->TrimmedPtSub2;
-    entry->TrimmedEtaSub2  = candidate->TrimmedEtaSub2;
-    entry->TrimmedPhiSub2  = candidate->TrimmedPhiSub2;
-
-    entry->TrimmedMassSub3 = candidate->TrimmedMassSub3;
-    entry->TrimmedPtSub3   = candidate->TrimmedPtSub3;
-    entry->TrimmedEtaSub3  = candidate->TrimmedEtaSub3;
-    entry->TrimmedPhiSub3  = candidate->TrimmedPhiSub3;
-
-    entry->NSubJetsPruned = candidate->NSubJetsPruned ;
-
-    entry->PrunedMass = candidate->PrunedMass;
-    entry->PrunedPt   = candidate->PrunedPt;
-    entry->PrunedEta  = candidate->PrunedEta;
-    entry->PrunedPhi  = candidate->PrunedPhi;
-
-    entry->PrunedMassSub1 = candidate->PrunedMassSub1;
-    entry->PrunedPtSub1   = candidate->PrunedPtSub1;
-    entry->PrunedEtaSub1  = candidate->PrunedEtaSub1;
-    entry->PrunedPhiSub1  = candidate->PrunedPhiSub1;
-
-    entry->PrunedMassSub2 = candidate->PrunedMassSub2;
-    entry->PrunedPtSub2   = candidate->PrunedPtSub2;
-    entry->PrunedEtaSub2  = candidate->PrunedEtaSub2;
-    entry->PrunedPhiSub2  = candidate->PrunedPhiSub2;
-
-    entry->PrunedMassSub3 = candidate->PrunedMassSub3;
-    entry->PrunedPtSub3   = candidate->PrunedPtSub3;
-    entry->PrunedEtaSub3  = candidate->PrunedEtaSub3;
-    entry->PrunedPhiSub3  = candidate->PrunedPhiSub3;
-
-    entry->NSubJetsSoftDrop = candidate->NSubJetsSoftDrop ;
-
-    entry->SoftDropMass = candidate->SoftDropMass;
-    entry->SoftDropPt   = candidate->SoftDropPt;
-    entry->SoftDropEta  = candidate->SoftDropEta;
-    entry->SoftDropPhi  = candidate->SoftDropPhi;
-
-    entry->SoftDropMassSub1 = candidate->SoftDropMassSub1;
-    entry->SoftDropPtSub1   = candidate->SoftDropPtSub1;
-    entry->SoftDropEtaSub1  = candidate->SoftDropEtaSub1;
-    entry->SoftDropPhiSub1  = candidate->SoftDropPhiSub1;
-
-    entry->SoftDropMassSub2 = candidate->SoftDropMassSub2;
-    entry->SoftDropPtSub2   = candidate->SoftDropPtSub2;
-    entry->SoftDropEtaSub2  = candidate->SoftDropEtaSub2;
-    entry->SoftDropPhiSub2  = candidate->SoftDropPhiSub2;
-
-    entry->SoftDropMassSub3 = candidate->SoftDropMassSub3;
-    entry->SoftDropPtSub3   = candidate->SoftDropPtSub3;
-    entry->SoftDropEtaSub3  = candidate->SoftDropEtaSub3;
-    entry->SoftDropPhiSub3  = candidate->SoftDropPhiSub3;
+    if(substructure){
+      entry->Tau1 = candidate->Tau1;
+      entry->Tau2 = candidate->Tau2;
+      entry->Tau3 = candidate->Tau3;
+
+      entry->NSubJetsTrimmed = candidate->NSubJetsTrimmed ;
+
+      entry->TrimmedMass = candidate->TrimmedMass;
+      entry->TrimmedPt   = candidate->TrimmedPt;
+      entry->TrimmedEta  = candidate->TrimmedEta;
+      entry->TrimmedPhi  = candidate->TrimmedPhi;
+
+      entry->TrimmedMassSub1 = candidate->TrimmedMassSub1;
+      entry->TrimmedPtSub1   = candidate->TrimmedPtSub1;
+      entry->TrimmedEtaSub1  = candidate->TrimmedEtaSub1;
+      entry->TrimmedPhiSub1  = candidate->TrimmedPhiSub1;
+
+      entry->TrimmedMassSub2 = candidate->TrimmedMassSub2;
+      entry->TrimmedPtSub2   = candidate->TrimmedPtSub2;
+      entry->TrimmedEtaSub2  = candidate->TrimmedEtaSub2;
+      entry->TrimmedPhiSub2  = candidate->TrimmedPhiSub2;
+
+      entry->TrimmedMassSub3 = candidate->TrimmedMassSub3;
+      entry->TrimmedPtSub3   = candidate->TrimmedPtSub3;
+      entry->TrimmedEtaSub3  = candidate->TrimmedEtaSub3;
+      entry->TrimmedPhiSub3  = candidate->TrimmedPhiSub3;
+
+      entry->NSubJetsPruned = candidate->NSubJetsPruned ;
+
+      entry->PrunedMass = candidate->PrunedMass;
+      entry->PrunedPt   = candidate->PrunedPt;
+      entry->PrunedEta  = candidate->PrunedEta;
+      entry->PrunedPhi  = candidate->PrunedPhi;
+
+      entry->PrunedMassSub1 = candidate->PrunedMassSub1;
+      entry->PrunedPtSub1   = candidate->PrunedPtSub1;
+      entry->PrunedEtaSub1  = candidate->PrunedEtaSub1;
+      entry->PrunedPhiSub1  = candidate->PrunedPhiSub1;
+
+      entry->PrunedMassSub2 = candidate->PrunedMassSub2;
+      entry->PrunedPtSub2   = candidate->PrunedPtSub2;
+      entry->PrunedEtaSub2  = candidate->PrunedEtaSub2;
+      entry->PrunedPhiSub2  = candidate->PrunedPhiSub2;
+
+      entry->PrunedMassSub3 = candidate->PrunedMassSub3;
+      entry->PrunedPtSub3   = candidate->PrunedPtSub3;
+      entry->PrunedEtaSub3  = candidate->PrunedEtaSub3;
+      entry->PrunedPhiSub3  = candidate->PrunedPhiSub3;
+
+      entry->NSubJetsSoftDrop = candidate->NSubJetsSoftDrop ;
+
+      entry->SoftDropMass = candidate->SoftDropMass;
+      entry->SoftDropPt   = candidate->SoftDropPt;
+      entry->SoftDropEta  = candidate->SoftDropEta;
+      entry->SoftDropPhi  = candidate->SoftDropPhi;
+
+      entry->SoftDropMassSub1 = candidate->SoftDropMassSub1;
+      entry->SoftDropPtSub1   = candidate->SoftDropPtSub1;
+      entry->SoftDropEtaSub1  = candidate->SoftDropEtaSub1;
+      entry->SoftDropPhiSub1  = candidate->SoftDropPhiSub1;
+
+      entry->SoftDropMassSub2 = candidate->SoftDropMassSub2;
+      entry->SoftDropPtSub2   = candidate->SoftDropPtSub2;
+      entry->SoftDropEtaSub2  = candidate->SoftDropEtaSub2;
+      entry->SoftDropPhiSub2  = candidate->SoftDropPhiSub2;
+
+      entry->SoftDropMassSub3 = candidate->SoftDropMassSub3;
+      entry->SoftDropPtSub3   = candidate->SoftDropPtSub3;
+      entry->SoftDropEtaSub3  = candidate->SoftDropEtaSub3;
+      entry->SoftDropPhiSub3  = candidate->SoftDropPhiSub3;
+    }
 
-    entry->AreaX = candidate->Area.X();
-    entry->AreaY = candidate->Area.Y();
-    entry->AreaZ = candidate->Area.Z();
-    entry->AreaT = candidate->Area.T();
+    if(area){
+      entry->AreaX = candidate->Area.X();
+      entry->AreaY = candidate->Area.Y();
+      entry->AreaZ = candidate->Area.Z();
+      entry->AreaT = candidate->Area.T();
+    }
 
     entry->Charge = candidate->Charge;
 
     entry->TauTag = candidate->TauTag;
 
-    entry->BTagAlgo      = candidate->BTagAlgo;
-    entry->BTagDefault      = candidate->BTagDefault;
-    entry->BTagPhysics   = candidate->BTagPhysics;
-    entry->BTagNearest2  = candidate->BTagNearest2;
-    entry->BTagNearest3  = candidate->BTagNearest3;
-    entry->BTagHeaviest  = candidate->BTagHeaviest;
-    entry->BTagHighestPt = candidate->BTagHighestPt;
-
-    entry->flavourAlgo      = candidate->flavourAlgo;
-    entry->flavourDefault      = candidate->flavourDefault;
-    entry->flavourPhysics   = candidate->flavourPhysics;
-    entry->flavourNearest2  = candidate->flavourNearest2;
-    entry->flavourNearest3  = candidate->flavourNearest3;
-    entry->flavourHeaviest  = candidate->flavourHeaviest;
-    entry->flavourHighestPt = candidate->flavourHighestPt;
-
-    itConstituents.Reset();
-    entry->Constituents.Clear();
-    ecalEnergy = 0.0;
-    hcalEnergy = 0.0;
-    while((constituent = static_cast<Candidate*>(itConstituents.Next()))){
-      entry->Constituents.Add(constituent);
-      ecalEnergy += constituent->Eem;
-      hcalEnergy += constituent->Ehad;
+    if(btag){
+      entry->BTagAlgo      = candidate->BTagAlgo;
+      entry->BTagDefault      = candidate->BTagDefault;
+      entry->BTagPhysics   = candidate->BTagPhysics;
+      entry->BTagNearest2  = candidate->BTagNearest2;
+      entry->BTagNearest3  = candidate->BTagNearest3;
+      entry->BTagHeaviest  = candidate->BTagHeaviest;
+      entry->BTagHighestPt = candidate->BTagHighestPt;
+
+      entry->flavourAlgo      = candidate->flavourAlgo;
+      entry->flavourDefault      = candidate->flavourDefault;
+      entry->flavourPhysics   = candidate->flavourPhysics;
+      entry->flavourNearest2  = candidate->flavourNearest2;
+      entry->flavourNearest3  = candidate->flavourNearest3;
+      entry->flavourHeaviest  = candidate->flavourHeaviest;
+      entry->flavourHighestPt = candidate->flavourHighestPt;
     }
 
-    entry->EhadOverEem = ecalEnergy > 0.0 ? hcalEnergy/ecalEnergy : 999.9;
+    if(constituents || ehadOverEem){
+      itConstituents.Reset();
+      entry->Constituents.Clear();
+      ecalEnergy = 0.0;
+      hcalEnergy = 0.0;
+      while((constituent = static_cast<Candidate*>(itConstituents.Next()))){
+        if(constituents) entry->Constituents.Add(constituent);
+        ecalEnergy += constituent->Eem;
+        hcalEnergy += constituent->Ehad;
+      }
+
+      entry->EhadOverEem = ecalEnergy > 0.0 ? hcalEnergy/ecalEnergy : 999.9;
+    }
 
     // pileup jet ID                                                                                                                                                                          
-    entry->dRMean   = candidate->dRMean;
-    entry->dR2Mean  = candidate->dR2Mean;
-    entry->ptD      = candidate->ptD;
-    entry->sumPt    = candidate->sumPt;
-    entry->sumPt2   = candidate->sumPt2;
-
-    entry->dRMeanEm  = candidate->dRMeanEm;
-    entry->ptDNe     = candidate->ptDNe;
-    entry->sumPtNe   = candidate->sumPtNe;
-    entry->nNeutral  = candidate->nNeutral;
-    entry->neuEMfrac   = candidate->neuEMfrac;
-    entry->dRMeanNeut  = candidate->dRMeanNeut;
-    entry->neuHadfrac  = candidate->neuHadfrac;
-
-    entry->dRMeanCh  = candidate->dRMeanCh;
-    entry->ptDCh     = candidate->ptDCh;
-    entry->sumPtCh   = candidate->sumPtCh;
-    entry->nCharged  = candidate->nCharged;
-
-    entry->chgEMfrac   = candidate->chgEMfrac;
-    entry->chgHadfrac  = candidate->chgHadfrac;
-
-    entry->betaClassic     = candidate->betaClassic;
-    entry->betaClassicStar = candidate->betaClassicStar;
-    entry->beta          = candidate->beta;
-    entry->betaStar      = candidate->betaStar;
-    entry->constituents  = candidate->constituents;
-
-    entry->dZ  = candidate->dZ;
-    entry->d0  = candidate->d0;
-
-    entry->etaW  = candidate->etaW;
-    entry->phiW  = candidate->phiW;
-    entry->jetW  = candidate->jetW;
-
-    entry->majW  = candidate->majW;
-    entry->minW  = candidate->minW;
-    entry->dRLeadCent  = candidate->dRLeadCent;
-    entry->dRLead2nd   = candidate->dRLead2nd;
-
-    entry->ptMean  = candidate->ptMean;
-    entry->ptRMS   = candidate->ptRMS;
-    entry->pt2A    = candidate->pt2A;
-    entry->sumChPt  = candidate->sumChPt;
-    entry->sumNePt  = candidate->sumNePt;
-    entry->axis2    = candidate->axis2;
-
-    entry->leadFrac   = candidate->leadFrac;
-    entry->secondFrac = candidate->secondFrac;
-    entry->thirdFrac  = candidate->thirdFrac;
-    entry->fourthFrac = candidate->fourthFrac;
-
-    entry->leadChFrac   = candidate->leadChFrac;
-    entry->secondChFrac = candidate->secondChFrac;
-    entry->thirdChFrac  = candidate->thirdChFrac;
-    entry->fourthChFrac = candidate->fourthChFrac;
-
-    entry->leadEmFrac   = candidate->leadEmFrac;
-    entry->secondEmFrac = candidate->secondEmFrac;
-    entry->thirdEmFrac  = candidate->thirdEmFrac;
-    entry->fourthEmFrac = candidate->fourthEmFrac;
-
-    entry->leadNeutFrac   = candidate->leadNeutFrac;
-    entry->secondNeutFrac = candidate->secondNeutFrac;
-    entry->thirdNeutFrac  = candidate->thirdNeutFrac;
-    entry->fourthNeutFrac = candidate->fourthNeutFrac;
-
-    entry->pileupIDFlagCutBased = candidate->pileupIDFlagCutBased;
-
-    entry->FracPt     = candidate->FracPt;
-    entry->emFracPt   = candidate->emFracPt;
-    entry->neutFracPt = candidate->neutFracPt;
-    entry->chFracPt   = candidate->chFracPt;
-
-    FillParticles(candidate, &entry->Particles);
-
-        
+    if(pileUpID){
+      entry->dRMean   = candidate->dRMean;
+      entry->dR2Mean  = candidate->dR2Mean;
+      entry->ptD      = candidate->ptD;
+      entry->sumPt    = candidate->sumPt;
+      entry->sumPt2   = candidate->sumPt2;
+
+      entry->dRMeanEm  = candidate->dRMeanEm;
+      entry->ptDNe     = candidate->ptDNe;
+      entry->sumPtNe   = candidate->sumPtNe;
+      entry->nNeutral  = candidate->nNeutral;
+      entry->neuEMfrac   = candidate->neuEMfrac;
+      entry->dRMeanNeut  = candidate->dRMeanNeut;
+      entry->neuHadfrac  = candidate->neuHadfrac;
+
+      entry->dRMeanCh  = candidate->dRMeanCh;
+      entry->ptDCh     = candidate->ptDCh;
+      entry->sumPtCh   = candidate->sumPtCh;
+      entry->nCharged  = candidate->nCharged;
+
+      entry->chgEMfrac   = candidate->chgEMfrac;
+      entry->chgHadfrac  = candidate->chgHadfrac;
+
+      entry->betaClassic     = candidate->betaClassic;
+      entry->betaClassicStar = candidate->betaClassicStar;
+      entry->beta          = candidate->beta;
+      entry->betaStar      = candidate->betaStar;
+      entry->constituents  = candidate->constituents;
+
+      entry->dZ  = candidate->dZ;
+      entry->d0  = candidate->d0;
+
+      entry->etaW  = candidate->etaW;
+      entry->phiW  = candidate->phiW;
+      entry->jetW  = candidate->jetW;
+
+      entry->majW  = candidate->majW;
+      entry->minW  = candidate->minW;
+      entry->dRLeadCent  = candidate->dRLeadCent;
+      entry->dRLead2nd   = candidate->dRLead2nd;
+
+      entry->ptMean  = candidate->ptMean;
+      entry->ptRMS   = candidate->ptRMS;
+      entry->pt2A    = candidate->pt2A;
+      entry->sumChPt  = candidate->sumChPt;
+      entry->sumNePt  = candidate->sumNePt;
+      entry->axis2    = candidate->axis2;
+
+      entry->leadFrac   = candidate->leadFrac;
+      entry->secondFrac = candidate->secondFrac;
+      entry->thirdFrac  = candidate->thirdFrac;
+      entry->fourthFrac = candidate->fourthFrac;
+
+      entry->leadChFrac   = candidate->leadChFrac;
+      entry->secondChFrac = candidate->secondChFrac;
+      entry->thirdChFrac  = candidate->thirdChFrac;
+      entry->fourthChFrac = candidate->fourthChFrac;
+
+      entry->leadEmFrac   = candidate->leadEmFrac;
+      entry->secondEmFrac = candidate->secondEmFrac;
+      entry->thirdEmFrac  = candidate->thirdEmFrac;
+      entry->fourthEmFrac = candidate->fourthEmFrac;
+
+      entry->leadNeutFrac   = candidate->leadNeutFrac;
+      entry->secondNeutFrac = candidate->secondNeutFrac;
+      entry->thirdNeutFrac  = candidate->thirdNeutFrac;
+      entry->fourthNeutFrac = candidate->fourthNeutFrac;
+
+      entry->pileupIDFlagCutBased = candidate->pileupIDFlagCutBased;
+    }
+
+    if(fractions){
+      entry->FracPt     = candidate->FracPt;
+      entry->emFracPt   = candidate->emFracPt;
+      entry->neutFracPt = candidate->neutFracPt;
+      entry->chFracPt   = candidate->chFracPt;
+    }
+
+    if(particles) FillParticles(candidate, &entry->Particles);
+
 
   }
 }
@@ -29,7 +29,14 @@ class TreeWriter: public DelphesModule {
   void Process();
   void Finish();
 
- private:
+ protected:
+
+  // creates the branch filled with the entries of a class, in the output tree here
+  virtual ExRootTreeBranch *CreateBranch(const char *name, TClass *branchClass);
+
+  void ReadBranchSettings();
+  void SelectFields(ExRootTreeBranch *branch, ExRootConfParam fields);
+  UInt_t GetWrittenProfiles(ExRootTreeBranch *branch);
 
   void FillParticles(Candidate *candidate, TRefArray *array);
 
@@ -59,6 +66,9 @@ class TreeWriter: public DelphesModule {
   int fOffsetFromModifyBeamSpot;
 
   std::map< TClass *, TProcessMethod > fClassMap; //!
+
+  // bits of the field profiles with at least one field written, for slimmed branches
+  std::map< ExRootTreeBranch *, UInt_t > fProfileMap; //!
 #endif
 
   ClassDef(TreeWriter, 1)
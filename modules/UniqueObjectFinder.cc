@@ -38,14 +38,118 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 
-UniqueObjectFinder::UniqueObjectFinder()
+class UniqueObjectFinderIDSet
 {
+public:
+
+  UniqueObjectFinderIDSet();
+
+  void Clear();
+  void Insert(UInt_t id);
+  Bool_t Contains(UInt_t id) const;
+
+private:
+
+  UInt_t Slot(UInt_t id) const;
+  void Expand();
+
+  // slots whose stamp differs from fStamp are empty,
+  // so clearing the set is a single increment
+  std::vector< UInt_t > fKeys, fStamps;
+
+  UInt_t fStamp, fMask, fEntries;
+};
+
+//------------------------------------------------------------------------------
+
+UniqueObjectFinderIDSet::UniqueObjectFinderIDSet() :
+  fKeys(1024, 0), fStamps(1024, 0), fStamp(1), fMask(1023), fEntries(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+void UniqueObjectFinderIDSet::Clear()
+{
+  fEntries = 0;
+  ++fStamp;
+  if(fStamp == 0)
+  {
+    fStamps.assign(fStamps.size(), 0);
+    fStamp = 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+UInt_t UniqueObjectFinderIDSet::Slot(UInt_t id) const
+{
+  // multiplicative hashing with linear probing
+  UInt_t slot = (id*2654435761U) & fMask;
+  while(fStamps[slot] == fStamp && fKeys[slot] != id)
+  {
+    slot = (slot + 1) & fMask;
+  }
+  return slot;
+}
+
+//------------------------------------------------------------------------------
+
+Bool_t UniqueObjectFinderIDSet::Contains(UInt_t id) const
+{
+  return fStamps[Slot(id)] == fStamp;
+}
+
+//------------------------------------------------------------------------------
+
+void UniqueObjectFinderIDSet::Insert(UInt_t id)
+{
+  UInt_t slot = Slot(id);
+  if(fStamps[slot] == fStamp) return;
+
+  fKeys[slot] = id;
+  fStamps[slot] = fStamp;
+  ++fEntries;
+
+  // keep the load factor below one half
+  if(2*fEntries > fMask) Expand();
+}
+
+//------------------------------------------------------------------------------
+
+void UniqueObjectFinderIDSet::Expand()
+{
+  vector< UInt_t > keys, stamps;
+  UInt_t i, stamp = fStamp;
+
+  keys.swap(fKeys);
+  stamps.swap(fStamps);
+
+  fMask = 2*(fMask + 1) - 1;
+  fKeys.assign(fMask + 1, 0);
+  fStamps.assign(fMask + 1, 0);
+  fStamp = 1;
+  fEntries = 0;
+
+  for(i = 0; i < keys.size(); ++i)
+  {
+    if(stamps[i] == stamp) Insert(keys[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+UniqueObjectFinder::UniqueObjectFinder() :
+  fIDSet(0)
+{
+  fIDSet = new UniqueObjectFinderIDSet;
 }
 
 //------------------------------------------------------------------------------
 
 UniqueObjectFinder::~UniqueObjectFinder()
 {
+  if(fIDSet) delete fIDSet;
 }
 
 //------------------------------------------------------------------------------
@@ -92,6 +196,9 @@ void UniqueObjectFinder::Process()
   map< TIterator *, TObjArray * >::iterator itInputMap;
   TIterator *iterator;
   TObjArray *array;
+  vector< UInt_t >::const_iterator itIDs;
+
+  fIDSet->Clear();
 
   // loop over all input arrays
   for(itInputMap = fInputMap.begin(); itInputMap != fInputMap.end(); ++itInputMap)
@@ -99,41 +206,42 @@ void UniqueObjectFinder::Process()
     iterator = itInputMap->first;
     array = itInputMap->second;
 
+    // candidates of the same array are not compared with each other,
+    // so their IDs are only claimed once the whole array is processed
+    fAcceptedIDs.clear();
+
     // loop over all candidates
     iterator->Reset();
     while((candidate = static_cast<Candidate*>(iterator->Next())))
     {
-      if(Unique(candidate, itInputMap))
+      if(Unique(candidate))
       {
         array->Add(candidate);
+        fAcceptedIDs.insert(fAcceptedIDs.end(), fIDs.begin(), fIDs.end());
       }
     }
+
+    for(itIDs = fAcceptedIDs.begin(); itIDs != fAcceptedIDs.end(); ++itIDs)
+    {
+      fIDSet->Insert(*itIDs);
+    }
   }
 }
 
 //------------------------------------------------------------------------------
 
-Bool_t UniqueObjectFinder::Unique(Candidate *candidate, map< TIterator *, TObjArray * >::iterator itInputMap)
+Bool_t UniqueObjectFinder::Unique(Candidate *candidate)
 {
-  Candidate *previousCandidate;
-  map< TIterator *, TObjArray * >::iterator previousItInputMap;
-  TObjArray *array;
+  vector< UInt_t >::const_iterator itIDs;
 
-  // loop over previous arrays
-  for(previousItInputMap = fInputMap.begin(); previousItInputMap != itInputMap; ++previousItInputMap)
-  {
-    array = previousItInputMap->second;
-    TIter iterator(array);
+  // a candidate overlaps with a previous one if any of its constituents,
+  // or the candidate itself, shares a unique ID with it
+  fIDs.clear();
+  candidate->FillUniqueIDs(fIDs);
 
-    // loop over all candidates
-    iterator.Reset();
-    while((previousCandidate = static_cast<Candidate*>(iterator.Next())))
-    {
-      if(candidate->Overlaps(previousCandidate))
-      {
-        return kFALSE;
-      }
-    }
+  for(itIDs = fIDs.begin(); itIDs != fIDs.end(); ++itIDs)
+  {
+    if(fIDSet->Contains(*itIDs)) return kFALSE;
   }
 
   return kTRUE;
@@ -16,11 +16,14 @@
 #include "classes/DelphesModule.h"
 
 #include <map>
+#include <vector>
 
 class TIterator;
 class TObjArray;
 class Candidate;
 
+class UniqueObjectFinderIDSet;
+
 class UniqueObjectFinder: public DelphesModule
 {
 public:
@@ -34,10 +37,15 @@ public:
 
 private:
 
-  Bool_t Unique(Candidate *candidate, std::map< TIterator *, TObjArray * >::iterator itInputMap);
+  Bool_t Unique(Candidate *candidate);
 
   std::map< TIterator *, TObjArray * > fInputMap; //!
 
+  // unique IDs claimed by the output of previous arrays
+  UniqueObjectFinderIDSet *fIDSet; //!
+
+  std::vector< UInt_t > fIDs, fAcceptedIDs; //!
+
   ClassDef(UniqueObjectFinder, 1)
 };
 
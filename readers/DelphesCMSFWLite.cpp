@@ -17,14 +17,13 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
 #include "classes/DelphesStream.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -79,15 +78,14 @@ void ConvertInput(fwlite::Event &event, Long64_t eventCounter, ExRootTreeBranch
     handleParticle.getByLabel(event, "genParticles");
 
     Candidate *candidate;
-    TDatabasePDG *pdg;
-    TParticlePDG *pdgParticle;
+    const DelphesPDGTable *pdg;
     Int_t pdgCode;
 
     Int_t pid, status;
     Double_t px, py, pz, e, mass;
     Double_t x, y, z;
 
-    pdg = TDatabasePDG::Instance();
+    pdg = DelphesPDGTable::Instance();
 
     for(itParticle = handleParticle->begin(); itParticle != handleParticle->end(); ++itParticle)
     {
@@ -128,8 +126,7 @@ void ConvertInput(fwlite::Event &event, Long64_t eventCounter, ExRootTreeBranch
 
         if(itCandidate != vectorCandidate.end()) candidate->D2 = distance(vectorCandidate.begin(), itCandidate);
 
-        pdgParticle = pdg->GetParticle(pid);
-        candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+        candidate->Charge = pdg->GetCharge(pid);
         candidate->Mass = mass;
 
         candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -138,7 +135,7 @@ void ConvertInput(fwlite::Event &event, Long64_t eventCounter, ExRootTreeBranch
 
         allParticleOutputArray->Add(candidate);
 
-        if(!pdgParticle) continue;
+        if(!pdg->IsKnown(pid)) continue;
 
         if(status == 1)
         {
@@ -299,6 +296,7 @@ int main(int argc, char *argv[])
       
       modularDelphes->FinishTask();
       treeWriter->Write();
+      treeWriter->PrintSummary();
       
       cout << "** Exiting..." << endl;
       
@@ -18,6 +18,8 @@
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
 #include "classes/DelphesHepMCReader.h"
+#include "classes/DelphesReadAhead.h"
+#include "classes/DelphesInputStream.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -40,9 +42,9 @@ int main(int argc, char *argv[])
 {
   char appName[] = "DelphesHepMC";
   stringstream message;
-  FILE *inputFile = 0;
+  DelphesInputStream *inputStream = 0;
   TFile *outputFile = 0;
-  TStopwatch readStopWatch, procStopWatch;
+  TStopwatch procStopWatch;
   ExRootTreeWriter *treeWriter = 0;
   ExRootTreeBranch *branchEvent = 0;
   ExRootConfReader *confReader = 0;
@@ -50,15 +52,16 @@ int main(int argc, char *argv[])
   DelphesFactory *factory = 0;
   TObjArray *stableParticleOutputArray = 0, *allParticleOutputArray = 0, *partonOutputArray = 0;
   DelphesHepMCReader *reader = 0;
-  Int_t i, maxEvents, skipEvents;
-  Long64_t length, eventCounter;
+  DelphesReadAhead<DelphesHepMCReader, HepMCEvent> *readAhead = 0;
+  Int_t i, maxEvents, skipEvents, readerThreads, readAheadDepth;
+  Long64_t eventCounter;
 
   if(argc < 3)
   {
     cout << " Usage: " << appName << " config_file" << " output_file" << " [input_file(s)]" << endl;
     cout << " config_file - configuration file in Tcl format," << endl;
     cout << " output_file - output file in ROOT format," << endl;
-    cout << " input_file(s) - input file(s) in HepMC format," << endl;
+    cout << " input_file(s) - input file(s) in HepMC format, possibly gzip or zstd compressed," << endl;
     cout << " with no input_file, or when input_file is -, read standard input." << endl;
     return 1;
   }
@@ -90,6 +93,8 @@ int main(int argc, char *argv[])
 
     maxEvents = confReader->GetInt("::MaxEvents", 0);
     skipEvents = confReader->GetInt("::SkipEvents", 0);
+    readAheadDepth = confReader->GetInt("::ReadAheadDepth", 0);
+    readerThreads = confReader->GetInt("::ReaderThreads", 0);
 
     if(maxEvents < 0)
     {
@@ -101,6 +106,16 @@ int main(int argc, char *argv[])
       throw runtime_error("SkipEvents must be zero or positive");
     }
 
+    if(readAheadDepth < 0)
+    {
+      throw runtime_error("ReadAheadDepth must be zero or positive");
+    }
+
+    if(readerThreads < 0)
+    {
+      throw runtime_error("ReaderThreads must be zero or positive");
+    }
+
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
@@ -112,6 +127,15 @@ int main(int argc, char *argv[])
 
     reader = new DelphesHepMCReader;
 
+    // parse the input in blocks on ReaderThreads threads
+    reader->SetNumberOfThreads(readerThreads);
+
+    // read the next ReadAheadDepth events while the current one is processed
+    readAhead = new DelphesReadAhead<DelphesHepMCReader, HepMCEvent>(reader, readAheadDepth);
+
+    // decompresses gzip and zstd input on a separate thread
+    inputStream = new DelphesInputStream;
+
     modularDelphes->InitTask();
 
     i = 3;
@@ -122,78 +146,66 @@ int main(int argc, char *argv[])
       if(i == argc || strncmp(argv[i], "-", 2) == 0)
       {
         cout << "** Reading standard input" << endl;
-        inputFile = stdin;
-        length = -1;
+        inputStream->Open("-");
       }
       else
       {
         cout << "** Reading " << argv[i] << endl;
-        inputFile = fopen(argv[i], "r");
-
-        if(inputFile == NULL)
-        {
-          message << "can't open " << argv[i];
-          throw runtime_error(message.str());
-        }
-
-        fseek(inputFile, 0L, SEEK_END);
-        length = ftello(inputFile);
-        fseek(inputFile, 0L, SEEK_SET);
+        inputStream->Open(argv[i]);
 
-        if(length <= 0)
+        if(inputStream->GetSize() <= 0)
         {
-          fclose(inputFile);
+          inputStream->Close();
           ++i;
           continue;
         }
       }
 
-      reader->SetInputFile(inputFile);
+      if(inputStream->GetFormat() != DelphesInputStream::kPlain)
+      {
+        cout << "** Decompressing " << inputStream->GetFormatName() << " input" << endl;
+      }
+
+      reader->SetInputFile(inputStream->GetFile());
 
-      ExRootProgressBar progressBar(length);
+      // progress in bytes of the file as stored
+      ExRootProgressBar progressBar(inputStream->GetSize());
 
       // Loop over all objects
       eventCounter = 0;
       treeWriter->Clear();
       modularDelphes->Clear();
       reader->Clear();
-      readStopWatch.Start();
+      readAhead->Start();
       while((maxEvents <= 0 || eventCounter - skipEvents < maxEvents) &&
-        reader->ReadBlock(factory, allParticleOutputArray,
+        readAhead->Next(factory, allParticleOutputArray,
         stableParticleOutputArray, partonOutputArray) && !interrupted)
       {
-        if(reader->EventReady())
-        {
-          ++eventCounter;
+        ++eventCounter;
 
-          readStopWatch.Stop();
-
-          if(eventCounter > skipEvents)
-          {
-            procStopWatch.Start();
-            modularDelphes->ProcessTask();
-            procStopWatch.Stop();
+        if(eventCounter > skipEvents)
+        {
+          procStopWatch.Start();
+          modularDelphes->ProcessTask();
+          procStopWatch.Stop();
 
-            reader->AnalyzeEvent(branchEvent, eventCounter, &readStopWatch, &procStopWatch);
+          readAhead->AnalyzeEvent(branchEvent, eventCounter, &procStopWatch);
 
-            treeWriter->Fill();
+          treeWriter->Fill();
 
-            treeWriter->Clear();
-          }
+          treeWriter->Clear();
+        }
 
-          modularDelphes->Clear();
-          reader->Clear();
+        modularDelphes->Clear();
 
-          readStopWatch.Start();
-        }
-        progressBar.Update(ftello(inputFile), eventCounter);
+        progressBar.Update(inputStream->GetPosition(), eventCounter);
       }
+      readAhead->Stop();
 
-      fseek(inputFile, 0L, SEEK_END);
-      progressBar.Update(ftello(inputFile), eventCounter, kTRUE);
+      progressBar.Update(inputStream->GetSize(), eventCounter, kTRUE);
       progressBar.Finish();
 
-      if(inputFile != stdin) fclose(inputFile);
+      inputStream->Close();
 
       ++i;
     }
@@ -202,8 +214,13 @@ int main(int argc, char *argv[])
     modularDelphes->FinishTask();
     treeWriter->Write();
 
+    readAhead->PrintSummary();
+    treeWriter->PrintSummary();
+
     cout << "** Exiting..." << endl;
 
+    delete readAhead;
+    delete inputStream;
     delete reader;
     delete modularDelphes;
     delete confReader;
@@ -214,6 +231,8 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(readAhead) delete readAhead;
+    if(inputStream) delete inputStream;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;
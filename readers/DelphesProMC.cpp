@@ -15,14 +15,14 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
 
 #include "modules/Delphes.h"
 #include "classes/DelphesStream.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
+#include "classes/DelphesReadAhead.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -36,51 +36,22 @@ using namespace std;
 
 //---------------------------------------------------------------------------
 
-void ConvertInput(ProMCEvent &event, ExRootTreeBranch *branch, DelphesFactory *factory,
-  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray,
-  TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+void ConvertInput(ProMCEvent &event, DelphesFactory *factory,
+  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray)
 {
   Int_t i;
 
-  ProMCEvent_Event *mutableEvent;
   ProMCEvent_Particles *mutableParticles;
 
-  HepMCEvent *element;
   Candidate *candidate;
-  TDatabasePDG *pdg;
-  TParticlePDG *pdgParticle;
+  const DelphesPDGTable *pdg;
   Int_t pdgCode;
 
   Int_t pid, status;
   Double_t px, py, pz, mass;
   Double_t x, y, z;
 
-  pdg = TDatabasePDG::Instance();
-
-  // event information
-  mutableEvent = event.mutable_event();
-
-  element = static_cast<HepMCEvent *>(branch->NewEntry());
-
-  element->Number = mutableEvent->number();
-
-  element->ProcessID = mutableEvent->process_id();
-  element->MPI = mutableEvent->mpi();
-  element->Weight = mutableEvent->weight();
-  element->Scale = mutableEvent->scale();
-  element->AlphaQED = mutableEvent->alpha_qed();
-  element->AlphaQCD = mutableEvent->alpha_qcd();
-
-  element->ID1 = mutableEvent->id1();
-  element->ID2 = mutableEvent->id2();
-  element->X1 = mutableEvent->x1();
-  element->X2 = mutableEvent->x2();
-  element->ScalePDF = mutableEvent->scale_pdf();
-  element->PDF1 = mutableEvent->pdf1();
-  element->PDF2 = mutableEvent->pdf2();
-
-  element->ReadTime = readStopWatch->RealTime();
-  element->ProcTime = procStopWatch->RealTime();
+  pdg = DelphesPDGTable::Instance();
 
   mutableParticles = event.mutable_particles();
 
@@ -104,8 +75,7 @@ void ConvertInput(ProMCEvent &event, ExRootTreeBranch *branch, DelphesFactory *f
     candidate->D1 = mutableParticles->daughter1(i);
     candidate->D2 = mutableParticles->daughter2(i);
 
-    pdgParticle = pdg->GetParticle(pid);
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    candidate->Charge = pdg->GetCharge(pid);
     candidate->Mass = mass;
 
     candidate->Momentum.SetXYZM(px, py, pz, mass);
@@ -114,7 +84,7 @@ void ConvertInput(ProMCEvent &event, ExRootTreeBranch *branch, DelphesFactory *f
 
     allParticleOutputArray->Add(candidate);
 
-    if(!pdgParticle) continue;
+    if(!pdg->IsKnown(pid)) continue;
 
     if(status == 1)
     {
@@ -129,6 +99,91 @@ void ConvertInput(ProMCEvent &event, ExRootTreeBranch *branch, DelphesFactory *f
 
 //---------------------------------------------------------------------------
 
+void ConvertEvent(ProMCEvent &event, ExRootTreeBranch *branch,
+  TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+{
+  ProMCEvent_Event *mutableEvent;
+  HepMCEvent *element;
+
+  mutableEvent = event.mutable_event();
+
+  element = static_cast<HepMCEvent *>(branch->NewEntry());
+
+  element->Number = mutableEvent->number();
+
+  element->ProcessID = mutableEvent->process_id();
+  element->MPI = mutableEvent->mpi();
+  element->Weight = mutableEvent->weight();
+  element->Scale = mutableEvent->scale();
+  element->AlphaQED = mutableEvent->alpha_qed();
+  element->AlphaQCD = mutableEvent->alpha_qcd();
+
+  element->ID1 = mutableEvent->id1();
+  element->ID2 = mutableEvent->id2();
+  element->X1 = mutableEvent->x1();
+  element->X2 = mutableEvent->x2();
+  element->ScalePDF = mutableEvent->scale_pdf();
+  element->PDF1 = mutableEvent->pdf1();
+  element->PDF2 = mutableEvent->pdf2();
+
+  element->ReadTime = readStopWatch->RealTime();
+  element->ProcTime = procStopWatch->RealTime();
+}
+
+//---------------------------------------------------------------------------
+
+// reads a ProMC book with the interface of the other readers, for DelphesReadAhead
+
+class ProMCReader
+{
+public:
+
+  ProMCReader() : fInputFile(0), fEvents(0), fCounter(0), fReady(false) {}
+
+  void SetInputFile(ProMCBook *inputFile)
+  {
+    fInputFile = inputFile;
+    fEvents = inputFile->getEvents();
+    fCounter = 0;
+  }
+
+  void Clear() { fReady = false; }
+  bool EventReady() { return fReady; }
+
+  bool ReadBlock(DelphesFactory *factory,
+    TObjArray *allParticleOutputArray,
+    TObjArray *stableParticleOutputArray,
+    TObjArray *partonOutputArray)
+  {
+    if(fCounter >= fEvents) return false;
+    ++fCounter;
+
+    if(fInputFile->next() != 0) return true;
+    fEvent = fInputFile->get();
+
+    ConvertInput(fEvent, factory,
+      allParticleOutputArray, stableParticleOutputArray, partonOutputArray);
+
+    fReady = true;
+    return true;
+  }
+
+  void AnalyzeEvent(ExRootTreeBranch *branch, long long eventNumber,
+    TStopwatch *readStopWatch, TStopwatch *procStopWatch)
+  {
+    ConvertEvent(fEvent, branch, readStopWatch, procStopWatch);
+  }
+
+private:
+
+  ProMCBook *fInputFile;
+  ProMCEvent fEvent;
+  Long64_t fEvents, fCounter;
+  bool fReady;
+};
+
+//---------------------------------------------------------------------------
+
 static bool interrupted = false;
 
 void SignalHandler(int sig)
@@ -144,14 +199,16 @@ int main(int argc, char *argv[])
   stringstream message;
   ProMCBook *inputFile = 0;
   TFile *outputFile = 0;
-  TStopwatch readStopWatch, procStopWatch;
+  TStopwatch procStopWatch;
   ExRootTreeWriter *treeWriter = 0;
   ExRootTreeBranch *branchEvent = 0;
   ExRootConfReader *confReader = 0;
   Delphes *modularDelphes = 0;
   DelphesFactory *factory = 0;
   TObjArray *allParticleOutputArray = 0, *stableParticleOutputArray = 0, *partonOutputArray = 0;
-  Int_t i;
+  ProMCReader *reader = 0;
+  DelphesReadAhead<ProMCReader, HepMCEvent> *readAhead = 0;
+  Int_t i, readAheadDepth;
   Long64_t eventCounter, numberOfEvents;
 
   if(argc < 4)
@@ -188,6 +245,13 @@ int main(int argc, char *argv[])
     confReader = new ExRootConfReader;
     confReader->ReadFile(argv[1]);
 
+    readAheadDepth = confReader->GetInt("::ReadAheadDepth", 0);
+
+    if(readAheadDepth < 0)
+    {
+      throw runtime_error("ReadAheadDepth must be zero or positive");
+    }
+
     modularDelphes = new Delphes("Delphes");
     modularDelphes->SetConfReader(confReader);
     modularDelphes->SetTreeWriter(treeWriter);
@@ -197,6 +261,11 @@ int main(int argc, char *argv[])
     stableParticleOutputArray = modularDelphes->ExportArray("stableParticles");
     partonOutputArray = modularDelphes->ExportArray("partons");
 
+    reader = new ProMCReader;
+
+    // read the next ReadAheadDepth events while the current one is processed
+    readAhead = new DelphesReadAhead<ProMCReader, HepMCEvent>(reader, readAheadDepth);
+
     modularDelphes->InitTask();
 
     for(i = 3; i < argc && !interrupted; ++i)
@@ -217,32 +286,30 @@ int main(int argc, char *argv[])
 
       ExRootProgressBar progressBar(numberOfEvents - 1);
 
+      reader->SetInputFile(inputFile);
+
       // Loop over all objects
       modularDelphes->Clear();
       treeWriter->Clear();
-      readStopWatch.Start();
-      for(eventCounter = 0; eventCounter < numberOfEvents && !interrupted; ++eventCounter)
+      reader->Clear();
+      readAhead->Start();
+      for(eventCounter = 0; !interrupted && readAhead->Next(factory, allParticleOutputArray,
+        stableParticleOutputArray, partonOutputArray); ++eventCounter)
       {
-        if(inputFile->next() != 0) continue;
-        ProMCEvent event = inputFile->get();
-
-        readStopWatch.Stop();
-
         procStopWatch.Start();
-        ConvertInput(event, branchEvent, factory,
-          allParticleOutputArray, stableParticleOutputArray, partonOutputArray,
-          &readStopWatch, &procStopWatch);
         modularDelphes->ProcessTask();
         procStopWatch.Stop();
 
+        readAhead->AnalyzeEvent(branchEvent, eventCounter + 1, &procStopWatch);
+
         treeWriter->Fill();
 
         modularDelphes->Clear();
         treeWriter->Clear();
 
-        readStopWatch.Start();
         progressBar.Update(eventCounter);
       }
+      readAhead->Stop();
 
       progressBar.Update(eventCounter, eventCounter, kTRUE);
       progressBar.Finish();
@@ -254,8 +321,13 @@ int main(int argc, char *argv[])
     modularDelphes->FinishTask();
     treeWriter->Write();
 
+    readAhead->PrintSummary();
+    treeWriter->PrintSummary();
+
     cout << "** Exiting..." << endl;
 
+    delete readAhead;
+    delete reader;
     delete modularDelphes;
     delete confReader;
     delete treeWriter;
@@ -265,6 +337,7 @@ int main(int argc, char *argv[])
   }
   catch(runtime_error &e)
   {
+    if(readAhead) delete readAhead;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     cerr << "** ERROR: " << e.what() << endl;
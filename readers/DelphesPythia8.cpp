@@ -13,13 +13,15 @@
 #include "TFile.h"
 #include "TObjArray.h"
 #include "TStopwatch.h"
-#include "TDatabasePDG.h"
-#include "TParticlePDG.h"
 #include "TLorentzVector.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
 
 #include "modules/Delphes.h"
 #include "classes/DelphesClasses.h"
 #include "classes/DelphesFactory.h"
+#include "classes/DelphesPDGTable.h"
 
 #include "ExRootAnalysis/ExRootTreeWriter.h"
 #include "ExRootAnalysis/ExRootTreeBranch.h"
@@ -37,21 +39,35 @@ void SignalHandler(int sig){
 }
 
 //**********************************************************
-//*** Method to filter LHE event on the fly and store info
+//*** Method to filter LHE event on the fly
 //**********************************************************
 bool LHEEventPreselection(const LHEF::Reader & reader, 
                           const float & Mjj_cut, 
-                          const int & SkimFullyHadronic, 
-                          DelphesFactory *factory, 
-                          ExRootTreeBranch* branch,
-                          TObjArray* LHEparticlesArray);
+                          const int & SkimFullyHadronic);
+
+//**********************************************************
+//*** Method to store the info of a selected LHE event
+//**********************************************************
+void ConvertLHEInput(const LHEF::HEPEUP & hepeup,
+                     DelphesFactory *factory,
+                     ExRootTreeBranch* branch,
+                     TObjArray* LHEparticlesArray);
+
+//*** event information kept from Pythia8 after hadronization
+struct HadronizationInfo {
+  int code, id1, id2;
+  double weight, QRen, QFac, alphaEM, alphaS, x1, x2, pdf1, pdf2;
+};
+
+void FillHadronizationInfo(Pythia8::Pythia* pythia, HadronizationInfo & info);
 
 //********************************************************************
 //*** Input Converter for Delphes (frpm Pythia8 to delphes particles)
 //********************************************************************
 
 void ConvertInput(Long64_t eventCounter, 
-                  Pythia8::Pythia* pythia,
+                  const HadronizationInfo & info,
+                  Pythia8::Event & event,
 		  ExRootTreeBranch *branch, 
                   DelphesFactory *factory,
 		  TObjArray *allParticleOutputArray, 
@@ -60,6 +76,71 @@ void ConvertInput(Long64_t eventCounter,
 		  TStopwatch *readStopWatch, 
                   TStopwatch *procStopWatch);
 
+//*****************************************************************************
+//*** Les Houches interface giving Pythia8 the events of an LHEF::Reader:
+//*** the file is parsed once, by the reader, and Pythia gets the event
+//*** held in hepeup (reader.hepeup, or a copy for a hadronization worker)
+//*****************************************************************************
+
+class LHEFReaderLHAup : public Pythia8::LHAup {
+
+ public:
+
+  LHEFReaderLHAup(const LHEF::HEPRUP *heprup, const LHEF::HEPEUP *hepeup) :
+    fHEPRUP(heprup), fHEPEUP(hepeup) {}
+
+  void SetHEPEUP(const LHEF::HEPEUP *hepeup) { fHEPEUP = hepeup; }
+
+  bool setInit();
+  bool setEvent(int idProcIn = 0);
+
+ private:
+
+  const LHEF::HEPRUP *fHEPRUP;
+  const LHEF::HEPEUP *fHEPEUP;
+};
+
+//*****************************************************************************
+//*** Hadronization workers: each owns a Pythia instance and a ring of slots.
+//*** Selected LHE events are given to the workers in turn and taken back in
+//*** the same turn, so Delphes sees them in the order of the file
+//*****************************************************************************
+
+struct HadronizationSlot {
+  LHEF::HEPEUP hepeup;
+  Long64_t number;
+  bool ok;
+  HadronizationInfo info;
+  Pythia8::Event event;
+};
+
+struct HadronizationWorker {
+  Pythia8::Pythia *pythia;
+  LHEFReaderLHAup *lhaUp;
+
+  TThread *thread;
+  TMutex *mutex;
+  TCondition *queued, *hadronized;
+
+  //--- slots [tail, next) are hadronized, [next, head) wait for Pythia
+  std::vector<HadronizationSlot> slots;
+  int head, next, tail;
+  int waiting, done;
+  bool stop;
+};
+
+void *HadronizeThread(void *worker);
+
+//*** reads LHE events until one passes the preselection, false at the end
+//*** of the file or once the requested number of events has been read
+bool ReadSelectedEvent(LHEF::Reader & reader,
+                       const float & Mjj_cut,
+                       const int & SkimFullyHadronic,
+                       int startEvent, int nEvent,
+                       Long64_t & startCounter, Long64_t & eventCounter,
+                       int & skippedCounter, ExRootProgressBar & progressBar,
+                       Long64_t & number);
+
 //*******************************************************************************************************************
 // main code : ./DelphesPythia8 <delphes_card> <lhe file> <output root file> <mjj cut> <filter fully hadronic FS> <starting event> <total event>
 //*******************************************************************************************************************
@@ -106,6 +187,8 @@ int main(int argc, char *argv[]){
 
   // parsing input parameters
   ExRootTreeWriter *treeWriter = 0;
+  Pythia8::Pythia *pythia = 0;
+  LHEFReaderLHAup *lhaUp = 0;
   try{
 
     inputFile  = argv[2]; // input file name for LHE
@@ -156,40 +239,97 @@ int main(int argc, char *argv[]){
     TObjArray *LHEparticlesArray         = modularDelphes->ExportArray("LHEParticles");
 
     modularDelphes->InitTask();
-   
+
     //------------------------------------------------------------
-    //----- initialize fast lhe file reader for preselection -----
+    //----- LHE file reader, parses the file for preselection ----
+    //----- and for Pythia                                    ----
     //------------------------------------------------------------
 
-    std::ifstream inputLHE (inputFile.c_str(), ios::in); // read the input LHE file  
+    LHEF::Reader Reader (inputFile);
     int skippedCounter = 0;
 
     //-----------------------------
     //----- Initialize pythia -----
     //-----------------------------
-    TStopwatch readStopWatch, procStopWatch;
-    Long64_t eventCounter, errorCounter, startCounter;
+    TStopwatch readStopWatch, procStopWatch, stallStopWatch;
+    Long64_t eventCounter, errorCounter, startCounter, number, stalls;
 
-    Pythia8::Pythia *pythia = new Pythia8::Pythia;        
+    //--- PythiaThreads > 0 hadronizes on that many threads, each with its own Pythia
+    int pythiaThreads = confReader->GetInt("::PythiaThreads", 0);
+    int randomSeed = confReader->GetInt("::RandomSeed", 0);
 
-    if(pythia == NULL or pythia == 0){
-      throw runtime_error("can't create Pythia instance");
-    }
+    HadronizationWorker *workers = 0;
 
-    //--- Initialize Les Houches Event File run. List initialization information.
-    std::string sRandomSeed = "Random:seed = "+sSeed;
-    //--- random seed from start event number
-    pythia->readString("Random:setSeed = on");
+    if(pythiaThreads <= 0){
 
-    pythia->readString("HadronLevel:Hadronize = on"); // turn on the hadronize module
+      pythia = new Pythia8::Pythia;
 
-    pythia->readString(sRandomSeed.c_str());          // random seed set
-    pythia->readString("Beams:frameType = 4");        
-    pythia->readString(("Beams:LHEF = "+inputFile).c_str());
-    pythia->init();
-    
-    if(pythia->LHAeventSkip(startEvent)){
-      std::cout << "### skipped first " << startEvent << " events" << std::endl;
+      if(pythia == NULL or pythia == 0){
+        throw runtime_error("can't create Pythia instance");
+      }
+
+      //--- Initialize Les Houches Event File run. List initialization information.
+      std::string sRandomSeed = "Random:seed = "+sSeed;
+      //--- random seed from start event number
+      pythia->readString("Random:setSeed = on");
+
+      pythia->readString("HadronLevel:Hadronize = on"); // turn on the hadronize module
+
+      pythia->readString(sRandomSeed.c_str());          // random seed set
+
+      //--- events come from Reader, Pythia does not open the file
+      lhaUp = new LHEFReaderLHAup(&Reader.heprup, &Reader.hepeup);
+      pythia->setLHAupPtr(lhaUp);
+      pythia->readString("Beams:frameType = 5");
+
+      if(!pythia->init()){
+        std::stringstream message;
+        message << "can't initialize Pythia with " << inputFile;
+        throw runtime_error(message.str());
+      }
+    }
+    else{
+
+      TThread::Initialize();
+      workers = new HadronizationWorker[pythiaThreads];
+      for(int i = 0; i < pythiaThreads; ++i){
+        HadronizationWorker *worker = &workers[i];
+
+        //--- worker i of a job starting at event start is seeded with
+        //--- RandomSeed + start*PythiaThreads + i + 1 (modulo 900000000, the Pythia limit):
+        //--- - the seed depends only on the worker index, not on thread timing,
+        //---   so a job gives the same events on every run;
+        //--- - jobs with different start events use disjoint seed ranges
+        //---   [RandomSeed + start*PythiaThreads + 1, RandomSeed + (start + 1)*PythiaThreads]
+        std::stringstream seed;
+        seed << "Random:seed = " << (randomSeed + Long64_t(startEvent)*pythiaThreads + i + 1) % 900000000;
+
+        worker->pythia = new Pythia8::Pythia;
+        worker->pythia->readString("Random:setSeed = on");
+        worker->pythia->readString("HadronLevel:Hadronize = on");
+        worker->pythia->readString(seed.str());
+
+        worker->lhaUp = new LHEFReaderLHAup(&Reader.heprup, 0);
+        worker->pythia->setLHAupPtr(worker->lhaUp);
+        worker->pythia->readString("Beams:frameType = 5");
+
+        if(!worker->pythia->init()){
+          std::stringstream message;
+          message << "can't initialize Pythia with " << inputFile;
+          throw runtime_error(message.str());
+        }
+
+        worker->slots.resize(4);
+        worker->head = worker->next = worker->tail = 0;
+        worker->waiting = worker->done = 0;
+        worker->stop = false;
+
+        worker->mutex = new TMutex;
+        worker->queued = new TCondition(worker->mutex);
+        worker->hadronized = new TCondition(worker->mutex);
+        worker->thread = new TThread(HadronizeThread, worker);
+        worker->thread->Run();
+      }
     }
 
     ExRootProgressBar progressBar(-1);
@@ -198,51 +338,134 @@ int main(int argc, char *argv[]){
     errorCounter = 0;
     eventCounter = 0;
     startCounter = 0;
+    stalls = 0;
     modularDelphes->Clear();
     readStopWatch.Start();
 
-    // read LHE info
-    std::ifstream InputLHE (inputFile.c_str(), ios::in); // read the input LHE file                                                                                        
-    LHEF::Reader Reader (InputLHE) ;
+    int nextFill = 0, nextTake = 0, pending = 0;
+    bool endOfInput = false;
 
-    while (Reader.readEvent ()){
-     if( startCounter < startEvent ) {
-       startCounter++;
-       continue;
-     }
-     if(eventCounter >= nEvent && nEvent != -1) break;                  
-      if(LHEEventPreselection(Reader,Mjj_cut,skimFullyHadronic,factory,branchEventLHE,LHEparticlesArray)){  // take only interesting events
-	  if(!pythia->next()){
-	    //--- If failure because reached end of file then exit event loop
-	    if (pythia->info.atEndOfFile()){
-	      std::cerr << "Aborted since reached end of Les Houches Event File" << std::endl;
-	      break;
-	    }
-	    //--- keep trace of faulty events
-	    errorCounter++;
-	  }
-
-	  readStopWatch.Stop();
-	  //--- delphes simulation fase
-	  procStopWatch.Start();
-	  ConvertInput(eventCounter,pythia,branchEventHEPMC,factory,allParticleOutputArray,stableParticleOutputArray,partonOutputArray,&readStopWatch,&procStopWatch);
-	  modularDelphes->ProcessTask();
-	  procStopWatch.Stop();
-
-	  //--- filling the output tree
-	  treeWriter->Fill();
-    
-	  //--- logistic 
-	  treeWriter->Clear();
-	  modularDelphes->Clear();
-	  readStopWatch.Start();
-       }
-       else{		
-	  if(pythia->LHAeventSkip(1)) skippedCounter++;
-	  else std::cout << "### ERROR: couldn't skip event" << endl;
-       }                
-       eventCounter++;
-       progressBar.Update(eventCounter, eventCounter);
+    while(true){
+
+      HadronizationInfo info;
+      HadronizationSlot *slot = 0;
+      Pythia8::Event *event = 0;
+
+      if(!workers){
+        if(!ReadSelectedEvent(Reader,Mjj_cut,skimFullyHadronic,startEvent,nEvent,startCounter,eventCounter,skippedCounter,progressBar,number)) break;
+
+        //--- Pythia showers and hadronizes the event held by Reader
+        if(!pythia->next()){
+          //--- keep trace of faulty events
+          errorCounter++;
+        }
+        FillHadronizationInfo(pythia, info);
+        event = &pythia->event;
+      }
+      else{
+        //--- give selected events to the workers in turn while the next one has a free slot
+        while(!endOfInput){
+          HadronizationWorker *worker = &workers[nextFill];
+          worker->mutex->Lock();
+          bool full = (worker->waiting + worker->done == int(worker->slots.size()));
+          worker->mutex->UnLock();
+          if(full) break;
+
+          if(!ReadSelectedEvent(Reader,Mjj_cut,skimFullyHadronic,startEvent,nEvent,startCounter,eventCounter,skippedCounter,progressBar,number)){
+            endOfInput = true;
+            break;
+          }
+
+          //--- the slot is free, the worker does not look at it before it is queued
+          worker->slots[worker->head].hepeup.setEvent(Reader.hepeup);
+          worker->slots[worker->head].number = number;
+
+          worker->mutex->Lock();
+          worker->head = (worker->head + 1) % worker->slots.size();
+          ++worker->waiting;
+          worker->queued->Signal();
+          worker->mutex->UnLock();
+
+          nextFill = (nextFill + 1) % pythiaThreads;
+          ++pending;
+        }
+
+        if(pending == 0) break;
+
+        //--- take back the oldest event, from the worker it was given to
+        HadronizationWorker *worker = &workers[nextTake];
+        worker->mutex->Lock();
+        if(worker->done == 0){
+          ++stalls;
+          stallStopWatch.Start(kFALSE);
+          while(worker->done == 0) worker->hadronized->Wait();
+          stallStopWatch.Stop();
+        }
+        worker->mutex->UnLock();
+
+        slot = &worker->slots[worker->tail];
+        if(!slot->ok){
+          //--- keep trace of faulty events
+          errorCounter++;
+        }
+        number = slot->number;
+        info = slot->info;
+        event = &slot->event;
+      }
+
+      readStopWatch.Stop();
+      //--- delphes simulation fase
+      procStopWatch.Start();
+      ConvertLHEInput(slot ? slot->hepeup : Reader.hepeup,factory,branchEventLHE,LHEparticlesArray);
+      ConvertInput(number,info,*event,branchEventHEPMC,factory,allParticleOutputArray,stableParticleOutputArray,partonOutputArray,&readStopWatch,&procStopWatch);
+      modularDelphes->ProcessTask();
+      procStopWatch.Stop();
+
+      //--- filling the output tree
+      treeWriter->Fill();
+
+      //--- logistic
+      treeWriter->Clear();
+      modularDelphes->Clear();
+
+      if(slot){
+        //--- the slot can take a new event
+        HadronizationWorker *worker = &workers[nextTake];
+        worker->mutex->Lock();
+        worker->tail = (worker->tail + 1) % worker->slots.size();
+        --worker->done;
+        worker->mutex->UnLock();
+
+        nextTake = (nextTake + 1) % pythiaThreads;
+        --pending;
+      }
+
+      readStopWatch.Start();
+    }
+
+    if(workers){
+      for(int i = 0; i < pythiaThreads; ++i){
+        HadronizationWorker *worker = &workers[i];
+
+        worker->mutex->Lock();
+        worker->stop = true;
+        worker->queued->Signal();
+        worker->mutex->UnLock();
+
+        worker->thread->Join();
+
+        delete worker->thread;
+        delete worker->hadronized;
+        delete worker->queued;
+        delete worker->mutex;
+        delete worker->pythia;
+        delete worker->lhaUp;
+      }
+      delete[] workers;
+
+      //--- stalls mean that Delphes waited for the hadronization
+      std::cout << "** INFO: hadronized on " << pythiaThreads << " threads, Delphes waited " << stalls;
+      std::cout << " times (" << stallStopWatch.RealTime() << " s)" << std::endl;
     }
 
     progressBar.Update(eventCounter, eventCounter, kTRUE);
@@ -257,16 +480,20 @@ int main(int argc, char *argv[]){
         
     modularDelphes->FinishTask();
     treeWriter->Write();
+    treeWriter->PrintSummary();
     
     std::cout << std::endl <<  "** Exiting..." << std::endl;
 
     delete pythia;
+    delete lhaUp;
     delete confReader;
 
     return 0;
   }
   
   catch(runtime_error &e){
+    if(pythia) delete pythia;
+    if(lhaUp) delete lhaUp;
     if(treeWriter) delete treeWriter;
     if(outputFile) delete outputFile;
     std::cerr << "** ERROR: " << e.what() << std::endl;
@@ -277,8 +504,7 @@ int main(int argc, char *argv[]){
 }
 
 // *****************************************************************************************************
-bool LHEEventPreselection(const LHEF::Reader & reader, const float & Mjj_cut, const int & SkimFullyHadronic,  DelphesFactory *factory, 
-                          ExRootTreeBranch* branch, TObjArray* LHEparticlesArray){
+bool LHEEventPreselection(const LHEF::Reader & reader, const float & Mjj_cut, const int & SkimFullyHadronic){
 
   if ( reader.outsideBlock.length ()) std::cout << reader.outsideBlock; 
 
@@ -286,13 +512,6 @@ bool LHEEventPreselection(const LHEF::Reader & reader, const float & Mjj_cut, co
   int leptons   = 0;
   int Mjj_check = 0;
 
-  TParticlePDG *pdgParticle = 0;
-  TDatabasePDG *pdg = 0;
-
-  pdg = TDatabasePDG::Instance();
-
-  Candidate *candidate = 0;
-  
 
   // loop over particles in the event                                                                                                                                                   
   for (size_t iPart = 0 ; iPart < reader.hepeup.IDUP.size (); ++iPart){
@@ -328,36 +547,47 @@ bool LHEEventPreselection(const LHEF::Reader & reader, const float & Mjj_cut, co
     return false;
   }
 
-  
+  return true;
+}
+
+// *****************************************************************************************************
+void ConvertLHEInput(const LHEF::HEPEUP & hepeup, DelphesFactory *factory,
+                     ExRootTreeBranch* branch, TObjArray* LHEparticlesArray){
+
+  const DelphesPDGTable *pdg = 0;
+
+  pdg = DelphesPDGTable::Instance();
+
+  Candidate *candidate = 0;
+
   //---loop on lhe events particle searching for W's---
   LHEFEvent *lheEvt;
   lheEvt = static_cast<LHEFEvent *>(branch->NewEntry());
-  lheEvt->ProcessID = reader.hepeup.IDPRUP ;
-  lheEvt->Weight    = reader.hepeup.XWGTUP ;
-  lheEvt->ScalePDF  = reader.hepeup.SCALUP ;
-  lheEvt->AlphaQED  = reader.hepeup.AQEDUP ;
-  lheEvt->AlphaQCD  = reader.hepeup.AQCDUP ;
+  lheEvt->ProcessID = hepeup.IDPRUP ;
+  lheEvt->Weight    = hepeup.XWGTUP ;
+  lheEvt->ScalePDF  = hepeup.SCALUP ;
+  lheEvt->AlphaQED  = hepeup.AQEDUP ;
+  lheEvt->AlphaQCD  = hepeup.AQCDUP ;
   
 
-  for (size_t iPart = 0 ; iPart < reader.hepeup.IDUP.size (); ++iPart){
+  for (size_t iPart = 0 ; iPart < hepeup.IDUP.size (); ++iPart){
     TLorentzVector tmp4vect;
-    tmp4vect.SetPxPyPzE(reader.hepeup.PUP.at(iPart).at(0),reader.hepeup.PUP.at(iPart).at(1),reader.hepeup.PUP.at(iPart).at(2),reader.hepeup.PUP.at(iPart).at(3)); 
+    tmp4vect.SetPxPyPzE(hepeup.PUP.at(iPart).at(0),hepeup.PUP.at(iPart).at(1),hepeup.PUP.at(iPart).at(2),hepeup.PUP.at(iPart).at(3)); 
     
     // for each particle in the LHE we can store the info in the treeWriter and the making branches in the dumper
     candidate = factory->NewCandidate();
-    candidate->PID    = reader.hepeup.IDUP.at(iPart);
-    candidate->Status = reader.hepeup.ISTUP.at(iPart);
+    candidate->PID    = hepeup.IDUP.at(iPart);
+    candidate->Status = hepeup.ISTUP.at(iPart);
 
     // mother and  daughters are not set
-    candidate->M1 = reader.hepeup.MOTHUP.at(iPart).first;
-    candidate->M2 = reader.hepeup.MOTHUP.at(iPart).second;
+    candidate->M1 = hepeup.MOTHUP.at(iPart).first;
+    candidate->M2 = hepeup.MOTHUP.at(iPart).second;
     candidate->D1 = -1;
     candidate->D2 = -1;
 
-    candidate->Spin = reader.hepeup.SPINUP.at(iPart) ;
+    candidate->Spin = hepeup.SPINUP.at(iPart) ;
  
-    pdgParticle = pdg->GetParticle(reader.hepeup.IDUP.at(iPart));
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    candidate->Charge = pdg->GetCharge(hepeup.IDUP.at(iPart));
 
     // store mass and 4V 
     candidate->Mass = tmp4vect.M();
@@ -366,22 +596,36 @@ bool LHEEventPreselection(const LHEF::Reader & reader, const float & Mjj_cut, co
 
     LHEparticlesArray->Add(candidate);
   }
+}
 
-  return true;
-  
+// *****************************************************************************************************************
+
+void FillHadronizationInfo(Pythia8::Pythia* pythia, HadronizationInfo & info){
+
+  info.code    = pythia->info.code();
+  info.weight  = pythia->info.weight();
+  info.QRen    = pythia->info.QRen();
+  info.QFac    = pythia->info.QFac();
+  info.alphaEM = pythia->info.alphaEM();
+  info.alphaS  = pythia->info.alphaS();
+  info.id1  = pythia->info.id1();
+  info.id2  = pythia->info.id2();
+  info.x1   = pythia->info.x1();
+  info.x2   = pythia->info.x2();
+  info.pdf1 = pythia->info.pdf1();
+  info.pdf2 = pythia->info.pdf2();
 }
 
 // *****************************************************************************************************************
 
-void ConvertInput(Long64_t eventCounter, Pythia8::Pythia* pythia,
+void ConvertInput(Long64_t eventCounter, const HadronizationInfo & info, Pythia8::Event & event,
 		  ExRootTreeBranch *branch, DelphesFactory *factory,
 		  TObjArray *allParticleOutputArray, TObjArray *stableParticleOutputArray, TObjArray *partonOutputArray,
 		  TStopwatch *readStopWatch, TStopwatch *procStopWatch){
 
   HepMCEvent *element  = 0;
   Candidate *candidate = 0;
-  TDatabasePDG *pdg = 0; 
-  TParticlePDG *pdgParticle = 0;
+  const DelphesPDGTable *pdg = 0;
   Int_t pdgCode;
 
   Int_t pid, status;
@@ -393,29 +637,29 @@ void ConvertInput(Long64_t eventCounter, Pythia8::Pythia* pythia,
 
   element->Number = eventCounter;
 
-  element->ProcessID = pythia->info.code();
+  element->ProcessID = info.code;
   element->MPI       = 1;
-  element->Weight    = pythia->info.weight();
-  element->Scale     = pythia->info.QRen();
-  element->AlphaQED  = pythia->info.alphaEM();
-  element->AlphaQCD  = pythia->info.alphaS();
-
-  element->ID1 = pythia->info.id1();
-  element->ID2 = pythia->info.id2();
-  element->X1  = pythia->info.x1();
-  element->X2  = pythia->info.x2();
-  element->ScalePDF = pythia->info.QFac();
-  element->PDF1 = pythia->info.pdf1();
-  element->PDF2 = pythia->info.pdf2();
+  element->Weight    = info.weight;
+  element->Scale     = info.QRen;
+  element->AlphaQED  = info.alphaEM;
+  element->AlphaQCD  = info.alphaS;
+
+  element->ID1 = info.id1;
+  element->ID2 = info.id2;
+  element->X1  = info.x1;
+  element->X2  = info.x2;
+  element->ScalePDF = info.QFac;
+  element->PDF1 = info.pdf1;
+  element->PDF2 = info.pdf2;
 
   element->ReadTime = readStopWatch->RealTime();
   element->ProcTime = procStopWatch->RealTime();
 
-  pdg = TDatabasePDG::Instance();
+  pdg = DelphesPDGTable::Instance();
   
-  for(int i = 0; i < int(pythia->event.size()); ++i){
+  for(int i = 0; i < int(event.size()); ++i){
 
-    Pythia8::Particle &particle = pythia->event[i];
+    Pythia8::Particle &particle = event[i];
         
     pid    = particle.id();
     status = particle.statusHepMC();
@@ -441,8 +685,7 @@ void ConvertInput(Long64_t eventCounter, Pythia8::Pythia* pythia,
     candidate->D1 = particle.daughter1() - 1;
     candidate->D2 = particle.daughter2() - 1;
 
-    pdgParticle = pdg->GetParticle(pid);
-    candidate->Charge = pdgParticle ? Int_t(pdgParticle->Charge()/3.0) : -999;
+    candidate->Charge = pdg->GetCharge(pid);
     candidate->Mass = mass;
 
     candidate->Momentum.SetPxPyPzE(px, py, pz, e);
@@ -459,5 +702,135 @@ void ConvertInput(Long64_t eventCounter, Pythia8::Pythia* pythia,
   }
 }
 
+// *****************************************************************************************************************
+
+bool LHEFReaderLHAup::setInit(){
+
+  const LHEF::HEPRUP &heprup = *fHEPRUP;
+
+  setBeamA(heprup.IDBMUP.first, heprup.EBMUP.first, heprup.PDFGUP.first, heprup.PDFSUP.first);
+  setBeamB(heprup.IDBMUP.second, heprup.EBMUP.second, heprup.PDFGUP.second, heprup.PDFSUP.second);
+
+  setStrategy(heprup.IDWTUP);
+
+  for(int i = 0; i < heprup.NPRUP; ++i){
+    addProcess(heprup.LPRUP[i], heprup.XSECUP[i], heprup.XERRUP[i], heprup.XMAXUP[i]);
+  }
+
+  return true;
+}
+
+// *****************************************************************************************************************
+
+bool LHEFReaderLHAup::setEvent(int idProcIn){
+
+  // Pythia may call this more than once for the same event when it retries,
+  // setProcess starts the event from scratch each time
+  const LHEF::HEPEUP &hepeup = *fHEPEUP;
+  const LHEF::HEPRUP &heprup = *fHEPRUP;
 
+  setProcess(hepeup.IDPRUP, hepeup.XWGTUP, hepeup.SCALUP, hepeup.AQEDUP, hepeup.AQCDUP);
+
+  int id1 = 0, id2 = 0, incoming = 0;
+  double x1 = 0.0, x2 = 0.0;
+
+  for(int i = 0; i < hepeup.NUP; ++i){
+    addParticle(hepeup.IDUP[i], hepeup.ISTUP[i],
+                hepeup.MOTHUP[i].first, hepeup.MOTHUP[i].second,
+                hepeup.ICOLUP[i].first, hepeup.ICOLUP[i].second,
+                hepeup.PUP[i][0], hepeup.PUP[i][1], hepeup.PUP[i][2], hepeup.PUP[i][3], hepeup.PUP[i][4],
+                hepeup.VTIMUP[i], hepeup.SPINUP[i]);
+
+    //--- the incoming partons give the momentum fractions, as in Pythia's own LHEF reader
+    if(hepeup.ISTUP[i] == -1 && incoming < 2){
+      if(incoming == 0){
+        id1 = hepeup.IDUP[i];
+        x1  = heprup.EBMUP.first > 0.0 ? hepeup.PUP[i][3]/heprup.EBMUP.first : 0.0;
+      }
+      else{
+        id2 = hepeup.IDUP[i];
+        x2  = heprup.EBMUP.second > 0.0 ? hepeup.PUP[i][3]/heprup.EBMUP.second : 0.0;
+      }
+      ++incoming;
+    }
+  }
 
+  setIdX(id1, id2, x1, x2);
+
+  //--- PDF information, from a pdfinfo tag or from a #pdf comment line
+  const LHEF::PDFInfo &pdfinfo = hepeup.pdfinfo;
+  if(pdfinfo.p1 != 0 || pdfinfo.p2 != 0){
+    setPdf(pdfinfo.p1, pdfinfo.p2, pdfinfo.x1, pdfinfo.x2, pdfinfo.scale, pdfinfo.xf1, pdfinfo.xf2, true);
+  }
+  else{
+    size_t position = hepeup.junk.find("#pdf");
+    if(position != std::string::npos){
+      std::istringstream line(hepeup.junk.substr(position + 4));
+      int id1pdf, id2pdf;
+      double x1pdf, x2pdf, scalePDF, pdf1, pdf2;
+      if(line >> id1pdf >> id2pdf >> x1pdf >> x2pdf >> scalePDF >> pdf1 >> pdf2){
+        setPdf(id1pdf, id2pdf, x1pdf, x2pdf, scalePDF, pdf1, pdf2, true);
+      }
+    }
+  }
+
+  return true;
+}
+
+// *****************************************************************************************************************
+
+bool ReadSelectedEvent(LHEF::Reader & reader, const float & Mjj_cut, const int & SkimFullyHadronic,
+                       int startEvent, int nEvent, Long64_t & startCounter, Long64_t & eventCounter,
+                       int & skippedCounter, ExRootProgressBar & progressBar, Long64_t & number){
+
+  while (reader.readEvent ()){
+    if( startCounter < startEvent ) {
+      startCounter++;
+      continue;
+    }
+    if(eventCounter >= nEvent && nEvent != -1) return false;
+
+    number = eventCounter++;
+    progressBar.Update(eventCounter, eventCounter);
+
+    if(LHEEventPreselection(reader,Mjj_cut,SkimFullyHadronic)) return true;  // take only interesting events
+
+    skippedCounter++;
+  }
+
+  return false;
+}
+
+// *****************************************************************************************************************
+
+void *HadronizeThread(void *arg){
+
+  HadronizationWorker *worker = static_cast<HadronizationWorker *>(arg);
+
+  while(true){
+
+    worker->mutex->Lock();
+    while(worker->waiting == 0 && !worker->stop) worker->queued->Wait();
+    if(worker->waiting == 0){
+      worker->mutex->UnLock();
+      break;
+    }
+    HadronizationSlot *slot = &worker->slots[worker->next];
+    worker->mutex->UnLock();
+
+    //--- Pythia showers and hadronizes the event of the slot
+    worker->lhaUp->SetHEPEUP(&slot->hepeup);
+    slot->ok = worker->pythia->next();
+    FillHadronizationInfo(worker->pythia, slot->info);
+    slot->event = worker->pythia->event;
+
+    worker->mutex->Lock();
+    worker->next = (worker->next + 1) % worker->slots.size();
+    --worker->waiting;
+    ++worker->done;
+    worker->hadronized->Signal();
+    worker->mutex->UnLock();
+  }
+
+  return 0;
+}